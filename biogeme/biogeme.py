@@ -16,6 +16,7 @@
 # pylint: disable=too-many-instance-attributes, too-many-lines,
 # pylint: disable=too-many-function-args
 
+import os
 import multiprocessing as mp
 from datetime import datetime
 import pickle
@@ -54,7 +55,10 @@ class BIOGEME:
                  skipAudit=False,
                  removeUnusedVariables=True,
                  suggestScales=True,
-                 missingData=99999):
+                 missingData=99999,
+                 cacheDirectory=None,
+                 storeDraws=True,
+                 singlePrecisionDraws=False):
         """Constructor
 
         :param database: choice data.
@@ -99,7 +103,8 @@ class BIOGEME:
         :type skipAudit: bool
 
         :param removeUnusedVariables: if True, all variables not used
-           in the expression are removed from the database. Default:
+           in the expression are not transferred to the C++
+           engine. The database itself is not modified. Default:
            True.
         :type removeUnusedVariables: bool
 
@@ -111,6 +116,33 @@ class BIOGEME:
            triggered. Default: 99999.
         :type missingData: float
 
+        :param cacheDirectory: if not None, name of a directory where
+           the formulas, once parsed by the C++ engine, are stored in
+           binary form. The next runs with the same formulas read
+           them from there instead of parsing them again. If the
+           draws are stored, all their types are native, and a seed
+           has been provided, they are also stored in this directory,
+           and the next runs with the same types of draws, sample
+           size, number of draws and seed map the file in memory
+           instead of generating them again. Without a seed, the
+           draws differ at each run and are not stored. The directory
+           is created if needed. Default: None.
+        :type cacheDirectory: str
+
+        :param storeDraws: if True, the draws for Monte-Carlo
+           integration are generated by the database and stored in
+           memory, for each individual. If False, and if all types
+           of draws are native, the C++ engine generates each draw
+           when it is needed, from a seed, and nothing is stored.
+           Default: True.
+        :type storeDraws: bool
+
+        :param singlePrecisionDraws: if True, the stored draws are
+           kept in single precision by the C++ engine, which divides
+           their memory by two. The calculations are still performed
+           in double precision. Default: False.
+        :type singlePrecisionDraws: bool
+
         """
 
         ## Logger that controls the output of messages to the screen and log file.
@@ -134,6 +166,8 @@ class BIOGEME:
         # Monte-Carlo integration.
         self.monteCarlo = False
         np.random.seed(seed)
+        ## Seed of the pseudo-random generators. None if not provided.
+        self.seed = seed
         ## If not None, it is the name of a file. The values of the
         ## estimated parameters are saved on that file each time the
         ## likelihood function is improved.
@@ -199,14 +233,19 @@ class BIOGEME:
             self.usedVariables |= f.setOfVariables()
         if self.database.isPanel():
             self.usedVariables.add(self.database.panelColumn)
+        ## Columns of the database transferred to the C++ engine.
+        self.engineColumns = list(self.database.data.columns)
         if removeUnusedVariables:
             unusedVariables = set(self.database.data.columns) - self.usedVariables
             error_msg = (f'Remove {len(unusedVariables)} '
                          'unused variables from the database '
                          f'as only {len(self.usedVariables)} are used.')
             self.logger.general(error_msg)
-            self.database.data = \
-                self.database.data.drop(columns=list(unusedVariables))
+            # The columns are removed only from the data transferred
+            # to the engine, so that the database can be used by
+            # other BIOGEME objects.
+            self.engineColumns = [c for c in self.engineColumns
+                                  if c in self.usedVariables]
 
 
                 
@@ -228,6 +267,10 @@ class BIOGEME:
             self._audit()
 
         self.theC = cb.pyBiogeme()
+        # The sampling of batches in the C++ engine is seeded from
+        # the seed defined above, using a separate generator so that
+        # the global numpy stream used for the draws is not affected.
+        self.theC.setSeed(np.random.RandomState(seed).randint(0, 2**31 - 1))
 
         self._prepareDatabaseForFormula()
         self._prepareLiterals()
@@ -244,10 +287,17 @@ class BIOGEME:
 
         ## Number of threads used for parallel computing. Default: the number of CPU available.
         self.numberOfThreads = mp.cpu_count() if numberOfThreads is None else numberOfThreads
+        ## If False, the draws are generated by the C++ engine when needed.
+        self.storeDraws = storeDraws
+        ## If True, the C++ engine stores the draws in single precision.
+        self.singlePrecisionDraws = singlePrecisionDraws
+        ## Directory where the formulas and the draws are stored.
+        self.cacheDirectory = cacheDirectory
+        if cacheDirectory is not None:
+            os.makedirs(cacheDirectory, exist_ok=True)
+            self.theC.setCacheDirectory(cacheDirectory)
         start_time = datetime.now()
         self._generateDraws(numberOfDraws)
-        if self.monteCarlo:
-            self.theC.setDraws(self.database.theDraws)
         ## Time needed to generate the draws.
         self.drawsProcessingTime = datetime.now() - start_time
         if self.loglike is not None:
@@ -322,50 +372,101 @@ class BIOGEME:
         self.numberOfDraws = numberOfDraws
         ## Draws
         self.monteCarlo = len(self.allDraws) > 0
-        if self.monteCarlo:
-            self.database.generateDraws(self.allDraws,
-                                        self.drawNames,
-                                        numberOfDraws)
+        if not self.monteCarlo:
+            return
+        native = self.database.nativeRandomNumberGenerators
+        userDefined = [name for name in self.drawNames
+                       if self.allDraws[name] not in native]
+        if not self.storeDraws and not userDefined:
+            # The draws are generated by the C++ engine, one at a
+            # time, from a seed. The seed is obtained from numpy, so
+            # that the seed of the BIOGEME object controls it.
+            types = [self.allDraws[name] for name in self.drawNames]
+            self.database.numberOfDraws = numberOfDraws
+            self.database.typesOfDraws.update(self.allDraws)
+            self.theC.setDrawGenerator(types,
+                                       numberOfDraws,
+                                       np.random.randint(0, 2**31 - 1))
+            return
+        if not self.storeDraws:
+            self.logger.warning(f'Draws {userDefined} are generated by '
+                                f'user defined functions. All draws are '
+                                f'stored in memory.')
+        if all(self.database.isSharedDrawType(self.allDraws[name])
+               for name in self.drawNames):
+            # Only the base sequences and the shifts of the
+            # individuals are stored.
+            base, shifts = \
+                self.database.generateSharedDraws(self.allDraws,
+                                                  self.drawNames,
+                                                  numberOfDraws)
+            self.theC.setSharedDraws(base,
+                                     shifts,
+                                     [self.allDraws[name]
+                                      for name in self.drawNames])
+            return
+        if self.cacheDirectory is not None and self.seed is not None \
+           and not userDefined:
+            # The draws are generated by the C++ engine, and stored
+            # in the cache directory, or read from there if they have
+            # already been generated by a previous run. Without a
+            # seed, the file would never be used again.
+            types = [self.allDraws[name] for name in self.drawNames]
+            self.database.numberOfDraws = numberOfDraws
+            self.database.typesOfDraws.update(self.allDraws)
+            if self.theC.setCachedDraws(types,
+                                        self.database.getSampleSize(),
+                                        numberOfDraws,
+                                        np.random.randint(0, 2**31 - 1),
+                                        self.singlePrecisionDraws,
+                                        self.numberOfThreads):
+                self.logger.general(f'Draws read from the cache '
+                                    f'directory {self.cacheDirectory}')
+            return
+        self.database.generateDraws(self.allDraws,
+                                    self.drawNames,
+                                    numberOfDraws)
+        self.theC.setDraws(self.database.theDraws, self.singlePrecisionDraws)
 
 
     def _prepareDatabaseForFormula(self, sample=None):
-        # Prepare the dataset.
-        if sample is None:
-            if self.lastSample == 1.0:
-                # We continue to use the full data set. Nothing to be done.
-                return
+        # The full data set is transferred only once to the C++
+        # engine. The batches for stochastic algorithms are then
+        # defined by the indices of the rows (or of the individuals
+        # for panel data) sampled by the engine, so that the data is
+        # never copied.
+        if self.lastSample is None:
+            if self.database.isPanel():
+                self.database.buildPanelMap()
+                self.theC.setPanel(True)
+                self.theC.setDataMap(self.database.individualMap)
+            self.theC.setData(self.database.data[self.engineColumns])
+            self.theC.setMissingData(self.missingData)
             self.lastSample = 1.0
-            self.database.useFullSample()
-        else:
-            # Check if the sample size is valid
-            if sample <= 0 or sample > 1.0:
-                error_msg = (f'The value of the parameter sample must be '
-                             f'strictly between 0.0 and 1.0,'
-                             f' and not {sample}')
-                raise ValueError(error_msg)
-
-            if sample == 1.0:
-                self.database.useFullSample()
-            else:
-                self.logger.detailed(f'Use {100*sample}% of the data.')
-                if self.database.isPanel():
-                    self.database.\
-                        sampleIndividualMapWithoutReplacement(sample,
-                                                              self.columnForBatchSamplingWeights)
-                else:
-                    self.database.sampleWithoutReplacement(sample,
-                                                           self.columnForBatchSamplingWeights)
-            self.lastSample = sample
 
-        # Rebuild the map for panel data
-        if self.database.isPanel():
-            self.database.buildPanelMap()
-            self.theC.setPanel(True)
-            self.theC.setDataMap(self.database.individualMap)
+        if sample is None:
+            if self.lastSample != 1.0:
+                self.theC.useFullSample()
+                self.lastSample = 1.0
+            return
+
+        # Check if the sample size is valid
+        if sample <= 0 or sample > 1.0:
+            error_msg = (f'The value of the parameter sample must be '
+                         f'strictly between 0.0 and 1.0,'
+                         f' and not {sample}')
+            raise ValueError(error_msg)
 
-        # Transfer the data to the C++ formula
-        self.theC.setData(self.database.data)
-        self.theC.setMissingData(self.missingData)
+        if sample == 1.0:
+            self.theC.useFullSample()
+        else:
+            self.logger.detailed(f'Use {100*sample}% of the data.')
+            weights = None
+            if self.columnForBatchSamplingWeights is not None:
+                weights = self.database.\
+                    getSamplingWeights(self.columnForBatchSamplingWeights)
+            self.theC.sampleWithoutReplacement(sample, weights)
+        self.lastSample = sample
 
     def getBoundsOnBeta(self, betaName):
         """ Returns the bounds on the parameter as defined by the user.
@@ -388,7 +489,7 @@ class BIOGEME:
         """
 
         collectionOfFormulas = [f for k, f in self.formulas.items()]
-        variableNames = list(self.database.data.columns.values)
+        variableNames = self.engineColumns
 
 
         self.elementaryExpressionIndex, \
@@ -483,10 +584,10 @@ class BIOGEME:
         self._prepareDatabaseForFormula(batch)
         f = self.theC.calculateLikelihood(x, self.fixedBetaValues)
 
-        self.logger.detailed(f'Log likelihood (N = {self.database.getSampleSize()}): {f:10.7g}')
+        self.logger.detailed(f'Log likelihood (N = {self.theC.getSampleSize()}): {f:10.7g}')
 
         if scaled:
-            return f / float(self.database.getSampleSize())
+            return f / float(self.theC.getSampleSize())
 
         return f
 
@@ -550,7 +651,7 @@ class BIOGEME:
         if bhhh:
             bhhhmsg = f'BHHH norm:  {np.linalg.norm(bh):10.1g}'
         gradnorm = np.linalg.norm(g)
-        self.logger.general(f'Log likelihood (N = {self.database.getSampleSize()}): {f:10.7g}'
+        self.logger.general(f'Log likelihood (N = {self.theC.getSampleSize()}): {f:10.7g}'
                             f' Gradient norm: {gradnorm:10.1g}'
                             f' {hmsg} {bhhhmsg}')
 
@@ -567,7 +668,7 @@ class BIOGEME:
                         print(f'{self.freeBetaNames[i]} = {v}', file=pf)
 
         if scaled:
-            N = float(self.database.getSampleSize())
+            N = float(self.theC.getSampleSize())
             if N == 0:
                 raise excep.biogemeError(f'Sample size is {N}')
 
@@ -689,7 +790,8 @@ formulas.
                  algorithm=opt.simpleBoundsNewtonAlgorithmForBiogeme,
                  algoParameters=None,
                  cfsqp_default_bounds=1000.0,
-                 saveIterations='__savedIterations.txt'):
+                 saveIterations='__savedIterations.txt',
+                 initialNumberOfDraws=None):
 
         """Estimate the parameters of the model.
 
@@ -720,6 +822,15 @@ formulas.
                                Default: '__savedIterations.txt'
         :type saveIterations: str
 
+        :param initialNumberOfDraws: if not None, and if the model
+               involves Monte-Carlo integration, the parameters are
+               first estimated with this number of draws. The number
+               of draws is then doubled, and the parameters estimated
+               again from the previous solution, until all the draws
+               are used. See :func:`biogeme.biogeme.BIOGEME.optimizeWithAdaptiveDraws`.
+               Default: None.
+        :type initialNumberOfDraws: int
+
         :return: object containing the estimation results.
         :rtype: biogeme.bioResults
 
@@ -771,7 +882,8 @@ formulas.
 
         #        yep.stop()
 
-        output = self.optimize(self.betaInitValues)
+        output = self.optimizeWithAdaptiveDraws(self.betaInitValues,
+                                                initialNumberOfDraws)
         xstar, optimizationMessages = output
         ## Running time of the optimization algorithm
         optimizationMessages['Optimization time'] = datetime.now() - start_time
@@ -810,10 +922,14 @@ formulas.
                     self.theC.setDataMap(sample)
                 else:
                     sample = self.database.sampleWithReplacement()
-                    self.theC.setData(sample)
+                    self.theC.setData(sample[self.engineColumns])
                 x_br, _ = self.optimize(xstar)
                 self.bootstrap_results[b] = x_br
 
+            # The full data set must be transferred again to the engine.
+            self.lastSample = None
+            self._prepareDatabaseForFormula()
+
             ## Time needed to generate the bootstrap results
             self.bootstrap_time = datetime.now() - start_time
             self.logger.resume()
@@ -986,6 +1102,91 @@ formulas.
                                  self.algoParameters)
         return results
 
+    def optimizeWithAdaptiveDraws(self,
+                                  startingValues=None,
+                                  initialNumberOfDraws=None):
+        """Calls the optimization algorithm with an increasing number
+        of draws.
+
+        The parameters are first estimated with initialNumberOfDraws
+        draws. The number of draws is then doubled, and the parameters
+        are estimated again from the previous solution, until all the
+        draws are used. The draws are nested: only the first draws of
+        each individual are used, so that they are extended, and not
+        generated again.
+
+        After each intermediate estimation, the norm of the gradient
+        obtained with all the draws is compared with its simulation
+        error, estimated by the difference with the gradient obtained
+        with half of the draws. If the gradient is dominated by the
+        simulation error, more draws cannot improve the solution
+        significantly before the final estimation, and the remaining
+        intermediate estimations are skipped.
+
+        :param startingValues: starting point for the algorithm
+        :type: list(float)
+
+        :param initialNumberOfDraws: number of draws of the first
+             estimation. If None, or if the model does not involve
+             Monte-Carlo integration, all the draws are used from the
+             start.
+        :type initialNumberOfDraws: int
+
+        :return: x, messages, as returned by :func:`biogeme.biogeme.BIOGEME.optimize`
+        :rtype: numpay.array, dict(str:object)
+
+        :raises biogemeError: if the initial number of draws is not positive.
+        """
+        if (not self.monteCarlo or
+                initialNumberOfDraws is None or
+                initialNumberOfDraws >= self.numberOfDraws):
+            return self.optimize(startingValues)
+        if initialNumberOfDraws <= 0:
+            raise excep.biogemeError(f'The initial number of draws must '
+                                     f'be positive, and not '
+                                     f'{initialNumberOfDraws}')
+        x = startingValues
+        r = initialNumberOfDraws
+        try:
+            while r < self.numberOfDraws:
+                self.logger.general(f'Estimation with {r} draws out of '
+                                    f'{self.numberOfDraws}')
+                self.theC.setNumberOfDraws(r)
+                # The values of the likelihood obtained with different
+                # numbers of draws cannot be compared.
+                self.bestIteration = None
+                x, _ = self.optimize(x)
+                if self._simulationErrorDominates(x):
+                    break
+                r *= 2
+        finally:
+            self.theC.setNumberOfDraws(0)
+        self.bestIteration = None
+        self.logger.general(f'Estimation with {self.numberOfDraws} draws')
+        return self.optimize(x)
+
+    def _simulationErrorDominates(self, x):
+        """Compares the gradient of the log likelihood with all the
+        draws with its simulation error.
+
+        :param x: values of the parameters
+        :type x: list(float)
+
+        :return: True if the norm of the gradient is smaller than the
+                 estimated simulation error.
+        :rtype: bool
+        """
+        self.theC.setNumberOfDraws(self.numberOfDraws // 2)
+        _, gHalf, _, _ = self.calculateLikelihoodAndDerivatives(x, scaled=True)
+        self.theC.setNumberOfDraws(0)
+        _, g, _, _ = self.calculateLikelihoodAndDerivatives(x, scaled=True)
+        gradientNorm = np.linalg.norm(g)
+        simulationError = np.linalg.norm(g - gHalf)
+        self.logger.detailed(f'Gradient norm with {self.numberOfDraws} draws: '
+                             f'{gradientNorm:.3g}. Simulation error: '
+                             f'{simulationError:.3g}')
+        return gradientNorm <= simulationError
+
     def simulate(self, theBetaValues=None):
         """Applies the formulas to each row of the database.
 
@@ -1044,7 +1245,7 @@ formulas.
             result = self.theC.simulateFormula(signature,
                                                betaValues,
                                                self.fixedBetaValues,
-                                               self.database.data)
+                                               self.database.data[self.engineColumns])
             output[k] = result
         return output
 
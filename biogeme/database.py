@@ -14,11 +14,13 @@ for specific services to Biogeme
 # pylint: disable=invalid-name, too-many-arguments, too-many-locals, too-many-statements, too-many-branches, too-many-instance-attributes, too-many-lines, too-many-public-methods
 
 from datetime import datetime
+import multiprocessing as mp
 import numpy as np
 import pandas as pd
 
 import biogeme.exceptions as excep
 import biogeme.filenames as bf
+import biogeme.cbiogeme as cb
 import biogeme.draws as draws
 import biogeme.messaging as msg
 import biogeme.tools as tools
@@ -87,6 +89,12 @@ class Database:
         ## Draws for Monte-Carlo integration
         self.theDraws = None
 
+        ## Base sequences of the draws shared by the individuals,
+        ## generated by the function Database.generateSharedDraws.
+        self.baseDraws = None
+        ## Shift of the shared draws for each individual.
+        self.drawShifts = None
+
         ## Availability expression to check
         self._avail = None
 
@@ -104,29 +112,57 @@ class Database:
             raise excep.biogemeError('\n'.join(listOfErrors))
 
     def _initNativeRandomNumberGenerators(self):
+        descriptions = {
+            'UNIFORM': 'Uniform U[0, 1]',
+            'UNIFORM_ANTI': 'Antithetic uniform U[0, 1]',
+            'UNIFORM_HALTON2': 'Halton draws with base 2, skipping the first 10',
+            'UNIFORM_HALTON3': 'Halton draws with base 3, skipping the first 10',
+            'UNIFORM_HALTON5': 'Halton draws with base 5, skipping the first 10',
+            'UNIFORM_RHALTON2': 'Randomly shifted Halton draws with base 2',
+            'UNIFORM_RHALTON3': 'Randomly shifted Halton draws with base 3',
+            'UNIFORM_RHALTON5': 'Randomly shifted Halton draws with base 5',
+            'UNIFORM_SHALTON2': 'Halton draws with base 2, shared by the individuals, each randomly shifted',
+            'UNIFORM_SHALTON3': 'Halton draws with base 3, shared by the individuals, each randomly shifted',
+            'UNIFORM_SHALTON5': 'Halton draws with base 5, shared by the individuals, each randomly shifted',
+            'UNIFORM_MLHS': 'Modified Latin Hypercube Sampling on [0, 1]',
+            'UNIFORM_MLHS_ANTI': 'Antithetic Modified Latin Hypercube Sampling on [0, 1]',
+            'UNIFORMSYM': 'Uniform U[-1, 1]',
+            'UNIFORMSYM_ANTI': 'Antithetic uniform U[-1, 1]',
+            'UNIFORMSYM_HALTON2': 'Halton draws on [-1, 1] with base 2, skipping the first 10',
+            'UNIFORMSYM_HALTON3': 'Halton draws on [-1, 1] with base 3, skipping the first 10',
+            'UNIFORMSYM_HALTON5': 'Halton draws on [-1, 1] with base 5, skipping the first 10',
+            'UNIFORMSYM_RHALTON2': 'Randomly shifted Halton draws on [-1, 1] with base 2',
+            'UNIFORMSYM_RHALTON3': 'Randomly shifted Halton draws on [-1, 1] with base 3',
+            'UNIFORMSYM_RHALTON5': 'Randomly shifted Halton draws on [-1, 1] with base 5',
+            'UNIFORMSYM_SHALTON2': 'Halton draws on [-1, 1] with base 2, shared by the individuals, each randomly shifted',
+            'UNIFORMSYM_SHALTON3': 'Halton draws on [-1, 1] with base 3, shared by the individuals, each randomly shifted',
+            'UNIFORMSYM_SHALTON5': 'Halton draws on [-1, 1] with base 5, shared by the individuals, each randomly shifted',
+            'UNIFORMSYM_MLHS': 'Modified Latin Hypercube Sampling on [-1, 1]',
+            'UNIFORMSYM_MLHS_ANTI': 'Antithetic Modified Latin Hypercube Sampling on [-1, 1]',
+            'NORMAL': 'Normal N(0, 1) draws',
+            'NORMAL_ANTI': 'Antithetic normal draws',
+            'NORMAL_HALTON2': 'Normal draws from Halton base 2 sequence',
+            'NORMAL_HALTON3': 'Normal draws from Halton base 3 sequence',
+            'NORMAL_HALTON5': 'Normal draws from Halton base 5 sequence',
+            'NORMAL_RHALTON2': 'Normal draws from randomly shifted Halton base 2 sequence',
+            'NORMAL_RHALTON3': 'Normal draws from randomly shifted Halton base 3 sequence',
+            'NORMAL_RHALTON5': 'Normal draws from randomly shifted Halton base 5 sequence',
+            'NORMAL_SHALTON2': 'Normal draws from a Halton base 2 sequence shared by the individuals, each randomly shifted',
+            'NORMAL_SHALTON3': 'Normal draws from a Halton base 3 sequence shared by the individuals, each randomly shifted',
+            'NORMAL_SHALTON5': 'Normal draws from a Halton base 5 sequence shared by the individuals, each randomly shifted',
+            'NORMAL_MLHS': 'Normal draws from Modified Latin Hypercube Sampling',
+            'NORMAL_MLHS_ANTI': 'Antithetic normal draws from Modified Latin Hypercube Sampling'
+        }
+
+        # The pseudo-random and MLHS types consume the numpy stream,
+        # as before, so that a seeded estimation gives the same
+        # uniform numbers. Only the transform to normal draws is done
+        # by the C++ engine.
         def uniform_antithetic(sampleSize, numberOfDraws):
             return draws.getAntithetic(draws.getUniform,
                                        sampleSize,
                                        numberOfDraws)
 
-        def halton2(sampleSize, numberOfDraws):
-            return draws.getHaltonDraws(sampleSize,
-                                        numberOfDraws,
-                                        base=2,
-                                        skip=10)
-
-        def halton3(sampleSize, numberOfDraws):
-            return draws.getHaltonDraws(sampleSize,
-                                        numberOfDraws,
-                                        base=3,
-                                        skip=10)
-
-        def halton5(sampleSize, numberOfDraws):
-            return draws.getHaltonDraws(sampleSize,
-                                        numberOfDraws,
-                                        base=5,
-                                        skip=10)
-
         def MLHS_anti(sampleSize, numberOfDraws):
             return draws.getAntithetic(draws.getLatinHypercubeDraws,
                                        sampleSize,
@@ -140,27 +176,6 @@ class Database:
             localDraws = symm_uniform(sampleSize, R)
             return np.concatenate((localDraws, -localDraws), axis=1)
 
-        def symm_halton2(sampleSize, numberOfDraws):
-            return draws.getHaltonDraws(sampleSize,
-                                        numberOfDraws,
-                                        symmetric=True,
-                                        base=2,
-                                        skip=10)
-
-        def symm_halton3(sampleSize, numberOfDraws):
-            return draws.getHaltonDraws(sampleSize,
-                                        numberOfDraws,
-                                        symmetric=True,
-                                        base=3,
-                                        skip=10)
-
-        def symm_halton5(sampleSize, numberOfDraws):
-            return draws.getHaltonDraws(sampleSize,
-                                        numberOfDraws,
-                                        symmetric=True,
-                                        base=5,
-                                        skip=10)
-
         def symm_MLHS(sampleSize, numberOfDraws):
             return draws.getLatinHypercubeDraws(sampleSize,
                                                 numberOfDraws,
@@ -176,36 +191,6 @@ class Database:
                                                numberOfDraws=numberOfDraws,
                                                antithetic=True)
 
-        def normal_halton2(sampleSize, numberOfDraws):
-            unif = draws.getHaltonDraws(sampleSize,
-                                        numberOfDraws,
-                                        base=2,
-                                        skip=10)
-            return draws.getNormalWichuraDraws(sampleSize,
-                                               numberOfDraws,
-                                               uniformNumbers=unif,
-                                               antithetic=False)
-
-        def normal_halton3(sampleSize, numberOfDraws):
-            unif = draws.getHaltonDraws(sampleSize,
-                                        numberOfDraws,
-                                        base=2,
-                                        skip=10)
-            return draws.getNormalWichuraDraws(sampleSize,
-                                               numberOfDraws,
-                                               uniformNumbers=unif,
-                                               antithetic=False)
-
-        def normal_halton5(sampleSize, numberOfDraws):
-            unif = draws.getHaltonDraws(sampleSize,
-                                        numberOfDraws,
-                                        base=2,
-                                        skip=10)
-            return draws.getNormalWichuraDraws(sampleSize,
-                                               numberOfDraws,
-                                               uniformNumbers=unif,
-                                               antithetic=False)
-
         def normal_MLHS(sampleSize, numberOfDraws):
             unif = draws.getLatinHypercubeDraws(sampleSize,
                                                 numberOfDraws)
@@ -222,51 +207,49 @@ class Database:
                                                uniformNumbers=unif,
                                                antithetic=True)
 
+        numpyGenerators = {
+            'UNIFORM': draws.getUniform,
+            'UNIFORM_ANTI': uniform_antithetic,
+            'UNIFORM_MLHS': draws.getLatinHypercubeDraws,
+            'UNIFORM_MLHS_ANTI': MLHS_anti,
+            'UNIFORMSYM': symm_uniform,
+            'UNIFORMSYM_ANTI': symm_uniform_antithetic,
+            'UNIFORMSYM_MLHS': symm_MLHS,
+            'UNIFORMSYM_MLHS_ANTI': symm_MLHS_anti,
+            'NORMAL': draws.getNormalWichuraDraws,
+            'NORMAL_ANTI': normal_antithetic,
+            'NORMAL_MLHS': normal_MLHS,
+            'NORMAL_MLHS_ANTI': normal_MLHS_anti
+        }
+
+        def nativeGenerator(drawType):
+            # The Halton draws are generated by the C++ engine, in
+            # parallel across individuals. The seed of the random
+            # shifts is obtained from numpy, so that
+            # numpy.random.seed controls these draws as well.
+            def generator(sampleSize, numberOfDraws):
+                if numberOfDraws <= 0:
+                    raise excep.biogemeError(f'Invalid number of draws: {numberOfDraws}.')
+                if sampleSize <= 0:
+                    raise excep.biogemeError(f'Invalid sample size: {sampleSize} '
+                                             f'when generating draws.')
+                try:
+                    return cb.generateDraws(drawType,
+                                            sampleSize,
+                                            numberOfDraws,
+                                            np.random.randint(0, 2**31 - 1),
+                                            mp.cpu_count())
+                except RuntimeError as e:
+                    raise excep.biogemeError(str(e))
+            return generator
+
         ## Dictionary containing native random number generators.
         self.nativeRandomNumberGenerators = {
-            'UNIFORM': (draws.getUniform,
-                        'Uniform U[0, 1]'),
-            'UNIFORM_ANTI':(uniform_antithetic,
-                            'Antithetic uniform U[0, 1]'),
-            'UNIFORM_HALTON2':(halton2,
-                               'Halton draws with base 2, skipping the first 10'),
-            'UNIFORM_HALTON3':(halton3,
-                               'Halton draws with base 3, skipping the first 10'),
-            'UNIFORM_HALTON5':(halton5,
-                               'Halton draws with base 5, skipping the first 10'),
-            'UNIFORM_MLHS':(draws.getLatinHypercubeDraws,
-                            'Modified Latin Hypercube Sampling on [0, 1]'),
-            'UNIFORM_MLHS_ANTI':(MLHS_anti,
-                                 'Antithetic Modified Latin Hypercube Sampling on [0, 1]'),
-            'UNIFORMSYM': (symm_uniform,
-                           'Uniform U[-1, 1]'),
-            'UNIFORMSYM_ANTI':(symm_uniform_antithetic,
-                               'Antithetic uniform U[-1, 1]'),
-            'UNIFORMSYM_HALTON2':(symm_halton2,
-                                  'Halton draws on [-1, 1] with base 2, skipping the first 10'),
-            'UNIFORMSYM_HALTON3':(symm_halton3,
-                                  'Halton draws on [-1, 1] with base 3, skipping the first 10'),
-            'UNIFORMSYM_HALTON5':(symm_halton5,
-                                  'Halton draws on [-1, 1] with base 5, skipping the first 10'),
-            'UNIFORMSYM_MLHS':(symm_MLHS,
-                               'Modified Latin Hypercube Sampling on [-1, 1]'),
-            'UNIFORMSYM_MLHS_ANTI':(symm_MLHS_anti,
-                                    'Antithetic Modified Latin Hypercube Sampling on [-1, 1]'),
-            'NORMAL': (draws.getNormalWichuraDraws,
-                       'Normal N(0, 1) draws'),
-            'NORMAL_ANTI':(normal_antithetic,
-                           'Antithetic normal draws'),
-            'NORMAL_HALTON2':(normal_halton2,
-                              'Normal draws from Halton base 2 sequence'),
-            'NORMAL_HALTON3':(normal_halton3,
-                              'Normal draws from Halton base 3 sequence'),
-            'NORMAL_HALTON5':(normal_halton5,
-                              'Normal draws from Halton base 5 sequence'),
-            'NORMAL_MLHS':(normal_MLHS,
-                           'Normal draws from Modified Latin Hypercube Sampling'),
-            'NORMAL_MLHS_ANTI':(normal_MLHS_anti,
-                                'Antithetic normal draws from Modified Latin Hypercube Sampling')
-            }
+            drawType: (numpyGenerators.get(drawType,
+                                           nativeGenerator(drawType)),
+                       description)
+            for drawType, description in descriptions.items()
+        }
 
     def descriptionOfNativeDraws(self):
         """ Describe the draws available draws with Biogeme
@@ -584,6 +567,28 @@ class Database:
                                              weights=columnWithSamplingWeights)
             self.logger.debug(f'Full data: {self.fullData.shape} Sampled data: {self.data.shape}')
 
+    def getSamplingWeights(self, columnWithSamplingWeights):
+        """ Weights used by the engine to sample batches without replacement
+
+        :param columnWithSamplingWeights: name of the column with
+              the sampling weights.
+        :type columnWithSamplingWeights: string
+
+        :return: one weight per row or, for panel data, one weight
+            per individual, taken from its first observation.
+        :rtype: numpy.array
+
+        :raises biogemeError: if the column does not exist.
+        """
+        if columnWithSamplingWeights not in self.data.columns:
+            errorMsg = (f'Column {columnWithSamplingWeights} for the '
+                        f'sampling weights is not in the database')
+            raise excep.biogemeError(errorMsg)
+        weights = self.data[columnWithSamplingWeights].to_numpy(dtype=float)
+        if self.isPanel():
+            return weights[self.individualMap[0].to_numpy(dtype=int)]
+        return weights
+
     def useFullSample(self):
         """ Re-establish the full sample for calculation of the likelihood
         """
@@ -760,6 +765,78 @@ class Database:
         self.theDraws = np.moveaxis(self.theDraws, 0, -1)
         return self.theDraws
 
+    def isSharedDrawType(self, drawType):
+        """Tells if a type of draws is a quasi Monte-Carlo sequence
+        shared by the individuals, such as NORMAL_SHALTON2.
+
+        :param drawType: type of draws
+        :type drawType: string
+
+        :return: True if the type is native and shared.
+        :rtype: bool
+        """
+        return (drawType in self.nativeRandomNumberGenerators and
+                '_SHALTON' in drawType)
+
+    def generateSharedDraws(self, types, names, numberOfDraws):
+        """Generate draws shared by the individuals for each variable.
+
+        Only the base sequence of each variable and a random shift
+        of each individual are generated. The draws of individual n
+        for a variable are the elements of the base sequence shifted
+        modulo 1 by the shift of n (Cranley-Patterson rotation), and
+        transformed into the distribution of the variable. They are
+        calculated by the C++ engine when needed, so that the memory
+        is proportional to (numberOfDraws + sampleSize) x
+        numberOfVariables.
+
+        :param types: A dict indexed by the names of the variables,
+                      describing the types of draws. Each of them must
+                      be a shared type, such as NORMAL_SHALTON2.
+        :type types: dict
+
+        :param names: the list of names of the variables that require draws to be generated.
+        :type names: list of strings
+
+        :param numberOfDraws: number of draws to generate.
+        :type numberOfDraws: int
+
+        :return: a 2-dimensional table with the uniform draws of the
+              base sequences (number of draws x number of
+              variables), and a 2-dimensional table with the shifts
+              (number of individuals x number of variables)
+        :rtype: tuple(numpy.array, numpy.array)
+
+        :raises biogemeError: if a type of draws is not shared.
+        """
+        if numberOfDraws <= 0:
+            raise excep.biogemeError(f'Invalid number of draws: {numberOfDraws}.')
+        sampleSize = self.getSampleSize()
+        if sampleSize <= 0:
+            raise excep.biogemeError(f'Invalid sample size: {sampleSize} '
+                                     f'when generating draws.')
+        self.numberOfDraws = numberOfDraws
+        base = np.empty((numberOfDraws, len(names)))
+        shifts = np.empty((sampleSize, len(names)))
+        for i, name in enumerate(names):
+            drawType = types[name]
+            if not self.isSharedDrawType(drawType):
+                errorMsg = (f'The draws of type {drawType} for variable '
+                            f'{name} are not shared by the individuals.')
+                raise excep.biogemeError(errorMsg)
+            self.typesOfDraws[name] = drawType
+            try:
+                base[:, i], shifts[:, i] = \
+                    cb.generateSharedDraws(drawType,
+                                           sampleSize,
+                                           numberOfDraws,
+                                           np.random.randint(0, 2**31 - 1))
+            except RuntimeError as e:
+                raise excep.biogemeError(str(e))
+        self.baseDraws = base
+        self.drawShifts = shifts
+        return self.baseDraws, self.drawShifts
+
     def getNumberOfObservations(self):
         """
           Reports the number of observations in the database.
@@ -1312,6 +1312,21 @@ class bioNormalCdf(UnaryOperator):
     def __str__(self):
         return f'bioNormalCdf({self.child})'
 
+class bioNormalPdf(UnaryOperator):
+    """
+    Probability Density Function of a standard normal random variable
+    """
+    def __init__(self, child):
+        """ Constructor
+
+        :param child: first arithmetic expression
+        :type child: biogeme.expressions.Expression
+        """
+        UnaryOperator.__init__(self, child)
+
+    def __str__(self):
+        return f'bioNormalPdf({self.child})'
+
 class PanelLikelihoodTrajectory(UnaryOperator):
     """
     Likelihood of a sequences of observations for the same individual
@@ -1498,17 +1513,41 @@ class Integrate(UnaryOperator):
     """
     Numerical integration
     """
-    def __init__(self, child, name):
+    ## Numbers of points of the available Gauss-Hermite rules
+    availableOrders = [10, 20, 30, 50, 100]
+
+    def __init__(self, child, name, order=None, adaptive=False):
         """ Constructor
 
         :param child: first arithmetic expression
         :type child: biogeme.expressions.Expression
         :param name: name of the random variable for the integration.
         :type name: string
+        :param order: number of points of the Gauss-Hermite
+            quadrature, among 10, 20, 30, 50 and 100. If None, 100
+            points are used.
+        :type order: int
+        :param adaptive: if True, the points are centered on the
+            mode of the integrand, and scaled by its curvature
+            (adaptive Gauss-Hermite quadrature). Few points are then
+            sufficient for integrands close to a normal density, such
+            as the likelihood of latent variable models.
+        :type adaptive: bool
+
+        :raises biogemeError: if the order is not available.
         """
         UnaryOperator.__init__(self, child)
         self.randomVariableName = name
         self.randomVariableIndex = None
+        if order is not None and order not in self.availableOrders:
+            errorMsg = (f'Gauss-Hermite quadrature with {order} points '
+                        f'is not available. Available: '
+                        f'{self.availableOrders}')
+            raise excep.biogemeError(errorMsg)
+        ## Number of points of the quadrature. None for the default.
+        self.order = order
+        ## If True, adaptive Gauss-Hermite quadrature.
+        self.adaptive = adaptive
 
     def audit(self, database=None):
         """ Performs various checks on the expressions.
@@ -1594,6 +1633,9 @@ class Integrate(UnaryOperator):
             3. the id of the expression between { }, preceeded by a comma
             4. the id of the children, preceeded by a comma
             5. the index of the randon variable, preceeded by a comma
+            6. if the order or the adaptive quadrature is requested,
+               the number of points, and 1 if the quadrature is
+               adaptive, 0 otherwise, each preceeded by a comma
 
         Consider the following expression:
 
@@ -1633,11 +1675,162 @@ class Integrate(UnaryOperator):
         mysignature += f'{{{id(self)}}}'
         mysignature += f',{id(self.child)}'
         mysignature += f',{self.randomVariableIndex}'
+        if self.order is not None or self.adaptive:
+            order = 100 if self.order is None else self.order
+            mysignature += f',{order},{int(self.adaptive)}'
+        listOfSignatures += [mysignature.encode()]
+        return listOfSignatures
+
+    def __str__(self):
+        if self.order is None and not self.adaptive:
+            return f'Integrate({self.child}, "{self.randomVariableName}")'
+        return (f'Integrate({self.child}, "{self.randomVariableName}", '
+                f'order={self.order}, adaptive={self.adaptive})')
+
+class MultipleIntegrate(UnaryOperator):
+    """
+    Numerical integration over several random variables, using a
+    Smolyak sparse grid built on the nested Genz-Keister rules. At
+    level q, the grid is exact for polynomials of total degree 2q-1
+    multiplied by the standard normal density, and uses far fewer
+    points than nested Integrate expressions.
+    """
+    ## Maximum level of the sparse grid
+    maxLevel = 25
+
+    def __init__(self, child, names, level=5):
+        """ Constructor
+
+        :param child: first arithmetic expression
+        :type child: biogeme.expressions.Expression
+        :param names: names of the random variables for the integration.
+        :type names: list(string)
+        :param level: level of the sparse grid, between 1 and 25.
+        :type level: int
+
+        :raises biogemeError: if the level is not valid, or if a
+            random variable appears several times.
+        """
+        UnaryOperator.__init__(self, child)
+        if len(set(names)) != len(names) or not names:
+            errorMsg = (f'The random variables of MultipleIntegrate must '
+                        f'be distinct: {names}')
+            raise excep.biogemeError(errorMsg)
+        if level < 1 or level > self.maxLevel:
+            errorMsg = (f'The level of the sparse grid must be between 1 '
+                        f'and {self.maxLevel}, and not {level}')
+            raise excep.biogemeError(errorMsg)
+        self.randomVariableNames = list(names)
+        self.randomVariableIndices = None
+        ## Level of the sparse grid
+        self.level = level
+
+    def audit(self, database=None):
+        """ Performs various checks on the expressions.
+
+        :param database: database object
+        :type database: biogeme.database.Database
+
+        :return: tuple listOfErrors, listOfWarnings
+        :rtype: list(string), list(string)
+
+        """
+        listOfErrors, listOfWarnings = self.child.audit(database)
+        if not self.child.embedExpression('RandomVariable'):
+            theError = (f'The argument of MultipleIntegrate must '
+                        f'contain a RandomVariable: {self}')
+            listOfErrors.append(theError)
+        return listOfErrors, listOfWarnings
+
+    def setUniqueId(self, idsOfElementaryExpressions):
+        """
+        Provides a unique id to the elementary expressions. Overloads the generic function
+
+        :param idsOfElementaryExpressions: dictionary mapping the name of
+                the elementary expression with their id.
+        :type idsOfElementaryExpressions: dict(string:int)
+
+        """
+        self.randomVariableIndices = []
+        for name in self.randomVariableNames:
+            if name not in idsOfElementaryExpressions:
+                errorMsg = f'No index is available for random variable {name}.'
+                raise excep.biogemeError(errorMsg)
+            self.randomVariableIndices.append(idsOfElementaryExpressions[name])
+        self.child.setUniqueId(idsOfElementaryExpressions)
+
+    def setSpecificIndices(self,
+                           indicesOfFreeBetas,
+                           indicesOfFixedBetas,
+                           indicesOfRandomVariables,
+                           indicesOfDraws):
+        """
+        Provide an index to all elementary expressions, specific to their type
+        Overloads the generic function.
+
+        :param indicesOfFreeBetas: dictionary mapping the name of the
+                               free betas with their index
+        :type indicesOfFreeBetas: dict(string:int)
+
+        :param indicesOfFixedBetas: dictionary mapping the name of the
+                                fixed betas with their index
+        :type indicesOfFixedBetas: dict(string:int)
+
+        :param indicesOfRandomVariables: dictionary mapping the name of the
+                                random variables with their index
+        :type indicesOfRandomVariables: dict(string:int)
+        :param indicesOfDraws: dictionary mapping the name of the draws with
+                            their index
+        :type indicesOfDraws: dict(string:int)
+
+        """
+        self.randomVariableIndices = []
+        for name in self.randomVariableNames:
+            if name not in indicesOfRandomVariables:
+                errorMsg = (f'No index is available for random variable '
+                            f'{name}. Known random variables:'
+                            f' {indicesOfRandomVariables.keys()}')
+                raise excep.biogemeError(errorMsg)
+            self.randomVariableIndices.append(indicesOfRandomVariables[name])
+        self.child.setSpecificIndices(indicesOfFreeBetas,
+                                      indicesOfFixedBetas,
+                                      indicesOfRandomVariables,
+                                      indicesOfDraws)
+
+    def getSignature(self):
+        """The signature of a string characterizing an expression.
+
+        This is designed to be communicated to C++, so that the
+        expression can be reconstructed in this environment.
+
+        The list contains the following elements:
+
+            1. the signatures of the child expression,
+            2. the name of the expression between < >
+            3. the id of the expression between { }
+            4. the number of random variables between ( )
+            5. the id of the child, preceeded by a comma
+            6. the level of the sparse grid, preceeded by a comma
+            7. the index of each random variable, preceeded by a comma
+
+        :return: list of the signatures of an expression and its children.
+        :rtype: list(string)
+        """
+        listOfSignatures = []
+        listOfSignatures += self.child.getSignature()
+        mysignature = f'<{self.getClassName()}>'
+        mysignature += f'{{{id(self)}}}'
+        mysignature += f'({len(self.randomVariableNames)})'
+        mysignature += f',{id(self.child)}'
+        mysignature += f',{self.level}'
+        for index in self.randomVariableIndices:
+            mysignature += f',{index}'
         listOfSignatures += [mysignature.encode()]
         return listOfSignatures
 
     def __str__(self):
-        return f'Integrate({self.child}, "{self.randomVariableName}")'
+        return (f'MultipleIntegrate({self.child}, '
+                f'{self.randomVariableNames}, level={self.level})')
 
 class Elementary(Expression):
     """Elementary expression.
@@ -2111,7 +2304,8 @@ class RandomVariable(Elementary):
         """
         listOfErrors = []
         listOfWarnings = []
-        if not self.isContainedIn('Integrate'):
+        if not (self.isContainedIn('Integrate') or
+                self.isContainedIn('MultipleIntegrate')):
             theError = f'RandomVariable expression must be embedded into a integrate: {self}'
             listOfErrors.append(theError)
         return listOfErrors, listOfWarnings
@@ -2500,6 +2694,25 @@ class LogLogit(Expression):
             e.parent = self
             self.children.append(e)
 
+    def _addChild(self, e):
+        """Adds a parameter of the model to the children of the expression.
+
+        :param e: parameter of the model.
+        :type e: float or biogeme.expressions.Expression
+
+        :return: the expression of the parameter.
+        :rtype: biogeme.expressions.Expression
+        """
+        if isNumeric(e):
+            theExpression = Numeric(e)
+        else:
+            if not isinstance(e, Expression):
+                raise excep.biogemeError(f'This is not a valid expression: {e}')
+            theExpression = e
+        theExpression.parent = self
+        self.children.append(theExpression)
+        return theExpression
+
     def audit(self, database=None):
         """ Performs various checks on the expressions.
 
@@ -2690,6 +2903,845 @@ class _bioLogLogitFullChoiceSet(LogLogit):
     """
 
 
+class _bioLogLogitSampled(LogLogit):
+    """This expression captures the logarithm of the logit formula,
+    where the choice set of each observation is replaced by a sample
+    of alternatives.
+
+    For each observation, sampleSize alternatives are drawn with
+    replacement, with probabilities proportional to the weights, and
+    the chosen alternative is added. The utility of each alternative
+    j of the sample is corrected by :math:`\\ln(k_j/q_j)`, where
+    :math:`k_j` is the number of times it appears in the sample, and
+    :math:`q_j` its sampling probability (McFadden, 1978). The
+    sample depends only on the seed and the observation. It uses only
+    the C++ implementation.
+    """
+    def __init__(self, util, av, choice, sampleSize, weights=None, seed=0):
+        """Constructor
+
+        :param util: dictionary where the keys are the identifiers of
+                     the alternatives, and the elements are objects
+                     defining the utility functions.
+
+        :type util: dict(int:biogeme.expressions.Expression)
+
+        :param av: dictionary where the keys are the identifiers of
+                   the alternatives, and the elements are object of
+                   type biogeme.expressions.Expression defining the
+                   availability conditions. If av is None, all the
+                   alternatives are assumed to be always available
+
+        :type av: dict(int:biogeme.expressions.Expression)
+
+        :param choice: formula to obtain the alternative for which the
+                       logit probability must be calculated.
+        :type choice: biogeme.expressions.Expression
+
+        :param sampleSize: number of alternatives drawn for each
+                           observation, in addition to the chosen one.
+        :type sampleSize: int
+
+        :param weights: dictionary where the keys are the identifiers
+                        of the alternatives, and the elements are
+                        positive numbers, proportional to the
+                        probability of drawing the alternative. If
+                        None, the alternatives are drawn with equal
+                        probabilities.
+        :type weights: dict(int:float)
+
+        :param seed: seed of the random number generator.
+        :type seed: int
+
+        :raise biogemeError: if the weights are not valid.
+        """
+        LogLogit.__init__(self, util, av, choice)
+        self.sampleSize = int(sampleSize)
+        self.seed = int(seed)
+        if self.sampleSize < 0 or self.seed < 0:
+            raise excep.biogemeError(f'Invalid sample size {sampleSize} '
+                                     f'or seed {seed}')
+        if weights is None:
+            self.weights = {i: 1.0 for i in self.util}
+        else:
+            if weights.keys() != self.util.keys():
+                raise excep.biogemeError(
+                    f'Incompatible list of alternatives for the weights '
+                    f'{set(weights.keys())} and the utilities '
+                    f'{set(self.util.keys())}')
+            self.weights = {i: float(weights[i]) for i in self.util}
+            for i, w in self.weights.items():
+                if not np.isfinite(w) or w <= 0:
+                    raise excep.biogemeError(f'Invalid sampling weight for '
+                                             f'alternative {i}: {w}')
+
+    def getValue(self):
+        """ The sample of alternatives depends on the observation. The
+        expression can therefore only be evaluated by the C++
+        implementation.
+
+        :raise biogemeError: always.
+        """
+        raise excep.biogemeError(f'Expression {self.getClassName()} can '
+                                 f'only be evaluated on a database, using '
+                                 f'getValue_c.')
+
+    def __str__(self):
+        s = LogLogit.__str__(self)
+        s += f'[{self.sampleSize}, {self.seed}]'
+        return s
+
+    def getSignature(self):
+        """The signature of a string characterizing an expression.
+
+        This is designed to be communicated to C++, so that the
+        expression can be reconstructed in this environment.
+
+        The list contains the following elements:
+
+            1. the signatures of all the children expressions,
+            2. the name of the expression between < >
+            3. the id of the expression between { }
+            4. the number of alternatives between ( )
+            5. the id of the expression for the chosen alternative,
+               preceeded by a comma.
+            6. the sample size,
+            7. the seed,
+            8. for each alternative, separated by commas:
+
+                 a. the number of the alternative, as defined by the user,
+                 b. the id of the expression for the utility,
+                 c. the id of the expression for the availability condition,
+                 d. the sampling weight.
+
+        :return: list of the signatures of an expression and its children.
+        :rtype: list(string)
+        """
+        listOfSignatures = []
+        for e in self.children:
+            listOfSignatures += e.getSignature()
+        signature = f'<{self.getClassName()}>'
+        signature += f'{{{id(self)}}}'
+        signature += f'({len(self.util)})'
+        signature += f',{id(self.choice)}'
+        signature += f',{self.sampleSize},{self.seed}'
+        for i, e in self.util.items():
+            signature += f',{i},{id(e)},{id(self.av[i])},{self.weights[i]!r}'
+        listOfSignatures += [signature.encode()]
+        return listOfSignatures
+
+
+class _bioLogNested(LogLogit):
+    """This expression captures the logarithm of the nested logit
+    formula.
+
+    The nests must be a partition of the choice set. The model is
+    evaluated, with its derivatives, by a dedicated C++ expression,
+    without building the tree of the MEV generating function.
+    """
+    def __init__(self, util, av, choice, nests, mu=1.0):
+        """Constructor
+
+        :param util: dictionary where the keys are the identifiers of
+                     the alternatives, and the elements are objects
+                     defining the utility functions.
+
+        :type util: dict(int:biogeme.expressions.Expression)
+
+        :param av: dictionary where the keys are the identifiers of
+                   the alternatives, and the elements are object of
+                   type biogeme.expressions.Expression defining the
+                   availability conditions. If av is None, all the
+                   alternatives are assumed to be always available
+
+        :type av: dict(int:biogeme.expressions.Expression)
+
+        :param choice: formula to obtain the alternative for which the
+                       logit probability must be calculated.
+        :type choice: biogeme.expressions.Expression
+
+        :param nests: A tuple containing as many items as nests.
+            Each item is also a tuple containing two items:
+
+            - an object of type biogeme.expressions.Expression
+              representing the nest parameter,
+            - a list containing the list of identifiers of the
+              alternatives belonging to the nest.
+
+        :type nests: tuple
+
+        :param mu: expression producing the value of the top-level
+                   scale parameter.
+        :type mu: biogeme.expressions.Expression
+
+        """
+        LogLogit.__init__(self, util, av, choice)
+        self.mu = self._addChild(mu)
+        self.nests = []
+        for m in nests:
+            param = self._addChild(m[0])
+            self.nests.append((param, [int(i) for i in m[1]]))
+
+    def getValue(self):
+        """ Evaluates the value of the expression
+
+        :return: value of the expression
+        :rtype: float
+        """
+        choice = int(self.choice.getValue())
+        if choice not in self.util:
+            self.logger.warning(f'Choice is {choice}. List of alternatives is {self.util.keys()}')
+            return np.nan
+        if self.av[choice].getValue() == 0.0:
+            return -np.log(0)
+        mu = self.mu.getValue()
+        logP = 0.0
+        inclusiveValues = []
+        for param, alternatives in self.nests:
+            mum = param.getValue()
+            muV = {i: mum * self.util[i].getValue()
+                   for i in alternatives if self.av[i].getValue() != 0.0}
+            if not muV:
+                continue
+            largest = max(muV.values())
+            logSum = largest + np.log(sum(np.exp(v - largest)
+                                          for v in muV.values()))
+            inclusiveValues.append(mu * logSum / mum)
+            if choice in muV:
+                logP += muV[choice] - logSum + inclusiveValues[-1]
+        largest = max(inclusiveValues)
+        logP -= largest + np.log(sum(np.exp(v - largest)
+                                     for v in inclusiveValues))
+        return logP
+
+    def __str__(self):
+        s = LogLogit.__str__(self)
+        s += f'[{self.mu}]('
+        s += ', '.join([f'{param}:{alternatives}'
+                        for param, alternatives in self.nests])
+        s += ')'
+        return s
+
+    def getSignature(self):
+        """The signature of a string characterizing an expression.
+
+        This is designed to be communicated to C++, so that the
+        expression can be reconstructed in this environment.
+
+        The list contains the following elements:
+
+            1. the signatures of all the children expressions,
+            2. the name of the expression between < >
+            3. the id of the expression between { }
+            4. the number of alternatives between ( )
+            5. the id of the expression for the chosen alternative,
+               preceeded by a comma.
+            6. the id of the expression for the scale parameter,
+            7. for each alternative, separated by commas:
+
+                 a. the number of the alternative, as defined by the user,
+                 b. the id of the expression for the utility,
+                 c. the id of the expression for the availability condition.
+
+            8. the number of nests,
+            9. for each nest, separated by commas:
+
+                 a. the id of the expression for the nest parameter,
+                 b. the number of alternatives in the nest,
+                 c. the numbers of the alternatives in the nest.
+
+        :return: list of the signatures of an expression and its children.
+        :rtype: list(string)
+        """
+        listOfSignatures = []
+        for e in self.children:
+            listOfSignatures += e.getSignature()
+        signature = f'<{self.getClassName()}>'
+        signature += f'{{{id(self)}}}'
+        signature += f'({len(self.util)})'
+        signature += f',{id(self.choice)}'
+        signature += f',{id(self.mu)}'
+        for i, e in self.util.items():
+            signature += f',{i},{id(e)},{id(self.av[i])}'
+        signature += f',{len(self.nests)}'
+        for param, alternatives in self.nests:
+            signature += f',{id(param)},{len(alternatives)}'
+            for i in alternatives:
+                signature += f',{i}'
+        listOfSignatures += [signature.encode()]
+        return listOfSignatures
+
+
+
+
+class _bioLogCnl(LogLogit):
+    """This expression captures the logarithm of the cross-nested logit
+    formula.
+
+    The model is evaluated, with its derivatives, by a dedicated C++
+    expression, without building the tree of the MEV generating
+    function. Only the alpha parameters that are defined are stored.
+    """
+    def __init__(self, util, av, choice, nests, mu=1.0):
+        """Constructor
+
+        :param util: dictionary where the keys are the identifiers of
+                     the alternatives, and the elements are objects
+                     defining the utility functions.
+
+        :type util: dict(int:biogeme.expressions.Expression)
+
+        :param av: dictionary where the keys are the identifiers of
+                   the alternatives, and the elements are object of
+                   type biogeme.expressions.Expression defining the
+                   availability conditions. If av is None, all the
+                   alternatives are assumed to be always available
+
+        :type av: dict(int:biogeme.expressions.Expression)
+
+        :param choice: formula to obtain the alternative for which the
+                       logit probability must be calculated.
+        :type choice: biogeme.expressions.Expression
+
+        :param nests: a tuple containing as many items as nests.
+            Each item is also a tuple containing two items:
+
+            - an object of type biogeme.expressions.Expression
+              representing the nest parameter,
+            - a dictionary mapping the alternative ids with the
+              cross-nested parameters for the corresponding nest. If
+              an alternative is missing in the dictionary, the
+              corresponding alpha is set to zero.
+
+        :type nests: tuple
+
+        :param mu: expression producing the value of the homogeneity
+                   parameter.
+        :type mu: biogeme.expressions.Expression
+
+        """
+        LogLogit.__init__(self, util, av, choice)
+        self.mu = self._addChild(mu)
+        self.nests = []
+        for m in nests:
+            param = self._addChild(m[0])
+            alphas = {int(i): self._addChild(a) for i, a in m[1].items()}
+            self.nests.append((param, alphas))
+
+    def getValue(self):
+        """ Evaluates the value of the expression
+
+        :return: value of the expression
+        :rtype: float
+        """
+        choice = int(self.choice.getValue())
+        if choice not in self.util:
+            self.logger.warning(f'Choice is {choice}. List of alternatives is {self.util.keys()}')
+            return np.nan
+        if self.av[choice].getValue() == 0.0:
+            return -np.log(0)
+        mu = self.mu.getValue()
+        chosenTerms = []
+        inclusiveValues = []
+        for param, alphas in self.nests:
+            mum = param.getValue()
+            x = {}
+            for i, a in alphas.items():
+                alpha = a.getValue()
+                if alpha != 0.0 and self.av[i].getValue() != 0.0:
+                    x[i] = mum * np.log(alpha) / mu + \
+                        mum * self.util[i].getValue()
+            if not x:
+                continue
+            largest = max(x.values())
+            logSum = largest + np.log(sum(np.exp(v - largest)
+                                          for v in x.values()))
+            inclusiveValues.append(mu * logSum / mum)
+            if choice in x:
+                chosenTerms.append(x[choice] - logSum + inclusiveValues[-1])
+        if not chosenTerms:
+            return -np.log(0)
+        largest = max(chosenTerms)
+        logP = largest + np.log(sum(np.exp(v - largest)
+                                    for v in chosenTerms))
+        largest = max(inclusiveValues)
+        logP -= largest + np.log(sum(np.exp(v - largest)
+                                     for v in inclusiveValues))
+        return logP
+
+    def __str__(self):
+        s = LogLogit.__str__(self)
+        s += f'[{self.mu}]('
+        s += ', '.join([f'{param}:{{' +
+                        ', '.join([f'{i}:{a}' for i, a in alphas.items()]) +
+                        '}'
+                        for param, alphas in self.nests])
+        s += ')'
+        return s
+
+    def getSignature(self):
+        """The signature of a string characterizing an expression.
+
+        This is designed to be communicated to C++, so that the
+        expression can be reconstructed in this environment.
+
+        The list contains the following elements:
+
+            1. the signatures of all the children expressions,
+            2. the name of the expression between < >
+            3. the id of the expression between { }
+            4. the number of alternatives between ( )
+            5. the id of the expression for the chosen alternative,
+               preceeded by a comma.
+            6. the id of the expression for the homogeneity parameter,
+            7. for each alternative, separated by commas:
+
+                 a. the number of the alternative, as defined by the user,
+                 b. the id of the expression for the utility,
+                 c. the id of the expression for the availability condition.
+
+            8. the number of nests,
+            9. for each nest, separated by commas:
+
+                 a. the id of the expression for the nest parameter,
+                 b. the number of alternatives in the nest,
+                 c. for each alternative in the nest, its number and
+                    the id of the expression for its alpha parameter.
+
+        :return: list of the signatures of an expression and its children.
+        :rtype: list(string)
+        """
+        listOfSignatures = []
+        for e in self.children:
+            listOfSignatures += e.getSignature()
+        signature = f'<{self.getClassName()}>'
+        signature += f'{{{id(self)}}}'
+        signature += f'({len(self.util)})'
+        signature += f',{id(self.choice)}'
+        signature += f',{id(self.mu)}'
+        for i, e in self.util.items():
+            signature += f',{i},{id(e)},{id(self.av[i])}'
+        signature += f',{len(self.nests)}'
+        for param, alphas in self.nests:
+            signature += f',{id(param)},{len(alphas)}'
+            for i, a in alphas.items():
+                signature += f',{i},{id(a)}'
+        listOfSignatures += [signature.encode()]
+        return listOfSignatures
+
+
+class _bioLogMev(LogLogit):
+    """This expression captures the logarithm of the choice probability
+    of a network MEV model.
+
+    The generating function is described by a network. Each node k
+    has a parameter mu_k, and its generating function is
+
+    .. math:: G_k(y) = \\sum_l \\alpha_{kl} G_l(y)^{\\mu_k / \\mu_l},
+
+    where the sum is over the successors l of the node. If l is an
+    alternative, :math:`G_l(y)=y_l` and :math:`\\mu_l=1`. The
+    generating function of the model is the one of the root, that is
+    the only node which is not the successor of another one. The
+    model is evaluated, with its derivatives, by a dedicated C++
+    expression, which computes all the derivatives of G in two passes
+    over the network.
+    """
+    def __init__(self, util, av, choice, network, correction=None):
+        """Constructor
+
+        :param util: dictionary where the keys are the identifiers of
+                     the alternatives, and the elements are objects
+                     defining the utility functions.
+
+        :type util: dict(int:biogeme.expressions.Expression)
+
+        :param av: dictionary where the keys are the identifiers of
+                   the alternatives, and the elements are object of
+                   type biogeme.expressions.Expression defining the
+                   availability conditions. If av is None, all the
+                   alternatives are assumed to be always available
+
+        :type av: dict(int:biogeme.expressions.Expression)
+
+        :param choice: formula to obtain the alternative for which the
+                       logit probability must be calculated.
+        :type choice: biogeme.expressions.Expression
+
+        :param network: dictionary where the keys are the names of the
+            nodes, and the elements are tuples containing two items:
+
+            - an object of type biogeme.expressions.Expression
+              representing the parameter of the node,
+            - a dictionary mapping the successors of the node with the
+              corresponding alpha parameters. A successor is either
+              the identifier of an alternative, or the name of
+              another node.
+
+        :type network: dict
+
+        :param correction: dictionary where the keys are the
+            identifiers of the alternatives, and the elements are
+            expressions added to the utilities in the denominator and
+            the numerator of the probability, such as the corrections
+            for endogenous sampling. If None, no correction is applied.
+        :type correction: dict(int:biogeme.expressions.Expression)
+
+        :raise biogemeError: if the network is not valid.
+        """
+        LogLogit.__init__(self, util, av, choice)
+        self.correction = None
+        if correction is not None:
+            if correction.keys() != self.util.keys():
+                raise excep.biogemeError(
+                    f'Incompatible list of alternatives for the corrections '
+                    f'{set(correction.keys())} and the utilities '
+                    f'{set(self.util.keys())}')
+            self.correction = {i: self._addChild(correction[i]) for i in self.util}
+        for name, (_, successors) in network.items():
+            if name in self.util:
+                raise excep.biogemeError(f'Node {name} has the same name '
+                                         f'as an alternative')
+            for l in successors:
+                if l not in self.util and l not in network:
+                    raise excep.biogemeError(f'Successor {l} of node {name} '
+                                             f'is neither an alternative '
+                                             f'nor a node')
+        successorNodes = {l for _, successors in network.values()
+                          for l in successors if l in network}
+        roots = [name for name in network if name not in successorNodes]
+        if len(roots) != 1:
+            raise excep.biogemeError(f'The network must have exactly one '
+                                     f'root, and not {len(roots)}: {roots}')
+        # The nodes are sorted so that the successors of a node come
+        # after it.
+        order = []
+        status = {}
+        def visit(name):
+            status[name] = 1
+            for l in network[name][1]:
+                if l in network:
+                    if status.get(l) == 1:
+                        raise excep.biogemeError(f'The network contains a '
+                                                 f'cycle through node {l}')
+                    if l not in status:
+                        visit(l)
+            status[name] = 2
+            order.append(name)
+        visit(roots[0])
+        if len(order) != len(network):
+            unreachable = [name for name in network if name not in status]
+            raise excep.biogemeError(f'Nodes {unreachable} cannot be reached '
+                                     f'from the root {roots[0]}')
+        order.reverse()
+        self.names = order
+        position = {name: k for k, name in enumerate(order)}
+        self.nodes = []
+        for name in order:
+            mu, successors = network[name]
+            param = self._addChild(mu)
+            edges = []
+            for l, a in successors.items():
+                if l in network:
+                    edges.append((False, position[l], self._addChild(a)))
+                else:
+                    edges.append((True, int(l), self._addChild(a)))
+            self.nodes.append((param, edges))
+
+    def getValue(self):
+        """ Evaluates the value of the expression
+
+        :return: value of the expression
+        :rtype: float
+        """
+        def logSumExp(values):
+            largest = max(values)
+            return largest + np.log(sum(np.exp(v - largest) for v in values))
+
+        choice = int(self.choice.getValue())
+        if choice not in self.util:
+            self.logger.warning(f'Choice is {choice}. List of alternatives is {self.util.keys()}')
+            return np.nan
+        if self.av[choice].getValue() == 0.0:
+            return -np.log(0)
+        V = {i: self.util[i].getValue() for i in self.util
+             if self.av[i].getValue() != 0.0}
+        mu = [param.getValue() for param, _ in self.nodes]
+        # From the alternatives to the root
+        logG = [None] * len(self.nodes)
+        edgeTerms = [[] for _ in self.nodes]
+        for k in reversed(range(len(self.nodes))):
+            for isAlternative, l, a in self.nodes[k][1]:
+                logGl = V.get(l) if isAlternative else logG[l]
+                alpha = a.getValue()
+                if logGl is None or alpha == 0.0:
+                    continue
+                ratio = mu[k] if isAlternative else mu[k] / mu[l]
+                edgeTerms[k].append((isAlternative, l, ratio,
+                                     np.log(alpha) + ratio * logGl))
+            if edgeTerms[k]:
+                logG[k] = logSumExp([t for _, _, _, t in edgeTerms[k]])
+        if logG[0] is None:
+            return -np.log(0)
+        # From the root to the alternatives
+        nodeContributions = [[] for _ in self.nodes]
+        alternativeContributions = {i: [] for i in V}
+        nodeContributions[0].append(0.0)
+        for k in range(len(self.nodes)):
+            if logG[k] is None or not nodeContributions[k]:
+                continue
+            logDerivative = logSumExp(nodeContributions[k])
+            for isAlternative, l, ratio, term in edgeTerms[k]:
+                if isAlternative:
+                    alternativeContributions[l].append(
+                        logDerivative + term + np.log(ratio) - V[l])
+                else:
+                    nodeContributions[l].append(
+                        logDerivative + term + np.log(ratio) - logG[l])
+        H = {}
+        for i, contributions in alternativeContributions.items():
+            if contributions:
+                H[i] = V[i] + logSumExp(contributions)
+                if self.correction is not None:
+                    H[i] += self.correction[i].getValue()
+        if choice not in H:
+            return -np.log(0)
+        return H[choice] - logSumExp(list(H.values()))
+
+    def __str__(self):
+        s = LogLogit.__str__(self)
+        if self.correction is not None:
+            s += '[' + ', '.join([f'{i}:{e}'
+                                  for i, e in self.correction.items()]) + ']'
+        s += '('
+        s += ', '.join([f'{name}[{param}]:{{' +
+                        ', '.join([f'{l if isAlternative else self.names[l]}:{a}'
+                                   for isAlternative, l, a in edges]) +
+                        '}'
+                        for name, (param, edges) in zip(self.names, self.nodes)])
+        s += ')'
+        return s
+
+    def getSignature(self):
+        """The signature of a string characterizing an expression.
+
+        This is designed to be communicated to C++, so that the
+        expression can be reconstructed in this environment.
+
+        The list contains the following elements:
+
+            1. the signatures of all the children expressions,
+            2. the name of the expression between < >
+            3. the id of the expression between { }
+            4. the number of alternatives between ( )
+            5. the id of the expression for the chosen alternative,
+               preceeded by a comma.
+            6. 1 if corrections are present, 0 otherwise,
+            7. for each alternative, separated by commas:
+
+                 a. the number of the alternative, as defined by the user,
+                 b. the id of the expression for the utility,
+                 c. the id of the expression for the availability condition,
+                 d. if corrections are present, the id of the
+                    expression for the correction.
+
+            8. the number of nodes,
+            9. for each node, the root first, separated by commas:
+
+                 a. the id of the expression for the node parameter,
+                 b. the number of successors of the node,
+                 c. for each successor, 1 if it is an alternative and
+                    0 if it is a node, its number or the position of
+                    the node, and the id of the expression for its
+                    alpha parameter.
+
+        :return: list of the signatures of an expression and its children.
+        :rtype: list(string)
+        """
+        listOfSignatures = []
+        for e in self.children:
+            listOfSignatures += e.getSignature()
+        signature = f'<{self.getClassName()}>'
+        signature += f'{{{id(self)}}}'
+        signature += f'({len(self.util)})'
+        signature += f',{id(self.choice)}'
+        signature += f',{0 if self.correction is None else 1}'
+        for i, e in self.util.items():
+            signature += f',{i},{id(e)},{id(self.av[i])}'
+            if self.correction is not None:
+                signature += f',{id(self.correction[i])}'
+        signature += f',{len(self.nodes)}'
+        for param, edges in self.nodes:
+            signature += f',{id(param)},{len(edges)}'
+            for isAlternative, l, a in edges:
+                signature += f',{1 if isAlternative else 0},{l},{id(a)}'
+        listOfSignatures += [signature.encode()]
+        return listOfSignatures
+
+
+class _bioLogLatentClass(Expression):
+    """This expression captures the logarithm of the choice
+    probability of a latent class model.
+
+    The classes are evaluated together by a dedicated C++ expression,
+    that computes the mixture in log space, with its derivatives,
+    without building the tree of the weighted sum.
+    """
+    def __init__(self, membership, models, panel=False):
+        """Constructor
+
+        :param membership: dictionary where the keys are the
+                           identifiers of the classes, and the
+                           elements are objects defining the
+                           utilities of the class membership model.
+        :type membership: dict(int:biogeme.expressions.Expression)
+
+        :param models: dictionary where the keys are the identifiers
+                       of the classes, and the elements are objects
+                       defining the log of the choice probability in
+                       the class, such as the result of
+                       biogeme.models.loglogit.
+        :type models: dict(int:biogeme.expressions.Expression)
+
+        :param panel: if True, the probabilities of the choices of
+                      the individual are multiplied inside each
+                      class, and the membership utilities are
+                      evaluated on the first observation of the
+                      individual.
+        :type panel: bool
+
+        :raise biogemeError: if there is no class, or if the two
+                             dictionaries do not define the same
+                             classes.
+        """
+        Expression.__init__(self)
+        if not membership:
+            raise excep.biogemeError('The latent class model has no class.')
+        if set(membership.keys()) != set(models.keys()):
+            raise excep.biogemeError(f'Inconsistent latent class model. '
+                                     f'Membership: {sorted(membership.keys())}. '
+                                     f'Models: {sorted(models.keys())}.')
+        self.panel = bool(panel)
+        self.membership = {}
+        self.models = {}
+        for k in sorted(membership.keys()):
+            self.membership[k] = self._addChild(membership[k])
+            self.models[k] = self._addChild(models[k])
+
+    def _addChild(self, e):
+        """Adds an expression to the children of the expression.
+
+        :param e: utility or class-specific model.
+        :type e: float or biogeme.expressions.Expression
+
+        :return: the expression.
+        :rtype: biogeme.expressions.Expression
+        """
+        if isNumeric(e):
+            theExpression = Numeric(e)
+        else:
+            if not isinstance(e, Expression):
+                raise excep.biogemeError(f'This is not a valid expression: {e}')
+            theExpression = e
+        theExpression.parent = self
+        self.children.append(theExpression)
+        return theExpression
+
+    def countPanelTrajectoryExpressions(self):
+        """ Count the number of times the PanelLikelihoodTrajectory
+        is used in the formula. With panel data, the expression
+        computes the likelihood of the trajectory.
+        """
+        nbr = 1 if self.panel else 0
+        return nbr + Expression.countPanelTrajectoryExpressions(self)
+
+    def audit(self, database=None):
+        """ Performs various checks on the expressions.
+
+        :param database: database object
+        :type database: biogeme.database.Database
+
+        :return: tuple listOfErrors, listOfWarnings
+        :rtype: list(string), list(string)
+
+        """
+        listOfErrors, listOfWarnings = Expression.audit(self, database)
+        if self.panel and not database.isPanel():
+            theError = (f'The latent class model with panel data can '
+                        f'only be used with panel data. Use the statement '
+                        f'database.panel("IndividualId") to declare the '
+                        f'panel structure of the data: {self}')
+            listOfErrors.append(theError)
+        return listOfErrors, listOfWarnings
+
+    def getValue(self):
+        """ Evaluates the value of the expression
+
+        :return: value of the expression
+        :rtype: float
+
+        :raise biogemeError: with panel data, as the observations of
+                             the individual are needed.
+        """
+        if self.panel:
+            raise excep.biogemeError(f'Expression {self.getClassName()} '
+                                     f'with panel data can only be '
+                                     f'evaluated on a database, using '
+                                     f'getValue_c.')
+
+        def logSumExp(values):
+            largest = max(values)
+            return largest + np.log(sum(np.exp(v - largest) for v in values))
+
+        W = {k: e.getValue() for k, e in self.membership.items()}
+        terms = [W[k] + e.getValue() for k, e in self.models.items()]
+        terms = [t for t in terms if t != -np.inf]
+        if not terms:
+            return -np.log(0)
+        return logSumExp(terms) - logSumExp(list(W.values()))
+
+    def __str__(self):
+        s = 'LatentClass'
+        if self.panel:
+            s += '[panel]'
+        s += '('
+        s += ', '.join([f'{k}:{self.membership[k]}:{self.models[k]}'
+                        for k in self.membership])
+        s += ')'
+        return s
+
+    def getSignature(self):
+        """The signature of a string characterizing an expression.
+
+        This is designed to be communicated to C++, so that the
+        expression can be reconstructed in this environment.
+
+        The list contains the following elements:
+
+            1. the signatures of all the children expressions,
+            2. the name of the expression between < >
+            3. the id of the expression between { }
+            4. the number of classes between ( )
+            5. 1 for panel data, 0 otherwise, preceeded by a comma,
+            6. for each class, separated by commas:
+
+                 a. the id of the expression for the membership utility,
+                 b. the id of the expression for the class-specific model.
+
+        :return: list of the signatures of an expression and its children.
+        :rtype: list(string)
+        """
+        listOfSignatures = []
+        for e in self.children:
+            listOfSignatures += e.getSignature()
+        signature = f'<{self.getClassName()}>'
+        signature += f'{{{id(self)}}}'
+        signature += f'({len(self.membership)})'
+        signature += f',{1 if self.panel else 0}'
+        for k, e in self.membership.items():
+            signature += f',{id(e)},{id(self.models[k])}'
+        listOfSignatures += [signature.encode()]
+        return listOfSignatures
 
 
 class bioMultSum(Expression):
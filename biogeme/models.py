@@ -15,6 +15,11 @@ import biogeme.messaging as msg
 
 from biogeme.expressions import (_bioLogLogit,
                                  _bioLogLogitFullChoiceSet,
+                                 _bioLogLogitSampled,
+                                 _bioLogNested,
+                                 _bioLogCnl,
+                                 _bioLogMev,
+                                 _bioLogLatentClass,
                                  exp,
                                  log,
                                  Elem,
@@ -93,6 +98,67 @@ def logit(V, av, i):
     return exp(_bioLogLogit(V, av, i))
 
 
+def loglogit_sampled(V, av, i, sampleSize, weights=None, seed=0):
+    """The logarithm of the logit model, where the choice set of each
+    observation is replaced by a sample of alternatives, as proposed
+    by `McFadden (1978)`_.
+
+    .. _`McFadden (1978)`:
+       https://elsa.berkeley.edu/reprints/mcfadden/zurich.pdf
+
+    For each observation, sampleSize alternatives are drawn with
+    replacement, with probabilities :math:`q_j` proportional to the
+    weights, and the chosen alternative is added to the sample
+    :math:`D`. The model is
+
+    .. math:: \\frac{e^{V_i + \\ln(k_i/q_i)}}{\\sum_{j \\in D}
+              a_j e^{V_j + \\ln(k_j/q_j)}},
+
+    where :math:`k_j` is the number of times alternative :math:`j`
+    appears in :math:`D`. Only the utilities of the sampled
+    alternatives are evaluated, so that the computational cost does
+    not depend on the number of alternatives. The sample depends only
+    on the seed and the observation, so that it is the same for each
+    evaluation of the likelihood function.
+
+    :param V: dict of objects representing the utility functions of
+              each alternative, indexed by numerical ids.
+
+    :type V: dict(int:biogeme.expressions.Expression)
+
+    :param av: dict of objects representing the availability of each
+               alternative (:math:`a_i` in the above formula), indexed
+               by numerical ids. Must be consistent with V, or
+               None. In this case, all alternatives are supposed to be
+               always available. The unavailable alternatives that
+               are drawn are ignored.
+
+    :type av: dict(int:biogeme.expressions.Expression)
+
+    :param i: id of the alternative for which the probability must be
+              calculated.
+    :type i: int
+
+    :param sampleSize: number of alternatives drawn for each
+                       observation, in addition to the chosen one.
+    :type sampleSize: int
+
+    :param weights: dict of positive numbers, indexed by numerical
+                    ids, proportional to the probability of drawing
+                    each alternative. If None, the alternatives are
+                    drawn with equal probabilities.
+    :type weights: dict(int:float)
+
+    :param seed: seed of the random number generator.
+    :type seed: int
+
+    :return: log of the choice probability of alternative number i,
+             given the sampled choice set.
+    :rtype: biogeme.expressions.Expression
+    """
+    return _bioLogLogitSampled(V, av, i, sampleSize, weights, seed)
+
+
 def boxcox(x, ell):
     """Box-Cox transform
 
@@ -539,6 +605,155 @@ def mev_endogenousSampling(V, logGi, av, correction, choice):
     return exp(logmev_endogenousSampling(V, logGi, av, correction, choice))
 
 
+def lognetworkgev(V, availability, network, choice, correction=None):
+    """Log of the choice probability of a network MEV model, where the
+    generating function is described by a network, as proposed by
+    `Daly and Bierlaire (2006)`_.
+
+    .. _`Daly and Bierlaire (2006)`:
+       http://dx.doi.org/10.1016/j.trb.2005.03.003
+
+    :param V: dict of objects representing the utility functions of
+              each alternative, indexed by numerical ids.
+    :type V: dict(int:biogeme.expressions.Expression)
+
+    :param availability: dict of objects representing the availability of each
+               alternative, indexed
+               by numerical ids. Must be consistent with V, or
+               None. In this case, all alternatives are supposed to be
+               always available.
+
+    :type availability: dict(int:biogeme.expressions.Expression)
+
+    :param network: a dictionary mapping the names of the nodes of the
+            network with tuples containing two items:
+
+          - an object of type biogeme.expressions.Expression
+            representing the parameter :math:`\\mu_k` of the node,
+          - a dictionary mapping the successors of the node with the
+            corresponding :math:`\\alpha` parameters. A successor is
+            either the id of an alternative, or the name of another
+            node.
+
+        The generating function of node :math:`k` is
+
+        .. math:: G_k(y) = \\sum_{\\ell} \\alpha_{k\\ell}
+                  G_\\ell(y)^{\\mu_k/\\mu_\\ell},
+
+        where :math:`G_\\ell(y)=y_\\ell` and :math:`\\mu_\\ell=1` if
+        :math:`\\ell` is an alternative. The network must be acyclic,
+        and have exactly one root, that is a node which is not the
+        successor of any other node. The generating function of the
+        model is the one of the root.
+
+        Example::
+
+            network = {'root': (1.0, {'public': 1.0, 3: 1.0}),
+                       'public': (MU_PUBLIC, {1: 1.0, 2: 1.0})}
+
+    :type network: dict
+
+    :param choice: id of the alternative for which the probability must be
+              calculated.
+    :type choice: biogeme.expressions.Expression
+
+    :param correction: a dict of expressions for the correction terms
+                       of each alternative, such as the correction for
+                       endogenous sampling. If None, no correction is
+                       applied.
+    :type correction: dict(int:biogeme.expressions.Expression)
+
+    :return: log of the choice probability of the network MEV model.
+    :rtype: biogeme.expressions.Expression
+
+    :raise biogemeError: if the network is not valid.
+
+    :note: the model is evaluated by a dedicated expression, that
+           computes all the derivatives of the generating function in
+           two passes over the network.
+
+    """
+    return _bioLogMev(V, availability, choice, network, correction)
+
+def networkgev(V, availability, network, choice, correction=None):
+    """Choice probability of a network MEV model.
+
+    :param V: dict of objects representing the utility functions of
+              each alternative, indexed by numerical ids.
+    :type V: dict(int:biogeme.expressions.Expression)
+
+    :param availability: dict of objects representing the availability of each
+               alternative, indexed
+               by numerical ids. Must be consistent with V, or
+               None. In this case, all alternatives are supposed to be
+               always available.
+
+    :type availability: dict(int:biogeme.expressions.Expression)
+
+    :param network: a dictionary mapping the names of the nodes of the
+            network with tuples containing the parameter of the node,
+            and a dictionary mapping its successors with the
+            corresponding :math:`\\alpha` parameters. See
+            :func:`lognetworkgev`.
+    :type network: dict
+
+    :param choice: id of the alternative for which the probability must be
+              calculated.
+    :type choice: biogeme.expressions.Expression
+
+    :param correction: a dict of expressions for the correction terms
+                       of each alternative. If None, no correction is
+                       applied.
+    :type correction: dict(int:biogeme.expressions.Expression)
+
+    :return: choice probability of the network MEV model.
+    :rtype: biogeme.expressions.Expression
+
+    """
+    return exp(lognetworkgev(V, availability, network, choice, correction))
+
+
+def loglatentclass(membership, models, panel=False):
+    """The logarithm of the choice probability of a latent class model
+
+    The model is defined as
+
+    .. math:: \\sum_{c=1}^C \\frac{e^{W_c}}{\\sum_{d=1}^C e^{W_d}} P(i|c),
+
+    where :math:`W_c` is the utility of class :math:`c` in the class
+    membership model, and :math:`P(i|c)` the choice probability in
+    class :math:`c`.
+
+    :param membership: dict of objects representing the utilities of
+              the class membership model, indexed by numerical ids of
+              the classes.
+    :type membership: dict(int:biogeme.expressions.Expression)
+
+    :param models: dict of objects representing the log of the choice
+              probability in each class, such as loglogit(V, av,
+              CHOICE), indexed by the same ids as membership.
+    :type models: dict(int:biogeme.expressions.Expression)
+
+    :param panel: if True, :math:`P(i|c)` is the product of the
+              probabilities of the choices of the individual, which
+              are computed inside each class. The membership
+              utilities are evaluated on the first observation of
+              the individual.
+    :type panel: bool
+
+    :return: log of the choice probability of the latent class model.
+    :rtype: biogeme.expressions.Expression
+
+    :raise biogemeError: if the classes of membership and models
+                         differ.
+
+    :note: the classes are evaluated together by a dedicated
+           expression, and the mixture is computed in log space.
+
+    """
+    return _bioLogLatentClass(membership, models, panel)
+
+
 def getMevForNested(V, availability, nests):
     """ Implements the MEV generating function for the nested logit model
 
@@ -706,14 +921,7 @@ def nested(V, availability, nests, choice):
              by the function getMevForNested
 
     """
-
-    ok, message = checkValidityNestedLogit(V, nests)
-    if not ok:
-        raise excep.biogemeError(message)
-
-    logGi = getMevForNested(V, availability, nests)
-    P = mev(V, logGi, availability, choice)
-    return P
+    return exp(lognested(V, availability, nests, choice))
 
 def lognested(V, availability, nests, choice):
     """Implements the log of a nested logit model as a MEV model.
@@ -755,13 +963,15 @@ def lognested(V, availability, nests, choice):
              based on the derivatives of the MEV generating function produced
              by the function getMevForNested
 
+    :note: the model is evaluated by a dedicated expression, that
+           computes the derivatives without building the tree of the
+           MEV generating function.
+
     """
     ok, message = checkValidityNestedLogit(V, nests)
     if not ok:
         raise excep.biogemeError(message)
-    logGi = getMevForNested(V, availability, nests)
-    logP = logmev(V, logGi, availability, choice)
-    return logP
+    return _bioLogNested(V, availability, choice, nests)
 
 def nestedMevMu(V, availability, nests, choice, mu):
     """Implements the nested logit model as a MEV model, where mu is also
@@ -874,10 +1084,10 @@ def lognestedMevMu(V, availability, nests, choice, mu):
     :rtype: biogeme.expressions.Expression
 
     """
-
-    logGi = getMevForNestedMu(V, availability, nests, mu)
-    logP = logmev(V, logGi, availability, choice)
-    return logP
+    ok, message = checkValidityNestedLogit(V, nests)
+    if not ok:
+        raise excep.biogemeError(message)
+    return _bioLogNested(V, availability, choice, nests, mu)
 
 def cnl_avail(V, availability, nests, choice):
     """ Same as cnl. Maintained for backward compatibility
@@ -1165,13 +1375,15 @@ def logcnl(V, availability, nests, choice):
     :return: log of the choice probability for the cross-nested logit model.
     :rtype: biogeme.expressions.Expression
 
+    :note: the model is evaluated by a dedicated expression, that
+           computes the derivatives without building the tree of the
+           MEV generating function.
+
     """
     ok, message = checkValidityCNL(V, nests)
     if not ok:
         raise excep.biogemeError(message)
-    logGi = getMevForCrossNested(V, availability, nests)
-    logP = logmev(V, logGi, availability, choice)
-    return logP
+    return _bioLogCnl(V, availability, choice, nests)
 
 
 def cnlmu(V, availability, nests, choice, mu):
@@ -1371,9 +1583,7 @@ def logcnlmu(V, availability, nests, choice, mu):
     ok, message = checkValidityCNL(V, nests)
     if not ok:
         raise excep.biogemeError(message)
-    logGi = getMevForCrossNestedMu(V, availability, nests, mu)
-    logP = logmev(V, logGi, availability, choice)
-    return logP
+    return _bioLogCnl(V, availability, choice, nests, mu)
 
 def checkValidityNestedLogit(V, nests):
     """Verifies if the nested logit model is indeed based on a partition
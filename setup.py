@@ -84,12 +84,23 @@ source = ['src/biogeme.cc',
           'src/bioNormalCdf.cc',
           'src/bioFormula.cc',
           'src/bioThreadMemory.cc',
+          'src/bioEvaluationState.cc',
+          'src/bioSignatureParser.cc',
+          'src/bioModelCache.cc',
+          'src/bioDrawGenerator.cc',
+          'src/bioDrawTable.cc',
+          'src/bioDrawCache.cc',
+          'src/bioPartialIntegral.cc',
           'src/bioString.cc',
+          'src/bioSlotTable.cc',
           'src/bioExprNormalCdf.cc',
+          'src/bioExprNormalPdf.cc',
           'src/bioExprIntegrate.cc',
+          'src/bioExprMultipleIntegrate.cc',
           'src/bioExprGaussHermite.cc',
           'src/bioExprRandomVariable.cc',
           'src/bioExprMontecarlo.cc',
+          'src/bioExprMixedLogit.cc',
           'src/bioExprPanelTrajectory.cc',
           'src/bioExprDraws.cc',
           'src/bioExprDerive.cc',
@@ -120,12 +131,19 @@ source = ['src/biogeme.cc',
           'src/bioExprNumeric.cc',
           'src/bioExprLogLogit.cc',
           'src/bioExprLogLogitFullChoiceSet.cc',
+          'src/bioExprLogLogitSampled.cc',
+          'src/bioExprLogNested.cc',
+          'src/bioExprLogCnl.cc',
+          'src/bioExprLogMev.cc',
+          'src/bioExprLogLatentClass.cc',
           'src/bioExprLinearUtility.cc',
           'src/bioExpression.cc',
           'src/bioExceptions.cc',
           'src/bioDerivatives.cc',
+          'src/bioBatchDerivatives.cc',
           'src/bioGaussHermite.cc',
           'src/bioGhFunction.cc',
+          'src/bioSparseGrid.cc',
           'src/mycfsqp.cc',
           'src/myqld.cc',
           'src/bioCfsqp.cc']
@@ -0,0 +1,29 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioBatchDerivatives.cc
+// @date   Mon Oct 19 02:52:08 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include "bioBatchDerivatives.h"
+#include <algorithm>
+
+bioBatchDerivatives::bioBatchDerivatives(bioUInt nbr, bioUInt s, bioBoolean gradient) :
+  n(nbr),
+  size(s),
+  hasGradient(gradient),
+  f(s),
+  g(gradient ? std::size_t(nbr) * s : 0),
+  active(gradient ? nbr : 0, 0) {
+}
+
+void bioBatchDerivatives::setToZero() {
+  std::fill(f.begin(),f.end(),0.0) ;
+  for (bioUInt i = 0 ; i < active.size() ; ++i) {
+    if (active[i]) {
+      std::fill(gradient(i),gradient(i)+size,0.0) ;
+      active[i] = false ;
+    }
+  }
+}
@@ -0,0 +1,43 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioBatchDerivatives.h
+// @date   Mon Oct 19 02:49:54 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioBatchDerivatives_h
+#define bioBatchDerivatives_h
+
+#include <vector>
+#include "bioTypes.h"
+
+// Values and gradients of an expression for a batch of consecutive
+// draws. The gradient is stored literal by literal, so that the loops
+// on the draws access contiguous memory: g[i * size + r] is the
+// derivative with respect to literal i for draw r of the batch. If
+// active[i] is false, the derivatives with respect to literal i are
+// zero for all the draws, and the calculations involving them can be
+// skipped.
+class bioBatchDerivatives {
+ public:
+  bioBatchDerivatives(bioUInt n, bioUInt size, bioBoolean gradient) ;
+  bioReal* gradient(bioUInt i) {
+    return &g[std::size_t(i) * size] ;
+  }
+  const bioReal* gradient(bioUInt i) const {
+    return &g[std::size_t(i) * size] ;
+  }
+  // Prepares the object to receive the result of another evaluation.
+  void setToZero() ;
+  // Number of literals
+  bioUInt n ;
+  // Number of draws
+  bioUInt size ;
+  bioBoolean hasGradient ;
+  std::vector<bioReal> f ;
+  std::vector<bioReal> g ;
+  std::vector<char> active ;
+};
+
+#endif
@@ -21,17 +21,26 @@
 const bioUInt bioBadId = static_cast<bioUInt>(-1) ;
 const bioReal bioPi = 3.141592653589793238463 ;
 const bioReal invSqrtTwoPi = 0.3989422804 ;
+// Number of draws processed together by the Monte-Carlo integration
+const bioUInt bioDrawBatchSize = 128 ;
+// When the draws of the individuals are split among the threads,
+// number of work items per thread, to balance the load.
+const bioUInt bioWorkItemsPerThread = 4 ;
+// Number of points of the Gauss-Hermite quadrature, if not specified
+const bioUInt bioGhDefaultOrder = 100 ;
+// Levels of the sparse grids for multiple integrals. At level q, the
+// grid is exact for the polynomials of degree 2q-1.
+const bioUInt bioSparseGridDefaultLevel = 5 ;
+const bioUInt bioSparseGridMaxLevel = 25 ;
 
 class bioLogMaxReal {
 public:
   /**
    */
   static bioReal the() {
-    static bioLogMaxReal* me = NULL ;
-    if (me == NULL) {
-      me = new bioLogMaxReal() ;
-    }
-    return (me->val) ;
+    // Initialization of a local static is thread safe.
+    static const bioLogMaxReal me ;
+    return (me.val) ;
   } ;
 private :
   bioLogMaxReal() : val(log(std::numeric_limits<bioReal>::max())) {
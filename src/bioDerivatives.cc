@@ -8,6 +8,8 @@
 //--------------------------------------------------------------------
 
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 #include "bioDerivatives.h"
 
 /**
@@ -31,6 +33,142 @@ void bioDerivatives::setGradientToZero() {
   std::fill(g.begin(),g.end(),0.0) ;
 }
 
+void bioDerivatives::add(bioReal a,
+			 const bioDerivatives& x,
+			 bioBoolean gradient,
+			 bioBoolean hessian) {
+  f += a * x.f ;
+  if (!gradient && !hessian) {
+    return ;
+  }
+  bioUInt n = g.size() ;
+  for (bioUInt i = 0 ; i < n ; ++i) {
+    g[i] += a * x.g[i] ;
+  }
+  if (hessian) {
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      for (bioUInt j = 0 ; j < n ; ++j) {
+	h[i][j] += a * x.h[i][j] ;
+      }
+    }
+  }
+}
+
+void bioDerivatives::setComposition(const bioDerivatives& x,
+				    bioReal phi,
+				    bioReal d1,
+				    bioReal d2,
+				    bioBoolean gradient,
+				    bioBoolean hessian) {
+  f = phi ;
+  if (!gradient && !hessian) {
+    return ;
+  }
+  bioUInt n = g.size() ;
+  for (bioUInt i = 0 ; i < n ; ++i) {
+    g[i] = d1 * x.g[i] ;
+  }
+  if (hessian) {
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      for (bioUInt j = 0 ; j < n ; ++j) {
+	h[i][j] = d1 * x.h[i][j] ;
+      }
+      if (x.g[i] != 0.0) {
+	for (bioUInt j = 0 ; j < n ; ++j) {
+	  h[i][j] += d2 * x.g[i] * x.g[j] ;
+	}
+      }
+    }
+  }
+}
+
+void bioDerivatives::setProduct(const bioDerivatives& x,
+				const bioDerivatives& y,
+				bioBoolean gradient,
+				bioBoolean hessian) {
+  f = x.f * y.f ;
+  if (!gradient && !hessian) {
+    return ;
+  }
+  bioUInt n = g.size() ;
+  for (bioUInt i = 0 ; i < n ; ++i) {
+    g[i] = x.f * y.g[i] + y.f * x.g[i] ;
+  }
+  if (hessian) {
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      for (bioUInt j = 0 ; j < n ; ++j) {
+	h[i][j] = x.f * y.h[i][j] + y.f * x.h[i][j] ;
+      }
+    }
+    addSymmetricProduct(1.0,x.g,y.g) ;
+  }
+}
+
+void bioDerivatives::setLogSumExp(const std::vector<const bioDerivatives*>& x,
+				  bioBoolean gradient,
+				  bioBoolean hessian) {
+  bioReal largest = -bioMaxReal ;
+  for (std::vector<const bioDerivatives*>::const_iterator k = x.begin() ;
+       k != x.end() ;
+       ++k) {
+    if ((*k)->f > largest) {
+      largest = (*k)->f ;
+    }
+  }
+  std::vector<bioReal> w(x.size()) ;
+  bioReal sum = 0.0 ;
+  for (bioUInt k = 0 ; k < x.size() ; ++k) {
+    w[k] = exp(x[k]->f - largest) ;
+    sum += w[k] ;
+  }
+  f = largest + log(sum) ;
+  if (!gradient && !hessian) {
+    return ;
+  }
+  // The weights are the shares exp(x_k - f).
+  bioUInt n = g.size() ;
+  std::fill(g.begin(),g.end(),0.0) ;
+  for (bioUInt k = 0 ; k < x.size() ; ++k) {
+    w[k] /= sum ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      g[i] += w[k] * x[k]->g[i] ;
+    }
+  }
+  if (hessian) {
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      std::fill(h[i].begin(),h[i].end(),0.0) ;
+    }
+    for (bioUInt k = 0 ; k < x.size() ; ++k) {
+      const bioDerivatives& xk = *x[k] ;
+      for (bioUInt i = 0 ; i < n ; ++i) {
+	for (bioUInt j = 0 ; j < n ; ++j) {
+	  h[i][j] += w[k] * xk.h[i][j] ;
+	}
+      }
+      addSymmetricProduct(0.5 * w[k],xk.g,xk.g) ;
+    }
+    addSymmetricProduct(-0.5,g,g) ;
+  }
+}
+
+void bioDerivatives::addSymmetricProduct(bioReal a,
+					 const std::vector<bioReal>& u,
+					 const std::vector<bioReal>& v) {
+  if (a == 0.0) {
+    return ;
+  }
+  bioUInt n = g.size() ;
+  for (bioUInt i = 0 ; i < n ; ++i) {
+    if (u[i] != 0.0) {
+      bioReal au = a * u[i] ;
+      for (bioUInt j = 0 ; j < n ; ++j) {
+	h[i][j] += au * v[j] ;
+	h[j][i] += au * v[j] ;
+      }
+    }
+  }
+}
+
 std::ostream& operator<<(std::ostream &str, const bioDerivatives& x) {
   str << "f = " << x.f << std::endl ;
   str << "g = [" ; 
@@ -12,6 +12,7 @@
 #define bioDerivatives_h
 
 #include <vector>
+#include <iostream>
 #include "bioTypes.h"
 
 class bioDerivatives {
@@ -21,6 +22,37 @@ class bioDerivatives {
   void setGradientToZero() ;
   void setHessianToZero() ;
   bioUInt getSize() const ;
+  // Chain rules used by the expressions computing closed-form
+  // derivatives of composite functions. The hessian is updated only
+  // if requested, and the gradient only if gradient or hessian is
+  // requested. The arguments must not be the object itself.
+  //
+  // this += a * x
+  void add(bioReal a,
+	   const bioDerivatives& x,
+	   bioBoolean gradient,
+	   bioBoolean hessian) ;
+  // this = phi(x), where d1 and d2 are the first and second
+  // derivatives of phi evaluated at x.f.
+  void setComposition(const bioDerivatives& x,
+		      bioReal phi,
+		      bioReal d1,
+		      bioReal d2,
+		      bioBoolean gradient,
+		      bioBoolean hessian) ;
+  // this = x * y
+  void setProduct(const bioDerivatives& x,
+		  const bioDerivatives& y,
+		  bioBoolean gradient,
+		  bioBoolean hessian) ;
+  // this = log(sum_k exp(x_k)), computed without overflow.
+  void setLogSumExp(const std::vector<const bioDerivatives*>& x,
+		    bioBoolean gradient,
+		    bioBoolean hessian) ;
+  // h += a * (u v^T + v u^T)
+  void addSymmetricProduct(bioReal a,
+			   const std::vector<bioReal>& u,
+			   const std::vector<bioReal>& v) ;
   bioReal f ;
   std::vector<bioReal> g ;
   std::vector<std::vector<bioReal> > h ;
@@ -0,0 +1,158 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioDrawCache.cc
+// @date   Mon Oct 19 03:17:38 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include "bioDrawCache.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bioDrawTable.h"
+#include "bioExceptions.h"
+
+// Must be incremented each time the format of the file, or the
+// draws generated by bioDrawGenerator, are modified.
+static const uint32_t bioDrawCacheVersion = 1 ;
+static const char bioDrawCacheMagic[8] = {'b','i','o','d','r','a','w','s'} ;
+// Detects files written on a machine with another byte order.
+static const uint32_t bioDrawCacheByteOrder = 0x01020304 ;
+// The draws start on a cache line of the mapped file.
+static const std::size_t bioDrawCacheAlignment = 64 ;
+
+static void appendBytes(std::vector<char>& h, const void* x, std::size_t n) {
+  const char* c = static_cast<const char*>(x) ;
+  h.insert(h.end(),c,c+n) ;
+}
+
+static void appendInteger(std::vector<char>& h, uint64_t x) {
+  appendBytes(h,&x,sizeof(x)) ;
+}
+
+bioDrawCache::bioDrawCache(const bioString& directory,
+			   const std::vector<bioString>& types,
+			   bioUInt n,
+			   bioUInt r,
+			   bioUInt seed,
+			   bioBoolean sp) :
+  theTypes(types),
+  sampleSize(n),
+  numberOfDraws(r),
+  theSeed(seed),
+  singlePrecision(sp) {
+  // 64-bit FNV-1a hash of the header, that contains all the
+  // characteristics of the draws.
+  std::vector<char> header = getHeader() ;
+  uint64_t h = 14695981039346656037ULL ;
+  for (std::vector<char>::const_iterator c = header.begin() ;
+       c != header.end() ;
+       ++c) {
+    h = (h ^ static_cast<unsigned char>(*c)) * 1099511628211ULL ;
+  }
+  std::stringstream str ;
+  str << directory ;
+  if (!directory.empty() && directory[directory.size()-1] != '/') {
+    str << '/' ;
+  }
+  str << "biogeme_draws_" << std::hex << std::setw(16) << std::setfill('0') << h << ".bin" ;
+  theFileName = str.str() ;
+}
+
+bioString bioDrawCache::getFileName() const {
+  return theFileName ;
+}
+
+std::vector<char> bioDrawCache::getHeader() const {
+  std::vector<char> h ;
+  appendBytes(h,bioDrawCacheMagic,sizeof(bioDrawCacheMagic)) ;
+  appendBytes(h,&bioDrawCacheVersion,sizeof(bioDrawCacheVersion)) ;
+  appendBytes(h,&bioDrawCacheByteOrder,sizeof(bioDrawCacheByteOrder)) ;
+  appendInteger(h,(singlePrecision) ? sizeof(float) : sizeof(bioReal)) ;
+  appendInteger(h,sampleSize) ;
+  appendInteger(h,numberOfDraws) ;
+  appendInteger(h,theSeed) ;
+  appendInteger(h,theTypes.size()) ;
+  for (std::vector<bioString>::const_iterator i = theTypes.begin() ;
+       i != theTypes.end() ;
+       ++i) {
+    appendInteger(h,i->size()) ;
+    appendBytes(h,i->data(),i->size()) ;
+  }
+  // Padding up to the alignment of the draws
+  h.resize((h.size() + bioDrawCacheAlignment - 1) / bioDrawCacheAlignment * bioDrawCacheAlignment,0) ;
+  return h ;
+}
+
+bioBoolean bioDrawCache::load(bioDrawTable& table) const {
+  int fd = open(theFileName.c_str(),O_RDONLY) ;
+  if (fd < 0) {
+    return false ;
+  }
+  struct stat st ;
+  if (fstat(fd,&st) != 0 || st.st_size <= 0) {
+    close(fd) ;
+    return false ;
+  }
+  std::size_t length = st.st_size ;
+  void* m = mmap(NULL,length,PROT_READ,MAP_SHARED,fd,0) ;
+  // The mapping remains valid after the file is closed.
+  close(fd) ;
+  if (m == MAP_FAILED) {
+    return false ;
+  }
+  // The whole header is compared, as two different sets of draws may
+  // have the same hash.
+  std::vector<char> header = getHeader() ;
+  std::size_t sizeOfElement = (singlePrecision) ? sizeof(float) : sizeof(bioReal) ;
+  std::size_t dataSize = std::size_t(sampleSize) * theTypes.size() * bioDrawTable::getStride(numberOfDraws,sizeOfElement) * sizeOfElement ;
+  if (length < header.size() ||
+      length - header.size() != dataSize ||
+      !std::equal(header.begin(),header.end(),static_cast<const char*>(m))) {
+    munmap(m,length) ;
+    return false ;
+  }
+  table.setMapped(m,length,header.size(),singlePrecision,sampleSize,numberOfDraws,theTypes.size()) ;
+  return true ;
+}
+
+void bioDrawCache::save(const bioDrawTable& table) const {
+  if (table.isSinglePrecision() != singlePrecision ||
+      table.getSampleSize() != sampleSize ||
+      table.getNumberOfDraws() != numberOfDraws ||
+      table.getNumberOfVariables() != theTypes.size() ||
+      table.getData() == NULL) {
+    throw bioExceptions(__FILE__,__LINE__,"The draws do not correspond to the cache") ;
+  }
+  // The file is written under a temporary name, and renamed when
+  // complete, so that another process never maps a partial file.
+  std::stringstream tmp ;
+  tmp << theFileName << "." << getpid() << ".tmp" ;
+  bioString tmpName = tmp.str() ;
+  {
+    std::ofstream f(tmpName.c_str(),std::ios::binary | std::ios::trunc) ;
+    if (!f) {
+      throw bioExceptions(__FILE__,__LINE__,"Cannot write the file "+tmpName) ;
+    }
+    std::vector<char> header = getHeader() ;
+    f.write(header.data(),header.size()) ;
+    f.write(static_cast<const char*>(table.getData()),table.getDataSize()) ;
+    f.close() ;
+    if (!f) {
+      std::remove(tmpName.c_str()) ;
+      throw bioExceptions(__FILE__,__LINE__,"Error while writing the file "+tmpName) ;
+    }
+  }
+  if (std::rename(tmpName.c_str(),theFileName.c_str()) != 0) {
+    std::remove(tmpName.c_str()) ;
+    throw bioExceptions(__FILE__,__LINE__,"Cannot create the file "+theFileName) ;
+  }
+}
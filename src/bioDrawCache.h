@@ -0,0 +1,50 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioDrawCache.h
+// @date   Mon Oct 19 03:15:24 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioDrawCache_h
+#define bioDrawCache_h
+
+#include <vector>
+#include <cstdint>
+#include "bioTypes.h"
+#include "bioString.h"
+
+class bioDrawTable ;
+
+// Table of draws generated by bioDrawGenerator, stored in a
+// directory. The name of the file is a hash of the types of draws,
+// the sample size, the number of draws, the seed, the precision and
+// the version of the generator, so that the next runs with the same
+// draws map the file in memory instead of generating them again. The
+// draws are stored in the layout of bioDrawTable, and are used
+// directly from the mapped file, without copy.
+class bioDrawCache {
+ public:
+  bioDrawCache(const bioString& directory,
+	       const std::vector<bioString>& types,
+	       bioUInt sampleSize,
+	       bioUInt numberOfDraws,
+	       bioUInt seed,
+	       bioBoolean singlePrecision) ;
+  // Returns false if the draws are not in the cache, or if the file
+  // cannot be used. In that case, the draws must be generated.
+  bioBoolean load(bioDrawTable& table) const ;
+  void save(const bioDrawTable& table) const ;
+  bioString getFileName() const ;
+ private:
+  // Header of the file, before the draws.
+  std::vector<char> getHeader() const ;
+  bioString theFileName ;
+  std::vector<bioString> theTypes ;
+  bioUInt sampleSize ;
+  bioUInt numberOfDraws ;
+  bioUInt theSeed ;
+  bioBoolean singlePrecision ;
+} ;
+
+#endif
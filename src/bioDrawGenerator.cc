@@ -0,0 +1,505 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioDrawGenerator.cc
+// @date   Mon Oct 19 02:36:00 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include "bioDrawGenerator.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <pthread.h>
+#include "bioExceptions.h"
+
+// As in the Python database, the Halton sequences skip their first
+// elements.
+static const bioUInt bioHaltonSkip = 11 ;
+
+bioDrawGenerator::bioDrawGenerator(std::vector<bioString> types,
+				   bioUInt n,
+				   bioUInt seed) :
+  numberOfDraws(n),
+  theSeed(uint32_t(seed)) {
+  if (numberOfDraws == 0) {
+    throw bioExceptions(__FILE__,__LINE__,"Invalid number of draws: 0") ;
+  }
+  if (numberOfDraws > bioUInt(UINT32_MAX)) {
+    std::stringstream str ;
+    str << "Too many draws: " << numberOfDraws ;
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  for (std::vector<bioString>::const_iterator i = types.begin() ;
+       i != types.end() ;
+       ++i) {
+    bioDrawType t = getType(*i) ;
+    if (t.antithetic && numberOfDraws % 2 != 0) {
+      std::stringstream str ;
+      str << "Please specify an even number of draws for antithetic draws. Requested number of " << numberOfDraws ;
+      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    }
+    theTypes.push_back(t) ;
+  }
+}
+
+bioDrawGenerator::bioDrawDistribution bioDrawGenerator::getDistribution(const bioString& name) {
+  if (name.compare(0,10,"UNIFORMSYM") == 0) {
+    return bioUniformSym ;
+  }
+  if (name.compare(0,7,"UNIFORM") == 0) {
+    return bioUniform ;
+  }
+  if (name.compare(0,6,"NORMAL") == 0) {
+    return bioNormal ;
+  }
+  throw bioExceptions(__FILE__,__LINE__,"Unknown type of draws: "+name) ;
+}
+
+bioBoolean bioDrawGenerator::isShared(const bioString& name) {
+  return getType(name).sequence == bioShiftedHalton ;
+}
+
+bioDrawGenerator::bioDrawType bioDrawGenerator::getType(const bioString& name) {
+  bioDrawType t ;
+  t.distribution = getDistribution(name) ;
+  bioString variant ;
+  switch (t.distribution) {
+  case bioUniformSym:
+    variant = name.substr(10) ;
+    break ;
+  case bioUniform:
+    variant = name.substr(7) ;
+    break ;
+  case bioNormal:
+    variant = name.substr(6) ;
+    break ;
+  }
+  t.sequence = bioPseudoRandom ;
+  t.antithetic = false ;
+  t.base = 0 ;
+  if (variant == "") {
+  }
+  else if (variant == "_ANTI") {
+    t.antithetic = true ;
+  }
+  else if (variant == "_HALTON2") {
+    t.sequence = bioHalton ;
+    t.base = 2 ;
+  }
+  else if (variant == "_HALTON3") {
+    t.sequence = bioHalton ;
+    t.base = 3 ;
+  }
+  else if (variant == "_HALTON5") {
+    t.sequence = bioHalton ;
+    t.base = 5 ;
+  }
+  else if (variant == "_RHALTON2") {
+    t.sequence = bioRandomizedHalton ;
+    t.base = 2 ;
+  }
+  else if (variant == "_RHALTON3") {
+    t.sequence = bioRandomizedHalton ;
+    t.base = 3 ;
+  }
+  else if (variant == "_RHALTON5") {
+    t.sequence = bioRandomizedHalton ;
+    t.base = 5 ;
+  }
+  else if (variant == "_SHALTON2") {
+    t.sequence = bioShiftedHalton ;
+    t.base = 2 ;
+  }
+  else if (variant == "_SHALTON3") {
+    t.sequence = bioShiftedHalton ;
+    t.base = 3 ;
+  }
+  else if (variant == "_SHALTON5") {
+    t.sequence = bioShiftedHalton ;
+    t.base = 5 ;
+  }
+  else if (variant == "_MLHS") {
+    t.sequence = bioMlhs ;
+  }
+  else if (variant == "_MLHS_ANTI") {
+    t.sequence = bioMlhs ;
+    t.antithetic = true ;
+  }
+  else {
+    throw bioExceptions(__FILE__,__LINE__,"Unknown type of draws: "+name) ;
+  }
+  return t ;
+}
+
+bioUInt bioDrawGenerator::getNumberOfDraws() const {
+  return numberOfDraws ;
+}
+
+bioUInt bioDrawGenerator::getNumberOfVariables() const {
+  return theTypes.size() ;
+}
+
+bioReal bioDrawGenerator::getDraw(bioUInt individual,
+				  bioUInt draw,
+				  bioUInt variable) const {
+  if (variable >= theTypes.size()) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,variable,0,theTypes.size()-1) ;
+  }
+  if (draw >= numberOfDraws) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,draw,0,numberOfDraws-1) ;
+  }
+  const bioDrawType& t = theTypes[variable] ;
+  // The second half of antithetic draws is the mirror of the first
+  // half.
+  bioBoolean mirror = false ;
+  if (t.antithetic && draw >= numberOfDraws / 2) {
+    draw -= numberOfDraws / 2 ;
+    mirror = true ;
+  }
+  bioReal u = getUniform(t,individual,draw,variable) ;
+  if (mirror) {
+    u = 1.0 - u ;
+  }
+  return transform(t.distribution,u) ;
+}
+
+bioReal bioDrawGenerator::getUniform(const bioDrawType& t,
+				     bioUInt individual,
+				     bioUInt draw,
+				     bioUInt variable) const {
+  bioUInt length = (t.antithetic) ? numberOfDraws / 2 : numberOfDraws ;
+  switch (t.sequence) {
+  case bioPseudoRandom: {
+    uint32_t c[4] = {uint32_t(draw),
+		     uint32_t(individual),
+		     uint32_t(uint64_t(individual) >> 32),
+		     uint32_t(variable)} ;
+    philox(c,0) ;
+    return toUniform(c[0],c[1]) ;
+  }
+  case bioHalton:
+    // Consecutive elements of the sequence are assigned to the
+    // draws of each individual.
+    return radicalInverse(uint64_t(individual) * length + draw + bioHaltonSkip,t.base) ;
+  case bioRandomizedHalton: {
+    uint32_t c[4] = {0,0,0,uint32_t(variable)} ;
+    philox(c,2) ;
+    bioReal u = radicalInverse(uint64_t(individual) * length + draw + bioHaltonSkip,t.base) + toUniform(c[0],c[1]) ;
+    return (u >= 1.0) ? u - 1.0 : u ;
+  }
+  case bioShiftedHalton: {
+    bioReal u = radicalInverse(uint64_t(draw) + bioHaltonSkip,t.base) + getShift(individual,variable) ;
+    return (u >= 1.0) ? u - 1.0 : u ;
+  }
+  case bioMlhs: {
+    // Modified Latin Hypercube Sampling (Hess et al., 2006): one
+    // random shift and one random permutation of the strata for each
+    // individual and each variable.
+    uint32_t c[4] = {0,
+		     uint32_t(individual),
+		     uint32_t(uint64_t(individual) >> 32),
+		     uint32_t(variable)} ;
+    philox(c,1) ;
+    bioReal shift = toUniform(c[0],c[1]) ;
+    uint32_t stratum = permute(uint32_t(draw),uint32_t(length),c[2]) ;
+    return (bioReal(stratum) + shift) / bioReal(length) ;
+  }
+  }
+  return 0.0 ;
+}
+
+void bioDrawGenerator::generate(bioUInt variable,
+				bioUInt sampleSize,
+				bioReal* output,
+				bioUInt nbrOfThreads) const {
+  if (output == NULL) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"draws") ;
+  }
+  if (variable >= theTypes.size()) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,variable,0,theTypes.size()-1) ;
+  }
+  parallelFor(sampleSize,nbrOfThreads,[&](bioUInt begin, bioUInt end) {
+      for (bioUInt n = begin ; n < end ; ++n) {
+	for (bioUInt r = 0 ; r < numberOfDraws ; ++r) {
+	  output[n * numberOfDraws + r] = getDraw(n,r,variable) ;
+	}
+      }
+    }) ;
+}
+
+void bioDrawGenerator::generateShared(bioUInt variable,
+				      bioUInt sampleSize,
+				      bioReal* base,
+				      bioReal* shifts) const {
+  if (base == NULL || shifts == NULL) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"draws") ;
+  }
+  if (variable >= theTypes.size()) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,variable,0,theTypes.size()-1) ;
+  }
+  const bioDrawType& t = theTypes[variable] ;
+  if (t.sequence != bioShiftedHalton) {
+    throw bioExceptions(__FILE__,__LINE__,"The draws are not shared by the individuals") ;
+  }
+  for (bioUInt r = 0 ; r < numberOfDraws ; ++r) {
+    base[r] = radicalInverse(uint64_t(r) + bioHaltonSkip,t.base) ;
+  }
+  for (bioUInt n = 0 ; n < sampleSize ; ++n) {
+    shifts[n] = getShift(n,variable) ;
+  }
+}
+
+void bioDrawGenerator::haltonSequence(bioUInt base,
+				      bioUInt skip,
+				      bioUInt length,
+				      bioReal* output,
+				      bioUInt nbrOfThreads) {
+  if (base < 2) {
+    std::stringstream str ;
+    str << "Invalid base for Halton draws: " << base ;
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  if (output == NULL) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"draws") ;
+  }
+  parallelFor(length,nbrOfThreads,[&](bioUInt begin, bioUInt end) {
+      for (bioUInt i = begin ; i < end ; ++i) {
+	output[i] = radicalInverse(uint64_t(skip) + i + 1,base) ;
+      }
+    }) ;
+}
+
+void bioDrawGenerator::normalQuantiles(const bioReal* p,
+				       bioUInt length,
+				       bioReal* output,
+				       bioUInt nbrOfThreads) {
+  if (p == NULL || output == NULL) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"draws") ;
+  }
+  parallelFor(length,nbrOfThreads,[&](bioUInt begin, bioUInt end) {
+      for (bioUInt i = begin ; i < end ; ++i) {
+	output[i] = normalQuantile(p[i]) ;
+      }
+    }) ;
+}
+
+class bioDrawTask {
+public:
+  const std::function<void(bioUInt,bioUInt)>* fct ;
+  bioUInt begin ;
+  bioUInt end ;
+} ;
+
+static void* runDrawTask(void* ptr) {
+  bioDrawTask* task = (bioDrawTask*) ptr ;
+  (*task->fct)(task->begin,task->end) ;
+  return NULL ;
+}
+
+void bioDrawGenerator::parallelFor(bioUInt length,
+				   bioUInt nbrOfThreads,
+				   const std::function<void(bioUInt,bioUInt)>& fct) {
+  if (nbrOfThreads > length) {
+    nbrOfThreads = length ;
+  }
+  if (nbrOfThreads <= 1) {
+    fct(0,length) ;
+    return ;
+  }
+  std::vector<bioDrawTask> tasks(nbrOfThreads) ;
+  std::vector<pthread_t> theThreads(nbrOfThreads) ;
+  bioUInt blockSize = (length + nbrOfThreads - 1) / nbrOfThreads ;
+  // The first block is processed by the calling thread.
+  for (bioUInt t = 0 ; t < nbrOfThreads ; ++t) {
+    tasks[t].fct = &fct ;
+    tasks[t].begin = std::min(t * blockSize,length) ;
+    tasks[t].end = std::min((t+1) * blockSize,length) ;
+  }
+  for (bioUInt t = 1 ; t < nbrOfThreads ; ++t) {
+    bioUInt diagnostic = pthread_create(&(theThreads[t]),NULL,runDrawTask,(void*) &(tasks[t])) ;
+    if (diagnostic != 0) {
+      for (bioUInt s = 1 ; s < t ; ++s) {
+	pthread_join(theThreads[s],NULL) ;
+      }
+      std::stringstream str ;
+      str << "Error " << diagnostic << " in creating thread " << t << "/" << nbrOfThreads ;
+      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    }
+  }
+  runDrawTask(&(tasks[0])) ;
+  for (bioUInt t = 1 ; t < nbrOfThreads ; ++t) {
+    pthread_join(theThreads[t],NULL) ;
+  }
+}
+
+void bioDrawGenerator::philox(uint32_t c[4], uint32_t stream) const {
+  uint32_t k0 = theSeed ;
+  uint32_t k1 = stream ;
+  for (int round = 0 ; round < 10 ; ++round) {
+    uint64_t p0 = uint64_t(0xD2511F53) * c[0] ;
+    uint64_t p1 = uint64_t(0xCD9E8D57) * c[2] ;
+    uint32_t x0 = uint32_t(p1 >> 32) ^ c[1] ^ k0 ;
+    uint32_t x1 = uint32_t(p1) ;
+    uint32_t x2 = uint32_t(p0 >> 32) ^ c[3] ^ k1 ;
+    uint32_t x3 = uint32_t(p0) ;
+    c[0] = x0 ;
+    c[1] = x1 ;
+    c[2] = x2 ;
+    c[3] = x3 ;
+    k0 += 0x9E3779B9 ;
+    k1 += 0xBB67AE85 ;
+  }
+}
+
+bioReal bioDrawGenerator::toUniform(uint32_t high, uint32_t low) {
+  // 53 random bits, shifted by half a unit so that neither 0 nor 1
+  // can be generated.
+  uint64_t bits = ((uint64_t(high) << 32) | low) >> 11 ;
+  return (bioReal(bits) + 0.5) / 9007199254740992.0 ;
+}
+
+bioReal bioDrawGenerator::getShift(bioUInt individual, bioUInt variable) const {
+  uint32_t c[4] = {0,
+		   uint32_t(individual),
+		   uint32_t(uint64_t(individual) >> 32),
+		   uint32_t(variable)} ;
+  philox(c,3) ;
+  return toUniform(c[0],c[1]) ;
+}
+
+bioReal bioDrawGenerator::radicalInverse(uint64_t index, bioUInt base) {
+  // Same operations as the Python implementation, so that the
+  // numbers are identical.
+  bioReal result = 0.0 ;
+  bioReal denominator = 1.0 ;
+  while (index > 0) {
+    denominator *= bioReal(base) ;
+    result += bioReal(index % base) / denominator ;
+    index /= base ;
+  }
+  return result ;
+}
+
+uint32_t bioDrawGenerator::permute(uint32_t i, uint32_t l, uint32_t p) {
+  uint32_t w = l - 1 ;
+  w |= w >> 1 ;
+  w |= w >> 2 ;
+  w |= w >> 4 ;
+  w |= w >> 8 ;
+  w |= w >> 16 ;
+  // The hash is a bijection on [0,w]. It is repeated until the
+  // result is in [0,l-1].
+  do {
+    i ^= p ;
+    i *= 0xe170893d ;
+    i ^= p >> 16 ;
+    i ^= (i & w) >> 4 ;
+    i ^= p >> 8 ;
+    i *= 0x0929eb3f ;
+    i ^= p >> 23 ;
+    i ^= (i & w) >> 1 ;
+    i *= 1 | p >> 27 ;
+    i *= 0x6935fa69 ;
+    i ^= (i & w) >> 11 ;
+    i *= 0x74dcb303 ;
+    i ^= (i & w) >> 2 ;
+    i *= 0x9e501cc3 ;
+    i ^= (i & w) >> 2 ;
+    i *= 0xc860a3df ;
+    i &= w ;
+    i ^= i >> 5 ;
+  } while (i >= l) ;
+  return (i + p) % l ;
+}
+
+bioReal bioDrawGenerator::normalQuantile(bioReal p) {
+  static const bioReal a[8] = {3.3871328727963666080e+00,
+			       1.3314166789178437745e+02,
+			       1.9715909503065514427e+03,
+			       1.3731693765509461125e+04,
+			       4.5921953931549871457e+04,
+			       6.7265770927008700853e+04,
+			       3.3430575583588128105e+04,
+			       2.5090809287301226727e+03} ;
+  static const bioReal b[8] = {1.0,
+			       4.2313330701600911252e+01,
+			       6.8718700749205790830e+02,
+			       5.3941960214247511077e+03,
+			       2.1213794301586595867e+04,
+			       3.9307895800092710610e+04,
+			       2.8729085735721942674e+04,
+			       5.2264952788528545610e+03} ;
+  static const bioReal c[8] = {1.42343711074968357734e+00,
+			       4.63033784615654529590e+00,
+			       5.76949722146069140550e+00,
+			       3.64784832476320460504e+00,
+			       1.27045825245236838258e+00,
+			       2.41780725177450611770e-01,
+			       2.27238449892691845833e-02,
+			       7.74545014278341407640e-04} ;
+  static const bioReal d[8] = {1.0,
+			       2.05319162663775882187e+00,
+			       1.67638483018380384940e+00,
+			       6.89767334985100004550e-01,
+			       1.48103976427480074590e-01,
+			       1.51986665636164571966e-02,
+			       5.47593808499534494600e-04,
+			       1.05075007164441684324e-09} ;
+  static const bioReal e[8] = {6.65790464350110377720e+00,
+			       5.46378491116411436990e+00,
+			       1.78482653991729133580e+00,
+			       2.96560571828504891230e-01,
+			       2.65321895265761230930e-02,
+			       1.24266094738807843860e-03,
+			       2.71155556874348757815e-05,
+			       2.01033439929228813265e-07} ;
+  static const bioReal f[8] = {1.0,
+			       5.99832206555887937690e-01,
+			       1.36929880922735805310e-01,
+			       1.48753612908506148525e-02,
+			       7.86869131145613259100e-04,
+			       1.84631831751005468180e-05,
+			       1.42151175831644588870e-07,
+			       2.04426310338993978564e-15} ;
+  // The values 0 and 1 are replaced by the closest numbers in the
+  // open interval, so that the quantile is finite.
+  p = std::min(std::max(p,std::numeric_limits<bioReal>::min()),
+	       1.0 - std::numeric_limits<bioReal>::epsilon() / 2.0) ;
+  bioReal q = p - 0.5 ;
+  // The central approximation is accurate only for |q| <= 0.425.
+  if (std::abs(q) <= 0.425) {
+    bioReal r = 0.180625 - q * q ;
+    bioReal num = a[7] ;
+    bioReal den = b[7] ;
+    for (int i = 6 ; i >= 0 ; --i) {
+      num = num * r + a[i] ;
+      den = den * r + b[i] ;
+    }
+    return q * num / den ;
+  }
+  bioReal r = (q < 0) ? p : 1.0 - p ;
+  r = std::sqrt(-std::log(r)) ;
+  bioReal num ;
+  bioReal den ;
+  if (r <= 5.0) {
+    r -= 1.6 ;
+    num = c[7] ;
+    den = d[7] ;
+    for (int i = 6 ; i >= 0 ; --i) {
+      num = num * r + c[i] ;
+      den = den * r + d[i] ;
+    }
+  }
+  else {
+    r -= 5.0 ;
+    num = e[7] ;
+    den = f[7] ;
+    for (int i = 6 ; i >= 0 ; --i) {
+      num = num * r + e[i] ;
+      den = den * r + f[i] ;
+    }
+  }
+  return (q < 0) ? -num / den : num / den ;
+}
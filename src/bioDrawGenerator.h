@@ -0,0 +1,122 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioDrawGenerator.h
+// @date   Mon Oct 19 02:33:09 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioDrawGenerator_h
+#define bioDrawGenerator_h
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "bioTypes.h"
+#include "bioString.h"
+
+// Generates the draws for Monte-Carlo integration when they are
+// needed, instead of storing the table individuals x draws x
+// variables. The value of a draw depends only on the seed, the
+// individual, the index of the draw and the variable, so that each
+// evaluation of the likelihood function, in any thread, uses the
+// same draws.
+//
+// The types are the native types of draws of the Python database:
+// UNIFORM, UNIFORMSYM or NORMAL, possibly followed by _ANTI,
+// _HALTON2, _HALTON3, _HALTON5, _RHALTON2, _RHALTON3, _RHALTON5,
+// _SHALTON2, _SHALTON3, _SHALTON5, _MLHS or _MLHS_ANTI. The
+// randomized Halton draws are shifted modulo 1 by a random number
+// specific to each variable. The shifted Halton draws use the same
+// base sequence for all individuals, shifted modulo 1 by a random
+// number specific to each individual and each variable
+// (Cranley-Patterson rotation).
+class bioDrawGenerator {
+ public:
+  enum bioDrawDistribution { bioUniform, bioUniformSym, bioNormal } ;
+  bioDrawGenerator(std::vector<bioString> types,
+		   bioUInt numberOfDraws,
+		   bioUInt seed) ;
+  bioReal getDraw(bioUInt individual, bioUInt draw, bioUInt variable) const ;
+  bioUInt getNumberOfDraws() const ;
+  bioUInt getNumberOfVariables() const ;
+  // Fills output[n * numberOfDraws + r] with the draws of one
+  // variable, for the individuals 0 to sampleSize-1. The individuals
+  // are shared among the threads.
+  void generate(bioUInt variable,
+		bioUInt sampleSize,
+		bioReal* output,
+		bioUInt nbrOfThreads) const ;
+  // For the shifted Halton draws, fills base[r] with the uniform
+  // draws of the base sequence, shared by all individuals, and
+  // shifts[n] with the shift of individual n, for the individuals 0
+  // to sampleSize-1.
+  void generateShared(bioUInt variable,
+		      bioUInt sampleSize,
+		      bioReal* base,
+		      bioReal* shifts) const ;
+  // Returns true if the draws of the type are a base sequence shifted
+  // for each individual.
+  static bioBoolean isShared(const bioString& type) ;
+  static bioDrawDistribution getDistribution(const bioString& type) ;
+  // Draw of the distribution corresponding to the uniform draw u.
+  static inline bioReal transform(bioDrawDistribution d, bioReal u) {
+    switch (d) {
+    case bioUniform:
+      return u ;
+    case bioUniformSym:
+      return 2.0 * u - 1.0 ;
+    case bioNormal:
+      return normalQuantile(u) ;
+    }
+    return u ;
+  }
+  // Elements skip+1 to skip+length of the Halton sequence
+  static void haltonSequence(bioUInt base,
+			     bioUInt skip,
+			     bioUInt length,
+			     bioReal* output,
+			     bioUInt nbrOfThreads) ;
+  // Quantiles of the standard normal distribution
+  static void normalQuantiles(const bioReal* p,
+			      bioUInt length,
+			      bioReal* output,
+			      bioUInt nbrOfThreads) ;
+  // Quantile of the standard normal distribution (Wichura,
+  // AS241). The quantiles of 0 and 1 are finite.
+  static bioReal normalQuantile(bioReal p) ;
+
+ private:
+  enum bioDrawSequence { bioPseudoRandom, bioHalton, bioRandomizedHalton, bioShiftedHalton, bioMlhs } ;
+  class bioDrawType {
+  public:
+    bioDrawSequence sequence ;
+    bioDrawDistribution distribution ;
+    bioBoolean antithetic ;
+    bioUInt base ;
+  } ;
+  static bioDrawType getType(const bioString& name) ;
+  // Uniform number in (0,1) for one draw of the sequence, before the
+  // antithetic symmetry is applied.
+  bioReal getUniform(const bioDrawType& type,
+		     bioUInt individual,
+		     bioUInt draw,
+		     bioUInt variable) const ;
+  // Calls fct(begin,end) on blocks of [0,length) in parallel
+  static void parallelFor(bioUInt length,
+			  bioUInt nbrOfThreads,
+			  const std::function<void(bioUInt,bioUInt)>& fct) ;
+  // Counter-based generator Philox4x32-10 (Salmon et al., 2011)
+  void philox(uint32_t counter[4], uint32_t stream) const ;
+  static bioReal toUniform(uint32_t high, uint32_t low) ;
+  // Shift of the shifted Halton draws for one individual
+  bioReal getShift(bioUInt individual, bioUInt variable) const ;
+  static bioReal radicalInverse(uint64_t index, bioUInt base) ;
+  // Random permutation of {0,...,length-1} (Kensler, 2013)
+  static uint32_t permute(uint32_t i, uint32_t length, uint32_t p) ;
+  std::vector<bioDrawType> theTypes ;
+  bioUInt numberOfDraws ;
+  uint32_t theSeed ;
+} ;
+
+#endif
@@ -0,0 +1,327 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioDrawTable.cc
+// @date   Mon Oct 19 02:44:03 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include "bioDrawTable.h"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+#include "bioExceptions.h"
+
+// Alignment of each series of draws, in bytes.
+static const std::size_t bioDrawAlignment = 64 ;
+
+bioDrawTable::bioDrawTable() :
+  buffer(NULL),
+  mapping(NULL),
+  mappingLength(0),
+  realDraws(NULL),
+  floatDraws(NULL),
+  sharedDraws(NULL),
+  sampleSize(0),
+  numberOfDraws(0),
+  numberOfVariables(0),
+  stride(0) {
+}
+
+bioDrawTable::bioDrawTable(const bioDrawTable& t) :
+  buffer(NULL),
+  mapping(NULL),
+  mappingLength(0),
+  realDraws(NULL),
+  floatDraws(NULL),
+  sharedDraws(NULL),
+  sampleSize(0),
+  numberOfDraws(0),
+  numberOfVariables(0),
+  stride(0) {
+  *this = t ;
+}
+
+bioDrawTable::~bioDrawTable() {
+  clear() ;
+}
+
+bioDrawTable& bioDrawTable::operator=(const bioDrawTable& t) {
+  if (this == &t) {
+    return *this ;
+  }
+  clear() ;
+  sampleSize = t.sampleSize ;
+  numberOfDraws = t.numberOfDraws ;
+  numberOfVariables = t.numberOfVariables ;
+  std::size_t count = std::size_t(sampleSize) * numberOfVariables ;
+  if (t.realDraws != NULL) {
+    realDraws = static_cast<bioReal*>(allocate(sizeof(bioReal),count)) ;
+    std::memcpy(realDraws,t.realDraws,count * stride * sizeof(bioReal)) ;
+  }
+  else if (t.floatDraws != NULL) {
+    floatDraws = static_cast<float*>(allocate(sizeof(float),count)) ;
+    std::memcpy(floatDraws,t.floatDraws,count * stride * sizeof(float)) ;
+  }
+  else if (t.sharedDraws != NULL) {
+    sharedDraws = static_cast<bioReal*>(allocate(sizeof(bioReal),numberOfVariables)) ;
+    std::memcpy(sharedDraws,t.sharedDraws,std::size_t(numberOfVariables) * stride * sizeof(bioReal)) ;
+    shifts = t.shifts ;
+    distributions = t.distributions ;
+  }
+  return *this ;
+}
+
+void bioDrawTable::set(const bioReal* d,
+		       bioUInt n,
+		       bioUInt r,
+		       bioUInt k) {
+  clear() ;
+  sampleSize = n ;
+  numberOfDraws = r ;
+  numberOfVariables = k ;
+  realDraws = static_cast<bioReal*>(allocate(sizeof(bioReal),std::size_t(n) * k)) ;
+  if (realDraws == NULL) {
+    return ;
+  }
+  if (d == NULL) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"draws") ;
+  }
+  for (std::size_t i = 0 ; i < std::size_t(n) * k ; ++i) {
+    std::memcpy(realDraws + i * stride,d + i * r,r * sizeof(bioReal)) ;
+  }
+}
+
+void bioDrawTable::set(const float* d,
+		       bioUInt n,
+		       bioUInt r,
+		       bioUInt k) {
+  clear() ;
+  sampleSize = n ;
+  numberOfDraws = r ;
+  numberOfVariables = k ;
+  floatDraws = static_cast<float*>(allocate(sizeof(float),std::size_t(n) * k)) ;
+  if (floatDraws == NULL) {
+    return ;
+  }
+  if (d == NULL) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"draws") ;
+  }
+  for (std::size_t i = 0 ; i < std::size_t(n) * k ; ++i) {
+    std::memcpy(floatDraws + i * stride,d + i * r,r * sizeof(float)) ;
+  }
+}
+
+void bioDrawTable::generate(const bioDrawGenerator& g,
+			    bioUInt n,
+			    bioBoolean singlePrecision,
+			    bioUInt nbrOfThreads) {
+  clear() ;
+  sampleSize = n ;
+  numberOfDraws = g.getNumberOfDraws() ;
+  numberOfVariables = g.getNumberOfVariables() ;
+  std::size_t count = std::size_t(n) * numberOfVariables ;
+  if (singlePrecision) {
+    floatDraws = static_cast<float*>(allocate(sizeof(float),count)) ;
+  }
+  else {
+    realDraws = static_cast<bioReal*>(allocate(sizeof(bioReal),count)) ;
+  }
+  if (count == 0) {
+    return ;
+  }
+  // Only the draws of one variable are stored at the same time
+  // outside the table.
+  std::vector<bioReal> d(std::size_t(n) * numberOfDraws) ;
+  for (bioUInt k = 0 ; k < numberOfVariables ; ++k) {
+    g.generate(k,n,d.data(),nbrOfThreads) ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      const bioReal* series = d.data() + std::size_t(i) * numberOfDraws ;
+      if (singlePrecision) {
+	std::copy(series,series+numberOfDraws,floatDraws + index(i,k)) ;
+      }
+      else {
+	std::copy(series,series+numberOfDraws,realDraws + index(i,k)) ;
+      }
+    }
+  }
+}
+
+void bioDrawTable::setShared(const bioReal* base,
+			     const bioReal* s,
+			     const std::vector<bioString>& types,
+			     bioUInt n,
+			     bioUInt r,
+			     bioUInt k) {
+  clear() ;
+  if (types.size() != k) {
+    throw bioExceptions(__FILE__,__LINE__,"Incompatible number of types of draws") ;
+  }
+  std::vector<bioDrawGenerator::bioDrawDistribution> d ;
+  for (std::vector<bioString>::const_iterator i = types.begin() ;
+       i != types.end() ;
+       ++i) {
+    d.push_back(bioDrawGenerator::getDistribution(*i)) ;
+  }
+  sampleSize = n ;
+  numberOfDraws = r ;
+  numberOfVariables = k ;
+  sharedDraws = static_cast<bioReal*>(allocate(sizeof(bioReal),k)) ;
+  if (sharedDraws == NULL || n == 0) {
+    clear() ;
+    return ;
+  }
+  if (base == NULL || s == NULL) {
+    clear() ;
+    throw bioExceptNullPointer(__FILE__,__LINE__,"draws") ;
+  }
+  for (bioUInt i = 0 ; i < k ; ++i) {
+    std::memcpy(sharedDraws + i * stride,base + std::size_t(i) * r,r * sizeof(bioReal)) ;
+  }
+  shifts.assign(s,s + std::size_t(n) * k) ;
+  distributions.swap(d) ;
+}
+
+void bioDrawTable::getSharedDraws(bioUInt individual,
+				  bioUInt variable,
+				  bioUInt firstDraw,
+				  bioUInt length,
+				  bioReal* output) const {
+  if (sharedDraws == NULL) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"shared draws") ;
+  }
+  const bioReal* base = sharedDraws + variable * stride + firstDraw ;
+  bioReal shift = shifts[std::size_t(individual) * numberOfVariables + variable] ;
+  for (bioUInt r = 0 ; r < length ; ++r) {
+    bioReal u = base[r] + shift ;
+    output[r] = (u >= 1.0) ? u - 1.0 : u ;
+  }
+  bioDrawGenerator::bioDrawDistribution d = distributions[variable] ;
+  if (d != bioDrawGenerator::bioUniform) {
+    for (bioUInt r = 0 ; r < length ; ++r) {
+      output[r] = bioDrawGenerator::transform(d,output[r]) ;
+    }
+  }
+}
+
+void bioDrawTable::setMapped(void* m,
+			     std::size_t length,
+			     std::size_t offset,
+			     bioBoolean singlePrecision,
+			     bioUInt n,
+			     bioUInt r,
+			     bioUInt k) {
+  clear() ;
+  if (m == NULL) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"mapped draws") ;
+  }
+  mapping = m ;
+  mappingLength = length ;
+  sampleSize = n ;
+  numberOfDraws = r ;
+  numberOfVariables = k ;
+  std::size_t sizeOfElement = (singlePrecision) ? sizeof(float) : sizeof(bioReal) ;
+  stride = getStride(numberOfDraws,sizeOfElement) ;
+  if (offset % bioDrawAlignment != 0 ||
+      offset + std::size_t(n) * k * stride * sizeOfElement > length) {
+    clear() ;
+    throw bioExceptions(__FILE__,__LINE__,"Invalid layout of the mapped draws") ;
+  }
+  char* data = static_cast<char*>(m) + offset ;
+  if (singlePrecision) {
+    floatDraws = reinterpret_cast<float*>(data) ;
+  }
+  else {
+    realDraws = reinterpret_cast<bioReal*>(data) ;
+  }
+}
+
+const void* bioDrawTable::getData() const {
+  if (realDraws != NULL) {
+    return realDraws ;
+  }
+  return floatDraws ;
+}
+
+std::size_t bioDrawTable::getDataSize() const {
+  if (realDraws != NULL) {
+    return std::size_t(sampleSize) * numberOfVariables * stride * sizeof(bioReal) ;
+  }
+  if (floatDraws != NULL) {
+    return std::size_t(sampleSize) * numberOfVariables * stride * sizeof(float) ;
+  }
+  return 0 ;
+}
+
+std::size_t bioDrawTable::getStride(bioUInt r, std::size_t sizeOfElement) {
+  // The length of each series is rounded up to a multiple of the
+  // alignment.
+  std::size_t elementsPerLine = bioDrawAlignment / sizeOfElement ;
+  return (std::size_t(r) + elementsPerLine - 1) / elementsPerLine * elementsPerLine ;
+}
+
+void* bioDrawTable::allocate(std::size_t sizeOfElement, std::size_t count) {
+  stride = getStride(numberOfDraws,sizeOfElement) ;
+  std::size_t size = count * stride * sizeOfElement ;
+  if (size == 0) {
+    return NULL ;
+  }
+  if (posix_memalign(&buffer,bioDrawAlignment,size) != 0) {
+    buffer = NULL ;
+    throw bioExceptions(__FILE__,__LINE__,"Not enough memory to store the draws") ;
+  }
+  // The padding is set to zero, so that the whole series can be
+  // processed by vector instructions.
+  std::memset(buffer,0,size) ;
+  return buffer ;
+}
+
+void bioDrawTable::clear() {
+  std::free(buffer) ;
+  buffer = NULL ;
+  if (mapping != NULL) {
+    munmap(mapping,mappingLength) ;
+    mapping = NULL ;
+    mappingLength = 0 ;
+  }
+  realDraws = NULL ;
+  floatDraws = NULL ;
+  sharedDraws = NULL ;
+  shifts.clear() ;
+  distributions.clear() ;
+  sampleSize = numberOfDraws = numberOfVariables = 0 ;
+  stride = 0 ;
+}
+
+bioBoolean bioDrawTable::empty() const {
+  return buffer == NULL && mapping == NULL ;
+}
+
+bioBoolean bioDrawTable::isSinglePrecision() const {
+  return floatDraws != NULL ;
+}
+
+bioBoolean bioDrawTable::isShared() const {
+  return sharedDraws != NULL ;
+}
+
+bioUInt bioDrawTable::getSampleSize() const {
+  return sampleSize ;
+}
+
+bioUInt bioDrawTable::getNumberOfDraws() const {
+  return numberOfDraws ;
+}
+
+bioUInt bioDrawTable::getNumberOfVariables() const {
+  return numberOfVariables ;
+}
+
+const bioReal* bioDrawTable::getRealDraws(bioUInt individual, bioUInt variable) const {
+  return (realDraws == NULL) ? NULL : realDraws + index(individual,variable) ;
+}
+
+const float* bioDrawTable::getFloatDraws(bioUInt individual, bioUInt variable) const {
+  return (floatDraws == NULL) ? NULL : floatDraws + index(individual,variable) ;
+}
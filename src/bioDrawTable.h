@@ -0,0 +1,134 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioDrawTable.h
+// @date   Mon Oct 19 02:41:12 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioDrawTable_h
+#define bioDrawTable_h
+
+#include <cstddef>
+#include <vector>
+#include "bioTypes.h"
+#include "bioString.h"
+#include "bioDrawGenerator.h"
+
+// Table of draws stored in a single aligned buffer, indexed by
+// [individual][variable][draw]. The draws of each variable for a
+// given individual are contiguous, and each of these series starts
+// on a cache line, so that a loop on the draws can be vectorized.
+// The draws can be stored in single precision, to divide the memory
+// by two when the number of draws is large.
+//
+// For the quasi Monte-Carlo sequences shared by the individuals, only
+// the base sequence of each variable and the shift of each individual
+// are stored, and the draws are calculated when accessed. The memory
+// is then proportional to (numberOfDraws + sampleSize) x
+// numberOfVariables instead of their product.
+class bioDrawTable {
+ public:
+  bioDrawTable() ;
+  ~bioDrawTable() ;
+  bioDrawTable(const bioDrawTable& t) ;
+  bioDrawTable& operator=(const bioDrawTable& t) ;
+  // The draws d are ordered as [individual][variable][draw].
+  void set(const bioReal* d,
+	   bioUInt sampleSize,
+	   bioUInt numberOfDraws,
+	   bioUInt numberOfVariables) ;
+  void set(const float* d,
+	   bioUInt sampleSize,
+	   bioUInt numberOfDraws,
+	   bioUInt numberOfVariables) ;
+  // The draws are generated by g, variable by variable, for the
+  // individuals 0 to sampleSize-1.
+  void generate(const bioDrawGenerator& g,
+		bioUInt sampleSize,
+		bioBoolean singlePrecision,
+		bioUInt nbrOfThreads) ;
+  // The uniform draws of the base sequences are ordered as
+  // [variable][draw], and the shifts as [individual][variable]. The
+  // types are the types of draws of the variables, that define the
+  // distribution of the draws.
+  void setShared(const bioReal* base,
+		 const bioReal* shifts,
+		 const std::vector<bioString>& types,
+		 bioUInt sampleSize,
+		 bioUInt numberOfDraws,
+		 bioUInt numberOfVariables) ;
+  // The draws are read from a memory mapped file, where they are
+  // stored at the given offset, in the same layout as the buffer of
+  // the table. The table unmaps the file when it is cleared.
+  void setMapped(void* mapping,
+		 std::size_t mappingLength,
+		 std::size_t offset,
+		 bioBoolean singlePrecision,
+		 bioUInt sampleSize,
+		 bioUInt numberOfDraws,
+		 bioUInt numberOfVariables) ;
+  void clear() ;
+  bioBoolean empty() const ;
+  bioBoolean isSinglePrecision() const ;
+  bioBoolean isShared() const ;
+  bioUInt getSampleSize() const ;
+  bioUInt getNumberOfDraws() const ;
+  bioUInt getNumberOfVariables() const ;
+  inline bioReal getDraw(bioUInt individual, bioUInt draw, bioUInt variable) const {
+    if (sharedDraws != NULL) {
+      return bioDrawGenerator::transform(distributions[variable],
+					 getSharedUniform(individual,draw,variable)) ;
+    }
+    std::size_t i = index(individual,variable) + draw ;
+    return (floatDraws != NULL) ? bioReal(floatDraws[i]) : realDraws[i] ;
+  }
+  // Series of the draws of one variable for one individual. At most
+  // one of the two functions returns a non NULL pointer, depending on
+  // the precision of the storage. Both return NULL if the draws are
+  // shared.
+  const bioReal* getRealDraws(bioUInt individual, bioUInt variable) const ;
+  const float* getFloatDraws(bioUInt individual, bioUInt variable) const ;
+  // Draws firstDraw to firstDraw+length-1 of one variable for one
+  // individual, when the draws are shared.
+  void getSharedDraws(bioUInt individual,
+		      bioUInt variable,
+		      bioUInt firstDraw,
+		      bioUInt length,
+		      bioReal* output) const ;
+  // Stored draws, in the layout of the buffer, to be written in a
+  // file. NULL if the draws are shared.
+  const void* getData() const ;
+  // Size of the data, in bytes
+  std::size_t getDataSize() const ;
+  // Number of elements between two consecutive series of draws, for
+  // elements of the given size.
+  static std::size_t getStride(bioUInt numberOfDraws, std::size_t sizeOfElement) ;
+ private:
+  inline std::size_t index(bioUInt individual, bioUInt variable) const {
+    return (std::size_t(individual) * numberOfVariables + variable) * stride ;
+  }
+  inline bioReal getSharedUniform(bioUInt individual, bioUInt draw, bioUInt variable) const {
+    bioReal u = sharedDraws[variable * stride + draw] + shifts[std::size_t(individual) * numberOfVariables + variable] ;
+    return (u >= 1.0) ? u - 1.0 : u ;
+  }
+  // Allocates the buffer for count series of numberOfDraws elements.
+  void* allocate(std::size_t sizeOfElement, std::size_t count) ;
+  void* buffer ;
+  // Memory mapped file, if the draws are read from a file
+  void* mapping ;
+  std::size_t mappingLength ;
+  bioReal* realDraws ;
+  float* floatDraws ;
+  // Base sequences of the shared draws, ordered as [variable][draw]
+  bioReal* sharedDraws ;
+  std::vector<bioReal> shifts ;
+  std::vector<bioDrawGenerator::bioDrawDistribution> distributions ;
+  bioUInt sampleSize ;
+  bioUInt numberOfDraws ;
+  bioUInt numberOfVariables ;
+  // Number of elements between two consecutive series of draws
+  std::size_t stride ;
+} ;
+
+#endif
@@ -0,0 +1,58 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioEvaluationState.cc
+// @date   Mon Oct 19 02:22:31 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include "bioEvaluationState.h"
+#include <algorithm>
+#include "bioExceptions.h"
+
+static thread_local bioEvaluationState* theCurrentState = NULL ;
+// Used when no state has been provided, where no row, individual or
+// draw is defined.
+static thread_local bioEvaluationState theDefaultState ;
+
+bioEvaluationState::bioEvaluationState() :
+  row(bioBadId),
+  individual(bioBadId),
+  draw(bioBadId),
+  invariants(NULL) {
+}
+
+void bioEvaluationState::reset() {
+  row = bioBadId ;
+  individual = bioBadId ;
+  draw = bioBadId ;
+  invariants = NULL ;
+  std::fill(randomVariableDefined.begin(),randomVariableDefined.end(),false) ;
+}
+
+void bioEvaluationState::setRandomVariable(bioUInt rvId, bioReal v) {
+  if (rvId >= randomVariables.size()) {
+    randomVariables.resize(rvId+1) ;
+    randomVariableDefined.resize(rvId+1,false) ;
+  }
+  randomVariables[rvId] = v ;
+  randomVariableDefined[rvId] = true ;
+}
+
+bioReal bioEvaluationState::getRandomVariable(bioUInt rvId) const {
+  if (rvId >= randomVariables.size() || !randomVariableDefined[rvId]) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"random variable value") ;
+  }
+  return randomVariables[rvId] ;
+}
+
+bioEvaluationState* bioEvaluationState::current() {
+  if (theCurrentState == NULL) {
+    return &theDefaultState ;
+  }
+  return theCurrentState ;
+}
+
+void bioEvaluationState::setCurrent(bioEvaluationState* s) {
+  theCurrentState = s ;
+}
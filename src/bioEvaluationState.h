@@ -0,0 +1,54 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioEvaluationState.h
+// @date   Mon Oct 19 02:19:40 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioEvaluationState_h
+#define bioEvaluationState_h
+
+#include <vector>
+#include <map>
+#include <utility>
+#include "bioConst.h"
+#include "bioTypes.h"
+#include "bioSmartPointer.h"
+#include "bioDerivatives.h"
+
+// The formulas are parsed once, and shared by all threads. They must
+// therefore not be modified during the evaluation. Everything that
+// varies from one evaluation to the next (row, individual, draw, value
+// of the random variables) is stored in this object, owned by the
+// thread performing the evaluation.
+
+class bioEvaluationState {
+ public:
+  bioEvaluationState() ;
+  void reset() ;
+  // bioBadId if the row is not defined. In that case, the variables
+  // take the value of the first row of the current individual.
+  bioUInt row ;
+  bioUInt individual ;
+  bioUInt draw ;
+  void setRandomVariable(bioUInt rvId, bioReal v) ;
+  bioReal getRandomVariable(bioUInt rvId) const ;
+  // Value and derivatives of the expressions that do not depend on
+  // the draws, for each row, during a Monte-Carlo integration. They
+  // are computed once, and reused for all the batches of draws. NULL
+  // outside a Monte-Carlo integration.
+  typedef std::pair<const void*,bioUInt> bioInvariantKey ;
+  typedef std::map<bioInvariantKey,bioSmartPointer<bioDerivatives> > bioInvariantValues ;
+  bioInvariantValues* invariants ;
+
+  // State used by the expressions evaluated in the current thread. If
+  // none has been set, an empty state is returned.
+  static bioEvaluationState* current() ;
+  static void setCurrent(bioEvaluationState* s) ;
+ private:
+  std::vector<bioReal> randomVariables ;
+  std::vector<bioBoolean> randomVariableDefined ;
+};
+
+#endif
@@ -25,7 +25,7 @@ bioSmartPointer<bioDerivatives> bioExprDerive::getValueAndDerivatives(std::vecto
 								      bioBoolean gradient,
 								      bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
   if (gradient || hessian) {
     throw bioExceptions(__FILE__,__LINE__,"No derivatives are available for this expression, yet.") ;
   }
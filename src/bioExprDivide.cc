@@ -8,6 +8,7 @@
 //--------------------------------------------------------------------
 
 #include "bioExprDivide.h"
+#include "bioBatchDerivatives.h"
 #include <sstream>
 #include "bioSmartPointer.h"
 #include "bioDebug.h"
@@ -33,7 +34,7 @@ bioExprDivide::getValueAndDerivatives(std::vector<bioUInt> literalIds,
     throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
   }
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   bioUInt n = literalIds.size() ;
   bioSmartPointer<bioDerivatives> leftResult = left->getValueAndDerivatives(literalIds,gradient,hessian) ;
@@ -185,3 +186,48 @@ bioString bioExprDivide::print(bioBoolean hp) const {
   return str.str() ;
 }
 
+
+void bioExprDivide::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						    bioBatchDerivatives& result) {
+  bioBatchDerivatives leftResult(result.n,result.size,result.hasGradient) ;
+  bioBatchDerivatives rightResult(result.n,result.size,result.hasGradient) ;
+  left->getBatchValueAndDerivatives(literalIds,leftResult) ;
+  right->getBatchValueAndDerivatives(literalIds,rightResult) ;
+  const bioReal* lf = &leftResult.f[0] ;
+  const bioReal* rf = &rightResult.f[0] ;
+  // Draws for which the denominator is zero. As for one draw, the
+  // value and the derivatives are then zero if the numerator is zero,
+  // and bioMaxReal otherwise.
+  bioBoolean zeroDenominator = false ;
+  for (bioUInt r = 0 ; r < result.size ; ++r) {
+    if (rf[r] == 0.0) {
+      zeroDenominator = true ;
+      result.f[r] = (lf[r] == 0.0) ? 0.0 : bioMaxReal ;
+    }
+    else {
+      result.f[r] = lf[r] / rf[r] ;
+    }
+  }
+  if (result.hasGradient) {
+    for (bioUInt i = 0 ; i < result.n ; ++i) {
+      if (!zeroDenominator && !leftResult.active[i] && !rightResult.active[i]) {
+	continue ;
+      }
+      bioReal* g = result.gradient(i) ;
+      const bioReal* lg = leftResult.gradient(i) ;
+      const bioReal* rg = rightResult.gradient(i) ;
+      for (bioUInt r = 0 ; r < result.size ; ++r) {
+	if (rf[r] == 0.0) {
+	  g[r] = (lf[r] == 0.0) ? 0.0 : bioMaxReal ;
+	}
+	else if (lf[r] == 0.0) {
+	  g[r] = lg[r] / rf[r] ;
+	}
+	else {
+	  g[r] = (lg[r] * rf[r] - rg[r] * lf[r]) / (rf[r] * rf[r]) ;
+	}
+      }
+      result.active[i] = true ;
+    }
+  }
+}
@@ -9,10 +9,14 @@
 
 #include "bioExprDraws.h"
 #include <sstream>
+#include <algorithm>
 #include "bioExceptions.h"
 #include "bioDebug.h"
+#include "bioDrawGenerator.h"
+#include "bioDrawTable.h"
+#include "bioBatchDerivatives.h"
 
-bioExprDraws::bioExprDraws(bioUInt literalId, bioUInt drawId, bioString name) : bioExprLiteral(literalId,name), theDrawId(drawId), drawIndex(NULL) {
+bioExprDraws::bioExprDraws(bioUInt literalId, bioUInt drawId, bioString name) : bioExprLiteral(literalId,name), theDrawId(drawId) {
   
 }
 bioExprDraws::~bioExprDraws() {
@@ -25,41 +29,67 @@ bioString bioExprDraws::print(bioBoolean hp) const {
   return str.str() ;
 }
 
-void bioExprDraws::setDrawIndex(bioUInt* d) {
-  drawIndex = d ;
+bioReal bioExprDraws::getLiteralValue() const {
+  const bioEvaluationState* state = bioEvaluationState::current() ;
+  checkDraws(state->draw,state->draw) ;
+  if (drawGenerator != NULL) {
+    return drawGenerator->getDraw(state->individual,state->draw,theDrawId) ;
+  }
+  return draws->getDraw(state->individual,state->draw,theDrawId) ;
 }
 
-bioReal bioExprDraws::getLiteralValue() const {
-  if (draws == NULL) {
-      throw bioExceptNullPointer(__FILE__,__LINE__,"draws") ;
+void bioExprDraws::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						   bioBatchDerivatives& result) {
+  const bioEvaluationState* state = bioEvaluationState::current() ;
+  checkDraws(state->draw,state->draw + result.size - 1) ;
+  if (drawGenerator != NULL) {
+    for (bioUInt r = 0 ; r < result.size ; ++r) {
+      result.f[r] = drawGenerator->getDraw(state->individual,state->draw + r,theDrawId) ;
+    }
   }
-  if (sampleSize == 0) {
-    throw bioExceptions(__FILE__,__LINE__,"Empty list of draws.") ;
+  else if (draws->isShared()) {
+    draws->getSharedDraws(state->individual,theDrawId,state->draw,result.size,result.f.data()) ;
   }
-  if (numberOfDraws == 0) {
-    throw bioExceptions(__FILE__,__LINE__,"Empty list of draws.") ;
-
+  else if (draws->isSinglePrecision()) {
+    const float* d = draws->getFloatDraws(state->individual,theDrawId) + state->draw ;
+    std::copy(d,d+result.size,result.f.begin()) ;
   }
-  if (numberOfDrawVariables == 0) {
-    throw bioExceptions(__FILE__,__LINE__,"Empty list of draws.") ;
+  else {
+    const bioReal* d = draws->getRealDraws(state->individual,theDrawId) + state->draw ;
+    std::copy(d,d+result.size,result.f.begin()) ;
   }
-  if (individualIndex == NULL) {
+  setBatchGradient(literalIds,result) ;
+}
+
+bioBoolean bioExprDraws::containsDraws() const {
+  return true ;
+}
+
+void bioExprDraws::checkDraws(bioUInt firstDraw, bioUInt lastDraw) const {
+  const bioEvaluationState* state = bioEvaluationState::current() ;
+  if (state->individual == bioBadId) {
     throw bioExceptions(__FILE__,__LINE__,"Row index is not defined.") ;
   }
-  if (*individualIndex >= sampleSize) {
-    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,*individualIndex,0,sampleSize-1) ;
-  }
-  if (drawIndex == NULL) {
+  if (firstDraw == bioBadId) {
     throw bioExceptions(__FILE__,__LINE__,"Draw index is not defined. It may be caused by the use of draws outside a Montecarlo statement.") ;
   }
-  if (*drawIndex >= numberOfDraws) {
-    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,*drawIndex,0,numberOfDraws-1) ;
+  if (drawGenerator != NULL) {
+    return ;
+  }
+  if (draws == NULL) {
+      throw bioExceptNullPointer(__FILE__,__LINE__,"draws") ;
+  }
+  if (sampleSize == 0 || numberOfDraws == 0 || numberOfDrawVariables == 0) {
+    throw bioExceptions(__FILE__,__LINE__,"Empty list of draws.") ;
+  }
+  if (state->individual >= sampleSize) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,state->individual,0,sampleSize-1) ;
+  }
+  if (lastDraw >= numberOfDraws) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,lastDraw,0,numberOfDraws-1) ;
   }
   if (theDrawId == bioBadId || theDrawId >= numberOfDrawVariables) {
     throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,theDrawId,0,numberOfDrawVariables-1) ;
   }
-
-  return (*draws)[*individualIndex][*drawIndex][theDrawId] ;
-
 }
 
@@ -19,11 +19,15 @@ class bioExprDraws: public bioExprLiteral {
   bioExprDraws(bioUInt uniqueId, bioUInt drawId, bioString name) ;
   ~bioExprDraws() ;
   virtual bioString print(bioBoolean hp = false) const ;
-  virtual void setDrawIndex(bioUInt* d) ;
   virtual bioReal getLiteralValue() const ;
+  virtual bioBoolean containsDraws() const ;
 protected:
+  virtual void computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+					       bioBatchDerivatives& result) ;
+  // Checks that the draws from firstDraw to lastDraw are available
+  // for the current individual.
+  void checkDraws(bioUInt firstDraw, bioUInt lastDraw) const ;
   bioUInt theDrawId ;
-  bioUInt* drawIndex ;
 };
 
 
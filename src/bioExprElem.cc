@@ -19,6 +19,7 @@ bioExprElem::bioExprElem(bioSmartPointer<bioExpression>  k, std::map<bioUInt,bio
 
 
   listOfChildren.push_back(k) ;
+  std::vector<bioUInt> keys ;
   for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = d.begin() ;
        i != d.end();
        ++i) {
@@ -26,7 +27,10 @@ bioExprElem::bioExprElem(bioSmartPointer<bioExpression>  k, std::map<bioUInt,bio
       throw bioExceptNullPointer(__FILE__,__LINE__,"Null expression in dictionary") ;
     }
     listOfChildren.push_back(i->second) ;
+    keys.push_back(i->first) ;
+    listOfExpressions.push_back(i->second) ;
   }
+  slots.setIds(keys) ;
 
 }
 
@@ -38,12 +42,10 @@ bioExprElem::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 				    bioBoolean gradient,
 				    bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
-
   bioUInt k = bioUInt(key->getValue()) ;
 
-  std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator found = dictOfExpressions.find(k) ;
-  if (found == dictOfExpressions.end()) {
+  bioUInt position = slots.getSlot(k) ;
+  if (position == bioBadId) {
     std::stringstream str ;
     str << "Key (" << key->print(true) << "=" << k << ") is not present in dictionary: " << std::endl;
     for (std::map<bioUInt,bioSmartPointer<bioExpression> >::const_iterator i = dictOfExpressions.begin() ;
@@ -53,30 +55,19 @@ bioExprElem::getValueAndDerivatives(std::vector<bioUInt> literalIds,
     }
     throw bioExceptions(__FILE__,__LINE__,str.str()) ;
   }
-  if (found->second == NULL) {
-    throw bioExceptNullPointer(__FILE__,__LINE__,"expression") ;
-  }
-  bioSmartPointer<bioDerivatives> fgh = found->second->getValueAndDerivatives(literalIds,gradient,hessian) ;
+  bioSmartPointer<bioExpression>& found = listOfExpressions[position] ;
+  bioSmartPointer<bioDerivatives> fgh = found->getValueAndDerivatives(literalIds,gradient,hessian) ;
   if (fgh == NULL) {
     throw bioExceptNullPointer(__FILE__,__LINE__,"derivatives") ;
   }
-  theDerivatives->f = fgh->f ;
   if (!std::isfinite(fgh->f)) {
     std::stringstream str ;
-    str << "Invalid value for expression <" << found->second->print(true) << ">: " << fgh->f ;
+    str << "Invalid value for expression <" << found->print(true) << ">: " << fgh->f ;
     throw bioExceptions(__FILE__,__LINE__,str.str()) ;
   }
-  if (gradient) {
-    for (std::size_t k = 0 ; k < literalIds.size() ; ++k) {
-      theDerivatives->g[k] = fgh->g[k] ;
-      if (hessian) {
-	for (std::size_t l = 0 ; l < literalIds.size() ; ++l) {
-	  theDerivatives->h[k][l] = fgh->h[k][l] ;
-	}
-      }
-    }
-  }
-  return theDerivatives ;
+  // The derivatives of the selected expression are returned as they
+  // are, without being copied.
+  return fgh ;
 }
 
 bioString bioExprElem::print(bioBoolean hp) const {
@@ -11,8 +11,10 @@
 #define bioExprElem_h
 
 #include <map>
+#include <vector>
 #include "bioExpression.h"
 #include "bioString.h"
+#include "bioSlotTable.h"
 
 class bioExprElem: public bioExpression {
  public:
@@ -26,6 +28,9 @@ class bioExprElem: public bioExpression {
 protected:
   bioSmartPointer<bioExpression>  key ;
   std::map<bioUInt,bioSmartPointer<bioExpression> > dictOfExpressions ;
+  // The expressions, sorted by key, and the position of each key.
+  std::vector<bioSmartPointer<bioExpression> > listOfExpressions ;
+  bioSlotTable slots ;
 
 };
 
@@ -8,6 +8,7 @@
 //--------------------------------------------------------------------
 
 #include "bioExprExp.h"
+#include "bioBatchDerivatives.h"
 #include "bioExceptions.h"
 #include "bioDebug.h"
 #include "bioSmartPointer.h"
@@ -28,7 +29,7 @@ bioExprExp::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 				   bioBoolean gradient,
 				   bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   bioUInt n = literalIds.size() ;
   bioSmartPointer<bioDerivatives> childResult = child->getValueAndDerivatives(literalIds,gradient,hessian) ;
@@ -57,3 +58,22 @@ bioString bioExprExp::print(bioBoolean hp) const {
   return str.str() ;
 
 }
+
+void bioExprExp::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						 bioBatchDerivatives& result) {
+  child->getBatchValueAndDerivatives(literalIds,result) ;
+  bioReal logMax = bioLogMaxReal::the() ;
+  for (bioUInt r = 0 ; r < result.size ; ++r) {
+    result.f[r] = (result.f[r] <= logMax) ? exp(result.f[r]) : std::numeric_limits<bioReal>::max() ;
+  }
+  if (result.hasGradient) {
+    for (bioUInt i = 0 ; i < result.n ; ++i) {
+      if (result.active[i]) {
+	bioReal* g = result.gradient(i) ;
+	for (bioUInt r = 0 ; r < result.size ; ++r) {
+	  g[r] *= result.f[r] ;
+	}
+      }
+    }
+  }
+}
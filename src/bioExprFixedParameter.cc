@@ -23,8 +23,9 @@ bioExprFixedParameter::~bioExprFixedParameter() {
 bioString bioExprFixedParameter::print(bioBoolean hp) const {
   std::stringstream str ;
   str << theName << " lit[" << theLiteralId << "],fixed[" << theParameterId << "]" ;
-  if (rowIndex != NULL) {
-    str << " <" << *rowIndex << ">" ;
+  bioUInt row = bioEvaluationState::current()->row ;
+  if (row != bioBadId) {
+    str << " <" << row << ">" ;
   }
   try {
     getLiteralValue() ;
@@ -20,8 +20,9 @@ bioExprFreeParameter::~bioExprFreeParameter() {
 bioString bioExprFreeParameter::print(bioBoolean hp) const {
   std::stringstream str ;
   str << theName << " lit[" << theLiteralId << "],free[" << theParameterId << "]" ;
-  if (rowIndex != NULL) {
-    str << " <" << *rowIndex << ">" ;
+  bioUInt row = bioEvaluationState::current()->row ;
+  if (row != bioBadId) {
+    str << " <" << row << ">" ;
   }
   try {
     getLiteralValue() ;
@@ -14,56 +14,34 @@
 #include "bioDebug.h"
 
 bioExprGaussHermite::bioExprGaussHermite(bioSmartPointer<bioExpression>  e,
-					 std::vector<bioUInt> derivl,
+					 const std::vector<bioUInt>& derivl,
 					 bioUInt l,
 					 bioBoolean wg,
-					 bioBoolean wh) : 
+					 bioBoolean wh,
+					 bioDerivatives& r) : 
   withGradient(wg),
   withHessian(wh),
   theExpression(e),
   derivLiteralIds(derivl),
-  rvId(l) {
-
-  theExpression->setRandomVariableValuePtr(rvId,&theValue) ;
-
-
-  
+  rvId(l),
+  result(r) {
 }
 
-std::vector<bioReal> bioExprGaussHermite::getValue(bioReal x) {
-  std::vector<bioReal> result ;
-  theValue = x ;
+void bioExprGaussHermite::addValue(bioReal x, bioReal w) {
+  bioEvaluationState::current()->setRandomVariable(rvId,x) ;
   bioUInt n = derivLiteralIds.size() ;
   bioSmartPointer<bioDerivatives> fgh = theExpression->getValueAndDerivatives(derivLiteralIds,withGradient,withHessian) ;
-  result.push_back(fgh->f) ;
+  result.f += w * fgh->f ;
   if (withGradient) {
     for (bioUInt i = 0 ; i < n ; ++i) {
-      result.push_back(fgh->g[i]) ;
+      result.g[i] += w * fgh->g[i] ;
     }
     if (withHessian) {
       for (bioUInt i = 0 ; i < n ; ++i) {
 	for (bioUInt j = i ; j < n ; ++j) {
-	  result.push_back(fgh->h[i][j]) ;
+	  result.h[i][j] += w * fgh->h[i][j] ;
 	}
       }
     }
   }
-  return result ;
 }
-
-bioUInt bioExprGaussHermite::getSize() const {
-  if (withGradient) {
-      bioUInt n = derivLiteralIds.size() ; 
-    if (withHessian) {
-      return 1 + n + (n * (n+1) / 2) ;
-    }
-    else {
-      return 1 + n ;
-    }
-  }
-  else {
-    return 1 ;
-  }
-}
-
-
@@ -12,29 +12,32 @@
 
 #include "bioGaussHermite.h"
 #include "bioSmartPointer.h"
+#include "bioDerivatives.h"
 
 class bioExpression ;
 
-// This object is designed to gather all variables that must be
-// integrated into one vector.  It is assumed that, if the hessian is
-// requested, so is the gradient.
+// The value of the expression and its derivatives are accumulated
+// in the result, which must be set to zero before the integration.
+// It is assumed that, if the hessian is requested, so is the
+// gradient.
 
 class bioExprGaussHermite: public bioGhFunction {
  public:
   bioExprGaussHermite(bioSmartPointer<bioExpression>  e,
-		      std::vector<bioUInt> derivl,
+		      const std::vector<bioUInt>& derivl,
 		      bioUInt l,
 		      bioBoolean wg,
-		      bioBoolean wh) ;
-  std::vector<bioReal> getValue(bioReal x) ;
-  bioUInt getSize() const ;
+		      bioBoolean wh,
+		      bioDerivatives& r) ;
+ protected:
+  void addValue(bioReal x, bioReal w) ;
 private:
   bioBoolean withGradient ;
   bioBoolean withHessian ;
   bioSmartPointer<bioExpression>  theExpression ;
-  std::vector<bioUInt> derivLiteralIds ;
+  const std::vector<bioUInt>& derivLiteralIds ;
   bioUInt rvId;
-  bioReal theValue ;
+  bioDerivatives& result ;
 };
 
 #endif
@@ -28,7 +28,7 @@ bioExprGreater::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 				       bioBoolean gradient,
 				       bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   if (gradient || hessian) {
     if (containsLiterals(literalIds)) {
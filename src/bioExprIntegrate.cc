@@ -16,9 +16,22 @@
 #include "bioExprGaussHermite.h"
 
 
-bioExprIntegrate::bioExprIntegrate(bioSmartPointer<bioExpression>  c, bioUInt id) :
-  child(c), rvId(id) {
+// Maximum number of iterations of Newton's method for the mode of
+// the integrand.
+static const bioUInt bioGhMaxNewtonIterations = 20 ;
+
+bioExprIntegrate::bioExprIntegrate(bioSmartPointer<bioExpression>  c,
+				   bioUInt id,
+				   bioUInt o,
+				   bioBoolean a,
+				   bioUInt rvl) :
+  child(c), rvId(id), order(o), adaptive(a), rvLiteralId(rvl) {
   listOfChildren.push_back(c) ;
+  // Check that the rule is available
+  bioGaussHermite theRule(NULL,order) ;
+  if (adaptive && rvLiteralId == bioBadId) {
+    throw bioExceptions(__FILE__,__LINE__,"The random variable of the adaptive integral does not appear in its argument") ;
+  }
 }
 bioExprIntegrate::~bioExprIntegrate() {
 }
@@ -28,35 +41,40 @@ bioExprIntegrate::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 					 bioBoolean gradient,
 					 bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
-  
-
-  bioExprGaussHermite theGh(child,literalIds,rvId,gradient,hessian) ;   
-  bioGaussHermite theGhAlgo(&theGh) ;
-  std::vector<bioReal> r = theGhAlgo.integrate() ;
-  theDerivatives->f = r[0] ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
+  theDerivatives->f = 0.0 ;
+  if (gradient) {
+    if (hessian) {
+      theDerivatives->setDerivativesToZero() ;
+    }
+    else {
+      theDerivatives->setGradientToZero() ;
+    }
+  }
+  bioReal mu = 0.0 ;
+  bioReal scale = 1.0 ;
+  if (adaptive && !findMode(mu,scale)) {
+    mu = 0.0 ;
+    scale = 1.0 ;
+  }
+  bioExprGaussHermite theGh(child,literalIds,rvId,gradient,hessian,*theDerivatives) ;   
+  bioGaussHermite theGhAlgo(&theGh,order) ;
+  theGhAlgo.integrate(mu,scale) ;
   bioUInt n = literalIds.size() ;
   if (gradient) {
     for (bioUInt j = 0 ; j < n ; ++j) {
-      if (std::isfinite(r[j+1])) {
-	theDerivatives->g[j] = r[j+1] ;
-      }
-      else {
+      if (!std::isfinite(theDerivatives->g[j])) {
 	theDerivatives->g[j] = bioMaxReal ;
       }
     }
   }
   if (hessian) {
-    bioUInt index = 1 + theDerivatives->g.size() ;
     for (bioUInt i = 0 ; i < n ; ++i) {
       for (bioUInt j = i ; j < n ; ++j) {
-	if (std::isfinite(r[index])) {
-	  theDerivatives->h[i][j] = theDerivatives->h[j][i] = r[index] ;
+	if (!std::isfinite(theDerivatives->h[i][j])) {
+	  theDerivatives->h[i][j] = bioMaxReal ;
 	}
-	else {
-	  theDerivatives->h[i][j] = theDerivatives->h[j][i] = bioMaxReal ;
-	}
-	++index ;
+	theDerivatives->h[j][i] = theDerivatives->h[i][j] ;
       }
     }
   }
@@ -64,9 +82,45 @@ bioExprIntegrate::getValueAndDerivatives(std::vector<bioUInt> literalIds,
   return theDerivatives ;
 }
 
+bioBoolean bioExprIntegrate::findMode(bioReal& mu, bioReal& scale) {
+  // Newton's method on the log of the integrand, starting from 0.
+  std::vector<bioUInt> rv(1,rvLiteralId) ;
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  bioReal x = 0.0 ;
+  for (bioUInt iter = 0 ; iter < bioGhMaxNewtonIterations ; ++iter) {
+    state->setRandomVariable(rvId,x) ;
+    bioSmartPointer<bioDerivatives> d = child->getValueAndDerivatives(rv,true,true) ;
+    if (!(d->f > 0.0) || !std::isfinite(d->f)) {
+      return false ;
+    }
+    bioReal g = d->g[0] / d->f ;
+    bioReal h = d->h[0][0] / d->f - g * g ;
+    if (!(h < 0.0) || !std::isfinite(g)) {
+      return false ;
+    }
+    bioReal step = - g / h ;
+    // Steps are limited to the scale of the integrand.
+    bioReal maxStep = 1.0 / std::sqrt(-h) ;
+    if (std::abs(step) > maxStep) {
+      step = (step > 0) ? maxStep : -maxStep ;
+    }
+    x += step ;
+    if (std::abs(step) <= 1.0e-6 * maxStep) {
+      mu = x ;
+      scale = std::sqrt(2.0 / (-h)) ;
+      return true ;
+    }
+  }
+  return false ;
+}
+
 bioString bioExprIntegrate::print(bioBoolean hp) const {
   std::stringstream str ; 
-  str << "Integrate(" << child->print(hp) << "," << rvId << ")" ;
+  str << "Integrate(" << child->print(hp) << "," << rvId ;
+  if (order != bioGhDefaultOrder || adaptive) {
+    str << "," << order << "," << adaptive ;
+  }
+  str << ")" ;
   return str.str() ;
 
 }
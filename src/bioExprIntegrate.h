@@ -13,9 +13,19 @@
 #include "bioExpression.h"
 #include "bioString.h"
 
+// Integral of the child over the random variable lid, with the
+// Gauss-Hermite rule with the given number of points. If adaptive,
+// the nodes are centered on the mode of the child, and scaled by its
+// curvature. The mode is obtained by Newton's method, using the
+// derivatives with respect to the random variable, identified by its
+// literal id.
 class bioExprIntegrate: public bioExpression {
  public:
-  bioExprIntegrate(bioSmartPointer<bioExpression>  c, bioUInt lid) ;
+  bioExprIntegrate(bioSmartPointer<bioExpression>  c,
+		   bioUInt lid,
+		   bioUInt order = bioGhDefaultOrder,
+		   bioBoolean adaptive = false,
+		   bioUInt rvLiteralId = bioBadId) ;
   ~bioExprIntegrate() ;
   virtual bioSmartPointer<bioDerivatives> getValueAndDerivatives(std::vector<bioUInt> literalIds,
 								 bioBoolean gradient,
@@ -24,7 +34,14 @@ class bioExprIntegrate: public bioExpression {
   virtual bioString print(bioBoolean hp = false) const ;
 
  protected:
+  // Center and scale of the nodes for the adaptive quadrature.
+  // Returns false if the mode cannot be found. The center and the
+  // scale are not differentiated with respect to the parameters.
+  bioBoolean findMode(bioReal& mu, bioReal& scale) ;
   bioSmartPointer<bioExpression>  child ;
   bioUInt rvId ;
+  bioUInt order ;
+  bioBoolean adaptive ;
+  bioUInt rvLiteralId ;
 };
 #endif
@@ -28,7 +28,7 @@ bioExprLess::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 				    bioBoolean gradient,
 				    bioBoolean hessian) {
   
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   if (gradient) {
     if (containsLiterals(literalIds)) {
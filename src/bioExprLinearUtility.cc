@@ -52,7 +52,7 @@ bioExprLinearUtility::getValueAndDerivatives(std::vector<bioUInt> literalIds,
     throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
   }
   
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   bioUInt n = literalIds.size() ;
   theDerivatives->f = 0.0 ;
@@ -74,7 +74,8 @@ bioExprLinearUtility::getValueAndDerivatives(std::vector<bioUInt> literalIds,
       theDerivatives->setGradientToZero() ;
     }
     for (std::size_t i = 0 ; i < literalIds.size() ; ++i) {
-      theDerivatives->g[i] = values[theFriend[i]] ;
+      std::map<bioUInt,bioString>::const_iterator found = theFriend.find(i) ;
+      theDerivatives->g[i] = (found == theFriend.end()) ? 0.0 : values[found->second] ;
       //      DEBUG_MESSAGE("Gradient[" << i << "]=" << "value[" << theFriend[i] << "]=" <<theDerivatives->g[i]) ;
       
     }
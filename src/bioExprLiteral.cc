@@ -8,7 +8,9 @@
 //--------------------------------------------------------------------
 
 #include "bioExprLiteral.h"
+#include "bioBatchDerivatives.h"
 #include <sstream>
+#include <algorithm>
 #include "bioSmartPointer.h"
 #include "bioExceptions.h"
 #include "bioDebug.h"
@@ -29,7 +31,7 @@ bioExprLiteral::getValueAndDerivatives(std::vector<bioUInt> literalIds,
     throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
   }
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   if (gradient) {
     if (hessian) {
@@ -55,8 +57,9 @@ bioExprLiteral::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 bioString bioExprLiteral::print(bioBoolean hp) const {
   std::stringstream str ;
   str << theName << "[" << theLiteralId << "]" ;
-  if (rowIndex != NULL) {
-    str << " <" << *rowIndex << ">" ;
+  bioUInt row = bioEvaluationState::current()->row ;
+  if (row != bioBadId) {
+    str << " <" << row << ">" ;
   }
   try {
     str << "(" << getLiteralValue() << ")";
@@ -78,6 +81,10 @@ bioBoolean bioExprLiteral::containsLiterals(std::vector<bioUInt> literalIds) con
   return false ;
 }
 
+bioBoolean bioExprLiteral::dependsOnlyOnData() const {
+  return false ;
+}
+
 void bioExprLiteral::setData(std::vector< std::vector<bioReal> >* d) {
   data = d ;
   if (data == NULL) {
@@ -106,3 +113,24 @@ std::map<bioString,bioReal> bioExprLiteral::getAllLiteralValues() const {
 bioUInt bioExprLiteral::getLiteralId() const {
   return theLiteralId ;
 }
+
+// Except for the draws, the value of a literal does not depend on the
+// draw.
+void bioExprLiteral::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						     bioBatchDerivatives& result) {
+  std::fill(result.f.begin(),result.f.end(),getLiteralValue()) ;
+  setBatchGradient(literalIds,result) ;
+}
+
+void bioExprLiteral::setBatchGradient(const std::vector<bioUInt>& literalIds,
+				      bioBatchDerivatives& result) const {
+  if (!result.hasGradient) {
+    return ;
+  }
+  for (bioUInt i = 0 ; i < literalIds.size() ; ++i) {
+    if (literalIds[i] == theLiteralId) {
+      std::fill(result.gradient(i),result.gradient(i)+result.size,1.0) ;
+      result.active[i] = true ;
+    }
+  }
+}
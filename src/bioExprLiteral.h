@@ -25,12 +25,20 @@ class bioExprLiteral: public bioExpression {
   // Returns true is the expression contains at least one literal in
   // the list. Used to simplify the calculation of the derivatives
   virtual bioBoolean containsLiterals(std::vector<bioUInt> literalIds) const ;
+  // Parameters, draws and random variables. Only the variables
+  // depend on the data.
+  virtual bioBoolean dependsOnlyOnData() const ;
   virtual void setData(std::vector< std::vector<bioReal> >* d) ;
   virtual std::map<bioString,bioReal> getAllLiteralValues() const ;
   virtual bioUInt getLiteralId() const ;
   
 protected:
+  virtual void computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+					       bioBatchDerivatives& result) ;
   virtual bioReal getLiteralValue() const = PURE_VIRTUAL ;
+  // The derivative of the literal with respect to itself is one.
+  void setBatchGradient(const std::vector<bioUInt>& literalIds,
+			bioBatchDerivatives& result) const ;
   bioUInt theLiteralId ;
   bioString theName ; 
 };
@@ -8,6 +8,7 @@
 //--------------------------------------------------------------------
 
 #include "bioExprLog.h"
+#include "bioBatchDerivatives.h"
 #include "bioDebug.h"
 #include "bioExceptions.h"
 #include "bioSmartPointer.h"
@@ -29,7 +30,7 @@ bioExprLog::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 						   bioBoolean hessian) {
   
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   bioUInt n = literalIds.size() ;
   bioSmartPointer<bioDerivatives> childResult = child->getValueAndDerivatives(literalIds,gradient,hessian) ;
@@ -46,8 +47,9 @@ bioExprLog::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 	   ++i) {
 	str << i->first << " = " << i->second << std::endl ;
       }
-      if (rowIndex != NULL) {
-	str << "row number: " << *rowIndex << ", ";
+      bioUInt row = bioEvaluationState::current()->row ;
+      if (row != bioBadId) {
+	str << "row number: " << row << ", ";
       }
       
       str << "Cannot take the log of a non positive number [" << childResult->f << "]" << std::endl ;
@@ -80,3 +82,43 @@ bioString bioExprLog::print(bioBoolean hp) const {
   return str.str() ;
 }
 
+
+void bioExprLog::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						 bioBatchDerivatives& result) {
+  bioBatchDerivatives childResult(result.n,result.size,result.hasGradient) ;
+  child->getBatchValueAndDerivatives(literalIds,childResult) ;
+  for (bioUInt r = 0 ; r < result.size ; ++r) {
+    if (childResult.f[r] < 0) {
+      if (std::abs(childResult.f[r]) < 1.0e-6) {
+	childResult.f[r] = 0.0 ;
+      }
+      else {
+	// The error is reported by the evaluation for this draw.
+	bioEvaluationState* state = bioEvaluationState::current() ;
+	bioUInt firstDraw = state->draw ;
+	state->draw = firstDraw + r ;
+	try {
+	  getValueAndDerivatives(literalIds,result.hasGradient,false) ;
+	}
+	catch(...) {
+	  state->draw = firstDraw ;
+	  throw ;
+	}
+	state->draw = firstDraw ;
+      }
+    }
+    result.f[r] = (childResult.f[r] == 0.0) ? -std::numeric_limits<bioReal>::max() / 2.0 : log(childResult.f[r]) ;
+  }
+  if (result.hasGradient) {
+    for (bioUInt i = 0 ; i < result.n ; ++i) {
+      if (childResult.active[i]) {
+	bioReal* g = result.gradient(i) ;
+	const bioReal* cg = childResult.gradient(i) ;
+	for (bioUInt r = 0 ; r < result.size ; ++r) {
+	  g[r] = cg[r] / childResult.f[r] ;
+	}
+	result.active[i] = true ;
+      }
+    }
+  }
+}
@@ -0,0 +1,234 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprLogCnl.cc
+// @date   Mon Oct 19 03:50:11 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include <iterator>
+#include "bioSmartPointer.h"
+#include "bioDebug.h"
+#include "bioExceptions.h"
+#include "bioExprLogCnl.h"
+
+bioExprLogCnl::bioExprLogCnl(bioSmartPointer<bioExpression>  c,
+			     std::map<bioUInt,bioSmartPointer<bioExpression> > u,
+			     std::map<bioUInt,bioSmartPointer<bioExpression> > a,
+			     bioSmartPointer<bioExpression>  mu,
+			     std::vector<bioCrossNest> n) :
+  choice(c), utilities(u), availabilities(a), scale(mu), nests(n) {
+  listOfChildren.push_back(choice) ;
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = u.begin() ;
+       i != u.end();
+       ++i) {
+    listOfChildren.push_back(i->second) ;
+  }
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = a.begin() ;
+       i != a.end();
+       ++i) {
+    listOfChildren.push_back(i->second) ;
+  }
+  listOfChildren.push_back(scale) ;
+  for (std::vector<bioCrossNest>::iterator m = nests.begin() ;
+       m != nests.end() ;
+       ++m) {
+    if (m->theAlternatives.size() != m->theAlphas.size()) {
+      throw bioExceptions(__FILE__,__LINE__,"Each alternative of a nest must have an alpha parameter") ;
+    }
+    listOfChildren.push_back(m->theParameter) ;
+    positions.push_back(std::vector<bioUInt>()) ;
+    for (bioUInt k = 0 ; k < m->theAlternatives.size() ; ++k) {
+      listOfChildren.push_back(m->theAlphas[k]) ;
+      std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = utilities.find(m->theAlternatives[k]) ;
+      if (i == utilities.end() ||
+	  availabilities.find(m->theAlternatives[k]) == availabilities.end()) {
+	std::stringstream str ;
+	str << "Alternative " << m->theAlternatives[k] << " appears in a nest, and not in the choice set" ;
+	throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+      }
+      positions.back().push_back(std::distance(utilities.begin(),i)) ;
+    }
+  }
+}
+
+bioExprLogCnl::~bioExprLogCnl() {
+}
+
+bioSmartPointer<bioDerivatives> bioExprLogCnl::getValueAndDerivatives(std::vector<bioUInt> literalIds,
+								      bioBoolean gradient,
+								      bioBoolean hessian) {
+
+  if (!gradient && hessian) {
+    throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
+  }
+
+  bioUInt n = literalIds.size() ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(n)) ;
+  if (hessian) {
+    theDerivatives->setDerivativesToZero() ;
+  }
+  else if (gradient) {
+    theDerivatives->setGradientToZero() ;
+  }
+  bioReal minusInfinity = (std::numeric_limits<bioReal>::has_infinity) ?
+    -std::numeric_limits<bioReal>::infinity() :
+    std::numeric_limits<bioReal>::lowest() ;
+
+  bioUInt chosen = bioUInt(choice->getValue()) ;
+  std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator theUtil = utilities.find(chosen) ;
+  if (theUtil == utilities.end()) {
+    std::stringstream str ;
+    str << "Alternative "
+	<< chosen
+	<< " is not known. The alternatives that have been defined are" ;
+    for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = utilities.begin() ;
+	 i != utilities.end() ;
+	 ++i) {
+      str << " " << i->first ;
+    }
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  bioUInt chosenPosition = std::distance(utilities.begin(),theUtil) ;
+
+  // The availabilities are evaluated once, and the utilities only
+  // when they are needed, for all the nests.
+  std::vector<bioBoolean> available ;
+  available.reserve(availabilities.size()) ;
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = availabilities.begin() ;
+       i != availabilities.end() ;
+       ++i) {
+    available.push_back(i->second->getValue() != 0.0) ;
+  }
+  if (!available[chosenPosition]) {
+    theDerivatives->f = minusInfinity ;
+    return theDerivatives ;
+  }
+  std::vector<bioSmartPointer<bioDerivatives> > V(utilities.size()) ;
+
+  bioSmartPointer<bioDerivatives> mu = scale->getValueAndDerivatives(literalIds,gradient,hessian) ;
+  bioDerivatives inverseMu(n) ;
+  inverseMu.setComposition(*mu,1.0/mu->f,-1.0/(mu->f*mu->f),2.0/(mu->f*mu->f*mu->f),gradient,hessian) ;
+
+  // Inclusive values mu/mu_m L_m of the nests
+  std::vector<bioDerivatives> inclusiveValues ;
+  inclusiveValues.reserve(nests.size()) ;
+  // Terms x_im + (mu/mu_m - 1) L_m of the chosen alternative
+  std::vector<bioDerivatives> chosenTerms ;
+  std::vector<bioDerivatives> x ;
+  std::vector<const bioDerivatives*> terms ;
+  bioDerivatives ratio(n) ;
+  bioDerivatives logAlpha(n) ;
+  bioDerivatives muV(n) ;
+  bioDerivatives logSum(n) ;
+  bioDerivatives inverseMum(n) ;
+  for (bioUInt m = 0 ; m < nests.size() ; ++m) {
+    bioCrossNest& theNest = nests[m] ;
+    bioSmartPointer<bioDerivatives> mum ;
+    bioUInt chosenIndex = bioBadId ;
+    x.clear() ;
+    for (bioUInt k = 0 ; k < theNest.theAlternatives.size() ; ++k) {
+      bioUInt p = positions[m][k] ;
+      if (!available[p]) {
+	continue ;
+      }
+      bioSmartPointer<bioDerivatives> alpha = theNest.theAlphas[k]->getValueAndDerivatives(literalIds,gradient,hessian) ;
+      if (alpha->f == 0.0) {
+	continue ;
+      }
+      if (mum == NULL) {
+	mum = theNest.theParameter->getValueAndDerivatives(literalIds,gradient,hessian) ;
+	ratio.setProduct(*mum,inverseMu,gradient,hessian) ;
+      }
+      if (V[p] == NULL) {
+	V[p] = utilities.at(theNest.theAlternatives[k])->getValueAndDerivatives(literalIds,gradient,hessian) ;
+	if (V[p] == NULL) {
+	  throw bioExceptNullPointer(__FILE__,__LINE__,"result") ;
+	}
+      }
+      bioReal a = alpha->f ;
+      logAlpha.setComposition(*alpha,log(a),1.0/a,-1.0/(a*a),gradient,hessian) ;
+      x.push_back(bioDerivatives(n)) ;
+      x.back().setProduct(ratio,logAlpha,gradient,hessian) ;
+      muV.setProduct(*mum,*V[p],gradient,hessian) ;
+      x.back().add(1.0,muV,gradient,hessian) ;
+      if (p == chosenPosition) {
+	chosenIndex = x.size() - 1 ;
+      }
+    }
+    if (x.empty()) {
+      continue ;
+    }
+    terms.clear() ;
+    for (std::vector<bioDerivatives>::iterator k = x.begin() ;
+	 k != x.end() ;
+	 ++k) {
+      terms.push_back(&(*k)) ;
+    }
+    logSum.setLogSumExp(terms,gradient,hessian) ;
+    bioReal b = mum->f ;
+    inverseMum.setComposition(*mum,1.0/b,-1.0/(b*b),2.0/(b*b*b),gradient,hessian) ;
+    ratio.setProduct(*mu,inverseMum,gradient,hessian) ;
+    inclusiveValues.push_back(bioDerivatives(n)) ;
+    inclusiveValues.back().setProduct(ratio,logSum,gradient,hessian) ;
+    if (chosenIndex != bioBadId) {
+      chosenTerms.push_back(x[chosenIndex]) ;
+      chosenTerms.back().add(-1.0,logSum,gradient,hessian) ;
+      chosenTerms.back().add(1.0,inclusiveValues.back(),gradient,hessian) ;
+    }
+  }
+  if (chosenTerms.empty()) {
+    // The chosen alternative does not belong to any nest.
+    theDerivatives->f = minusInfinity ;
+    return theDerivatives ;
+  }
+  terms.clear() ;
+  for (std::vector<bioDerivatives>::iterator k = chosenTerms.begin() ;
+       k != chosenTerms.end() ;
+       ++k) {
+    terms.push_back(&(*k)) ;
+  }
+  theDerivatives->setLogSumExp(terms,gradient,hessian) ;
+  terms.clear() ;
+  for (std::vector<bioDerivatives>::iterator k = inclusiveValues.begin() ;
+       k != inclusiveValues.end() ;
+       ++k) {
+    terms.push_back(&(*k)) ;
+  }
+  logSum.setLogSumExp(terms,gradient,hessian) ;
+  theDerivatives->add(-1.0,logSum,gradient,hessian) ;
+  return theDerivatives ;
+}
+
+bioString bioExprLogCnl::print(bioBoolean hp) const {
+  std::stringstream str ;
+  str << "CrossNested[" << choice->print(hp) << "](" ;
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::const_iterator i = utilities.begin() ;
+       i != utilities.end() ;
+       ++i) {
+    if (i != utilities.begin()) {
+      str << ";" ;
+    }
+    str << "{" << availabilities.at(i->first)->print(hp) << "}" << i->second->print(hp) ;
+  }
+  str << ")[" << scale->print(hp) << "](" ;
+  for (std::vector<bioCrossNest>::const_iterator m = nests.begin() ;
+       m != nests.end() ;
+       ++m) {
+    if (m != nests.begin()) {
+      str << ";" ;
+    }
+    str << m->theParameter->print(hp) << ":" ;
+    for (bioUInt k = 0 ; k < m->theAlternatives.size() ; ++k) {
+      if (k != 0) {
+	str << "," ;
+      }
+      str << m->theAlternatives[k] << "[" << m->theAlphas[k]->print(hp) << "]" ;
+    }
+  }
+  str << ")" ;
+  return str.str() ;
+}
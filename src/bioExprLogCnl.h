@@ -0,0 +1,64 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprLogCnl.h
+// @date   Mon Oct 19 03:47:57 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioExprLogCnl_h
+#define bioExprLogCnl_h
+
+#include <map>
+#include <vector>
+#include "bioExpression.h"
+#include "bioString.h"
+
+// Nest of the cross-nested logit model. Only the alternatives with an
+// alpha parameter are stored.
+class bioCrossNest {
+public:
+  bioSmartPointer<bioExpression>  theParameter ;
+  std::vector<bioUInt> theAlternatives ;
+  std::vector<bioSmartPointer<bioExpression> > theAlphas ;
+};
+
+// Log of the cross-nested logit probability. With
+//
+// x_jm = mu_m/mu ln alpha_jm + mu_m V_j,
+// L_m = ln sum_j a_j exp(x_jm),
+//
+// the probability of alternative i is
+//
+// ln P(i) = ln sum_m exp(x_im + (mu/mu_m - 1) L_m)
+//           - ln sum_m exp(mu/mu_m L_m),
+//
+// which is the same model as the MEV generating function built by
+// models.getMevForCrossNestedMu. The terms such that alpha_jm is
+// zero are skipped. The derivatives are obtained by the chain rules
+// of bioDerivatives.
+class bioExprLogCnl: public bioExpression {
+ public:
+  bioExprLogCnl(bioSmartPointer<bioExpression>  c,
+		std::map<bioUInt,bioSmartPointer<bioExpression> > u,
+		std::map<bioUInt,bioSmartPointer<bioExpression> > a,
+		bioSmartPointer<bioExpression>  mu,
+		std::vector<bioCrossNest> n) ;
+  ~bioExprLogCnl() ;
+  virtual bioSmartPointer<bioDerivatives> getValueAndDerivatives(std::vector<bioUInt> literalIds,
+								 bioBoolean gradient,
+								 bioBoolean hessian) ;
+  virtual bioString print(bioBoolean hp = false) const ;
+protected:
+  bioSmartPointer<bioExpression>  choice ;
+  std::map<bioUInt,bioSmartPointer<bioExpression> > utilities ;
+  std::map<bioUInt,bioSmartPointer<bioExpression> > availabilities ;
+  bioSmartPointer<bioExpression>  scale ;
+  std::vector<bioCrossNest> nests ;
+  // Position of the alternatives of each nest in the list of
+  // alternatives, sorted by id.
+  std::vector<std::vector<bioUInt> > positions ;
+};
+
+
+#endif
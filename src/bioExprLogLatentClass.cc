@@ -0,0 +1,159 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprLogLatentClass.cc
+// @date   Mon Oct 19 04:30:11 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include "bioSmartPointer.h"
+#include "bioDebug.h"
+#include "bioExceptions.h"
+#include "bioEvaluationState.h"
+#include "bioExprLogLatentClass.h"
+
+bioExprLogLatentClass::bioExprLogLatentClass(std::vector<bioSmartPointer<bioExpression> > m,
+					     std::vector<bioSmartPointer<bioExpression> > l,
+					     bioBoolean p) :
+  membership(m), models(l), panel(p) {
+  if (membership.empty()) {
+    throw bioExceptions(__FILE__,__LINE__,"The latent class model has no class") ;
+  }
+  if (membership.size() != models.size()) {
+    std::stringstream str ;
+    str << "Inconsistent latent class model: " << membership.size() << " membership utilities and " << models.size() << " class-specific models" ;
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  for (bioUInt c = 0 ; c < membership.size() ; ++c) {
+    listOfChildren.push_back(membership[c]) ;
+    listOfChildren.push_back(models[c]) ;
+  }
+}
+
+bioExprLogLatentClass::~bioExprLogLatentClass() {
+}
+
+bioSmartPointer<bioDerivatives> bioExprLogLatentClass::getValueAndDerivatives(std::vector<bioUInt> literalIds,
+									      bioBoolean gradient,
+									      bioBoolean hessian) {
+
+  if (!gradient && hessian) {
+    throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
+  }
+
+  bioUInt n = literalIds.size() ;
+  bioUInt C = membership.size() ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(n)) ;
+  bioReal minusInfinity = (std::numeric_limits<bioReal>::has_infinity) ?
+    -std::numeric_limits<bioReal>::infinity() :
+    std::numeric_limits<bioReal>::lowest() ;
+  if (hessian) {
+    theDerivatives->setDerivativesToZero() ;
+  }
+  else if (gradient) {
+    theDerivatives->setGradientToZero() ;
+  }
+
+  std::vector<bioDerivatives> W(C,bioDerivatives(n)) ;
+  for (bioUInt c = 0 ; c < C ; ++c) {
+    bioSmartPointer<bioDerivatives> w = membership[c]->getValueAndDerivatives(literalIds,gradient,hessian) ;
+    if (w == NULL) {
+      throw bioExceptNullPointer(__FILE__,__LINE__,"result") ;
+    }
+    W[c] = *w ;
+  }
+
+  // Log of the probability of the choice(s) in each class
+  std::vector<bioDerivatives> L(C,bioDerivatives(n)) ;
+  if (panel) {
+    for (bioUInt c = 0 ; c < C ; ++c) {
+      L[c].f = 0.0 ;
+    }
+    if (dataMap == NULL) {
+      throw bioExceptNullPointer(__FILE__,__LINE__,"data map") ;
+    }
+    bioEvaluationState* state = bioEvaluationState::current() ;
+    if (state->individual == bioBadId) {
+      throw bioExceptNullPointer(__FILE__,__LINE__,"individual index") ;
+    }
+    if (state->individual >= dataMap->size()) {
+      throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,state->individual,0,dataMap->size() - 1) ;
+    }
+    bioUInt previousRow = state->row ;
+    // The rows are visited once, and all the classes are evaluated
+    // for each of them.
+    for (state->row = (*dataMap)[state->individual][0]  ; state->row <= (*dataMap)[state->individual][1] ; ++state->row) {
+      try {
+	for (bioUInt c = 0 ; c < C ; ++c) {
+	  bioSmartPointer<bioDerivatives> l = models[c]->getValueAndDerivatives(literalIds,gradient,hessian) ;
+	  if (l == NULL) {
+	    throw bioExceptNullPointer(__FILE__,__LINE__,"result") ;
+	  }
+	  if (l->f == minusInfinity) {
+	    L[c].f = minusInfinity ;
+	  }
+	  else if (L[c].f != minusInfinity) {
+	    L[c].add(1.0,*l,gradient,hessian) ;
+	  }
+	}
+      }
+      catch(bioExceptions& e) {
+	std::stringstream str ;
+	str << "Error for data entry " << state->row << ": " << e.what() ;
+	state->row = previousRow ;
+	throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+      }
+    }
+    state->row = previousRow ;
+  }
+  else {
+    for (bioUInt c = 0 ; c < C ; ++c) {
+      bioSmartPointer<bioDerivatives> l = models[c]->getValueAndDerivatives(literalIds,gradient,hessian) ;
+      if (l == NULL) {
+	throw bioExceptNullPointer(__FILE__,__LINE__,"result") ;
+      }
+      L[c] = *l ;
+    }
+  }
+
+  // The classes where the choices have a zero probability do not
+  // contribute to the mixture.
+  std::vector<const bioDerivatives*> terms ;
+  std::vector<const bioDerivatives*> membershipTerms ;
+  for (bioUInt c = 0 ; c < C ; ++c) {
+    membershipTerms.push_back(&W[c]) ;
+    if (L[c].f != minusInfinity) {
+      L[c].add(1.0,W[c],gradient,hessian) ;
+      terms.push_back(&L[c]) ;
+    }
+  }
+  if (terms.empty()) {
+    theDerivatives->f = minusInfinity ;
+    return theDerivatives ;
+  }
+  theDerivatives->setLogSumExp(terms,gradient,hessian) ;
+  bioDerivatives logSum(n) ;
+  logSum.setLogSumExp(membershipTerms,gradient,hessian) ;
+  theDerivatives->add(-1.0,logSum,gradient,hessian) ;
+  return theDerivatives ;
+}
+
+bioString bioExprLogLatentClass::print(bioBoolean hp) const {
+  std::stringstream str ;
+  str << "LatentClass" ;
+  if (panel) {
+    str << "[panel]" ;
+  }
+  str << "(" ;
+  for (bioUInt c = 0 ; c < membership.size() ; ++c) {
+    if (c != 0) {
+      str << ";" ;
+    }
+    str << membership[c]->print(hp) << ":" << models[c]->print(hp) ;
+  }
+  str << ")" ;
+  return str.str() ;
+}
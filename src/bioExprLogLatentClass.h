@@ -0,0 +1,45 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprLogLatentClass.h
+// @date   Mon Oct 19 04:27:20 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioExprLogLatentClass_h
+#define bioExprLogLatentClass_h
+
+#include <vector>
+#include "bioExpression.h"
+#include "bioString.h"
+
+// Log of the choice probability of a latent class model. Class c has
+// the membership utility W_c and the class-specific model L_c, which
+// is the log of a choice probability. Then,
+//
+// ln P = ln sum_c exp(W_c + L_c) - ln sum_c exp(W_c).
+//
+// With panel data, L_c is summed over the observations of the
+// individual, so that the product of the probabilities of the
+// trajectory is computed inside each class, and the membership
+// utilities take the value of the first observation. The classes are
+// evaluated together, row by row, and the derivatives are obtained
+// from the two sums, without building the tree of the mixture.
+class bioExprLogLatentClass: public bioExpression {
+ public:
+  bioExprLogLatentClass(std::vector<bioSmartPointer<bioExpression> > m,
+			std::vector<bioSmartPointer<bioExpression> > l,
+			bioBoolean p) ;
+  ~bioExprLogLatentClass() ;
+  virtual bioSmartPointer<bioDerivatives> getValueAndDerivatives(std::vector<bioUInt> literalIds,
+								 bioBoolean gradient,
+								 bioBoolean hessian) ;
+  virtual bioString print(bioBoolean hp = false) const ;
+protected:
+  std::vector<bioSmartPointer<bioExpression> > membership ;
+  std::vector<bioSmartPointer<bioExpression> > models ;
+  bioBoolean panel ;
+};
+
+
+#endif
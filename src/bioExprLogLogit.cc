@@ -9,10 +9,32 @@
 
 #include <sstream>
 #include <cmath>
+#include <algorithm>
+#include <deque>
 #include "bioSmartPointer.h"
 #include "bioDebug.h"
 #include "bioExceptions.h"
 #include "bioExprLogLogit.h"
+#include "bioBatchDerivatives.h"
+
+// One element per level of nesting. The elements of a deque are not
+// moved when it grows.
+static thread_local std::deque<bioLogitBuffers> theLogitBuffers ;
+static thread_local bioUInt theLogitDepth = 0 ;
+
+static bioLogitBuffers& reserveLogitBuffers() {
+  if (theLogitDepth == theLogitBuffers.size()) {
+    theLogitBuffers.push_back(bioLogitBuffers()) ;
+  }
+  return theLogitBuffers[theLogitDepth++] ;
+}
+
+bioLogitWorkspace::bioLogitWorkspace() : buffers(reserveLogitBuffers()) {
+}
+
+bioLogitWorkspace::~bioLogitWorkspace() {
+  --theLogitDepth ;
+}
 
 bioExprLogLogit::bioExprLogLogit(bioSmartPointer<bioExpression>  c,
 				 std::map<bioUInt,bioSmartPointer<bioExpression> > u,
@@ -28,89 +50,162 @@ bioExprLogLogit::bioExprLogLogit(bioSmartPointer<bioExpression>  c,
        i != a.end();
        ++i) {
     listOfChildren.push_back(i->second) ;
+    ids.push_back(i->first) ;
+    std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator theUtil = utilities.find(i->first) ;
+    utilityList.push_back((theUtil == utilities.end()) ? bioSmartPointer<bioExpression>(NULL) : theUtil->second) ;
+    availabilityList.push_back(i->second) ;
   }
+  slots.setIds(ids) ;
 }
 
 bioExprLogLogit::~bioExprLogLogit() {
 }
 
-bioSmartPointer<bioDerivatives> bioExprLogLogit::getValueAndDerivatives(std::vector<bioUInt> literalIds,
-							bioBoolean gradient,
-							bioBoolean hessian) {
+void bioExprLogLogit::setData(std::vector< std::vector<bioReal> >* d) {
+  bioExpression::setData(d) ;
+  // The lists of available alternatives are obsolete.
+  availableStart.clear() ;
+  availableAlternatives.clear() ;
+  availabilityFailed.clear() ;
+}
 
-  if (!gradient && hessian) {
-    throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
+void bioExprLogLogit::prepareData() {
+  availableStart.clear() ;
+  availableAlternatives.clear() ;
+  availabilityFailed.clear() ;
+  if (data == NULL) {
+    return ;
   }
-  
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
-
-  bioUInt n = literalIds.size() ;
-  bioUInt chosen = bioUInt(choice->getValue()) ;
-  std::vector<bioSmartPointer<bioDerivatives> > Vs ;
-  bioSmartPointer<bioDerivatives> chosenUtility(NULL) ;
-  bioSmartPointer<bioDerivatives> V;
-  bioReal largestUtility(-bioMaxReal) ;
-  for (std::map<bioUInt, bioSmartPointer<bioExpression> >::iterator i = availabilities.begin() ;
-       i != availabilities.end() ;
+  for (std::vector<bioSmartPointer<bioExpression> >::iterator i = availabilityList.begin() ;
+       i != availabilityList.end() ;
        ++i) {
-    bioReal av = i->second->getValue() ;
-    if (av == 0.0) {
-      if (i->first == chosen) {
-	if (gradient) {
-	  if (hessian) {
-	    theDerivatives->setDerivativesToZero() ;
-	  }
-	  else {
-	    theDerivatives->setGradientToZero() ;
-	  }
-	}
-	if (std::numeric_limits<bioReal>::has_infinity) {
-	  theDerivatives->f = -std::numeric_limits<bioReal>::infinity() ;
-	}
-	else {
-	  theDerivatives->f = std::numeric_limits<bioReal>::lowest() ;
+    if (!(*i)->dependsOnlyOnData()) {
+      return ;
+    }
+  }
+  bioUInt N = data->size() ;
+  availableStart.reserve(N+1) ;
+  availabilityFailed.assign(N,false) ;
+  bioEvaluationState state ;
+  bioEvaluationState::setCurrent(&state) ;
+  for (state.row = 0 ; state.row < N ; ++state.row) {
+    bioUInt size = availableAlternatives.size() ;
+    availableStart.push_back(size) ;
+    try {
+      for (bioUInt k = 0 ; k < availabilityList.size() ; ++k) {
+	if (availabilityList[k]->getValue() != 0.0) {
+	  availableAlternatives.push_back(k) ;
 	}
-	return theDerivatives ;
       }
     }
-    else {
-      //      DEBUG_MESSAGE("FIND THE EQUIVALENT OF ZIP IN C++")
-      std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator theUtil = utilities.find(i->first) ;
-      if (theUtil == utilities.end()) {
-	std::stringstream str ;
-	str << "Inconsistent dictionaries. Alternative " << i->first << " defined in the availabilities, and not in the utilities" ;
-	throw bioExceptions(__FILE__,__LINE__,str.str()) ;
-      }
-      if (theUtil->second == NULL) {
-	throw bioExceptNullPointer(__FILE__,__LINE__,"formula") ;
-      }
-      V = theUtil->second->getValueAndDerivatives(literalIds,gradient,hessian) ;
-      if (V == NULL) {
-	throw bioExceptNullPointer(__FILE__,__LINE__,"result") ;
+    catch(bioExceptions& e) {
+      availableAlternatives.resize(size) ;
+      availabilityFailed[state.row] = true ;
+    }
+  }
+  availableStart.push_back(availableAlternatives.size()) ;
+  bioEvaluationState::setCurrent(NULL) ;
+}
 
-      }
-      if (V->f > largestUtility) {
-	largestUtility = V->f ;
-      }
-      if (i->first == chosen) {
-	chosenUtility = V ;
-      }
-      Vs.push_back(V) ;
+void bioExprLogLogit::getAvailableAlternatives(std::vector<bioUInt>& buffer,
+					       const bioUInt*& first,
+					       const bioUInt*& last) {
+  bioUInt row = bioEvaluationState::current()->row ;
+  if (row < availabilityFailed.size() && !availabilityFailed[row]) {
+    first = availableAlternatives.data() + availableStart[row] ;
+    last = availableAlternatives.data() + availableStart[row+1] ;
+    return ;
+  }
+  buffer.clear() ;
+  for (bioUInt k = 0 ; k < availabilityList.size() ; ++k) {
+    if (availabilityList[k]->getValue() != 0.0) {
+      buffer.push_back(k) ;
     }
   }
-  
-  if (chosenUtility == NULL) {
+  first = buffer.data() ;
+  last = first + buffer.size() ;
+}
+
+bioUInt bioExprLogLogit::getPosition(bioUInt alternative) const {
+  bioUInt position = slots.getSlot(alternative) ;
+  if (position == bioBadId) {
     std::stringstream str ;
     str << "Alternative "
-	<< chosen
+	<< alternative
 	<< " is not known. The alternatives that have been defined are" ;
-    for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = utilities.begin() ;
+    for (std::map<bioUInt,bioSmartPointer<bioExpression> >::const_iterator i = utilities.begin() ;
 	 i != utilities.end() ;
 	 ++i) {
       str << " " << i->first ;
     }
     throw bioExceptions(__FILE__,__LINE__,str.str()) ;
   }
+  return position ;
+}
+
+bioSmartPointer<bioExpression> bioExprLogLogit::getUtility(bioUInt position) const {
+  if (utilityList[position] == NULL) {
+    std::stringstream str ;
+    str << "Inconsistent dictionaries. Alternative " << ids[position] << " defined in the availabilities, and not in the utilities" ;
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  return utilityList[position] ;
+}
+
+bioSmartPointer<bioDerivatives> bioExprLogLogit::getValueAndDerivatives(std::vector<bioUInt> literalIds,
+							bioBoolean gradient,
+							bioBoolean hessian) {
+
+  if (!gradient && hessian) {
+    throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
+  }
+  
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
+
+  bioUInt n = literalIds.size() ;
+  bioUInt chosen = bioUInt(choice->getValue()) ;
+  bioLogitWorkspace workspace ;
+  bioLogitBuffers& buffers = workspace.buffers ;
+  const bioUInt* first ;
+  const bioUInt* last ;
+  getAvailableAlternatives(buffers.available,first,last) ;
+  bioUInt chosenPosition = getPosition(chosen) ;
+  if (!std::binary_search(first,last,chosenPosition)) {
+    if (gradient) {
+      if (hessian) {
+	theDerivatives->setDerivativesToZero() ;
+      }
+      else {
+	theDerivatives->setGradientToZero() ;
+      }
+    }
+    if (std::numeric_limits<bioReal>::has_infinity) {
+      theDerivatives->f = -std::numeric_limits<bioReal>::infinity() ;
+    }
+    else {
+      theDerivatives->f = std::numeric_limits<bioReal>::lowest() ;
+    }
+    return theDerivatives ;
+  }
+  std::vector<bioSmartPointer<bioDerivatives> >& Vs = buffers.V ;
+  Vs.clear() ;
+  bioSmartPointer<bioDerivatives> chosenUtility(NULL) ;
+  bioSmartPointer<bioDerivatives> V;
+  bioReal largestUtility(-bioMaxReal) ;
+  for (const bioUInt* k = first ; k != last ; ++k) {
+    V = getUtility(*k)->getValueAndDerivatives(literalIds,gradient,hessian) ;
+    if (V == NULL) {
+      throw bioExceptNullPointer(__FILE__,__LINE__,"result") ;
+    }
+    if (V->f > largestUtility) {
+      largestUtility = V->f ;
+    }
+    if (*k == chosenPosition) {
+      chosenUtility = V ;
+    }
+    Vs.push_back(V) ;
+  }
+  
   bioReal maxexp = ceil(largestUtility / 10.0) * 10.0 ;
 
   
@@ -121,7 +216,8 @@ bioSmartPointer<bioDerivatives> bioExprLogLogit::getValueAndDerivatives(std::vec
   }
   
 
-  std::vector<bioReal> expi(Vs.size()) ; ;
+  std::vector<bioReal>& expi = buffers.expi ;
+  expi.resize(Vs.size()) ;
   
   bioReal denominator(0.0) ;
   for (bioUInt k = 0 ; k < Vs.size() ; ++k) {
@@ -132,7 +228,8 @@ bioSmartPointer<bioDerivatives> bioExprLogLogit::getValueAndDerivatives(std::vec
 
   theDerivatives->f = chosenUtility->f - log(denominator) ;
   if (gradient) {
-    std::vector<bioReal> weightedSum(n,0.0) ;
+    std::vector<bioReal>& weightedSum = buffers.weightedSum ;
+    weightedSum.assign(n,0.0) ;
     for (bioUInt j = 0 ; j < n ; ++j) {
       for (bioUInt k = 0 ; k < Vs.size() ; ++k) {
 	if (Vs[k]->g[j] != 0.0) {
@@ -170,6 +267,8 @@ bioSmartPointer<bioDerivatives> bioExprLogLogit::getValueAndDerivatives(std::vec
       }
     }
   }
+  // The derivatives of the utilities are not kept until the next row.
+  Vs.clear() ;
   return theDerivatives ;
 }
 
@@ -187,3 +286,117 @@ bioString bioExprLogLogit::print(bioBoolean hp) const {
   str << ")" ;
   return str.str() ;
 }
+
+void bioExprLogLogit::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						      bioBatchDerivatives& result) {
+  // The choice and the availabilities are evaluated once for the
+  // batch, unless they depend on the draws.
+  bioBoolean drawDependent = choice->containsDraws() ;
+  for (std::map<bioUInt, bioSmartPointer<bioExpression> >::iterator i = availabilities.begin() ;
+       i != availabilities.end() && !drawDependent ;
+       ++i) {
+    drawDependent = i->second->containsDraws() ;
+  }
+  if (drawDependent) {
+    bioExpression::computeBatchValueAndDerivatives(literalIds,result) ;
+    return ;
+  }
+  bioUInt chosen = bioUInt(choice->getValue()) ;
+  bioLogitWorkspace workspace ;
+  const bioUInt* first ;
+  const bioUInt* last ;
+  getAvailableAlternatives(workspace.buffers.available,first,last) ;
+  bioUInt chosenPosition = getPosition(chosen) ;
+  if (!std::binary_search(first,last,chosenPosition)) {
+    bioReal minusInfinity = (std::numeric_limits<bioReal>::has_infinity) ?
+      -std::numeric_limits<bioReal>::infinity() :
+      std::numeric_limits<bioReal>::lowest() ;
+    std::fill(result.f.begin(),result.f.end(),minusInfinity) ;
+    return ;
+  }
+  std::vector<bioBatchDerivatives>& Vs = workspace.buffers.batchV ;
+  bioUInt chosenIndex = bioBadId ;
+  for (const bioUInt* k = first ; k != last ; ++k) {
+    bioUInt i = bioUInt(k - first) ;
+    getUtility(*k)->getBatchValueAndDerivatives(literalIds,getBatchBuffer(Vs,i,result)) ;
+    if (*k == chosenPosition) {
+      chosenIndex = i ;
+    }
+  }
+  getBatchLogit(workspace.buffers,bioUInt(last-first),chosenIndex,result) ;
+}
+
+bioBatchDerivatives& bioExprLogLogit::getBatchBuffer(std::vector<bioBatchDerivatives>& Vs,
+						     bioUInt i,
+						     const bioBatchDerivatives& result) {
+  if (i >= Vs.size()) {
+    Vs.resize(i+1,bioBatchDerivatives(result.n,result.size,result.hasGradient)) ;
+    return Vs[i] ;
+  }
+  bioBatchDerivatives& b = Vs[i] ;
+  if (b.n == result.n && b.size == result.size && b.hasGradient == result.hasGradient) {
+    b.setToZero() ;
+  }
+  else {
+    b = bioBatchDerivatives(result.n,result.size,result.hasGradient) ;
+  }
+  return b ;
+}
+
+void bioExprLogLogit::getBatchLogit(bioLogitBuffers& buffers,
+				    bioUInt numberOfAlternatives,
+				    bioUInt chosen,
+				    bioBatchDerivatives& result) {
+  std::vector<bioBatchDerivatives>& Vs = buffers.batchV ;
+  bioUInt size = result.size ;
+  // For each draw, the utilities are shifted as for one draw, to
+  // avoid overflows.
+  std::vector<bioReal>& maxexp = buffers.maxexp ;
+  maxexp.assign(size,-bioMaxReal) ;
+  for (bioUInt k = 0 ; k < numberOfAlternatives ; ++k) {
+    for (bioUInt r = 0 ; r < size ; ++r) {
+      maxexp[r] = std::max(maxexp[r],Vs[k].f[r]) ;
+    }
+  }
+  for (bioUInt r = 0 ; r < size ; ++r) {
+    maxexp[r] = ceil(maxexp[r] / 10.0) * 10.0 ;
+    result.f[r] = Vs[chosen].f[r] - maxexp[r] ;
+  }
+  // The values of the utilities are replaced by their exponential.
+  std::vector<bioReal>& denominator = buffers.denominator ;
+  denominator.assign(size,0.0) ;
+  for (bioUInt k = 0 ; k < numberOfAlternatives ; ++k) {
+    for (bioUInt r = 0 ; r < size ; ++r) {
+      Vs[k].f[r] = exp(Vs[k].f[r] - maxexp[r]) ;
+      denominator[r] += Vs[k].f[r] ;
+    }
+  }
+  for (bioUInt r = 0 ; r < size ; ++r) {
+    result.f[r] -= log(denominator[r]) ;
+  }
+  if (!result.hasGradient) {
+    return ;
+  }
+  std::vector<bioReal>& weightedSum = buffers.weightedSum ;
+  for (bioUInt j = 0 ; j < result.n ; ++j) {
+    bioBoolean active = false ;
+    weightedSum.assign(size,0.0) ;
+    for (bioUInt k = 0 ; k < numberOfAlternatives ; ++k) {
+      if (Vs[k].active[j]) {
+	active = true ;
+	const bioReal* vg = Vs[k].gradient(j) ;
+	for (bioUInt r = 0 ; r < size ; ++r) {
+	  weightedSum[r] += vg[r] * Vs[k].f[r] ;
+	}
+      }
+    }
+    if (active) {
+      const bioReal* cg = Vs[chosen].gradient(j) ;
+      bioReal* g = result.gradient(j) ;
+      for (bioUInt r = 0 ; r < size ; ++r) {
+	g[r] = cg[r] - weightedSum[r] / denominator[r] ;
+      }
+      result.active[j] = true ;
+    }
+  }
+}
@@ -11,8 +11,36 @@
 #define bioExprLogLogit_h
 
 #include <map>
+#include <vector>
 #include "bioExpression.h"
 #include "bioString.h"
+#include "bioSlotTable.h"
+#include "bioBatchDerivatives.h"
+
+class bioLogitBuffers {
+public:
+  std::vector<bioUInt> available ;
+  std::vector<bioSmartPointer<bioDerivatives> > V ;
+  std::vector<bioReal> expi ;
+  // Indexed by the literals for one draw, or by the draws for a batch.
+  std::vector<bioReal> weightedSum ;
+  std::vector<bioBatchDerivatives> batchV ;
+  // Indexed by the draws of a batch.
+  std::vector<bioReal> maxexp ;
+  std::vector<bioReal> denominator ;
+};
+
+// Buffers used by the logit expressions of the current thread. They
+// are reused from one row to the next, so that no memory is allocated
+// once they have reached their size. As a utility may itself involve
+// a logit, each level of nesting has its own buffers, reserved by the
+// constructor and released by the destructor.
+class bioLogitWorkspace {
+ public:
+  bioLogitWorkspace() ;
+  ~bioLogitWorkspace() ;
+  bioLogitBuffers& buffers ;
+};
 
 class bioExprLogLogit: public bioExpression {
  public:
@@ -21,11 +49,54 @@ class bioExprLogLogit: public bioExpression {
   virtual bioSmartPointer<bioDerivatives> getValueAndDerivatives(std::vector<bioUInt> literalIds,
 								 bioBoolean gradient,
 								 bioBoolean hessian) ;
+  // Prepares the i-th element of Vs to receive the utilities of an
+  // alternative for the batch, reusing it if it has the right size.
+  static bioBatchDerivatives& getBatchBuffer(std::vector<bioBatchDerivatives>& Vs,
+					     bioUInt i,
+					     const bioBatchDerivatives& result) ;
+  // Log of the logit probability for a batch of draws, from the
+  // utilities of the first numberOfAlternatives elements of
+  // buffers.batchV. The values of the utilities are overwritten.
+  static void getBatchLogit(bioLogitBuffers& buffers,
+			    bioUInt numberOfAlternatives,
+			    bioUInt chosen,
+			    bioBatchDerivatives& result) ;
   virtual bioString print(bioBoolean hp = false) const ;
+  // If the availability conditions depend only on the data, the list
+  // of available alternatives of each row is computed once.
+  virtual void prepareData() ;
+  virtual void setData(std::vector< std::vector<bioReal> >* d) ;
 protected:
+  virtual void computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+					       bioBatchDerivatives& result) ;
+  // Positions of the alternatives available for the current row,
+  // from first to last. They are stored in buffer if they are not
+  // precomputed.
+  void getAvailableAlternatives(std::vector<bioUInt>& buffer,
+				const bioUInt*& first,
+				const bioUInt*& last) ;
+  // Position of the alternative in the list, sorted by id.
+  bioUInt getPosition(bioUInt alternative) const ;
+  // Utility of the alternative at the given position.
+  bioSmartPointer<bioExpression> getUtility(bioUInt position) const ;
   bioSmartPointer<bioExpression>  choice ;
   std::map<bioUInt,bioSmartPointer<bioExpression> > utilities ;
   std::map<bioUInt,bioSmartPointer<bioExpression> > availabilities ;
+  // The alternatives, sorted by id, with their utility (NULL if it is
+  // not defined) and availability condition.
+  std::vector<bioUInt> ids ;
+  std::vector<bioSmartPointer<bioExpression> > utilityList ;
+  std::vector<bioSmartPointer<bioExpression> > availabilityList ;
+  bioSlotTable slots ;
+  // Compressed lists of the positions of the available alternatives:
+  // the alternatives of row n are availableAlternatives[k], for k from
+  // availableStart[n] to availableStart[n+1]-1. Empty if the
+  // availabilities must be evaluated. The rows where the evaluation
+  // failed, for instance because of missing data, are evaluated again
+  // when needed, so that the error is reported at that time.
+  std::vector<bioUInt> availableStart ;
+  std::vector<bioUInt> availableAlternatives ;
+  std::vector<bioBoolean> availabilityFailed ;
 };
 
 
@@ -12,21 +12,45 @@
 #include "bioDebug.h"
 #include "bioExceptions.h"
 #include "bioExprLogLogitFullChoiceSet.h"
+#include "bioExprLogLogit.h"
+#include "bioBatchDerivatives.h"
 
 bioExprLogLogitFullChoiceSet::bioExprLogLogitFullChoiceSet(bioSmartPointer<bioExpression>  c,
 				 std::map<bioUInt,bioSmartPointer<bioExpression> > u) :
   choice(c), utilities(u) {
   listOfChildren.push_back(choice) ;
+  std::vector<bioUInt> ids ;
   for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = u.begin() ;
        i != u.end();
        ++i) {
     listOfChildren.push_back(i->second) ;
+    ids.push_back(i->first) ;
+    utilityList.push_back(i->second) ;
   }
+  slots.setIds(ids) ;
 }
 
 bioExprLogLogitFullChoiceSet::~bioExprLogLogitFullChoiceSet() {
 }
 
+bioUInt bioExprLogLogitFullChoiceSet::getChosenPosition() {
+  bioUInt chosen = bioUInt(choice->getValue()) ;
+  bioUInt position = slots.getSlot(chosen) ;
+  if (position == bioBadId) {
+    std::stringstream str ;
+    str << "Alternative "
+	<< chosen
+	<< " is not known. The alternatives that have been defined are" ;
+    for (std::map<bioUInt,bioSmartPointer<bioExpression> >::const_iterator i = utilities.begin() ;
+	 i != utilities.end() ;
+	 ++i) {
+      str << " " << i->first ;
+    }
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  return position ;
+}
+
 bioSmartPointer<bioDerivatives>
 bioExprLogLogitFullChoiceSet::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 						     bioBoolean gradient,
@@ -37,39 +61,22 @@ bioExprLogLogitFullChoiceSet::getValueAndDerivatives(std::vector<bioUInt> litera
     throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
   }
   
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   bioUInt n = literalIds.size() ;
-  bioUInt chosen = bioUInt(choice->getValue()) ;
-  std::vector<bioSmartPointer<bioDerivatives> > Vs ;
-  bioSmartPointer<bioDerivatives> chosenUtility(NULL) ;
-  bioSmartPointer<bioDerivatives> V;
+  bioUInt chosenPosition = getChosenPosition() ;
+  bioLogitWorkspace workspace ;
+  std::vector<bioSmartPointer<bioDerivatives> >& Vs = workspace.buffers.V ;
+  Vs.resize(utilityList.size()) ;
   bioReal largestUtility(-bioMaxReal) ;
-  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator theUtil = utilities.begin() ;
-       theUtil != utilities.end() ;
-       ++theUtil) {
-      V = theUtil->second->getValueAndDerivatives(literalIds,gradient,hessian) ;
-      if (V->f > largestUtility) {
-	largestUtility = V->f ;
-      }
-      if (theUtil->first == chosen) {
-	chosenUtility = V ;
-      }
-      Vs.push_back(V) ;
+  for (bioUInt k = 0 ; k < utilityList.size() ; ++k) {
+    Vs[k] = utilityList[k]->getValueAndDerivatives(literalIds,gradient,hessian) ;
+    if (Vs[k]->f > largestUtility) {
+      largestUtility = Vs[k]->f ;
     }
-
-  if (chosenUtility == NULL) {
-    std::stringstream str ;
-    str << "Alternative "
-	<< chosen
-	<< " is not known. The alternatives that have been defined are" ;
-    for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = utilities.begin() ;
-	 i != utilities.end() ;
-	 ++i) {
-      str << " " << i->first ;
-    }
-    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
   }
+  bioSmartPointer<bioDerivatives> chosenUtility = Vs[chosenPosition] ;
+
   bioReal maxexp = ceil(largestUtility / 10.0) * 10.0 ;
 
   for (std::vector<bioSmartPointer<bioDerivatives> >::iterator i = Vs.begin() ;
@@ -78,7 +85,8 @@ bioExprLogLogitFullChoiceSet::getValueAndDerivatives(std::vector<bioUInt> litera
     (*i)->f -= maxexp ;
   }
 
-  std::vector<bioReal> expi(Vs.size()) ; ;
+  std::vector<bioReal>& expi = workspace.buffers.expi ;
+  expi.resize(Vs.size()) ;
     
   bioReal denominator(0.0) ;
   for (bioUInt k = 0 ; k < Vs.size() ; ++k) {
@@ -88,7 +96,8 @@ bioExprLogLogitFullChoiceSet::getValueAndDerivatives(std::vector<bioUInt> litera
 
   theDerivatives->f = chosenUtility->f - log(denominator) ;
   if (gradient) {
-    std::vector<bioReal> weightedSum(n,0.0) ;
+    std::vector<bioReal>& weightedSum = workspace.buffers.weightedSum ;
+    weightedSum.assign(n,0.0) ;
     for (bioUInt j = 0 ; j < n ; ++j) {
       for (bioUInt k = 0 ; k < Vs.size() ; ++k) {
 	if (Vs[k]->g[j] != 0.0) {
@@ -126,6 +135,8 @@ bioExprLogLogitFullChoiceSet::getValueAndDerivatives(std::vector<bioUInt> litera
       }
     }
   }
+  // The derivatives of the utilities are not kept until the next row.
+  Vs.clear() ;
   return theDerivatives ;
 }
 
@@ -143,3 +154,18 @@ bioString bioExprLogLogitFullChoiceSet::print(bioBoolean hp) const {
   str << ")" ;
   return str.str() ;
 }
+
+void bioExprLogLogitFullChoiceSet::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+								   bioBatchDerivatives& result) {
+  if (choice->containsDraws()) {
+    bioExpression::computeBatchValueAndDerivatives(literalIds,result) ;
+    return ;
+  }
+  bioUInt chosenPosition = getChosenPosition() ;
+  bioLogitWorkspace workspace ;
+  std::vector<bioBatchDerivatives>& Vs = workspace.buffers.batchV ;
+  for (bioUInt k = 0 ; k < utilityList.size() ; ++k) {
+    utilityList[k]->getBatchValueAndDerivatives(literalIds,bioExprLogLogit::getBatchBuffer(Vs,k,result)) ;
+  }
+  bioExprLogLogit::getBatchLogit(workspace.buffers,utilityList.size(),chosenPosition,result) ;
+}
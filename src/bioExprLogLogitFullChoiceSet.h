@@ -10,8 +10,10 @@
 #define bioExprLogLogitFullChoiceSet_h
 
 #include <map>
+#include <vector>
 #include "bioExpression.h"
 #include "bioString.h"
+#include "bioSlotTable.h"
 
 class bioExprLogLogitFullChoiceSet: public bioExpression {
  public:
@@ -22,8 +24,16 @@ class bioExprLogLogitFullChoiceSet: public bioExpression {
 								 bioBoolean hessian) ;
   virtual bioString print(bioBoolean hp = false) const ;
 protected:
+  virtual void computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+					       bioBatchDerivatives& result) ;
   bioSmartPointer<bioExpression>  choice ;
   std::map<bioUInt,bioSmartPointer<bioExpression> > utilities ;
+  // The utilities, sorted by id, and the position of each id.
+  std::vector<bioSmartPointer<bioExpression> > utilityList ;
+  bioSlotTable slots ;
+  // Position of the chosen alternative. An exception is thrown if it
+  // is unknown.
+  bioUInt getChosenPosition() ;
 };
 
 
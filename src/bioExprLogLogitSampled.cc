@@ -0,0 +1,222 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprLogLogitSampled.cc
+// @date   Mon Oct 19 04:03:32 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include "bioSmartPointer.h"
+#include "bioDebug.h"
+#include "bioExceptions.h"
+#include "bioEvaluationState.h"
+#include "bioExprLogLogitSampled.h"
+
+// Finalizer of the SplitMix64 generator (Steele et al., 2014), used as
+// a hash of the seed, the row and the index of the draw.
+static inline uint64_t bioMix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL ;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL ;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL ;
+  return x ^ (x >> 31) ;
+}
+
+bioExprLogLogitSampled::bioExprLogLogitSampled(bioSmartPointer<bioExpression>  c,
+					       std::map<bioUInt,bioSmartPointer<bioExpression> > u,
+					       std::map<bioUInt,bioSmartPointer<bioExpression> > a,
+					       std::map<bioUInt,bioReal> w,
+					       bioUInt r,
+					       bioUInt s) :
+  choice(c), sampleSize(r), seed(s) {
+  listOfChildren.push_back(choice) ;
+  if (u.empty()) {
+    throw bioExceptions(__FILE__,__LINE__,"The choice set is empty") ;
+  }
+  if (u.size() > bioUInt(UINT32_MAX)) {
+    std::stringstream str ;
+    str << "Too many alternatives: " << u.size() ;
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  bioReal total(0.0) ;
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = u.begin() ;
+       i != u.end();
+       ++i) {
+    std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator theAvail = a.find(i->first) ;
+    std::map<bioUInt,bioReal>::iterator theWeight = w.find(i->first) ;
+    if (theAvail == a.end() || theWeight == w.end()) {
+      std::stringstream str ;
+      str << "Inconsistent dictionaries. Alternative " << i->first << " has no availability condition or no sampling weight" ;
+      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    }
+    if (!(theWeight->second > 0.0) || !std::isfinite(theWeight->second)) {
+      std::stringstream str ;
+      str << "Invalid sampling weight for alternative " << i->first << ": " << theWeight->second ;
+      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    }
+    positions[i->first] = ids.size() ;
+    ids.push_back(i->first) ;
+    utilities.push_back(i->second) ;
+    availabilities.push_back(theAvail->second) ;
+    logWeights.push_back(log(theWeight->second)) ;
+    total += theWeight->second ;
+    listOfChildren.push_back(i->second) ;
+    listOfChildren.push_back(theAvail->second) ;
+  }
+
+  // Alias table (Vose, 1991)
+  bioUInt n = ids.size() ;
+  aliasProbabilities.resize(n) ;
+  aliases.resize(n) ;
+  std::vector<bioUInt> small ;
+  std::vector<bioUInt> large ;
+  for (bioUInt j = 0 ; j < n ; ++j) {
+    aliasProbabilities[j] = w[ids[j]] * bioReal(n) / total ;
+    aliases[j] = j ;
+    if (aliasProbabilities[j] < 1.0) {
+      small.push_back(j) ;
+    }
+    else {
+      large.push_back(j) ;
+    }
+  }
+  while (!small.empty() && !large.empty()) {
+    bioUInt j = small.back() ;
+    small.pop_back() ;
+    bioUInt l = large.back() ;
+    aliases[j] = l ;
+    aliasProbabilities[l] = (aliasProbabilities[l] + aliasProbabilities[j]) - 1.0 ;
+    if (aliasProbabilities[l] < 1.0) {
+      large.pop_back() ;
+      small.push_back(l) ;
+    }
+  }
+  // Because of rounding errors, the remaining entries may differ
+  // slightly from one.
+  for (std::vector<bioUInt>::iterator j = small.begin() ; j != small.end() ; ++j) {
+    aliasProbabilities[*j] = 1.0 ;
+  }
+  for (std::vector<bioUInt>::iterator j = large.begin() ; j != large.end() ; ++j) {
+    aliasProbabilities[*j] = 1.0 ;
+  }
+}
+
+bioExprLogLogitSampled::~bioExprLogLogitSampled() {
+}
+
+void bioExprLogLogitSampled::drawSample(bioUInt row, std::vector<bioUInt>& sample) const {
+  uint64_t n = ids.size() ;
+  uint64_t key = bioMix(bioMix(uint64_t(seed)) ^ uint64_t(row)) ;
+  for (bioUInt r = 0 ; r < sampleSize ; ++r) {
+    uint64_t h = bioMix(key ^ uint64_t(r)) ;
+    // The high bits select the column of the table, and the low bits
+    // decide between the column and its alias.
+    bioUInt j = bioUInt(((h >> 32) * n) >> 32) ;
+    bioReal v = bioReal(h & 0xFFFFFFFFULL) / 4294967296.0 ;
+    sample.push_back((v < aliasProbabilities[j]) ? j : aliases[j]) ;
+  }
+}
+
+bioSmartPointer<bioDerivatives> bioExprLogLogitSampled::getValueAndDerivatives(std::vector<bioUInt> literalIds,
+									       bioBoolean gradient,
+									       bioBoolean hessian) {
+
+  if (!gradient && hessian) {
+    throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
+  }
+
+  bioUInt n = literalIds.size() ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(n)) ;
+  if (hessian) {
+    theDerivatives->setDerivativesToZero() ;
+  }
+  else if (gradient) {
+    theDerivatives->setGradientToZero() ;
+  }
+
+  bioUInt chosen = bioUInt(choice->getValue()) ;
+  std::map<bioUInt,bioUInt>::const_iterator thePosition = positions.find(chosen) ;
+  if (thePosition == positions.end()) {
+    std::stringstream str ;
+    str << "Alternative "
+	<< chosen
+	<< " is not known. The alternatives that have been defined are" ;
+    for (std::vector<bioUInt>::const_iterator i = ids.begin() ;
+	 i != ids.end() ;
+	 ++i) {
+      str << " " << *i ;
+    }
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  bioUInt chosenPosition = thePosition->second ;
+  if (availabilities[chosenPosition]->getValue() == 0.0) {
+    if (std::numeric_limits<bioReal>::has_infinity) {
+      theDerivatives->f = -std::numeric_limits<bioReal>::infinity() ;
+    }
+    else {
+      theDerivatives->f = std::numeric_limits<bioReal>::lowest() ;
+    }
+    return theDerivatives ;
+  }
+
+  std::vector<bioUInt> sample ;
+  sample.reserve(sampleSize+1) ;
+  drawSample(bioEvaluationState::current()->row,sample) ;
+  sample.push_back(chosenPosition) ;
+  std::sort(sample.begin(),sample.end()) ;
+
+  // H_j = V_j + ln k_j - ln w_j. The normalization of the weights
+  // cancels out.
+  std::vector<bioDerivatives> H ;
+  H.reserve(sample.size()) ;
+  bioUInt chosenIndex = bioBadId ;
+  std::vector<bioUInt>::iterator i = sample.begin() ;
+  while (i != sample.end()) {
+    bioUInt p = *i ;
+    std::vector<bioUInt>::iterator next = std::upper_bound(i,sample.end(),p) ;
+    bioReal k = bioReal(next - i) ;
+    i = next ;
+    // The unavailable alternatives that have been drawn are ignored.
+    if (p != chosenPosition && availabilities[p]->getValue() == 0.0) {
+      continue ;
+    }
+    bioSmartPointer<bioDerivatives> V = utilities[p]->getValueAndDerivatives(literalIds,gradient,hessian) ;
+    if (V == NULL) {
+      throw bioExceptNullPointer(__FILE__,__LINE__,"result") ;
+    }
+    H.push_back(*V) ;
+    H.back().f += log(k) - logWeights[p] ;
+    if (p == chosenPosition) {
+      chosenIndex = H.size() - 1 ;
+    }
+  }
+  std::vector<const bioDerivatives*> terms ;
+  terms.reserve(H.size()) ;
+  for (std::vector<bioDerivatives>::iterator t = H.begin() ;
+       t != H.end() ;
+       ++t) {
+    terms.push_back(&(*t)) ;
+  }
+  bioDerivatives logSum(n) ;
+  logSum.setLogSumExp(terms,gradient,hessian) ;
+  *theDerivatives = H[chosenIndex] ;
+  theDerivatives->add(-1.0,logSum,gradient,hessian) ;
+  return theDerivatives ;
+}
+
+bioString bioExprLogLogitSampled::print(bioBoolean hp) const {
+  std::stringstream str ;
+  str << "SampledLogit[" << choice->print(hp) << "][" << sampleSize << "," << seed << "](" ;
+  for (bioUInt j = 0 ; j < ids.size() ; ++j) {
+    if (j != 0) {
+      str << ";" ;
+    }
+    str << ids[j] << "{" << availabilities[j]->print(hp) << "}" << utilities[j]->print(hp) ;
+  }
+  str << ")" ;
+  return str.str() ;
+}
@@ -0,0 +1,63 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprLogLogitSampled.h
+// @date   Mon Oct 19 04:00:41 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioExprLogLogitSampled_h
+#define bioExprLogLogitSampled_h
+
+#include <map>
+#include <vector>
+#include "bioExpression.h"
+#include "bioString.h"
+
+// Log of the logit probability, where the choice set of each row is
+// replaced by a sample of alternatives (McFadden, 1978). R
+// alternatives are drawn with replacement, with probabilities
+// proportional to the weights w_j, and the chosen alternative is
+// added. If k_j is the number of times alternative j appears in the
+// sample D, and q_j = w_j / sum_l w_l,
+//
+// ln P(i|D) = H_i - ln sum_{j in D} exp(H_j), H_j = V_j + ln(k_j/q_j).
+//
+// The sample depends only on the seed and the row, so that each
+// evaluation of the likelihood function, in any thread, uses the
+// same choice sets. Only the utilities and availabilities of the
+// sampled alternatives are evaluated: the cost of a row does not
+// depend on the number of alternatives.
+class bioExprLogLogitSampled: public bioExpression {
+ public:
+  bioExprLogLogitSampled(bioSmartPointer<bioExpression>  c,
+			 std::map<bioUInt,bioSmartPointer<bioExpression> > u,
+			 std::map<bioUInt,bioSmartPointer<bioExpression> > a,
+			 std::map<bioUInt,bioReal> w,
+			 bioUInt r,
+			 bioUInt s) ;
+  ~bioExprLogLogitSampled() ;
+  virtual bioSmartPointer<bioDerivatives> getValueAndDerivatives(std::vector<bioUInt> literalIds,
+								 bioBoolean gradient,
+								 bioBoolean hessian) ;
+  virtual bioString print(bioBoolean hp = false) const ;
+protected:
+  // Draws the positions of the sampled alternatives for the row.
+  void drawSample(bioUInt row, std::vector<bioUInt>& sample) const ;
+  bioSmartPointer<bioExpression>  choice ;
+  // The alternatives are stored by position, sorted by id.
+  std::vector<bioUInt> ids ;
+  std::vector<bioSmartPointer<bioExpression> > utilities ;
+  std::vector<bioSmartPointer<bioExpression> > availabilities ;
+  std::vector<bioReal> logWeights ;
+  std::map<bioUInt,bioUInt> positions ;
+  // Alias table (Walker, 1977), so that each draw takes a constant
+  // time.
+  std::vector<bioReal> aliasProbabilities ;
+  std::vector<bioUInt> aliases ;
+  bioUInt sampleSize ;
+  bioUInt seed ;
+};
+
+
+#endif
@@ -0,0 +1,328 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprLogMev.cc
+// @date   Mon Oct 19 03:57:02 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include <iterator>
+#include "bioSmartPointer.h"
+#include "bioDebug.h"
+#include "bioExceptions.h"
+#include "bioExprLogMev.h"
+
+bioExprLogMev::bioExprLogMev(bioSmartPointer<bioExpression>  c,
+			     std::map<bioUInt,bioSmartPointer<bioExpression> > u,
+			     std::map<bioUInt,bioSmartPointer<bioExpression> > a,
+			     std::map<bioUInt,bioSmartPointer<bioExpression> > corr,
+			     std::vector<bioMevNode> n) :
+  choice(c), utilities(u), availabilities(a), corrections(corr), nodes(n) {
+  listOfChildren.push_back(choice) ;
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = u.begin() ;
+       i != u.end();
+       ++i) {
+    listOfChildren.push_back(i->second) ;
+    if (availabilities.find(i->first) == availabilities.end()) {
+      std::stringstream str ;
+      str << "No availability condition for alternative " << i->first ;
+      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    }
+  }
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = a.begin() ;
+       i != a.end();
+       ++i) {
+    listOfChildren.push_back(i->second) ;
+  }
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = corr.begin() ;
+       i != corr.end();
+       ++i) {
+    listOfChildren.push_back(i->second) ;
+  }
+  if (nodes.empty()) {
+    throw bioExceptions(__FILE__,__LINE__,"The network of the MEV model has no node") ;
+  }
+  for (bioUInt k = 0 ; k < nodes.size() ; ++k) {
+    bioMevNode& theNode = nodes[k] ;
+    if (theNode.theSuccessors.size() != theNode.theAlphas.size() ||
+	theNode.theSuccessors.size() != theNode.isAlternative.size()) {
+      throw bioExceptions(__FILE__,__LINE__,"Each successor of a node must have an alpha parameter") ;
+    }
+    listOfChildren.push_back(theNode.theParameter) ;
+    positions.push_back(std::vector<bioUInt>()) ;
+    for (bioUInt s = 0 ; s < theNode.theSuccessors.size() ; ++s) {
+      listOfChildren.push_back(theNode.theAlphas[s]) ;
+      if (theNode.isAlternative[s]) {
+	std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = utilities.find(theNode.theSuccessors[s]) ;
+	if (i == utilities.end()) {
+	  std::stringstream str ;
+	  str << "Alternative " << theNode.theSuccessors[s] << " appears in the network, and not in the choice set" ;
+	  throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+	}
+	positions.back().push_back(std::distance(utilities.begin(),i)) ;
+      }
+      else {
+	if (theNode.theSuccessors[s] <= k || theNode.theSuccessors[s] >= nodes.size()) {
+	  std::stringstream str ;
+	  str << "Node " << theNode.theSuccessors[s] << " cannot be a successor of node " << k ;
+	  throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+	}
+	positions.back().push_back(theNode.theSuccessors[s]) ;
+      }
+    }
+  }
+}
+
+bioExprLogMev::~bioExprLogMev() {
+}
+
+bioSmartPointer<bioDerivatives> bioExprLogMev::getValueAndDerivatives(std::vector<bioUInt> literalIds,
+								      bioBoolean gradient,
+								      bioBoolean hessian) {
+
+  if (!gradient && hessian) {
+    throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
+  }
+
+  bioUInt n = literalIds.size() ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(n)) ;
+  if (hessian) {
+    theDerivatives->setDerivativesToZero() ;
+  }
+  else if (gradient) {
+    theDerivatives->setGradientToZero() ;
+  }
+  bioReal minusInfinity = (std::numeric_limits<bioReal>::has_infinity) ?
+    -std::numeric_limits<bioReal>::infinity() :
+    std::numeric_limits<bioReal>::lowest() ;
+
+  bioUInt chosen = bioUInt(choice->getValue()) ;
+  std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator theUtil = utilities.find(chosen) ;
+  if (theUtil == utilities.end()) {
+    std::stringstream str ;
+    str << "Alternative "
+	<< chosen
+	<< " is not known. The alternatives that have been defined are" ;
+    for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = utilities.begin() ;
+	 i != utilities.end() ;
+	 ++i) {
+      str << " " << i->first ;
+    }
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  bioUInt chosenPosition = std::distance(utilities.begin(),theUtil) ;
+
+  std::vector<bioBoolean> available ;
+  available.reserve(utilities.size()) ;
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = utilities.begin() ;
+       i != utilities.end() ;
+       ++i) {
+    available.push_back(availabilities.at(i->first)->getValue() != 0.0) ;
+  }
+  if (!available[chosenPosition]) {
+    theDerivatives->f = minusInfinity ;
+    return theDerivatives ;
+  }
+  std::vector<bioSmartPointer<bioDerivatives> > V(utilities.size()) ;
+
+  // From the alternatives to the root: ln G_k = ln sum_l
+  // exp(ln alpha_kl + mu_k/mu_l ln G_l). The terms of the sum, and
+  // the logarithms of mu_k/mu_l, are kept for the second pass.
+  bioUInt K = nodes.size() ;
+  std::vector<bioDerivatives> logG(K,bioDerivatives(n)) ;
+  std::vector<bioDerivatives> inverseMu(K,bioDerivatives(n)) ;
+  std::vector<bioBoolean> active(K,false) ;
+  std::vector<std::vector<bioDerivatives> > edgeTerms(K) ;
+  std::vector<std::vector<bioDerivatives> > edgeLogRatios(K) ;
+  std::vector<std::vector<bioUInt> > edgeSuccessors(K) ;
+  std::vector<const bioDerivatives*> terms ;
+  bioDerivatives ratio(n) ;
+  bioDerivatives logAlpha(n) ;
+  for (bioUInt kk = K ; kk > 0 ; --kk) {
+    bioUInt k = kk - 1 ;
+    bioMevNode& theNode = nodes[k] ;
+    bioSmartPointer<bioDerivatives> mu = theNode.theParameter->getValueAndDerivatives(literalIds,gradient,hessian) ;
+    inverseMu[k].setComposition(*mu,1.0/mu->f,-1.0/(mu->f*mu->f),2.0/(mu->f*mu->f*mu->f),gradient,hessian) ;
+    terms.clear() ;
+    for (bioUInt s = 0 ; s < theNode.theSuccessors.size() ; ++s) {
+      bioUInt p = positions[k][s] ;
+      const bioDerivatives* logGl ;
+      if (theNode.isAlternative[s]) {
+	if (!available[p]) {
+	  continue ;
+	}
+	if (V[p] == NULL) {
+	  V[p] = utilities.at(theNode.theSuccessors[s])->getValueAndDerivatives(literalIds,gradient,hessian) ;
+	  if (V[p] == NULL) {
+	    throw bioExceptNullPointer(__FILE__,__LINE__,"result") ;
+	  }
+	}
+	logGl = &(*V[p]) ;
+      }
+      else {
+	if (!active[p]) {
+	  continue ;
+	}
+	logGl = &logG[p] ;
+      }
+      bioSmartPointer<bioDerivatives> alpha = theNode.theAlphas[s]->getValueAndDerivatives(literalIds,gradient,hessian) ;
+      if (alpha->f == 0.0) {
+	continue ;
+      }
+      if (theNode.isAlternative[s]) {
+	ratio = *mu ;
+      }
+      else {
+	ratio.setProduct(*mu,inverseMu[p],gradient,hessian) ;
+      }
+      bioReal a = alpha->f ;
+      logAlpha.setComposition(*alpha,log(a),1.0/a,-1.0/(a*a),gradient,hessian) ;
+      edgeTerms[k].push_back(bioDerivatives(n)) ;
+      edgeTerms[k].back().setProduct(ratio,*logGl,gradient,hessian) ;
+      edgeTerms[k].back().add(1.0,logAlpha,gradient,hessian) ;
+      bioReal r = ratio.f ;
+      edgeLogRatios[k].push_back(bioDerivatives(n)) ;
+      edgeLogRatios[k].back().setComposition(ratio,log(r),1.0/r,-1.0/(r*r),gradient,hessian) ;
+      edgeSuccessors[k].push_back(s) ;
+    }
+    if (edgeTerms[k].empty()) {
+      continue ;
+    }
+    for (std::vector<bioDerivatives>::iterator t = edgeTerms[k].begin() ;
+	 t != edgeTerms[k].end() ;
+	 ++t) {
+      terms.push_back(&(*t)) ;
+    }
+    logG[k].setLogSumExp(terms,gradient,hessian) ;
+    active[k] = true ;
+  }
+  if (!active[0]) {
+    theDerivatives->f = minusInfinity ;
+    return theDerivatives ;
+  }
+
+  // From the root to the alternatives: ln dG/dG_l = ln sum_k
+  // exp(ln dG/dG_k + ln alpha_kl + ln(mu_k/mu_l) + (mu_k/mu_l - 1) ln G_l),
+  // over the predecessors k of l.
+  std::vector<std::vector<bioDerivatives> > nodeContributions(K) ;
+  std::vector<std::vector<bioDerivatives> > alternativeContributions(utilities.size()) ;
+  bioDerivatives logDerivative(n) ;
+  for (bioUInt k = 0 ; k < K ; ++k) {
+    if (!active[k]) {
+      continue ;
+    }
+    if (k == 0) {
+      logDerivative.f = 0.0 ;
+      if (hessian) {
+	logDerivative.setDerivativesToZero() ;
+      }
+      else if (gradient) {
+	logDerivative.setGradientToZero() ;
+      }
+    }
+    else {
+      if (nodeContributions[k].empty()) {
+	// The node cannot be reached from the root.
+	continue ;
+      }
+      terms.clear() ;
+      for (std::vector<bioDerivatives>::iterator t = nodeContributions[k].begin() ;
+	   t != nodeContributions[k].end() ;
+	   ++t) {
+	terms.push_back(&(*t)) ;
+      }
+      logDerivative.setLogSumExp(terms,gradient,hessian) ;
+    }
+    const bioMevNode& theNode = nodes[k] ;
+    for (bioUInt e = 0 ; e < edgeTerms[k].size() ; ++e) {
+      bioUInt s = edgeSuccessors[k][e] ;
+      bioUInt p = positions[k][s] ;
+      std::vector<bioDerivatives>& contributions = (theNode.isAlternative[s]) ?
+	alternativeContributions[p] :
+	nodeContributions[p] ;
+      const bioDerivatives& logGl = (theNode.isAlternative[s]) ? *V[p] : logG[p] ;
+      contributions.push_back(logDerivative) ;
+      contributions.back().add(1.0,edgeTerms[k][e],gradient,hessian) ;
+      contributions.back().add(1.0,edgeLogRatios[k][e],gradient,hessian) ;
+      contributions.back().add(-1.0,logGl,gradient,hessian) ;
+    }
+  }
+
+  // ln P(i) = H_i - ln sum_j exp(H_j), where H_j = V_j + ln G_j + c_j
+  std::vector<bioDerivatives> H ;
+  H.reserve(utilities.size()) ;
+  bioUInt chosenIndex = bioBadId ;
+  bioUInt p = 0 ;
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = utilities.begin() ;
+       i != utilities.end() ;
+       ++i, ++p) {
+    if (alternativeContributions[p].empty()) {
+      continue ;
+    }
+    terms.clear() ;
+    for (std::vector<bioDerivatives>::iterator t = alternativeContributions[p].begin() ;
+	 t != alternativeContributions[p].end() ;
+	 ++t) {
+      terms.push_back(&(*t)) ;
+    }
+    H.push_back(bioDerivatives(n)) ;
+    H.back().setLogSumExp(terms,gradient,hessian) ;
+    H.back().add(1.0,*V[p],gradient,hessian) ;
+    std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator c = corrections.find(i->first) ;
+    if (c != corrections.end()) {
+      bioSmartPointer<bioDerivatives> theCorrection = c->second->getValueAndDerivatives(literalIds,gradient,hessian) ;
+      H.back().add(1.0,*theCorrection,gradient,hessian) ;
+    }
+    if (p == chosenPosition) {
+      chosenIndex = H.size() - 1 ;
+    }
+  }
+  if (chosenIndex == bioBadId) {
+    // The chosen alternative cannot be reached from the root.
+    theDerivatives->f = minusInfinity ;
+    return theDerivatives ;
+  }
+  terms.clear() ;
+  for (std::vector<bioDerivatives>::iterator t = H.begin() ;
+       t != H.end() ;
+       ++t) {
+    terms.push_back(&(*t)) ;
+  }
+  bioDerivatives logSum(n) ;
+  logSum.setLogSumExp(terms,gradient,hessian) ;
+  *theDerivatives = H[chosenIndex] ;
+  theDerivatives->add(-1.0,logSum,gradient,hessian) ;
+  return theDerivatives ;
+}
+
+bioString bioExprLogMev::print(bioBoolean hp) const {
+  std::stringstream str ;
+  str << "NetworkMev[" << choice->print(hp) << "](" ;
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::const_iterator i = utilities.begin() ;
+       i != utilities.end() ;
+       ++i) {
+    if (i != utilities.begin()) {
+      str << ";" ;
+    }
+    str << "{" << availabilities.at(i->first)->print(hp) << "}" << i->second->print(hp) ;
+  }
+  str << ")(" ;
+  for (bioUInt k = 0 ; k < nodes.size() ; ++k) {
+    if (k != 0) {
+      str << ";" ;
+    }
+    str << k << "[" << nodes[k].theParameter->print(hp) << "]:" ;
+    for (bioUInt s = 0 ; s < nodes[k].theSuccessors.size() ; ++s) {
+      if (s != 0) {
+	str << "," ;
+      }
+      str << ((nodes[k].isAlternative[s]) ? "alt " : "node ")
+	  << nodes[k].theSuccessors[s] << "[" << nodes[k].theAlphas[s]->print(hp) << "]" ;
+    }
+  }
+  str << ")" ;
+  return str.str() ;
+}
@@ -0,0 +1,69 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprLogMev.h
+// @date   Mon Oct 19 03:54:11 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioExprLogMev_h
+#define bioExprLogMev_h
+
+#include <map>
+#include <vector>
+#include "bioExpression.h"
+#include "bioString.h"
+
+// Node of a network GEV model. A successor is either an alternative,
+// identified by its id, or another node, identified by its position
+// in the list of nodes.
+class bioMevNode {
+public:
+  bioSmartPointer<bioExpression>  theParameter ;
+  std::vector<bioBoolean> isAlternative ;
+  std::vector<bioUInt> theSuccessors ;
+  std::vector<bioSmartPointer<bioExpression> > theAlphas ;
+};
+
+// Log of the choice probability of a network GEV model. The
+// generating function of node k, with parameter mu_k, is
+//
+// G_k(y) = sum_l alpha_kl G_l(y)^(mu_k/mu_l),
+//
+// where G_l(y) = y_l and mu_l = 1 if l is an alternative, and G is
+// the generating function of the first node (the root). The nodes
+// must be sorted so that the successors of a node come after it.
+//
+// The values ln G_k are computed from the alternatives to the root,
+// and the derivatives ln dG/dG_k from the root to the alternatives,
+// so that all the ln G_i = ln dG/dy_i are obtained in two passes over
+// the network. Then,
+//
+// ln P(i) = V_i + ln G_i + c_i - ln sum_j exp(V_j + ln G_j + c_j),
+//
+// where c_i is the correction for endogenous sampling.
+class bioExprLogMev: public bioExpression {
+ public:
+  bioExprLogMev(bioSmartPointer<bioExpression>  c,
+		std::map<bioUInt,bioSmartPointer<bioExpression> > u,
+		std::map<bioUInt,bioSmartPointer<bioExpression> > a,
+		std::map<bioUInt,bioSmartPointer<bioExpression> > corr,
+		std::vector<bioMevNode> n) ;
+  ~bioExprLogMev() ;
+  virtual bioSmartPointer<bioDerivatives> getValueAndDerivatives(std::vector<bioUInt> literalIds,
+								 bioBoolean gradient,
+								 bioBoolean hessian) ;
+  virtual bioString print(bioBoolean hp = false) const ;
+protected:
+  bioSmartPointer<bioExpression>  choice ;
+  std::map<bioUInt,bioSmartPointer<bioExpression> > utilities ;
+  std::map<bioUInt,bioSmartPointer<bioExpression> > availabilities ;
+  std::map<bioUInt,bioSmartPointer<bioExpression> > corrections ;
+  std::vector<bioMevNode> nodes ;
+  // Position of the successors in the list of alternatives, sorted
+  // by id, or in the list of nodes.
+  std::vector<std::vector<bioUInt> > positions ;
+};
+
+
+#endif
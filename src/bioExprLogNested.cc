@@ -0,0 +1,209 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprLogNested.cc
+// @date   Mon Oct 19 03:46:53 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include "bioSmartPointer.h"
+#include "bioDebug.h"
+#include "bioExceptions.h"
+#include "bioExprLogNested.h"
+
+bioExprLogNested::bioExprLogNested(bioSmartPointer<bioExpression>  c,
+				   std::map<bioUInt,bioSmartPointer<bioExpression> > u,
+				   std::map<bioUInt,bioSmartPointer<bioExpression> > a,
+				   bioSmartPointer<bioExpression>  mu,
+				   std::vector<bioNest> n) :
+  choice(c), utilities(u), availabilities(a), scale(mu), nests(n) {
+  listOfChildren.push_back(choice) ;
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = u.begin() ;
+       i != u.end();
+       ++i) {
+    listOfChildren.push_back(i->second) ;
+  }
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = a.begin() ;
+       i != a.end();
+       ++i) {
+    listOfChildren.push_back(i->second) ;
+  }
+  listOfChildren.push_back(scale) ;
+  for (std::vector<bioNest>::iterator m = nests.begin() ;
+       m != nests.end() ;
+       ++m) {
+    listOfChildren.push_back(m->theParameter) ;
+    for (std::vector<bioUInt>::iterator i = m->theAlternatives.begin() ;
+	 i != m->theAlternatives.end() ;
+	 ++i) {
+      if (utilities.find(*i) == utilities.end() ||
+	  availabilities.find(*i) == availabilities.end()) {
+	std::stringstream str ;
+	str << "Alternative " << *i << " appears in a nest, and not in the choice set" ;
+	throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+      }
+    }
+  }
+}
+
+bioExprLogNested::~bioExprLogNested() {
+}
+
+bioSmartPointer<bioDerivatives> bioExprLogNested::getValueAndDerivatives(std::vector<bioUInt> literalIds,
+									 bioBoolean gradient,
+									 bioBoolean hessian) {
+
+  if (!gradient && hessian) {
+    throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
+  }
+
+  bioUInt n = literalIds.size() ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(n)) ;
+  bioUInt chosen = bioUInt(choice->getValue()) ;
+  std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator theAvail = availabilities.find(chosen) ;
+  if (theAvail == availabilities.end()) {
+    std::stringstream str ;
+    str << "Alternative "
+	<< chosen
+	<< " is not known. The alternatives that have been defined are" ;
+    for (std::map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = utilities.begin() ;
+	 i != utilities.end() ;
+	 ++i) {
+      str << " " << i->first ;
+    }
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  if (theAvail->second->getValue() == 0.0) {
+    if (gradient) {
+      if (hessian) {
+	theDerivatives->setDerivativesToZero() ;
+      }
+      else {
+	theDerivatives->setGradientToZero() ;
+      }
+    }
+    if (std::numeric_limits<bioReal>::has_infinity) {
+      theDerivatives->f = -std::numeric_limits<bioReal>::infinity() ;
+    }
+    else {
+      theDerivatives->f = std::numeric_limits<bioReal>::lowest() ;
+    }
+    return theDerivatives ;
+  }
+
+  theDerivatives->f = 0.0 ;
+  if (hessian) {
+    theDerivatives->setDerivativesToZero() ;
+  }
+  else if (gradient) {
+    theDerivatives->setGradientToZero() ;
+  }
+
+  bioSmartPointer<bioDerivatives> mu = scale->getValueAndDerivatives(literalIds,gradient,hessian) ;
+  // Inclusive values mu/mu_m ln S_m of the nests
+  std::vector<bioDerivatives> inclusiveValues ;
+  inclusiveValues.reserve(nests.size()) ;
+  bioBoolean chosenFound = false ;
+  std::vector<bioDerivatives> muV ;
+  std::vector<const bioDerivatives*> terms ;
+  bioDerivatives logSum(n) ;
+  bioDerivatives inverseMum(n) ;
+  bioDerivatives ratio(n) ;
+  for (std::vector<bioNest>::iterator m = nests.begin() ;
+       m != nests.end() ;
+       ++m) {
+    bioSmartPointer<bioDerivatives> mum ;
+    bioUInt chosenIndex = bioBadId ;
+    muV.clear() ;
+    for (std::vector<bioUInt>::iterator i = m->theAlternatives.begin() ;
+	 i != m->theAlternatives.end() ;
+	 ++i) {
+      if (availabilities.at(*i)->getValue() == 0.0) {
+	continue ;
+      }
+      if (mum == NULL) {
+	mum = m->theParameter->getValueAndDerivatives(literalIds,gradient,hessian) ;
+      }
+      bioSmartPointer<bioDerivatives> V = utilities.at(*i)->getValueAndDerivatives(literalIds,gradient,hessian) ;
+      if (V == NULL) {
+	throw bioExceptNullPointer(__FILE__,__LINE__,"result") ;
+      }
+      muV.push_back(bioDerivatives(n)) ;
+      muV.back().setProduct(*mum,*V,gradient,hessian) ;
+      if (*i == chosen) {
+	chosenIndex = muV.size() - 1 ;
+      }
+    }
+    if (muV.empty()) {
+      // No alternative of the nest is available
+      continue ;
+    }
+    terms.clear() ;
+    for (std::vector<bioDerivatives>::iterator k = muV.begin() ;
+	 k != muV.end() ;
+	 ++k) {
+      terms.push_back(&(*k)) ;
+    }
+    logSum.setLogSumExp(terms,gradient,hessian) ;
+    bioReal x = mum->f ;
+    inverseMum.setComposition(*mum,1.0/x,-1.0/(x*x),2.0/(x*x*x),gradient,hessian) ;
+    ratio.setProduct(*mu,inverseMum,gradient,hessian) ;
+    inclusiveValues.push_back(bioDerivatives(n)) ;
+    inclusiveValues.back().setProduct(ratio,logSum,gradient,hessian) ;
+    if (chosenIndex != bioBadId) {
+      theDerivatives->add(1.0,muV[chosenIndex],gradient,hessian) ;
+      theDerivatives->add(-1.0,logSum,gradient,hessian) ;
+      theDerivatives->add(1.0,inclusiveValues.back(),gradient,hessian) ;
+      chosenFound = true ;
+    }
+  }
+  if (!chosenFound) {
+    std::stringstream str ;
+    str << "Alternative " << chosen << " does not belong to any nest" ;
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  terms.clear() ;
+  for (std::vector<bioDerivatives>::iterator k = inclusiveValues.begin() ;
+       k != inclusiveValues.end() ;
+       ++k) {
+    terms.push_back(&(*k)) ;
+  }
+  logSum.setLogSumExp(terms,gradient,hessian) ;
+  theDerivatives->add(-1.0,logSum,gradient,hessian) ;
+  return theDerivatives ;
+}
+
+bioString bioExprLogNested::print(bioBoolean hp) const {
+  std::stringstream str ;
+  str << "Nested[" << choice->print(hp) << "](" ;
+  for (std::map<bioUInt,bioSmartPointer<bioExpression> >::const_iterator i = utilities.begin() ;
+       i != utilities.end() ;
+       ++i) {
+    if (i != utilities.begin()) {
+      str << ";" ;
+    }
+    str << "{" << availabilities.at(i->first)->print(hp) << "}" << i->second->print(hp) ;
+  }
+  str << ")[" << scale->print(hp) << "](" ;
+  for (std::vector<bioNest>::const_iterator m = nests.begin() ;
+       m != nests.end() ;
+       ++m) {
+    if (m != nests.begin()) {
+      str << ";" ;
+    }
+    str << m->theParameter->print(hp) << ":" ;
+    for (std::vector<bioUInt>::const_iterator i = m->theAlternatives.begin() ;
+	 i != m->theAlternatives.end() ;
+	 ++i) {
+      if (i != m->theAlternatives.begin()) {
+	str << "," ;
+      }
+      str << *i ;
+    }
+  }
+  str << ")" ;
+  return str.str() ;
+}
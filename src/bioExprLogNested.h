@@ -0,0 +1,54 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprLogNested.h
+// @date   Mon Oct 19 03:44:39 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioExprLogNested_h
+#define bioExprLogNested_h
+
+#include <map>
+#include <vector>
+#include "bioExpression.h"
+#include "bioString.h"
+
+class bioNest {
+public:
+  bioSmartPointer<bioExpression>  theParameter ;
+  std::vector<bioUInt> theAlternatives ;
+};
+
+// Log of the nested logit probability. The nests must be a partition
+// of the choice set. For alternative i in nest m,
+//
+// ln P(i) = mu_m V_i + (mu/mu_m - 1) ln S_m - ln sum_n S_n^(mu/mu_n),
+//
+// where S_m = sum_{j in m} a_j exp(mu_m V_j) and mu is the scale
+// parameter (1 for the usual normalization). The logarithms of the
+// sums are computed without overflow, and the derivatives with
+// respect to the utilities, mu and the mu_m are obtained by the chain
+// rule, without building the expression tree of the model.
+class bioExprLogNested: public bioExpression {
+ public:
+  bioExprLogNested(bioSmartPointer<bioExpression>  c,
+		   std::map<bioUInt,bioSmartPointer<bioExpression> > u,
+		   std::map<bioUInt,bioSmartPointer<bioExpression> > a,
+		   bioSmartPointer<bioExpression>  mu,
+		   std::vector<bioNest> n) ;
+  ~bioExprLogNested() ;
+  virtual bioSmartPointer<bioDerivatives> getValueAndDerivatives(std::vector<bioUInt> literalIds,
+								 bioBoolean gradient,
+								 bioBoolean hessian) ;
+  virtual bioString print(bioBoolean hp = false) const ;
+protected:
+  bioSmartPointer<bioExpression>  choice ;
+  std::map<bioUInt,bioSmartPointer<bioExpression> > utilities ;
+  std::map<bioUInt,bioSmartPointer<bioExpression> > availabilities ;
+  bioSmartPointer<bioExpression>  scale ;
+  std::vector<bioNest> nests ;
+};
+
+
+#endif
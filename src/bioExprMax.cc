@@ -29,7 +29,7 @@ bioExprMax::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 				   bioBoolean gradient,
 				   bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   if (theDerivatives == NULL) {
     throw bioExceptNullPointer(__FILE__,__LINE__,"theDerivatives") ;
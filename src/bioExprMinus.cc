@@ -8,6 +8,7 @@
 //--------------------------------------------------------------------
 
 #include "bioExprMinus.h"
+#include "bioBatchDerivatives.h"
 #include "bioDebug.h"
 
 #include "bioSmartPointer.h"
@@ -28,7 +29,7 @@ bioExprMinus::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 				     bioBoolean gradient,
 				     bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   bioUInt n = literalIds.size() ;
   bioSmartPointer<bioDerivatives> leftResult = left->getValueAndDerivatives(literalIds,gradient,hessian) ;
@@ -57,3 +58,27 @@ bioString bioExprMinus::print(bioBoolean hp) const {
   }
   return str.str() ;
 }
+
+void bioExprMinus::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						   bioBatchDerivatives& result) {
+  bioBatchDerivatives leftResult(result.n,result.size,result.hasGradient) ;
+  bioBatchDerivatives rightResult(result.n,result.size,result.hasGradient) ;
+  left->getBatchValueAndDerivatives(literalIds,leftResult) ;
+  right->getBatchValueAndDerivatives(literalIds,rightResult) ;
+  for (bioUInt r = 0 ; r < result.size ; ++r) {
+    result.f[r] = leftResult.f[r] - rightResult.f[r] ;
+  }
+  if (result.hasGradient) {
+    for (bioUInt i = 0 ; i < result.n ; ++i) {
+      if (leftResult.active[i] || rightResult.active[i]) {
+	const bioReal* lg = leftResult.gradient(i) ;
+	const bioReal* rg = rightResult.gradient(i) ;
+	bioReal* g = result.gradient(i) ;
+	for (bioUInt r = 0 ; r < result.size ; ++r) {
+	  g[r] = lg[r] - rg[r] ;
+	}
+	result.active[i] = true ;
+      }
+    }
+  }
+}
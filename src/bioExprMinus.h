@@ -24,6 +24,8 @@ class bioExprMinus: public bioExpression {
 
   virtual bioString print(bioBoolean hp = false) const ;
 protected:
+  virtual void computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+					       bioBatchDerivatives& result) ;
   bioSmartPointer<bioExpression>  left ;
   bioSmartPointer<bioExpression>  right ;
 };
@@ -0,0 +1,281 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprMixedLogit.cc
+// @date   Mon Oct 19 03:01:46 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include "bioExprMixedLogit.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <sstream>
+#include "bioSmartPointer.h"
+#include "bioExceptions.h"
+#include "bioBatchDerivatives.h"
+#include "bioPartialIntegral.h"
+
+static const bioReal bioMinusInfinity = -std::numeric_limits<bioReal>::infinity() ;
+
+bioExprMixedLogit::bioExprMixedLogit(bioSmartPointer<bioExpression> theLogit,
+				     bioSmartPointer<bioExpression> theIntegral,
+				     bioBoolean p) :
+  logit(theLogit), integral(theIntegral), panel(p) {
+  listOfChildren.push_back(theIntegral) ;
+}
+
+bioExprMixedLogit::~bioExprMixedLogit() {
+}
+
+bioSmartPointer<bioDerivatives>
+bioExprMixedLogit::getValueAndDerivatives(std::vector<bioUInt> literalIds,
+					  bioBoolean gradient,
+					  bioBoolean hessian) {
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
+  theDerivatives->f = 0.0 ;
+  if (gradient) {
+    if (hessian) {
+      theDerivatives->setDerivativesToZero() ;
+    }
+    else {
+      theDerivatives->setGradientToZero() ;
+    }
+  }
+  if (numberOfDraws == 0) {
+    throw bioExceptions(__FILE__,__LINE__,"Cannot perform Monte-Carlo integration with no draws.") ;
+  }
+  if (gradient && hessian) {
+    getLogIntegral(literalIds,*theDerivatives) ;
+  }
+  else {
+    bioPartialIntegral theSums(literalIds.size()) ;
+    getPartialLogIntegral(literalIds,gradient,0,numberOfDraws,theSums) ;
+    theSums.getLogIntegral(numberOfDraws,gradient,*theDerivatives) ;
+  }
+  return theDerivatives ;
+}
+
+bioBoolean bioExprMixedLogit::isDrawSplittable() const {
+  return true ;
+}
+
+void bioExprMixedLogit::getPartialLogIntegral(const std::vector<bioUInt>& literalIds,
+					      bioBoolean gradient,
+					      bioUInt firstDraw,
+					      bioUInt lastDraw,
+					      bioPartialIntegral& result) {
+  if (lastDraw > numberOfDraws || firstDraw > lastDraw) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,lastDraw,firstDraw,numberOfDraws) ;
+  }
+  bioUInt n = literalIds.size() ;
+  result.g.resize(gradient ? n : 0) ;
+  result.setToZero() ;
+  if (firstDraw == lastDraw) {
+    return ;
+  }
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  bioUInt previousDraw = state->draw ;
+  bioEvaluationState::bioInvariantValues theInvariants ;
+  bioEvaluationState::bioInvariantValues* previousInvariants = state->invariants ;
+  state->invariants = &theInvariants ;
+  bioBatchDerivatives batch(n,std::min(bioDrawBatchSize,lastDraw - firstDraw),gradient) ;
+  try {
+    for (bioUInt draw = firstDraw ; draw < lastDraw ; draw += batch.size) {
+      bioUInt size = std::min(bioDrawBatchSize,lastDraw - draw) ;
+      if (size != batch.size) {
+	batch = bioBatchDerivatives(n,size,gradient) ;
+      }
+      state->draw = draw ;
+      getBatchTrajectory(literalIds,batch) ;
+      result.rescale(*std::max_element(batch.f.begin(),batch.f.end())) ;
+      if (result.maxLog == bioMinusInfinity) {
+	// Zero likelihood for all the draws so far.
+	continue ;
+      }
+      // The log likelihoods are replaced by the scaled likelihoods.
+      for (bioUInt r = 0 ; r < size ; ++r) {
+	batch.f[r] = exp(batch.f[r] - result.maxLog) ;
+	result.sum += batch.f[r] ;
+      }
+      if (gradient) {
+	for (bioUInt i = 0 ; i < n ; ++i) {
+	  if (batch.active[i]) {
+	    const bioReal* g = batch.gradient(i) ;
+	    for (bioUInt r = 0 ; r < size ; ++r) {
+	      result.g[i] += batch.f[r] * g[r] ;
+	    }
+	  }
+	}
+      }
+    }
+  }
+  catch(...) {
+    state->draw = previousDraw ;
+    state->invariants = previousInvariants ;
+    throw ;
+  }
+  state->draw = previousDraw ;
+  state->invariants = previousInvariants ;
+}
+
+void bioExprMixedLogit::getBatchTrajectory(const std::vector<bioUInt>& literalIds,
+					   bioBatchDerivatives& result) {
+  result.setToZero() ;
+  if (!panel) {
+    logit->getBatchValueAndDerivatives(literalIds,result) ;
+    return ;
+  }
+  bioUInt first, last ;
+  getRows(first,last) ;
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  bioBatchDerivatives rowResult(result.n,result.size,result.hasGradient) ;
+  bioUInt previousRow = state->row ;
+  for (state->row = first ; state->row <= last ; ++state->row) {
+    rowResult.setToZero() ;
+    try {
+      logit->getBatchValueAndDerivatives(literalIds,rowResult) ;
+    }
+    catch(bioExceptions& e) {
+      std::stringstream str ;
+      str << "Error for data entry " << state->row << ": " << e.what() ;
+      state->row = previousRow ;
+      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    }
+    for (bioUInt r = 0 ; r < result.size ; ++r) {
+      result.f[r] += rowResult.f[r] ;
+    }
+    if (result.hasGradient) {
+      for (bioUInt i = 0 ; i < result.n ; ++i) {
+	if (rowResult.active[i]) {
+	  bioReal* g = result.gradient(i) ;
+	  const bioReal* rg = rowResult.gradient(i) ;
+	  for (bioUInt r = 0 ; r < result.size ; ++r) {
+	    g[r] += rg[r] ;
+	  }
+	  result.active[i] = true ;
+	}
+      }
+    }
+  }
+  state->row = previousRow ;
+}
+
+void bioExprMixedLogit::getLogIntegral(const std::vector<bioUInt>& literalIds,
+				       bioDerivatives& result) {
+  bioUInt n = literalIds.size() ;
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  bioUInt previousDraw = state->draw ;
+  bioReal maxLog = bioMinusInfinity ;
+  bioReal sum = 0.0 ;
+  bioDerivatives trajectory(n) ;
+  try {
+    for (state->draw = 0 ; state->draw < numberOfDraws ; ++state->draw) {
+      getTrajectory(literalIds,trajectory) ;
+      if (trajectory.f > maxLog) {
+	bioReal scale = exp(maxLog - trajectory.f) ;
+	sum *= scale ;
+	for (bioUInt i = 0 ; i < n ; ++i) {
+	  result.g[i] *= scale ;
+	  for (bioUInt j = i ; j < n ; ++j) {
+	    result.h[i][j] *= scale ;
+	  }
+	}
+	maxLog = trajectory.f ;
+      }
+      if (maxLog == bioMinusInfinity) {
+	continue ;
+      }
+      // Second derivatives of the likelihood, relative to the
+      // likelihood: h + g g'
+      bioReal w = exp(trajectory.f - maxLog) ;
+      sum += w ;
+      for (bioUInt i = 0 ; i < n ; ++i) {
+	if (trajectory.g[i] != 0.0) {
+	  result.g[i] += w * trajectory.g[i] ;
+	}
+	for (bioUInt j = i ; j < n ; ++j) {
+	  result.h[i][j] += w * (trajectory.h[i][j] + trajectory.g[i] * trajectory.g[j]) ;
+	}
+      }
+    }
+  }
+  catch(...) {
+    state->draw = previousDraw ;
+    throw ;
+  }
+  state->draw = previousDraw ;
+  if (sum == 0.0) {
+    result.f = -bioMaxReal / 2.0 ;
+    result.setDerivativesToZero() ;
+    return ;
+  }
+  result.f = maxLog + log(sum / bioReal(numberOfDraws)) ;
+  for (bioUInt i = 0 ; i < n ; ++i) {
+    result.g[i] /= sum ;
+  }
+  for (bioUInt i = 0 ; i < n ; ++i) {
+    for (bioUInt j = i ; j < n ; ++j) {
+      result.h[i][j] = result.h[i][j] / sum - result.g[i] * result.g[j] ;
+      result.h[j][i] = result.h[i][j] ;
+    }
+  }
+}
+
+void bioExprMixedLogit::getTrajectory(const std::vector<bioUInt>& literalIds,
+				      bioDerivatives& result) {
+  if (!panel) {
+    result = *logit->getValueAndDerivatives(literalIds,true,true) ;
+    return ;
+  }
+  bioUInt n = literalIds.size() ;
+  bioUInt first, last ;
+  getRows(first,last) ;
+  result.f = 0.0 ;
+  result.setDerivativesToZero() ;
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  bioUInt previousRow = state->row ;
+  for (state->row = first ; state->row <= last ; ++state->row) {
+    bioSmartPointer<bioDerivatives> rowResult(NULL) ;
+    try {
+      rowResult = logit->getValueAndDerivatives(literalIds,true,true) ;
+    }
+    catch(bioExceptions& e) {
+      std::stringstream str ;
+      str << "Error for data entry " << state->row << ": " << e.what() ;
+      state->row = previousRow ;
+      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    }
+    result.f += rowResult->f ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      if (rowResult->g[i] != 0.0) {
+	result.g[i] += rowResult->g[i] ;
+      }
+      for (bioUInt j = i ; j < n ; ++j) {
+	result.h[i][j] += rowResult->h[i][j] ;
+      }
+    }
+  }
+  state->row = previousRow ;
+}
+
+void bioExprMixedLogit::getRows(bioUInt& first, bioUInt& last) const {
+  if (dataMap == NULL) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"data map") ;
+  }
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  if (state->individual == bioBadId) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"individual index") ;
+  }
+  if (state->individual >= dataMap->size()) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,state->individual,0,dataMap->size() - 1) ;
+  }
+  first = (*dataMap)[state->individual][0] ;
+  last = (*dataMap)[state->individual][1] ;
+}
+
+bioString bioExprMixedLogit::print(bioBoolean hp) const {
+  std::stringstream str ;
+  str << "log(" << integral->print(hp) << ")" ;
+  return str.str() ;
+}
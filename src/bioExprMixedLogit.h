@@ -0,0 +1,65 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprMixedLogit.h
+// @date   Mon Oct 19 02:59:32 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioExprMixedLogit_h
+#define bioExprMixedLogit_h
+
+#include "bioExpression.h"
+#include "bioString.h"
+
+class bioBatchDerivatives ;
+
+// Replaces the expressions
+//   log(MonteCarlo(exp(logit)))
+//   log(MonteCarlo(PanelLikelihoodTrajectory(exp(logit))))
+// where logit is _bioLogLogit or _bioLogLogitFullChoiceSet. For each
+// draw, the log likelihood of the observation (or of the sequence of
+// observations of the individual) is accumulated in log space, and
+// the average over the draws is obtained with a log-mean-exp. The
+// probabilities are never exponentiated and the derivatives of the
+// intermediate expressions are never stored.
+class bioExprMixedLogit: public bioExpression {
+ public:
+  // theIntegral is the MonteCarlo expression that is replaced. It is
+  // used only to print the expression, and to list the literals.
+  bioExprMixedLogit(bioSmartPointer<bioExpression> theLogit,
+		    bioSmartPointer<bioExpression> theIntegral,
+		    bioBoolean panel) ;
+  ~bioExprMixedLogit() ;
+  virtual bioSmartPointer<bioDerivatives> getValueAndDerivatives(std::vector<bioUInt> literalIds,
+								 bioBoolean gradient,
+								 bioBoolean hessian) ;
+  virtual bioString print(bioBoolean hp = false) const ;
+  virtual bioBoolean isDrawSplittable() const ;
+  // Value and gradient, by batches of draws.
+  virtual void getPartialLogIntegral(const std::vector<bioUInt>& literalIds,
+				     bioBoolean gradient,
+				     bioUInt firstDraw,
+				     bioUInt lastDraw,
+				     bioPartialIntegral& result) ;
+
+ private:
+  // Log likelihood of the observations for a batch of draws.
+  void getBatchTrajectory(const std::vector<bioUInt>& literalIds,
+			  bioBatchDerivatives& result) ;
+  // Value, gradient and hessian, draw by draw.
+  void getLogIntegral(const std::vector<bioUInt>& literalIds,
+		      bioDerivatives& result) ;
+  // Log likelihood of the observations for the current draw.
+  void getTrajectory(const std::vector<bioUInt>& literalIds,
+		     bioDerivatives& result) ;
+  // First and last rows of the observations of the current
+  // individual.
+  void getRows(bioUInt& first, bioUInt& last) const ;
+
+ protected:
+  bioSmartPointer<bioExpression> logit ;
+  bioSmartPointer<bioExpression> integral ;
+  bioBoolean panel ;
+};
+#endif
@@ -8,10 +8,12 @@
 //--------------------------------------------------------------------
 
 #include "bioExprMontecarlo.h"
+#include <algorithm>
 #include <sstream>
 #include "bioSmartPointer.h"
 #include "bioDebug.h"
 #include "bioExceptions.h"
+#include "bioBatchDerivatives.h"
 
 bioExprMontecarlo::bioExprMontecarlo(bioSmartPointer<bioExpression>  c) :
   child(c) {
@@ -25,7 +27,7 @@ bioExprMontecarlo::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 					  bioBoolean gradient,
 					  bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   theDerivatives->f = 0.0 ;
   if (gradient) {
@@ -42,8 +44,17 @@ bioExprMontecarlo::getValueAndDerivatives(std::vector<bioUInt> literalIds,
   }
 
   bioUInt n = literalIds.size() ;
-  child->setDrawIndex(&drawIndex) ;
-  for (drawIndex = 0 ; drawIndex < numberOfDraws ; ++drawIndex) {
+  if (!child->containsDraws()) {
+    // The integrand does not depend on the draws.
+    return child->getValueAndDerivatives(literalIds,gradient,hessian) ;
+  }
+  if (!hessian) {
+    getBatchIntegral(literalIds,gradient,*theDerivatives) ;
+    return theDerivatives ;
+  }
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  bioUInt previousDraw = state->draw ;
+  for (state->draw = 0 ; state->draw < numberOfDraws ; ++state->draw) {
     bioSmartPointer<bioDerivatives> childResult = child->getValueAndDerivatives(literalIds,gradient,hessian) ;
     theDerivatives->f += childResult->f ;
     if (gradient) {
@@ -57,6 +68,7 @@ bioExprMontecarlo::getValueAndDerivatives(std::vector<bioUInt> literalIds,
       }
     }
   }
+  state->draw = previousDraw ;
   
   theDerivatives->f /= bioReal(numberOfDraws) ;
   if (gradient) {
@@ -79,6 +91,59 @@ bioExprMontecarlo::getValueAndDerivatives(std::vector<bioUInt> literalIds,
   return theDerivatives ;
 }
 
+void bioExprMontecarlo::getBatchIntegral(const std::vector<bioUInt>& literalIds,
+					 bioBoolean gradient,
+					 bioDerivatives& result) {
+  bioUInt n = literalIds.size() ;
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  bioUInt previousDraw = state->draw ;
+  // The parts of the integrand that do not depend on the draws are
+  // evaluated once per row, for the first batch.
+  bioEvaluationState::bioInvariantValues theInvariants ;
+  bioEvaluationState::bioInvariantValues* previousInvariants = state->invariants ;
+  state->invariants = &theInvariants ;
+  bioBatchDerivatives batch(n,std::min(bioDrawBatchSize,numberOfDraws),gradient) ;
+  try {
+    for (bioUInt firstDraw = 0 ; firstDraw < numberOfDraws ; firstDraw += batch.size) {
+      bioUInt size = std::min(bioDrawBatchSize,numberOfDraws - firstDraw) ;
+      if (size == batch.size) {
+	batch.setToZero() ;
+      }
+      else {
+	batch = bioBatchDerivatives(n,size,gradient) ;
+      }
+      state->draw = firstDraw ;
+      child->getBatchValueAndDerivatives(literalIds,batch) ;
+      for (bioUInt r = 0 ; r < size ; ++r) {
+	result.f += batch.f[r] ;
+      }
+      if (gradient) {
+	for (bioUInt i = 0 ; i < n ; ++i) {
+	  if (batch.active[i]) {
+	    const bioReal* g = batch.gradient(i) ;
+	    for (bioUInt r = 0 ; r < size ; ++r) {
+	      result.g[i] += g[r] ;
+	    }
+	  }
+	}
+      }
+    }
+  }
+  catch(...) {
+    state->draw = previousDraw ;
+    state->invariants = previousInvariants ;
+    throw ;
+  }
+  state->draw = previousDraw ;
+  state->invariants = previousInvariants ;
+  result.f /= bioReal(numberOfDraws) ;
+  if (gradient) {
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      result.g[i] /= bioReal(numberOfDraws) ;
+    }
+  }
+}
+
 bioString bioExprMontecarlo::print(bioBoolean hp) const {
   std::stringstream str ; 
   str << "Montecarlo(" << child->print(hp) << ")";
@@ -23,8 +23,17 @@ class bioExprMontecarlo: public bioExpression {
 
   virtual bioString print(bioBoolean hp = false) const ;
 
+ private:
+  // The draws are processed by batches, for the value and the
+  // gradient. bioBatchDerivatives does not store second derivatives,
+  // so that, when the hessian is requested, as it is by default
+  // during the estimation, the tree is still evaluated once per
+  // draw.
+  void getBatchIntegral(const std::vector<bioUInt>& literalIds,
+			bioBoolean gradient,
+			bioDerivatives& result) ;
+
  protected:
-  bioUInt drawIndex ;
   bioSmartPointer<bioExpression>  child ;
 };
 #endif
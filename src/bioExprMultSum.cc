@@ -8,6 +8,8 @@
 //--------------------------------------------------------------------
 
 #include <sstream>
+#include <algorithm>
+#include "bioBatchDerivatives.h"
 #include "bioSmartPointer.h"
 #include "bioDebug.h"
 #include "bioExprMultSum.h"
@@ -30,7 +32,7 @@ bioExprMultSum::getValueAndDerivatives(std::vector<bioUInt> literalIds,
     throw bioExceptions(__FILE__,__LINE__,"If the hessian is needed, the gradient must be computed") ;
   }
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   theDerivatives->f = 0.0 ;
   if (gradient) {
@@ -96,3 +98,30 @@ bioString bioExprMultSum::print(bioBoolean hp) const {
   }
   return str.str() ;
 }
+
+void bioExprMultSum::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						     bioBatchDerivatives& result) {
+  bioBatchDerivatives term(result.n,result.size,result.hasGradient) ;
+  std::fill(result.f.begin(),result.f.end(),0.0) ;
+  for (std::vector<bioSmartPointer<bioExpression> >::iterator e = expressions.begin();
+       e != expressions.end() ;
+       ++e) {
+    term.setToZero() ;
+    (*e)->getBatchValueAndDerivatives(literalIds,term) ;
+    for (bioUInt r = 0 ; r < result.size ; ++r) {
+      result.f[r] += term.f[r] ;
+    }
+    if (result.hasGradient) {
+      for (bioUInt i = 0 ; i < result.n ; ++i) {
+	if (term.active[i]) {
+	  bioReal* g = result.gradient(i) ;
+	  const bioReal* tg = term.gradient(i) ;
+	  for (bioUInt r = 0 ; r < result.size ; ++r) {
+	    g[r] += tg[r] ;
+	  }
+	  result.active[i] = true ;
+	}
+      }
+    }
+  }
+}
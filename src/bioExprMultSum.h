@@ -24,6 +24,8 @@ class bioExprMultSum: public bioExpression {
 								 bioBoolean hessian) ;
   virtual bioString print(bioBoolean hp = false) const ;
 protected:
+  virtual void computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+					       bioBatchDerivatives& result) ;
   std::vector<bioSmartPointer<bioExpression> > expressions ;
 };
 
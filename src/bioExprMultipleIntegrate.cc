@@ -0,0 +1,94 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprMultipleIntegrate.cc
+// @date   Mon Oct 19 03:34:21 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include "bioExprMultipleIntegrate.h"
+#include <sstream>
+#include <cmath>
+#include "bioSmartPointer.h"
+#include "bioExceptions.h"
+
+bioExprMultipleIntegrate::bioExprMultipleIntegrate(bioSmartPointer<bioExpression> c,
+						   const std::vector<bioUInt>& ids,
+						   bioUInt l) :
+  child(c), rvIds(ids), level(l), theGrid(ids.size(),l) {
+  listOfChildren.push_back(c) ;
+}
+
+bioExprMultipleIntegrate::~bioExprMultipleIntegrate() {
+}
+
+bioSmartPointer<bioDerivatives>
+bioExprMultipleIntegrate::getValueAndDerivatives(std::vector<bioUInt> literalIds,
+						 bioBoolean gradient,
+						 bioBoolean hessian) {
+
+  bioUInt n = literalIds.size() ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(n)) ;
+  theDerivatives->f = 0.0 ;
+  if (gradient) {
+    if (hessian) {
+      theDerivatives->setDerivativesToZero() ;
+    }
+    else {
+      theDerivatives->setGradientToZero() ;
+    }
+  }
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  bioUInt d = rvIds.size() ;
+  for (bioUInt p = 0 ; p < theGrid.getNumberOfPoints() ; ++p) {
+    const bioReal* x = theGrid.getNode(p) ;
+    for (bioUInt k = 0 ; k < d ; ++k) {
+      state->setRandomVariable(rvIds[k],x[k]) ;
+    }
+    bioReal w = theGrid.getWeight(p) ;
+    bioSmartPointer<bioDerivatives> fgh = child->getValueAndDerivatives(literalIds,gradient,hessian) ;
+    theDerivatives->f += w * fgh->f ;
+    if (gradient) {
+      for (bioUInt i = 0 ; i < n ; ++i) {
+	theDerivatives->g[i] += w * fgh->g[i] ;
+      }
+      if (hessian) {
+	for (bioUInt i = 0 ; i < n ; ++i) {
+	  for (bioUInt j = i ; j < n ; ++j) {
+	    theDerivatives->h[i][j] += w * fgh->h[i][j] ;
+	  }
+	}
+      }
+    }
+  }
+  if (gradient) {
+    for (bioUInt j = 0 ; j < n ; ++j) {
+      if (!std::isfinite(theDerivatives->g[j])) {
+	theDerivatives->g[j] = bioMaxReal ;
+      }
+    }
+  }
+  if (hessian) {
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      for (bioUInt j = i ; j < n ; ++j) {
+	if (!std::isfinite(theDerivatives->h[i][j])) {
+	  theDerivatives->h[i][j] = bioMaxReal ;
+	}
+	theDerivatives->h[j][i] = theDerivatives->h[i][j] ;
+      }
+    }
+  }
+  return theDerivatives ;
+}
+
+bioString bioExprMultipleIntegrate::print(bioBoolean hp) const {
+  std::stringstream str ;
+  str << "MultipleIntegrate(" << child->print(hp) ;
+  for (std::vector<bioUInt>::const_iterator i = rvIds.begin() ;
+       i != rvIds.end() ;
+       ++i) {
+    str << "," << *i ;
+  }
+  str << "," << level << ")" ;
+  return str.str() ;
+}
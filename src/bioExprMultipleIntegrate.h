@@ -0,0 +1,39 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioExprMultipleIntegrate.h
+// @date   Mon Oct 19 03:31:30 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioExprMultipleIntegrate_h
+#define bioExprMultipleIntegrate_h
+
+#include "bioExpression.h"
+#include "bioString.h"
+#include "bioSparseGrid.h"
+
+// Integral of the child over several random variables, with a
+// sparse grid of the given level. The grid is generated once, when
+// the expression is created. As the integral is a weighted sum of
+// the values of the child, its derivatives are the weighted sums of
+// the derivatives of the child.
+class bioExprMultipleIntegrate: public bioExpression {
+ public:
+  bioExprMultipleIntegrate(bioSmartPointer<bioExpression> c,
+			   const std::vector<bioUInt>& rvIds,
+			   bioUInt level = bioSparseGridDefaultLevel) ;
+  ~bioExprMultipleIntegrate() ;
+  virtual bioSmartPointer<bioDerivatives> getValueAndDerivatives(std::vector<bioUInt> literalIds,
+								 bioBoolean gradient,
+								 bioBoolean hessian) ;
+
+  virtual bioString print(bioBoolean hp = false) const ;
+
+ protected:
+  bioSmartPointer<bioExpression> child ;
+  std::vector<bioUInt> rvIds ;
+  bioUInt level ;
+  bioSparseGrid theGrid ;
+};
+#endif
@@ -11,6 +11,7 @@
 #include "bioSmartPointer.h"
 #include <cmath>
 #include "bioExprNormalCdf.h"
+#include "bioBatchDerivatives.h"
 #include "bioDebug.h"
 
 bioExprNormalCdf::bioExprNormalCdf(bioSmartPointer<bioExpression>  c) :
@@ -25,14 +26,14 @@ bioExprNormalCdf::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 					 bioBoolean gradient,
 					 bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   bioSmartPointer<bioDerivatives> childResult = child->getValueAndDerivatives(literalIds,gradient,hessian) ;
   theDerivatives->f = theNormalCdf.compute(childResult->f) ;
 
   if (gradient) {
     bioUInt n = literalIds.size() ;
-    bioReal thePdf = invSqrtTwoPi * exp(- childResult->f * childResult->f / 2.0) ;
+    bioReal thePdf = theNormalCdf.derivative(childResult->f) ;
     for (bioUInt i = 0 ; i < n ; ++i) {
       if (childResult->g[i] == 0.0) {
 	theDerivatives->g[i] = 0.0 ;
@@ -74,3 +75,21 @@ bioString bioExprNormalCdf::print(bioBoolean hp) const {
   return str.str() ;
 
 }
+
+void bioExprNormalCdf::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						       bioBatchDerivatives& result) {
+  child->getBatchValueAndDerivatives(literalIds,result) ;
+  std::vector<bioReal> x(result.f) ;
+  std::vector<bioReal> pdf(result.size) ;
+  bioNormalCdf::compute(x.data(),result.f.data(),pdf.data(),result.size) ;
+  if (result.hasGradient) {
+    for (bioUInt i = 0 ; i < result.n ; ++i) {
+      if (result.active[i]) {
+	bioReal* g = result.gradient(i) ;
+	for (bioUInt r = 0 ; r < result.size ; ++r) {
+	  g[r] *= pdf[r] ;
+	}
+      }
+    }
+  }
+}
@@ -25,6 +25,8 @@ class bioExprNormalCdf: public bioExpression {
   virtual bioString print(bioBoolean hp = false) const ;
   
 protected:
+  virtual void computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+					       bioBatchDerivatives& result) ;
   bioNormalCdf theNormalCdf ;
   bioSmartPointer<bioExpression>  child ;
 };
@@ -7,6 +7,7 @@
 //--------------------------------------------------------------------
 
 #include "bioExprNormalPdf.h"
+#include "bioBatchDerivatives.h"
 #include <sstream>
 #include "bioSmartPointer.h"
 #include <cmath>
@@ -25,18 +26,14 @@ bioExprNormalPdf::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 					 bioBoolean gradient,
 					 bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   bioSmartPointer<bioDerivatives> childResult = child->getValueAndDerivatives(literalIds,gradient,hessian) ;
-  bioReal x = - childResult->f * childResult->f / 2.0 ;
-  if (x <= bioLogMaxReal::the()) { 
-    theDerivatives->f = exp(x) * 0.3989422804 ;
-  }
-  else {
-    theDerivatives->f = std::numeric_limits<bioReal>::max() ;
-  }
+  bioReal x = childResult->f ;
+  theDerivatives->f = theNormalCdf.derivative(x) ;
 
-  
+  // d pdf(x) = -x pdf(x) dx
+  // d2 pdf(x) = pdf(x) ((x*x-1) dx dx' - x d2x)
   if (gradient) {
     bioUInt n = literalIds.size() ;
     for (bioUInt i = 0 ; i < n ; ++i) {
@@ -48,17 +45,15 @@ bioExprNormalPdf::getValueAndDerivatives(std::vector<bioUInt> literalIds,
       }
       if (hessian) {
 	for (bioUInt j = i ; j < n ; ++j) {
+	  theDerivatives->h[i][j] = 0.0 ;
 	  if (childResult->h[i][j] != 0.0) {
-	    theDerivatives->h[i][j] = TO BE IMPLEMENTED (AND TESTED)
-	  }
-	  else {
-	    theDerivatives->h[i][j] = 0.0 ;
+	    theDerivatives->h[i][j] -= x * childResult->h[i][j] ;
 	  }
-	  if (childResult->f != 0.0 && 
-	      childResult->g[i] != 0 && 
-	      childResult->g[j] != 0) {
-	    theDerivatives->h[i][j] -= thePdf * childResult->f * childResult->g[i] * childResult->g[j] ;
+	  if (childResult->g[i] != 0.0 &&
+	      childResult->g[j] != 0.0) {
+	    theDerivatives->h[i][j] += (x * x - 1.0) * childResult->g[i] * childResult->g[j] ;
 	  }
+	  theDerivatives->h[i][j] *= theDerivatives->f ;
 	}
       }
     }
@@ -80,3 +75,20 @@ bioString bioExprNormalPdf::print(bioBoolean hp) const {
   return str.str() ;
 
 }
+
+void bioExprNormalPdf::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						       bioBatchDerivatives& result) {
+  child->getBatchValueAndDerivatives(literalIds,result) ;
+  std::vector<bioReal> x(result.f) ;
+  bioNormalCdf::derivative(x.data(),result.f.data(),result.size) ;
+  if (result.hasGradient) {
+    for (bioUInt i = 0 ; i < result.n ; ++i) {
+      if (result.active[i]) {
+	bioReal* g = result.gradient(i) ;
+	for (bioUInt r = 0 ; r < result.size ; ++r) {
+	  g[r] *= - x[r] * result.f[r] ;
+	}
+      }
+    }
+  }
+}
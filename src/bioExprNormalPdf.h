@@ -11,8 +11,9 @@
 
 #include "bioExpression.h"
 #include "bioString.h"
-#include "bioNormalPdf.h"
+#include "bioNormalCdf.h"
 
+// Density of the standard normal distribution.
 class bioExprNormalPdf: public bioExpression {
  public:
   bioExprNormalPdf(bioSmartPointer<bioExpression>  c) ;
@@ -24,6 +25,9 @@ class bioExprNormalPdf: public bioExpression {
   virtual bioString print(bioBoolean hp = false) const ;
   
 protected:
+  virtual void computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+					       bioBatchDerivatives& result) ;
+  bioNormalCdf theNormalCdf ;
   bioSmartPointer<bioExpression>  child ;
 };
 #endif
@@ -8,7 +8,9 @@
 //--------------------------------------------------------------------
 
 #include "bioExprNumeric.h"
+#include "bioBatchDerivatives.h"
 #include <sstream>
+#include <algorithm>
 #include "bioSmartPointer.h"
 #include "bioDebug.h"
 bioExprNumeric::bioExprNumeric(bioReal v) : value(v) {
@@ -23,7 +25,7 @@ bioExprNumeric::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 				       bioBoolean gradient,
 				       bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   if (gradient) {
     if (hessian) {
@@ -44,3 +46,8 @@ bioString bioExprNumeric::print(bioBoolean hp) const {
   return str.str() ;
 }
 
+
+void bioExprNumeric::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						     bioBatchDerivatives& result) {
+  std::fill(result.f.begin(),result.f.end(),value) ;
+}
@@ -22,6 +22,8 @@ class bioExprNumeric: public bioExpression {
 								 bioBoolean hessian) ;
   virtual bioString print(bioBoolean hp = false) const ;
 protected:
+  virtual void computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+					       bioBatchDerivatives& result) ;
   bioReal value ;
 };
 #endif
@@ -8,7 +8,9 @@
 //--------------------------------------------------------------------
 
 #include "bioExprPanelTrajectory.h"
+#include "bioBatchDerivatives.h"
 #include <cmath>
+#include <algorithm>
 #include "bioSmartPointer.h"
 #include <sstream>
 #include "bioExceptions.h"
@@ -28,7 +30,7 @@ bioExprPanelTrajectory::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 					       bioBoolean hessian) {
 
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   theDerivatives->f = 0.0 ;
   if (gradient) {
@@ -44,24 +46,25 @@ bioExprPanelTrajectory::getValueAndDerivatives(std::vector<bioUInt> literalIds,
     throw bioExceptNullPointer(__FILE__,__LINE__,"data map") ;
   }
 
-  if (individualIndex == NULL) {
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  if (state->individual == bioBadId) {
     throw bioExceptNullPointer(__FILE__,__LINE__,"individual index") ;
 
   }
   
-  if (*individualIndex >= dataMap->size()) {
-    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,*individualIndex,0,dataMap->size() - 1) ;
+  if (state->individual >= dataMap->size()) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,state->individual,0,dataMap->size() - 1) ;
   }
   bioUInt n = literalIds.size() ;
-  child->setRowIndex(&theRowIndex) ;
+  bioUInt previousRow = state->row ;
 
-  for (theRowIndex = (*dataMap)[*individualIndex][0]  ; theRowIndex <= (*dataMap)[*individualIndex][1] ; ++theRowIndex) {
+  for (state->row = (*dataMap)[state->individual][0]  ; state->row <= (*dataMap)[state->individual][1] ; ++state->row) {
     bioSmartPointer<bioDerivatives> childResult(NULL) ;
     try {
       childResult = child->getValueAndDerivatives(literalIds,gradient,hessian) ;
       // if (childResult->f <= 1.0e-6) {
       // 	std::stringstream str ;
-      // 	str << "Error for data entry " << theRowIndex << ": probability " << childResult->f << "for " << child->print() ;
+      // 	str << "Error for data entry " << state->row << ": probability " << childResult->f << "for " << child->print() ;
       // 	throw bioExceptions(__FILE__,__LINE__,str.str()) ;
       // }
       theDerivatives->f += log(childResult->f) ;
@@ -85,10 +88,12 @@ bioExprPanelTrajectory::getValueAndDerivatives(std::vector<bioUInt> literalIds,
     }
     catch(bioExceptions& e) {
       std::stringstream str ;
-      str << "Error for data entry " << theRowIndex << ": " << e.what() ;
+      str << "Error for data entry " << state->row << ": " << e.what() ;
+      state->row = previousRow ;
       throw bioExceptions(__FILE__,__LINE__,str.str()) ;
     }
   }
+  state->row = previousRow ;
   // So far, we have calculated the derivatrives for the log
   // likelihood. We need now to store the derivatives of the
   // likelihood of the trajectory.
@@ -124,8 +129,62 @@ bioString bioExprPanelTrajectory::print(bioBoolean hp) const {
 
 }
 
-// This is the only class that should not propagate the row index
-// pointer, as its own pointer may be inconsistent with its formula.
-void bioExprPanelTrajectory::setRowIndex(bioUInt* i) {
-  
+void bioExprPanelTrajectory::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+							     bioBatchDerivatives& result) {
+  if (dataMap == NULL) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"data map") ;
+  }
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  if (state->individual == bioBadId) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"individual index") ;
+  }
+  if (state->individual >= dataMap->size()) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,state->individual,0,dataMap->size() - 1) ;
+  }
+  // As for one draw, the log of the probability of the trajectory is
+  // accumulated, with its derivatives.
+  std::fill(result.f.begin(),result.f.end(),0.0) ;
+  bioBatchDerivatives childResult(result.n,result.size,result.hasGradient) ;
+  bioUInt previousRow = state->row ;
+  for (state->row = (*dataMap)[state->individual][0]  ; state->row <= (*dataMap)[state->individual][1] ; ++state->row) {
+    childResult.setToZero() ;
+    try {
+      child->getBatchValueAndDerivatives(literalIds,childResult) ;
+    }
+    catch(bioExceptions& e) {
+      std::stringstream str ;
+      str << "Error for data entry " << state->row << ": " << e.what() ;
+      state->row = previousRow ;
+      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    }
+    for (bioUInt r = 0 ; r < result.size ; ++r) {
+      result.f[r] += log(childResult.f[r]) ;
+    }
+    if (result.hasGradient) {
+      for (bioUInt i = 0 ; i < result.n ; ++i) {
+	if (childResult.active[i]) {
+	  bioReal* g = result.gradient(i) ;
+	  const bioReal* cg = childResult.gradient(i) ;
+	  for (bioUInt r = 0 ; r < result.size ; ++r) {
+	    g[r] += cg[r] / childResult.f[r] ;
+	  }
+	  result.active[i] = true ;
+	}
+      }
+    }
+  }
+  state->row = previousRow ;
+  for (bioUInt r = 0 ; r < result.size ; ++r) {
+    result.f[r] = exp(result.f[r]) ;
+  }
+  if (result.hasGradient) {
+    for (bioUInt i = 0 ; i < result.n ; ++i) {
+      if (result.active[i]) {
+	bioReal* g = result.gradient(i) ;
+	for (bioUInt r = 0 ; r < result.size ; ++r) {
+	  g[r] *= result.f[r] ;
+	}
+      }
+    }
+  }
 }
@@ -24,10 +24,10 @@ class bioExprPanelTrajectory: public bioExpression {
 								 bioBoolean hessian) ;
 
   virtual bioString print(bioBoolean hp = false) const ;
-  virtual void setRowIndex(bioUInt* i) ;
 
  protected:
-  bioUInt theRowIndex ;
+  virtual void computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+					       bioBatchDerivatives& result) ;
   bioSmartPointer<bioExpression>  child ;
 
 };
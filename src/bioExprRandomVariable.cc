@@ -12,7 +12,7 @@
 #include "bioExceptions.h"
 #include "bioDebug.h"
 
-bioExprRandomVariable::bioExprRandomVariable(bioUInt uniqueId, bioUInt id, bioString name) : bioExprLiteral(uniqueId,name), rvId(id), valuePtr(NULL) {
+bioExprRandomVariable::bioExprRandomVariable(bioUInt uniqueId, bioUInt id, bioString name) : bioExprLiteral(uniqueId,name), rvId(id) {
 
 }
 bioExprRandomVariable::~bioExprRandomVariable() {
@@ -24,17 +24,8 @@ bioString bioExprRandomVariable::print(bioBoolean hp) const {
   return str.str() ;
 }
 
-void bioExprRandomVariable::setRandomVariableValuePtr(bioUInt id, bioReal* v) {
-  if (rvId == id) {
-    valuePtr = v ;
-  }
-}
-
 bioReal bioExprRandomVariable::getLiteralValue() const {
 
-  if (valuePtr == NULL) {
-    throw bioExceptNullPointer(__FILE__,__LINE__,"random variable value") ;
-  }
-  return *valuePtr ;
+  return bioEvaluationState::current()->getRandomVariable(rvId) ;
 
 }
@@ -19,11 +19,9 @@ class bioExprRandomVariable: public bioExprLiteral {
   bioExprRandomVariable(bioUInt literalId, bioUInt id, bioString name) ;
   ~bioExprRandomVariable() ;
   virtual bioString print(bioBoolean hp = false) const ;
-  virtual void setRandomVariableValuePtr(bioUInt id, bioReal* v) ;
   virtual bioReal getLiteralValue() const ;
 protected:
   bioUInt rvId ;
-  bioReal* valuePtr ;
 };
 
 
@@ -27,7 +27,7 @@ bioExprSum::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 				   bioBoolean hessian) {
 
   bioString str = print(true) ;
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   bioUInt n = literalIds.size() ;
   theDerivatives->setToZero() ;
@@ -8,6 +8,7 @@
 //--------------------------------------------------------------------
 
 #include "bioExprTimes.h"
+#include "bioBatchDerivatives.h"
 #include <sstream>
 #include "bioSmartPointer.h"
 #include "bioDebug.h"
@@ -29,7 +30,7 @@ bioExprTimes::getValueAndDerivatives(std::vector<bioUInt> literalIds,
 				     bioBoolean hessian) {
   
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   bioUInt n = literalIds.size() ;
   bioSmartPointer<bioDerivatives> leftResult = left->getValueAndDerivatives(literalIds,gradient,hessian) ;
@@ -156,3 +157,42 @@ bioString bioExprTimes::print(bioBoolean hp) const {
   return str.str() ;
 }
 
+
+void bioExprTimes::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						   bioBatchDerivatives& result) {
+  bioBatchDerivatives leftResult(result.n,result.size,result.hasGradient) ;
+  bioBatchDerivatives rightResult(result.n,result.size,result.hasGradient) ;
+  left->getBatchValueAndDerivatives(literalIds,leftResult) ;
+  right->getBatchValueAndDerivatives(literalIds,rightResult) ;
+  const bioReal* lf = &leftResult.f[0] ;
+  const bioReal* rf = &rightResult.f[0] ;
+  for (bioUInt r = 0 ; r < result.size ; ++r) {
+    result.f[r] = lf[r] * rf[r] ;
+  }
+  if (result.hasGradient) {
+    for (bioUInt i = 0 ; i < result.n ; ++i) {
+      bioReal* g = result.gradient(i) ;
+      const bioReal* lg = leftResult.gradient(i) ;
+      const bioReal* rg = rightResult.gradient(i) ;
+      // As for one draw, a term is zero if the other factor is zero.
+      if (leftResult.active[i] && rightResult.active[i]) {
+	for (bioUInt r = 0 ; r < result.size ; ++r) {
+	  g[r] = ((rf[r] != 0.0) ? lg[r] * rf[r] : 0.0) + ((lf[r] != 0.0) ? rg[r] * lf[r] : 0.0) ;
+	}
+	result.active[i] = true ;
+      }
+      else if (leftResult.active[i]) {
+	for (bioUInt r = 0 ; r < result.size ; ++r) {
+	  g[r] = (rf[r] != 0.0) ? lg[r] * rf[r] : 0.0 ;
+	}
+	result.active[i] = true ;
+      }
+      else if (rightResult.active[i]) {
+	for (bioUInt r = 0 ; r < result.size ; ++r) {
+	  g[r] = (lf[r] != 0.0) ? rg[r] * lf[r] : 0.0 ;
+	}
+	result.active[i] = true ;
+      }
+    }
+  }
+}
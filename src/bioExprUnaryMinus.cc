@@ -8,6 +8,7 @@
 //--------------------------------------------------------------------
 
 #include "bioExprUnaryMinus.h"
+#include "bioBatchDerivatives.h"
 #include "bioDebug.h"
 #include <sstream>
 #include "bioSmartPointer.h"
@@ -23,7 +24,7 @@ bioSmartPointer<bioDerivatives> bioExprUnaryMinus::getValueAndDerivatives(std::v
 							  bioBoolean gradient,
 							  bioBoolean hessian) {
 
-  theDerivatives = bioSmartPointer<bioDerivatives>(new bioDerivatives(literalIds.size())) ;
+  bioSmartPointer<bioDerivatives> theDerivatives(new bioDerivatives(literalIds.size())) ;
 
   bioUInt n = literalIds.size() ;
   bioSmartPointer<bioDerivatives> childResult = child->getValueAndDerivatives(literalIds,gradient,hessian) ;
@@ -48,3 +49,21 @@ bioString bioExprUnaryMinus::print(bioBoolean hp) const {
 
 }
 
+
+void bioExprUnaryMinus::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+							bioBatchDerivatives& result) {
+  child->getBatchValueAndDerivatives(literalIds,result) ;
+  for (bioUInt r = 0 ; r < result.size ; ++r) {
+    result.f[r] = - result.f[r] ;
+  }
+  if (result.hasGradient) {
+    for (bioUInt i = 0 ; i < result.n ; ++i) {
+      if (result.active[i]) {
+	bioReal* g = result.gradient(i) ;
+	for (bioUInt r = 0 ; r < result.size ; ++r) {
+	  g[r] = - g[r] ;
+	}
+      }
+    }
+  }
+}
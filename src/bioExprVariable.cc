@@ -20,8 +20,9 @@ bioExprVariable::~bioExprVariable() {
 bioString bioExprVariable::print(bioBoolean hp) const {
   std::stringstream str ;
   str << theName << " lit[" << theLiteralId << "], fixed[" << theVariableId << "]" ;
-  if (rowIndex != NULL) {
-    str << " <" << *rowIndex << ">" ;
+  bioUInt row = bioEvaluationState::current()->row ;
+  if (row != bioBadId) {
+    str << " <" << row << ">" ;
   }
   try {
     getLiteralValue() ;
@@ -33,17 +34,23 @@ bioString bioExprVariable::print(bioBoolean hp) const {
   return str.str() ;
 }
 
+bioBoolean bioExprVariable::dependsOnlyOnData() const {
+  return true ;
+}
+
 bioReal bioExprVariable::getLiteralValue() const {
   bioReal value(missingData) ;
-  if (rowIndex == NULL) {
-    if (individualIndex == NULL) {
+  const bioEvaluationState* state = bioEvaluationState::current() ;
+  bioUInt row = state->row ;
+  if (row == bioBadId) {
+    if (state->individual == bioBadId) {
       std::stringstream str ;
       str << "No data has been provided to the formula to obtain a value for variable " << theName ;
       throw bioExceptNullPointer(__FILE__,__LINE__,str.str()) ;
     }
     else {
       // We consider the first observation of this individual
-      bioUInt theFirstIndex = (*dataMap)[*individualIndex][0] ;
+      bioUInt theFirstIndex = (*dataMap)[state->individual][0] ;
       if (theVariableId >= (*data)[theFirstIndex].size()) {
 	throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,theVariableId,0,(*data)[theFirstIndex].size() - 1) ;
       }
@@ -51,19 +58,19 @@ bioReal bioExprVariable::getLiteralValue() const {
     }
   }
   else {
-    if (*rowIndex >= data->size()) {
+    if (row >= data->size()) {
       std::stringstream str ;
-      str << theName << ": " << *rowIndex << " out of range [0," << data->size() - 1 << "]" ;
+      str << theName << ": " << row << " out of range [0," << data->size() - 1 << "]" ;
       throw bioExceptions(__FILE__,__LINE__,str.str()) ;
     }
-    if (theVariableId >= (*data)[*rowIndex].size()) {
-      throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,theVariableId,0,(*data)[*rowIndex].size() - 1) ;
+    if (theVariableId >= (*data)[row].size()) {
+      throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,theVariableId,0,(*data)[row].size() - 1) ;
     }
-    value = (*data)[*rowIndex][theVariableId] ;
+    value = (*data)[row][theVariableId] ;
   }
   if (value == missingData) {
     std::stringstream str ;
-    str << "Variable " << theName << " takes value " << missingData << " at row " << *rowIndex << ". This value is interpreted as a missing value by Biogeme. If it is a genuine value, change the parameter 'missingData' in Biogeme. If not, either remove the observation or change the specification of the model." ;
+    str << "Variable " << theName << " takes value " << missingData << " at row " << row << ". This value is interpreted as a missing value by Biogeme. If it is a genuine value, change the parameter 'missingData' in Biogeme. If not, either remove the observation or change the specification of the model." ;
     throw bioExceptions(__FILE__,__LINE__,str.str()) ;
   }
   return value ;
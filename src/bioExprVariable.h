@@ -21,6 +21,7 @@ class bioExprVariable: public bioExprLiteral {
   // Returns true is the expression contains at least one literal in
   // the list. Used to simplify the calculation of the derivatives
   virtual bioReal getLiteralValue() const ;
+  virtual bioBoolean dependsOnlyOnData() const ;
 
 protected:
   bioUInt theVariableId ;
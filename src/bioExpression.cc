@@ -9,8 +9,13 @@
 
 #include "bioExpression.h"
 #include "bioDebug.h"
+#include "bioDrawGenerator.h"
+#include "bioDrawTable.h"
+#include "bioBatchDerivatives.h"
+#include "bioExceptions.h"
 #include <sstream>
-bioExpression::bioExpression() : parameters(NULL), theDerivatives(NULL), data(NULL), dataMap(NULL), draws(NULL), sampleSize(0), numberOfDraws(0), numberOfDrawVariables(0), rowIndex(NULL), individualIndex(NULL) {
+#include <algorithm>
+bioExpression::bioExpression() : parameters(NULL), fixedParameters(NULL), data(NULL), dataMap(NULL), draws(NULL), drawGenerator(NULL), sampleSize(0), numberOfDraws(0), numberOfDrawVariables(0), drawDependent(true) {
 }
 
 bioExpression::~bioExpression() {
@@ -33,35 +38,41 @@ void bioExpression::setDataMap(std::vector< std::vector<bioUInt> >* dm) {
   dataMap = dm ;
 }
 
-void bioExpression::setDraws(std::vector< std::vector< std::vector<bioReal> > >* d) {
+void bioExpression::setDraws(const bioDrawTable* d) {
   draws = d ;
+  drawGenerator = NULL ;
   if (draws != NULL) {
-    sampleSize = draws->size() ;
-  }
-  if (sampleSize > 0) {
-    numberOfDraws = (*draws)[0].size() ;
-  }
-  if (numberOfDraws > 0) {
-    numberOfDrawVariables = (*draws)[0][0].size() ;
+    sampleSize = draws->getSampleSize() ;
+    numberOfDraws = draws->getNumberOfDraws() ;
+    numberOfDrawVariables = draws->getNumberOfVariables() ;
   }
 }
 
-void bioExpression::setRowIndex(bioUInt* d) {
-  rowIndex = d ;
-  for (std::vector<bioSmartPointer<bioExpression> >::iterator i = listOfChildren.begin() ;
-       i != listOfChildren.end() ;
-       ++i) {
-    (*i)->setRowIndex(d) ;
+void bioExpression::setDrawGenerator(const bioDrawGenerator* g) {
+  drawGenerator = g ;
+  draws = NULL ;
+  // The generator is not limited to a number of individuals.
+  sampleSize = 0 ;
+  numberOfDraws = 0 ;
+  numberOfDrawVariables = 0 ;
+  if (drawGenerator != NULL) {
+    numberOfDraws = drawGenerator->getNumberOfDraws() ;
+    numberOfDrawVariables = drawGenerator->getNumberOfVariables() ;
   }
 }
 
-void bioExpression::setIndividualIndex(bioUInt* d) {
-  individualIndex = d ;
-  for (std::vector<bioSmartPointer<bioExpression> >::iterator i = listOfChildren.begin() ;
-       i != listOfChildren.end() ;
-       ++i) {
-    (*i)->setIndividualIndex(d) ;
+void bioExpression::setNumberOfDraws(bioUInt r) {
+  bioUInt available = 0 ;
+  if (draws != NULL) {
+    available = draws->getNumberOfDraws() ;
+  }
+  else if (drawGenerator != NULL) {
+    available = drawGenerator->getNumberOfDraws() ;
   }
+  if (r > available) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,r,0,available) ;
+  }
+  numberOfDraws = (r == 0) ? available : r ;
 }
 
 void bioExpression::setMissingData(bioReal md) {
@@ -74,22 +85,6 @@ void bioExpression::setMissingData(bioReal md) {
 }
 
 
-void bioExpression::setDrawIndex(bioUInt* d) {
-  for (std::vector<bioSmartPointer<bioExpression> >::iterator i = listOfChildren.begin() ;
-       i != listOfChildren.end() ;
-       ++i) {
-    (*i)->setDrawIndex(d) ;
-  }
-}
-
-void bioExpression::setRandomVariableValuePtr(bioUInt rvId, bioReal* v) {
-  for (std::vector<bioSmartPointer<bioExpression> >::iterator i = listOfChildren.begin() ;
-       i != listOfChildren.end() ;
-       ++i) {
-    (*i)->setRandomVariableValuePtr(rvId, v) ;
-  }
-}
-
 bioReal bioExpression::getValue() {
   bioSmartPointer<bioDerivatives> r = getValueAndDerivatives(std::vector<bioUInt>(),false,false) ;
   return r->f ;
@@ -118,3 +113,116 @@ std::map<bioString,bioReal> bioExpression::getAllLiteralValues() const {
   return m ;  
 }
 
+
+void bioExpression::getBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						bioBatchDerivatives& result) {
+  if (drawDependent || listOfChildren.empty()) {
+    // The literals are cheaper to evaluate than to look up.
+    computeBatchValueAndDerivatives(literalIds,result) ;
+    return ;
+  }
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  bioSmartPointer<bioDerivatives> d ;
+  if (state->invariants == NULL) {
+    d = getValueAndDerivatives(literalIds,result.hasGradient,false) ;
+  }
+  else {
+    bioEvaluationState::bioInvariantKey key(this,state->row) ;
+    bioEvaluationState::bioInvariantValues::iterator found = state->invariants->find(key) ;
+    if (found == state->invariants->end()) {
+      d = getValueAndDerivatives(literalIds,result.hasGradient,false) ;
+      state->invariants->insert(std::make_pair(key,d)) ;
+    }
+    else {
+      d = found->second ;
+    }
+  }
+  broadcast(*d,result) ;
+}
+
+void bioExpression::computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+						    bioBatchDerivatives& result) {
+  if (!containsDraws()) {
+    // The expression takes the same value for all the draws.
+    bioSmartPointer<bioDerivatives> d = getValueAndDerivatives(literalIds,result.hasGradient,false) ;
+    broadcast(*d,result) ;
+    return ;
+  }
+  bioEvaluationState* state = bioEvaluationState::current() ;
+  bioUInt firstDraw = state->draw ;
+  try {
+    for (bioUInt r = 0 ; r < result.size ; ++r) {
+      state->draw = firstDraw + r ;
+      bioSmartPointer<bioDerivatives> d = getValueAndDerivatives(literalIds,result.hasGradient,false) ;
+      result.f[r] = d->f ;
+      if (result.hasGradient) {
+	for (bioUInt i = 0 ; i < result.n ; ++i) {
+	  if (d->g[i] != 0.0) {
+	    result.gradient(i)[r] = d->g[i] ;
+	    result.active[i] = true ;
+	  }
+	}
+      }
+    }
+  }
+  catch(...) {
+    state->draw = firstDraw ;
+    throw ;
+  }
+  state->draw = firstDraw ;
+}
+
+void bioExpression::broadcast(const bioDerivatives& d,
+			      bioBatchDerivatives& result) {
+  std::fill(result.f.begin(),result.f.end(),d.f) ;
+  if (result.hasGradient) {
+    for (bioUInt i = 0 ; i < result.n ; ++i) {
+      if (d.g[i] != 0.0) {
+	std::fill(result.gradient(i),result.gradient(i)+result.size,d.g[i]) ;
+	result.active[i] = true ;
+      }
+    }
+  }
+}
+
+bioBoolean bioExpression::dependsOnlyOnData() const {
+  for (std::vector<bioSmartPointer<bioExpression> >::const_iterator i = listOfChildren.begin() ;
+       i != listOfChildren.end() ;
+       ++i) {
+    if (!(*i)->dependsOnlyOnData()) {
+      return false ;
+    }
+  }
+  return true ;
+}
+
+void bioExpression::prepareData() {
+}
+
+bioBoolean bioExpression::containsDraws() const {
+  return drawDependent ;
+}
+
+void bioExpression::updateDrawDependency() {
+  drawDependent = false ;
+  for (std::vector<bioSmartPointer<bioExpression> >::const_iterator i = listOfChildren.begin() ;
+       i != listOfChildren.end() ;
+       ++i) {
+    if ((*i)->containsDraws()) {
+      drawDependent = true ;
+      return ;
+    }
+  }
+}
+
+bioBoolean bioExpression::isDrawSplittable() const {
+  return false ;
+}
+
+void bioExpression::getPartialLogIntegral(const std::vector<bioUInt>& literalIds,
+					  bioBoolean gradient,
+					  bioUInt firstDraw,
+					  bioUInt lastDraw,
+					  bioPartialIntegral& result) {
+  throw bioExceptions(__FILE__,__LINE__,"The expression cannot be evaluated by ranges of draws: "+print()) ;
+}
@@ -17,6 +17,16 @@
 #include "bioString.h"
 #include "bioSmartPointer.h"
 #include "bioDerivatives.h"
+#include "bioEvaluationState.h"
+
+class bioDrawGenerator ;
+class bioDrawTable ;
+class bioBatchDerivatives ;
+class bioPartialIntegral ;
+
+// The expressions are shared by all threads. The state of the
+// evaluation (row, individual, draw) is stored in the
+// bioEvaluationState of the current thread, and not in the expression.
 class bioExpression {
  public:
   bioExpression() ;
@@ -24,14 +34,17 @@ class bioExpression {
   virtual bioString print(bioBoolean hp = false) const = PURE_VIRTUAL ;
   virtual void setParameters(std::vector<bioReal>* p) ;
   virtual void setFixedParameters(std::vector<bioReal>* p) ;
-  virtual void setRowIndex(bioUInt* i) ;
-  virtual void setIndividualIndex(bioUInt* i) ;
-  virtual void setRandomVariableValuePtr(bioUInt rvId, bioReal* v) ;
-  virtual void setDrawIndex(bioUInt* d) ;
   virtual void setData(std::vector< std::vector<bioReal> >* d) ;
   virtual void setMissingData(bioReal md) ;
   virtual void setDataMap(std::vector< std::vector<bioUInt> >* dm) ;
-  virtual void setDraws(std::vector< std::vector< std::vector<bioReal> > >* d) ;
+  virtual void setDraws(const bioDrawTable* d) ;
+  // The draws are generated when needed, instead of being stored.
+  virtual void setDrawGenerator(const bioDrawGenerator* g) ;
+  // Only the first r draws of each individual are used, so that the
+  // number of draws can be increased without generating them
+  // again. If r is 0, all the draws are used. Must be called after
+  // setDraws or setDrawGenerator.
+  void setNumberOfDraws(bioUInt r) ;
   virtual bioReal getValue() ;
   // Returns true is the expression contains at least one literal in
   // the list. Used to simplify the calculation of the derivatives
@@ -40,10 +53,47 @@ class bioExpression {
 								 bioBoolean gradient,
 								 bioBoolean hessian) = PURE_VIRTUAL ;
   virtual std::map<bioString,bioReal> getAllLiteralValues() const;
+  // Value and gradient for a batch of consecutive draws, starting
+  // with the draw of the current evaluation state. If the expression
+  // does not depend on the draws, it is evaluated once, and the
+  // result is reused for all the draws of the batch and, during a
+  // Monte-Carlo integration, for all the batches of the same row.
+  void getBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+				   bioBatchDerivatives& result) ;
+  // Returns true if the value of the expression depends on the draws.
+  virtual bioBoolean containsDraws() const ;
+  // Returns true if the value of the expression depends only on the
+  // current row of the data, and not on the parameters, the draws or
+  // the random variables.
+  virtual bioBoolean dependsOnlyOnData() const ;
+  // Called once the data, the data map and the missing value have
+  // been set, before any evaluation, so that the quantities depending
+  // only on the data can be computed once.
+  virtual void prepareData() ;
+  // Must be called once the children have been set. The dependency
+  // on the draws is then obtained without exploring the expression.
+  void updateDrawDependency() ;
+  // True if the expression is the log of a Monte-Carlo integral,
+  // that can be evaluated by ranges of draws, possibly in different
+  // threads. The partial sums over the draws firstDraw to lastDraw-1
+  // are then merged before the log is taken.
+  virtual bioBoolean isDrawSplittable() const ;
+  virtual void getPartialLogIntegral(const std::vector<bioUInt>& literalIds,
+				     bioBoolean gradient,
+				     bioUInt firstDraw,
+				     bioUInt lastDraw,
+				     bioPartialIntegral& result) ;
  protected:
+  // The default implementation evaluates the expression draw by
+  // draw. The expressions involved in Monte-Carlo integration
+  // override it, so that the calculations are performed for all the
+  // draws at once.
+  virtual void computeBatchValueAndDerivatives(const std::vector<bioUInt>& literalIds,
+					       bioBatchDerivatives& result) ;
+  // Same value and gradient for all the draws of the batch.
+  static void broadcast(const bioDerivatives& d, bioBatchDerivatives& result) ;
   std::vector<bioReal>* parameters ;
   std::vector<bioReal>* fixedParameters ;
-  bioSmartPointer<bioDerivatives> theDerivatives ;
   // Dimensons of the data
   // 1. number of rows
   // 2. number of variables
@@ -57,14 +107,16 @@ class bioExpression {
   std::vector<bioSmartPointer<bioExpression> > listOfChildren ;
   // Dimensions of the draws
   // 1. number of individuals
-  // 2. number of draws
-  // 3. number of draw variables
-  std::vector< std::vector< std::vector<bioReal> > >* draws ;
+  // 2. number of draw variables
+  // 3. number of draws
+  const bioDrawTable* draws ;
+  // If not NULL, it replaces the table of draws.
+  const bioDrawGenerator* drawGenerator ;
   bioUInt sampleSize ;
   bioUInt numberOfDraws ;
   bioUInt numberOfDrawVariables ;
-  bioUInt* rowIndex ;
-  bioUInt* individualIndex ;
   bioReal missingData ;
+  // True until updateDrawDependency has been called.
+  bioBoolean drawDependent ;
 };
 #endif
@@ -13,11 +13,15 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include "bioSmartPointer.h"
 #include <sstream>
 #include "bioTypes.h"
 #include "bioString.h"
 #include "bioExceptions.h"
+#include "bioSignatureParser.h"
+#include "bioModelCache.h"
 
 #include "bioExprFreeParameter.h"
 #include "bioExprFixedParameter.h"
@@ -42,486 +46,404 @@
 #include "bioExprMultSum.h"
 #include "bioExprLogLogit.h"
 #include "bioExprLogLogitFullChoiceSet.h"
+#include "bioExprLogLogitSampled.h"
+#include "bioExprLogNested.h"
+#include "bioExprLogCnl.h"
+#include "bioExprLogMev.h"
+#include "bioExprLogLatentClass.h"
 #include "bioExprLinearUtility.h"
 #include "bioExprNumeric.h"
 #include "bioExprDerive.h"
 #include "bioExprDraws.h"
 #include "bioExprMontecarlo.h"
 #include "bioExprNormalCdf.h"
+#include "bioExprNormalPdf.h"
 #include "bioExprPanelTrajectory.h"
 #include "bioExprRandomVariable.h"
 #include "bioExprIntegrate.h"
+#include "bioExprMultipleIntegrate.h"
 #include "bioExprMin.h"
 #include "bioExprMax.h"
+#include "bioExprMixedLogit.h"
 
-bioFormula::bioFormula(std::vector<bioString> expressionsStrings) {
-  // Process the formulas
-  for (std::vector<bioString>::iterator i = expressionsStrings.begin() ;
-       i != expressionsStrings.end() ;
+bioFormula::bioFormula(std::vector<bioString> expressionsStrings,
+		       bioString cacheDirectory) {
+  std::vector<bioSignatureNode> nodes ;
+  bioUInt root ;
+  if (cacheDirectory.empty()) {
+    root = bioSignatureParser::parseSignatures(expressionsStrings,nodes) ;
+  }
+  else {
+    bioModelCache theCache(cacheDirectory,expressionsStrings) ;
+    if (!theCache.load(nodes,root)) {
+      root = bioSignatureParser::parseSignatures(expressionsStrings,nodes) ;
+      theCache.save(nodes,root) ;
+    }
+  }
+  expressions.reserve(nodes.size()) ;
+  theNodes.reserve(nodes.size()) ;
+  for (std::vector<bioSignatureNode>::iterator i = nodes.begin() ;
+       i != nodes.end() ;
+       ++i) {
+    theNodes[i->id] = &(*i) ;
+  }
+  // The children always appear before their parents.
+  for (std::vector<bioSignatureNode>::iterator i = nodes.begin() ;
+       i != nodes.end() ;
        ++i) {
-    // As the formula is the last in the list, it will
-    // be correct at the end of the loop. The other assignments do not
-    // matter.
-    theFormula = processFormula(*i) ;
+    buildExpression(*i) ;
+  }
+  theNodes.clear() ;
+  if (!nodes.empty()) {
+    theFormula = getChild(root) ;
   }
 }
 
 bioFormula::~bioFormula() {
 }
 
-bioSmartPointer<bioExpression> bioFormula::processFormula(bioString f) {
+bioSmartPointer<bioExpression> bioFormula::getChild(bioUInt id) const {
+  std::unordered_map<bioUInt, bioSmartPointer<bioExpression> >::const_iterator found = expressions.find(id) ;
+  if (found == expressions.end()) {
+    std::stringstream str ;
+    str << "No expression number: " << id ;
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  return found->second ;
+}
+
+bioSmartPointer<bioExpression> bioFormula::buildExpression(const bioSignatureNode& node) {
   bioSmartPointer<bioExpression> theExpression ;
-  bioString typeOfExpression = extractParentheses('<','>',f) ;
-  bioString id = extractParentheses('{','}',f) ;
-  std::map<bioString, bioSmartPointer<bioExpression> >::iterator found = expressions.find(id) ;
-  if (found != expressions.end()) {
-    // The expression has already been processed
-    return found->second ;
-  }
-  if (typeOfExpression == "Beta") {
-    bioString name = extractParentheses('"','"',f) ;
-    bioUInt status = std::stoi(extractParentheses('[',']',f)) ;
-    std::vector<bioString> items = split(f,',') ;
-    bioUInt uniqueId = std::stoi(items[1]) ;
-    bioUInt parameterId = std::stoi(items[2]) ;
-    if (status == 0) {
-      theExpression = bioSmartPointer<bioExpression>(new bioExprFreeParameter(uniqueId,parameterId,name)) ;
+  const std::vector<bioUInt>& c = node.children ;
+  switch (node.type) {
+  case bioNodeBeta:
+    if (node.status == 0) {
+      theExpression = bioSmartPointer<bioExpression>(new bioExprFreeParameter(node.integers[0],node.integers[1],node.name)) ;
     }
     else {
-      theExpression = bioSmartPointer<bioExpression>(new bioExprFixedParameter(uniqueId,parameterId,name)) ;
-    }
-    expressions[id] = theExpression ;
-    literals[id] = theExpression ;
-    return theExpression ;
-  }
-  if (typeOfExpression == "Variable" ||
-      typeOfExpression == "DefineVariable") {
-    bioString name = extractParentheses('"','"',f) ;
-    std::vector<bioString> items = split(f,',') ;
-    bioUInt uniqueId = std::stoi(items[1]) ;
-    bioUInt variableId = std::stoi(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprVariable(uniqueId,variableId,name)) ;
-    expressions[id] = theExpression ;
-    literals[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "bioDraws") {
-    bioString name = extractParentheses('"','"',f) ;
-    std::vector<bioString> items = split(f,',') ;
-    bioUInt uniqueId = std::stoi(items[1]) ;
-    bioUInt drawId = std::stoi(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprDraws(uniqueId,drawId,name)) ;
-    expressions[id] = theExpression ;
-    literals[id] = theExpression ;
-    return theExpression ;
-    
-  }
-  else if (typeOfExpression == "RandomVariable") {
-    bioString name = extractParentheses('"','"',f) ;
-    std::vector<bioString> items = split(f,',') ;
-    bioUInt uniqueId = std::stoi(items[1]) ;
-    bioUInt rvId = std::stoi(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprRandomVariable(uniqueId,rvId,name)) ;
-    expressions[id] = theExpression ;
-    literals[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Numeric") {
-    std::vector<bioString> items = split(f,',') ;
-    bioReal v = std::stof(items[1]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprNumeric(v)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Plus") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for Plus: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
-    }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString, bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString, bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprPlus(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Minus") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for Plus: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
-    }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString, bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString, bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprMinus(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Times") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for Plus: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
-    }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString, bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString, bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprTimes(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Divide") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for Plus: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+      theExpression = bioSmartPointer<bioExpression>(new bioExprFixedParameter(node.integers[0],node.integers[1],node.name)) ;
     }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprDivide(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Power") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for Plus: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    literals[node.id] = theExpression ;
+    break ;
+  case bioNodeVariable:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprVariable(node.integers[0],node.integers[1],node.name)) ;
+    literals[node.id] = theExpression ;
+    break ;
+  case bioNodeDraws:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprDraws(node.integers[0],node.integers[1],node.name)) ;
+    literals[node.id] = theExpression ;
+    break ;
+  case bioNodeRandomVariable:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprRandomVariable(node.integers[0],node.integers[1],node.name)) ;
+    literals[node.id] = theExpression ;
+    break ;
+  case bioNodeNumeric:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprNumeric(node.value)) ;
+    break ;
+  case bioNodePlus:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprPlus(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeMinus:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprMinus(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeTimes:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprTimes(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeDivide:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprDivide(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodePower:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprPower(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeAnd:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprAnd(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeOr:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprOr(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeEqual:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprEqual(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeNotEqual:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprNotEqual(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeLess:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprLess(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeLessOrEqual:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprLessOrEqual(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeGreater:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprGreater(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeGreaterOrEqual:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprGreaterOrEqual(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeMin:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprMin(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeMax:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprMax(getChild(c[0]),getChild(c[1]))) ;
+    break ;
+  case bioNodeUnaryMinus:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprUnaryMinus(getChild(c[0]))) ;
+    break ;
+  case bioNodeMonteCarlo:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprMontecarlo(getChild(c[0]))) ;
+    break ;
+  case bioNodeNormalCdf:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprNormalCdf(getChild(c[0]))) ;
+    break ;
+  case bioNodeNormalPdf:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprNormalPdf(getChild(c[0]))) ;
+    break ;
+  case bioNodePanelTrajectory:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprPanelTrajectory(getChild(c[0]))) ;
+    break ;
+  case bioNodeExp:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprExp(getChild(c[0]))) ;
+    break ;
+  case bioNodeLog:
+    theExpression = fuseMixedLogit(node) ;
+    if (theExpression == NULL) {
+      theExpression = bioSmartPointer<bioExpression>(new bioExprLog(getChild(c[0]))) ;
     }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprPower(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "And") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for And: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
-    }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprAnd(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Or") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for Or: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
-    }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprOr(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Equal") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for Equal: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
-    }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprEqual(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "NotEqual") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for NotEqual: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    break ;
+  case bioNodeDerive:
+    theExpression = bioSmartPointer<bioExpression>(new bioExprDerive(getChild(c[0]),node.integers[0])) ;
+    break ;
+  case bioNodeIntegrate: {
+    bioUInt order = (node.integers.size() > 1) ? node.integers[1] : bioGhDefaultOrder ;
+    bioBoolean adaptive = (node.integers.size() > 2) && (node.integers[2] != 0) ;
+    bioUInt rvLiteralId = (adaptive) ? findRandomVariable(c[0],node.integers[0]) : bioBadId ;
+    theExpression = bioSmartPointer<bioExpression>(new bioExprIntegrate(getChild(c[0]),node.integers[0],order,adaptive,rvLiteralId)) ;
+    break ;
+  }
+  case bioNodeMultipleIntegrate: {
+    std::vector<bioUInt> rvIds(node.integers.begin()+1,node.integers.end()) ;
+    theExpression = bioSmartPointer<bioExpression>(new bioExprMultipleIntegrate(getChild(c[0]),rvIds,node.integers[0])) ;
+    break ;
+  }
+  case bioNodeLinearUtility: {
+    std::vector<bioLinearTerm> listOfTerms ;
+    for (bioUInt i = 0 ; i < node.integers.size() / 2 ; ++i) {
+      bioLinearTerm aTerm ;
+      aTerm.theBeta = getChild(c[2*i]) ;
+      aTerm.theBetaId = node.integers[2*i] ;
+      aTerm.theBetaName = node.names[2*i] ;
+      aTerm.theVar = getChild(c[2*i+1]) ;
+      aTerm.theVarId = node.integers[2*i+1] ;
+      aTerm.theVarName = node.names[2*i+1] ;
+      listOfTerms.push_back(aTerm) ;
     }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprNotEqual(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Less") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for Less: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    theExpression = bioSmartPointer<bioExpression>(new bioExprLinearUtility(listOfTerms)) ;
+    break ;
+  }
+  case bioNodeLogLogit: {
+    std::map<bioUInt,bioSmartPointer<bioExpression> > theUtils ;
+    std::map<bioUInt,bioSmartPointer<bioExpression> > theAvails ;
+    for (bioUInt i = 0 ; i < node.integers.size() ; ++i) {
+      bioUInt alt = node.integers[i] ;
+      theUtils[alt] = getChild(c[1+2*i]) ;
+      theAvails[alt] = getChild(c[2+2*i]) ;
     }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprLess(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "LessOrEqual") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for LessOrEqual: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    theExpression = bioSmartPointer<bioExpression>(new bioExprLogLogit(getChild(c[0]),theUtils,theAvails)) ;
+    break ;
+  }
+  case bioNodeLogLogitFullChoiceSet: {
+    std::map<bioUInt,bioSmartPointer<bioExpression> > theUtils ;
+    for (bioUInt i = 0 ; i < node.integers.size() ; ++i) {
+      theUtils[node.integers[i]] = getChild(c[1+2*i]) ;
     }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprLessOrEqual(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Greater") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for Greater: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    theExpression = bioSmartPointer<bioExpression>(new bioExprLogLogitFullChoiceSet(getChild(c[0]),theUtils)) ;
+    break ;
+  }
+  case bioNodeLogLogitSampled: {
+    std::map<bioUInt,bioSmartPointer<bioExpression> > theUtils ;
+    std::map<bioUInt,bioSmartPointer<bioExpression> > theAvails ;
+    std::map<bioUInt,bioReal> theWeights ;
+    for (bioUInt i = 0 ; i < node.reals.size() ; ++i) {
+      bioUInt alt = node.integers[2+i] ;
+      theUtils[alt] = getChild(c[1+2*i]) ;
+      theAvails[alt] = getChild(c[2+2*i]) ;
+      theWeights[alt] = node.reals[i] ;
     }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprGreater(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "GreaterOrEqual") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for GreaterOrEqual: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    theExpression = bioSmartPointer<bioExpression>(new bioExprLogLogitSampled(getChild(c[0]),theUtils,theAvails,theWeights,node.integers[0],node.integers[1])) ;
+    break ;
+  }
+  case bioNodeLogNested: {
+    std::map<bioUInt,bioSmartPointer<bioExpression> > theUtils ;
+    std::map<bioUInt,bioSmartPointer<bioExpression> > theAvails ;
+    bioUInt n = node.integers[0] ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      bioUInt alt = node.integers[1+i] ;
+      theUtils[alt] = getChild(c[2+2*i]) ;
+      theAvails[alt] = getChild(c[3+2*i]) ;
     }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprGreaterOrEqual(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "bioMin") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for bioMin: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    std::vector<bioNest> theNests ;
+    bioUInt k = 1 + n ;
+    for (bioUInt m = 2 + 2 * n ; m < c.size() ; ++m) {
+      bioNest aNest ;
+      aNest.theParameter = getChild(c[m]) ;
+      bioUInt nbrOfAlts = node.integers[k++] ;
+      aNest.theAlternatives.assign(node.integers.begin()+k,node.integers.begin()+k+nbrOfAlts) ;
+      k += nbrOfAlts ;
+      theNests.push_back(aNest) ;
     }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprMin(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "bioMax") {
-    bioString strChildren = extractParentheses('(',')',f) ;
-    bioUInt children = std::stoi(strChildren) ;
-    if (children != 2) {
-      std::stringstream str ;
-      str << "Incorrect number of children for bioMax: " << children ;
-      throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+    theExpression = bioSmartPointer<bioExpression>(new bioExprLogNested(getChild(c[0]),theUtils,theAvails,getChild(c[1]),theNests)) ;
+    break ;
+  }
+  case bioNodeLogCnl: {
+    std::map<bioUInt,bioSmartPointer<bioExpression> > theUtils ;
+    std::map<bioUInt,bioSmartPointer<bioExpression> > theAvails ;
+    bioUInt n = node.integers[0] ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      bioUInt alt = node.integers[1+i] ;
+      theUtils[alt] = getChild(c[2+2*i]) ;
+      theAvails[alt] = getChild(c[3+2*i]) ;
     }
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fl = expressions.find(items[1]) ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator fr = expressions.find(items[2]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprMax(fl->second,fr->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "UnaryMinus") {
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator e = expressions.find(items[1]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprUnaryMinus(e->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "MonteCarlo") {
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator e = expressions.find(items[1]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprMontecarlo(e->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "bioNormalCdf") {
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator e = expressions.find(items[1]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprNormalCdf(e->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "PanelLikelihoodTrajectory") {
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator e = expressions.find(items[1]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprPanelTrajectory(e->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "exp") {
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator e = expressions.find(items[1]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprExp(e->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Derive") {
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator e = expressions.find(items[1]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprDerive(e->second,bioUInt(std::stoi(items[2])))) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "Integrate") {
-    std::vector<bioString> items = split(f,',') ;
-    
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator e = expressions.find(items[1]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprIntegrate(e->second,bioUInt(std::stoi(items[2])))) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "log") {
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator e = expressions.find(items[1]) ;
-    theExpression = bioSmartPointer<bioExpression>(new bioExprLog(e->second)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "bioLinearUtility") {
-    bioString strNbrTerms = extractParentheses('(',')',f) ;
-    bioUInt nbrTerms = std::stoi(strNbrTerms) ;
-    std::vector<bioString> terms = split(f,',') ;
-    std::vector<bioLinearTerm> listOfTerms ;
-    for (bioUInt i = 0 ; i < nbrTerms ; ++i) {
-      bioLinearTerm aTerm ;
-      aTerm.theBeta = expressions.find(terms[i*6+1])->second ;
-      aTerm.theBetaId = std::stoi(terms[i*6+2]) ;
-      aTerm.theBetaName = terms[i*6+3] ;
-      aTerm.theVar = expressions.find(terms[i*6+4])->second ;
-      aTerm.theVarId = std::stoi(terms[i*6+5]) ;
-      aTerm.theVarName = terms[i*6+6] ;
-      listOfTerms.push_back(aTerm) ;
+    std::vector<bioCrossNest> theNests ;
+    bioUInt k = 1 + n ;
+    bioUInt child = 2 + 2 * n ;
+    while (child < c.size()) {
+      bioCrossNest aNest ;
+      aNest.theParameter = getChild(c[child++]) ;
+      bioUInt nbrOfAlts = node.integers[k++] ;
+      for (bioUInt i = 0 ; i < nbrOfAlts ; ++i) {
+	aNest.theAlternatives.push_back(node.integers[k++]) ;
+	aNest.theAlphas.push_back(getChild(c[child++])) ;
+      }
+      theNests.push_back(aNest) ;
     }
-    theExpression = bioSmartPointer<bioExpression>(new bioExprLinearUtility(listOfTerms)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "_bioLogLogit") {
-    bioString strNbrUtil = extractParentheses('(',')',f) ;
-    bioUInt nbrUtil = std::stoi(strNbrUtil) ;
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator choice = expressions.find(items[1]) ;
+    theExpression = bioSmartPointer<bioExpression>(new bioExprLogCnl(getChild(c[0]),theUtils,theAvails,getChild(c[1]),theNests)) ;
+    break ;
+  }
+  case bioNodeLogMev: {
     std::map<bioUInt,bioSmartPointer<bioExpression> > theUtils ;
     std::map<bioUInt,bioSmartPointer<bioExpression> > theAvails ;
-    for (bioUInt i = 0 ; i < nbrUtil ; ++i) {
-      bioUInt alt = std::stoi(items[2+3*i]) ;
-      std::map<bioString,bioSmartPointer<bioExpression> >::iterator u = expressions.find(items[2+3*i+1]) ;
-      theUtils[alt] = u->second ;
-      std::map<bioString,bioSmartPointer<bioExpression> >::iterator a = expressions.find(items[2+3*i+2]) ;
-      theAvails[alt] = a->second ;
-      
+    std::map<bioUInt,bioSmartPointer<bioExpression> > theCorrections ;
+    bioUInt n = node.integers[0] ;
+    bioBoolean correction = (node.integers[1] != 0) ;
+    bioUInt child = 1 ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      bioUInt alt = node.integers[2+i] ;
+      theUtils[alt] = getChild(c[child++]) ;
+      theAvails[alt] = getChild(c[child++]) ;
+      if (correction) {
+	theCorrections[alt] = getChild(c[child++]) ;
+      }
     }
-
-    theExpression = bioSmartPointer<bioExpression>(new bioExprLogLogit(choice->second,theUtils,theAvails)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "_bioLogLogitFullChoiceSet") {
-    bioString strNbrUtil = extractParentheses('(',')',f) ;
-    bioUInt nbrUtil = std::stoi(strNbrUtil) ;
-    std::vector<bioString> items = split(f,',') ;
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator choice = expressions.find(items[1]) ;
-    std::map<bioUInt,bioSmartPointer<bioExpression> > theUtils ;
-    for (bioUInt i = 0 ; i < nbrUtil ; ++i) {
-      bioUInt alt = std::stoi(items[2+3*i]) ;
-      std::map<bioString,bioSmartPointer<bioExpression> >::iterator u = expressions.find(items[2+3*i+1]) ;
-      theUtils[alt] = u->second ;
+    std::vector<bioMevNode> theMevNodes ;
+    bioUInt k = 2 + n ;
+    while (child < c.size()) {
+      bioMevNode aNode ;
+      aNode.theParameter = getChild(c[child++]) ;
+      bioUInt nbrOfSuccessors = node.integers[k++] ;
+      for (bioUInt i = 0 ; i < nbrOfSuccessors ; ++i) {
+	aNode.isAlternative.push_back(node.integers[k++] != 0) ;
+	aNode.theSuccessors.push_back(node.integers[k++]) ;
+	aNode.theAlphas.push_back(getChild(c[child++])) ;
+      }
+      theMevNodes.push_back(aNode) ;
+    }
+    theExpression = bioSmartPointer<bioExpression>(new bioExprLogMev(getChild(c[0]),theUtils,theAvails,theCorrections,theMevNodes)) ;
+    break ;
+  }
+  case bioNodeLogLatentClass: {
+    std::vector<bioSmartPointer<bioExpression> > theMembership ;
+    std::vector<bioSmartPointer<bioExpression> > theModels ;
+    for (bioUInt i = 0 ; i + 1 < c.size() ; i += 2) {
+      theMembership.push_back(getChild(c[i])) ;
+      theModels.push_back(getChild(c[i+1])) ;
     }
-    theExpression = bioSmartPointer<bioExpression>(new bioExprLogLogitFullChoiceSet(choice->second,theUtils)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
-  }
-  else if (typeOfExpression == "bioMultSum") {
-    bioString strNbrTerms = extractParentheses('(',')',f) ;
-    bioUInt nbrTerms = std::stoi(strNbrTerms) ;
-    std::vector<bioString> items = split(f,',') ;
+    theExpression = bioSmartPointer<bioExpression>(new bioExprLogLatentClass(theMembership,theModels,node.integers[0] != 0)) ;
+    break ;
+  }
+  case bioNodeMultSum: {
     std::vector<bioSmartPointer<bioExpression> > theExpressions ;
-    for (bioUInt i = 0 ; i < nbrTerms ; ++i) {
-      std::map<bioString,bioSmartPointer<bioExpression> >::iterator u = expressions.find(items[1+i]) ;
-      theExpressions.push_back(u->second) ;
+    for (bioUInt i = 0 ; i < c.size() ; ++i) {
+      theExpressions.push_back(getChild(c[i])) ;
     }
-
     theExpression = bioSmartPointer<bioExpression>(new bioExprMultSum(theExpressions)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
+    break ;
   }
-  else if (typeOfExpression == "Elem") {
-    bioString strNbrExpr = extractParentheses('(',')',f) ;
-    bioUInt nbrExpr = std::stoi(strNbrExpr) ;
-    std::vector<bioString> items = split(f,',') ;
-
-    
-    std::map<bioString,bioSmartPointer<bioExpression> >::iterator key = expressions.find(items[1]) ;
+  case bioNodeElem: {
     std::map<bioUInt,bioSmartPointer<bioExpression> > theExpressions ;
-    for (bioUInt i = 0 ; i < nbrExpr ; ++i) {
-      bioUInt alt = std::stoi(items[2+2*i]) ;
-      std::map<bioString,bioSmartPointer<bioExpression> >::iterator e = expressions.find(items[2+2*i+1]) ;
-      if (e == expressions.end()) {
-	std::stringstream str ;
-	str << "No expression number: " << items[2+2*i] ;
-	throw bioExceptions(__FILE__,__LINE__,str.str()) ;
-      }
-      theExpressions[alt] = e->second ;
-      
+    for (bioUInt i = 0 ; i < node.integers.size() ; ++i) {
+      theExpressions[node.integers[i]] = getChild(c[1+i]) ;
     }
-
-    theExpression = bioSmartPointer<bioExpression>(new bioExprElem(key->second,theExpressions)) ;
-    expressions[id] = theExpression ;
-    return theExpression ;
+    theExpression = bioSmartPointer<bioExpression>(new bioExprElem(getChild(c[0]),theExpressions)) ;
+    break ;
   }
-  else {
+  default: {
     std::stringstream str ;
-    str << "Unknown expression: " << typeOfExpression << ": " << f ;
+    str << "Unknown expression type " << node.type << " for expression " << node.id ;
     throw bioExceptions(__FILE__,__LINE__,str.str()) ;
   }
-      
+  }
+  // The children have been built before, so that their dependency
+  // on the draws is already known.
+  theExpression->updateDrawDependency() ;
+  expressions[node.id] = theExpression ;
   return theExpression ;
 }
 
+bioUInt bioFormula::findRandomVariable(bioUInt id, bioUInt rvId) const {
+  std::vector<bioUInt> stack(1,id) ;
+  std::unordered_set<bioUInt> visited ;
+  while (!stack.empty()) {
+    bioUInt current = stack.back() ;
+    stack.pop_back() ;
+    std::unordered_map<bioUInt, const bioSignatureNode*>::const_iterator found = theNodes.find(current) ;
+    if (found == theNodes.end() || !visited.insert(current).second) {
+      continue ;
+    }
+    const bioSignatureNode* node = found->second ;
+    if (node->type == bioNodeRandomVariable && node->integers[1] == rvId) {
+      return node->integers[0] ;
+    }
+    stack.insert(stack.end(),node->children.begin(),node->children.end()) ;
+  }
+  return bioBadId ;
+}
+
+bioUInt bioFormula::getNodeType(bioUInt id) const {
+  std::unordered_map<bioUInt, const bioSignatureNode*>::const_iterator found = theNodes.find(id) ;
+  if (found == theNodes.end()) {
+    return bioBadId ;
+  }
+  return found->second->type ;
+}
+
+bioSmartPointer<bioExpression> bioFormula::fuseMixedLogit(const bioSignatureNode& node) const {
+  // log(MonteCarlo([PanelLikelihoodTrajectory](exp(logit))))
+  bioSmartPointer<bioExpression> noMatch(NULL) ;
+  bioUInt integralId = node.children[0] ;
+  if (getNodeType(integralId) != bioNodeMonteCarlo) {
+    return noMatch ;
+  }
+  bioUInt id = theNodes.at(integralId)->children[0] ;
+  bioBoolean panel = (getNodeType(id) == bioNodePanelTrajectory) ;
+  if (panel) {
+    id = theNodes.at(id)->children[0] ;
+  }
+  if (getNodeType(id) != bioNodeExp) {
+    return noMatch ;
+  }
+  id = theNodes.at(id)->children[0] ;
+  bioUInt type = getNodeType(id) ;
+  if (type != bioNodeLogLogit && type != bioNodeLogLogitFullChoiceSet) {
+    return noMatch ;
+  }
+  return bioSmartPointer<bioExpression>(new bioExprMixedLogit(getChild(id),getChild(integralId),panel)) ;
+}
+
 bioSmartPointer<bioExpression>  bioFormula::getExpression() {
   return theFormula ;
 }
 
 void bioFormula::setParameters(std::vector<bioReal>* p) {
-  for (std::map<bioString,bioSmartPointer<bioExpression> >::iterator i = literals.begin() ;
+  for (std::unordered_map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = literals.begin() ;
        i != literals.end() ;
        ++i) {
     i->second->setParameters(p) ;
@@ -529,7 +451,7 @@ void bioFormula::setParameters(std::vector<bioReal>* p) {
 }
 
 void bioFormula::setFixedParameters(std::vector<bioReal>* p) {
-  for (std::map<bioString,bioSmartPointer<bioExpression> >::iterator i = literals.begin() ;
+  for (std::unordered_map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = literals.begin() ;
        i != literals.end() ;
        ++i) {
     i->second->setFixedParameters(p) ;
@@ -538,16 +460,32 @@ void bioFormula::setFixedParameters(std::vector<bioReal>* p) {
 }
 
 
-void bioFormula::setDraws(std::vector< std::vector< std::vector<bioReal> > >* d) {
-  for (std::map<bioString,bioSmartPointer<bioExpression> >::iterator i = expressions.begin() ;
+void bioFormula::setDraws(const bioDrawTable* d) {
+  for (std::unordered_map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = expressions.begin() ;
        i != expressions.end() ;
        ++i) {
     i->second->setDraws(d) ;
   }
 }
 
+void bioFormula::setDrawGenerator(const bioDrawGenerator* g) {
+  for (std::unordered_map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = expressions.begin() ;
+       i != expressions.end() ;
+       ++i) {
+    i->second->setDrawGenerator(g) ;
+  }
+}
+
+void bioFormula::setNumberOfDraws(bioUInt r) {
+  for (std::unordered_map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = expressions.begin() ;
+       i != expressions.end() ;
+       ++i) {
+    i->second->setNumberOfDraws(r) ;
+  }
+}
+
 void bioFormula::setData(std::vector< std::vector<bioReal> >* d) {
-  for (std::map<bioString,bioSmartPointer<bioExpression> >::iterator i = expressions.begin() ;
+  for (std::unordered_map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = expressions.begin() ;
        i != expressions.end() ;
        ++i) {
     i->second->setData(d) ;
@@ -555,7 +493,7 @@ void bioFormula::setData(std::vector< std::vector<bioReal> >* d) {
 }
 
 void bioFormula::setMissingData(bioReal md) {
-  for (std::map<bioString,bioSmartPointer<bioExpression> >::iterator i = expressions.begin() ;
+  for (std::unordered_map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = expressions.begin() ;
        i != expressions.end() ;
        ++i) {
     i->second->setMissingData(md) ;
@@ -564,27 +502,18 @@ void bioFormula::setMissingData(bioReal md) {
 
 
 void bioFormula::setDataMap(std::vector< std::vector<bioUInt> >* dm) {
-  for (std::map<bioString,bioSmartPointer<bioExpression> >::iterator i = expressions.begin() ;
+  for (std::unordered_map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = expressions.begin() ;
        i != expressions.end() ;
        ++i) {
     i->second->setDataMap(dm) ;
   }
 }
 
-void bioFormula::setRowIndex(bioUInt* r) {
-  for (std::map<bioString,bioSmartPointer<bioExpression> >::iterator e = expressions.begin() ;
-       e != expressions.end() ;
-       ++e) {
-    e->second->setRowIndex(r) ;
-  }
-
-}
-
-void bioFormula::setIndividualIndex(bioUInt* i) {
-  for (std::map<bioString,bioSmartPointer<bioExpression> >::iterator e = expressions.begin() ;
-       e != expressions.end() ;
-       ++e) {
-    e->second->setIndividualIndex(i) ;
+void bioFormula::prepareData() {
+  for (std::unordered_map<bioUInt,bioSmartPointer<bioExpression> >::iterator i = expressions.begin() ;
+       i != expressions.end() ;
+       ++i) {
+    i->second->prepareData() ;
   }
 }
 
@@ -11,32 +11,53 @@
 #define bioFormula_h
 
 #include <vector>
-#include <map>
+#include <unordered_map>
 #include "bioSmartPointer.h"
 #include "bioTypes.h"
 #include "bioString.h"
 
 class bioExpression ;
+class bioSignatureNode ;
+class bioDrawGenerator ;
+class bioDrawTable ;
 
 class bioFormula {
   friend std::ostream& operator<<(std::ostream &str, const bioFormula& x) ;
 
  public:
-  bioFormula(std::vector<bioString> expressionsStrings) ;
+  // If a cache directory is provided, the parsed signatures are
+  // read from it when available, and stored in it otherwise.
+  bioFormula(std::vector<bioString> expressionsStrings,
+	     bioString cacheDirectory = bioString()) ;
   ~bioFormula() ;
   bioSmartPointer<bioExpression> getExpression() ;
   void setParameters(std::vector<bioReal>* p) ;
   void setFixedParameters(std::vector<bioReal>* p) ;
-  void setRowIndex(bioUInt* r) ;
-  void setIndividualIndex(bioUInt* i) ;
   void setData(std::vector< std::vector<bioReal> >* d) ;
   void setMissingData(bioReal md) ;
   void setDataMap(std::vector< std::vector<bioUInt> >* dm) ;
-  void setDraws(std::vector< std::vector< std::vector<bioReal> > >* d) ;
+  void setDraws(const bioDrawTable* d) ;
+  void setDrawGenerator(const bioDrawGenerator* g) ;
+  void setNumberOfDraws(bioUInt r) ;
+  // Must be called once the data, the data map and the missing value
+  // have been set.
+  void prepareData() ;
  private:
-  bioSmartPointer<bioExpression> processFormula(bioString f) ;
-  std::map<bioString, bioSmartPointer<bioExpression> > expressions ;
-  std::map<bioString, bioSmartPointer<bioExpression> > literals ;
+  bioSmartPointer<bioExpression> buildExpression(const bioSignatureNode& node) ;
+  bioSmartPointer<bioExpression> getChild(bioUInt id) const ;
+  // Returns a bioExprMixedLogit if the node is the log of a mixed
+  // logit, or of a panel mixed logit. Returns NULL otherwise.
+  bioSmartPointer<bioExpression> fuseMixedLogit(const bioSignatureNode& node) const ;
+  // Literal id of the random variable rvId in the expression id, or
+  // bioBadId if it does not appear.
+  bioUInt findRandomVariable(bioUInt id, bioUInt rvId) const ;
+  // Type of the signature node, or bioBadId if it is not known.
+  bioUInt getNodeType(bioUInt id) const ;
+  // The expressions are indexed by the id of their signature.
+  std::unordered_map<bioUInt, bioSmartPointer<bioExpression> > expressions ;
+  std::unordered_map<bioUInt, bioSmartPointer<bioExpression> > literals ;
+  // Signature nodes, available only while the formula is built.
+  std::unordered_map<bioUInt, const bioSignatureNode*> theNodes ;
   bioSmartPointer<bioExpression> theFormula ;
   bioReal missingData ;
 
@@ -8,53 +8,207 @@
 //-------------------------------------------------------------------
 
 #include "bioGaussHermite.h"
+#include <sstream>
 #include "bioExceptions.h"
 
-bioGaussHermite::bioGaussHermite(bioGhFunction* f) : 
-  theFunction(f) {
+// Positive nodes z of the Gauss-Hermite rules, and the corresponding
+// weights multiplied by exp(z*z), so that the rules apply directly to
+// the function to integrate. The rules are symmetric. The values
+// have been calculated with 60 significant digits, by Newton's method
+// on the normalized Hermite polynomials.
 
-}
+// 10 points
+static constexpr bioReal bioGhNodes10[] = {
+    3.42901327223704608789e-01,    1.03661082978951365418e+00,
+    1.75668364929988177345e+00,    2.53273167423278979641e+00,
+    3.43615911883773760333e+00
+} ;
+static constexpr bioReal bioGhWeights10[] = {
+    6.87081853951273362687e-01,    7.03296323104906170098e-01,
+    7.41441931943564970082e-01,    8.20666126404816614572e-01,
+    1.02545169136573723302e+00
+} ;
 
-std::vector<bioReal> bioGaussHermite::integrate() {
+// 20 points
+static constexpr bioReal bioGhNodes20[] = {
+    2.45340708300901249904e-01,    7.37473728545394358706e-01,
+    1.23407621539532300789e+00,    1.73853771211658620678e+00,
+    2.25497400208927552308e+00,    2.78880605842813048053e+00,
+    3.34785456738321632691e+00,    3.94476404011562521038e+00,
+    4.60368244955074427308e+00,    5.38748089001123286202e+00
+} ;
+static constexpr bioReal bioGhWeights20[] = {
+    4.90921500666745824280e-01,    4.93843385272052927815e-01,
+    4.99920871336290517265e-01,    5.09679027117458006673e-01,
+    5.24080350948557612677e-01,    5.44851742364520005199e-01,
+    5.75262442852503182139e-01,    6.22278696191412280649e-01,
+    7.04332961176942408714e-01,    8.98591961453191416421e-01
+} ;
 
-  if (theFunction == NULL) {
-      throw bioExceptNullPointer(__FILE__,__LINE__,"Function to integrate.") ;
-  }
+// 30 points
+static constexpr bioReal bioGhNodes30[] = {
+    2.01128576548871485546e-01,    6.03921058625552307778e-01,
+    1.00833827104672346180e+00,    1.41552780019818851194e+00,
+    1.82674114360368803884e+00,    2.24339146776150407247e+00,
+    2.66713212453561720057e+00,    3.09997052958644174869e+00,
+    3.54444387315534988693e+00,    4.00390860386122881523e+00,
+    4.48305535709251834189e+00,    4.98891896858994394449e+00,
+    5.53314715156749572512e+00,    6.13827922012393462039e+00,
+    6.86334529352989158106e+00
+} ;
+static constexpr bioReal bioGhWeights30[] = {
+    4.02346066701902927115e-01,    4.03419816924804022553e-01,
+    4.05605123325684436312e-01,    4.08981575003531602497e-01,
+    4.13679363611138937184e-01,    4.19895003736824088642e-01,
+    4.27918062932743748583e-01,    4.38177022652683703695e-01,
+    4.51321035991188621287e-01,    4.68374812564728816775e-01,
+    4.91057995832882696506e-01,    5.22525689331354549642e-01,
+    5.69402691949640503966e-01,    6.49097981554266700710e-01,
+    8.34247471012761795341e-01
+} ;
+
+// 50 points
+static constexpr bioReal bioGhNodes50[] = {
+    1.56302546889468675438e-01,    4.69059056678236086244e-01,
+    7.82271729554606885812e-01,    1.09625112895768164235e+00,
+    1.41131775489830006202e+00,    1.72780654751589855853e+00,
+    2.04607196868640920785e+00,    2.36649390429866382890e+00,
+    2.68948470226774507255e+00,    3.01549776957452241886e+00,
+    3.34503831393789109022e+00,    3.67867706251526928172e+00,
+    4.01706817285813438788e+00,    4.36097316045457866432e+00,
+    4.71129366616904278739e+00,    5.06911758491723503245e+00,
+    5.43578608722494814162e+00,    5.81299467542040605916e+00,
+    6.20295251927467161631e+00,    6.60864797385535900613e+00,
+    7.03432350977061064881e+00,    7.48640942986419426682e+00,
+    7.97562236820563655424e+00,    8.52277103091780418914e+00,
+    9.18240695812931736635e+00
+} ;
+static constexpr bioReal bioGhWeights50[] = {
+    3.12630298030359122647e-01,    3.12933448052389891275e-01,
+    3.13543589989641610831e-01,    3.14468550882471921551e-01,
+    3.15720440230093698585e-01,    3.17316124349604325531e-01,
+    3.19277915993180742134e-01,    3.21634537962055979507e-01,
+    3.24422448708866826890e-01,    3.27687661354606419534e-01,
+    3.31488254247521860023e-01,    3.35897876837685552073e-01,
+    3.41010727258747850608e-01,    3.46948769599378382046e-01,
+    3.53872469979461721026e-01,    3.61997265091617450788e-01,
+    3.71619771249915029427e-01,    3.83161392196479354785e-01,
+    3.97244943775846314870e-01,    4.14838821059022496638e-01,
+    4.37553282300047559509e-01,    4.68326211942547493013e-01,
+    5.13304797851540889529e-01,    5.88605297377289840259e-01,
+    7.61348691118076750299e-01
+} ;
 
-  std::vector<bioReal> integral(theFunction->getSize(),0.0);
-  const bioReal *pA = &A[NUM_OF_POSITIVE_ZEROS];
-  const bioReal *px;
-  
-  for (px = &x[NUM_OF_POSITIVE_ZEROS - 1]; px >= x; px--) {
-    std::vector<bioReal> t1 = theFunction->getUnweightedValue(*px) ;
-    std::vector<bioReal> t2 = theFunction->getUnweightedValue(- *px) ;
-    bioReal p  = *(--pA) ;
-    for (bioUInt i = 0 ; i < integral.size() ; ++i) {
-      integral[i] +=  p * ( t1[i] + t2[i] );
+// 100 points
+static constexpr bioReal bioGhNodes100[] = {
+    1.10795872422439482888e-01,    3.32414692342231807046e-01,
+    5.54114823591616988233e-01,    7.75950761540145781975e-01,
+    9.97977436098105243924e-01,    1.22025039121895305882e+00,
+    1.44282597021593278770e+00,    1.66576150874150946987e+00,
+    1.88911553742700837149e+00,    2.11294799637118795203e+00,
+    2.33732046390687850501e+00,    2.56229640237260802506e+00,
+    2.78794142398198931319e+00,    3.01432358033115551672e+00,
+    3.24151367963101295036e+00,    3.46958563641858916977e+00,
+    3.69861685931849193980e+00,    3.92868868342767097201e+00,
+    4.15988685513103054007e+00,    4.39230207868268401674e+00,
+    4.62603063578715577307e+00,    4.86117509179121021005e+00,
+    5.09784510508913624700e+00,    5.33615836013836049728e+00,
+    5.57624164932992410330e+00,    5.81823213520351704736e+00,
+    6.06227883261430263867e+00,    6.30854436111213512164e+00,
+    6.55720703192153931598e+00,    6.80846335285879641448e+00,
+    7.06253106024886543747e+00,    7.31965282230453531633e+00,
+    7.58010080785748888429e+00,    7.84418238446082116879e+00,
+    8.11224731116279191721e+00,    8.38469694041626507509e+00,
+    8.66199616813451771438e+00,    8.94468921732547447880e+00,
+    9.23342089021916155048e+00,    9.52896582339011480470e+00,
+    9.83226980777796909436e+00,    1.01445099412928454699e+01,
+    1.04671854213428121418e+01,    1.08022607536847145948e+01,
+    1.11524043855851252649e+01,    1.15214154007870302417e+01,
+    1.19150619431141658020e+01,    1.23429642228596742951e+01,
+    1.28237997494878089063e+01,    1.34064873381449101385e+01
+} ;
+static constexpr bioReal bioGhWeights100[] = {
+    2.21596255924183270221e-01,    2.21650420411515547110e-01,
+    2.21758921729023785805e-01,    2.21922106165498110136e-01,
+    2.22140497191773490166e-01,    2.22414800390544350900e-01,
+    2.22745910173357235135e-01,    2.23134918413968496565e-01,
+    2.23583125167177609196e-01,    2.24092051687791109734e-01,
+    2.24663456017245197001e-01,    2.25299351467708196188e-01,
+    2.26002028407800085009e-01,    2.26774079843685723664e-01,
+    2.27618431398402065643e-01,    2.28538376426246803542e-01,
+    2.29537617164869894481e-01,    2.30620313034512848758e-01,
+    2.31791137453703842101e-01,    2.33055344869710310074e-01,
+    2.34418850121758228317e-01,    2.35888322794699254658e-01,
+    2.37471299920461647511e-01,    2.39176321299559035959e-01,
+    2.41013092922387224180e-01,    2.42992685579107730478e-01,
+    2.45127777913567834895e-01,    2.47432956126835293416e-01,
+    2.49925086601289282222e-01,    2.52623783391417573284e-01,
+    2.55552000562019435280e-01,    2.58736790904380865771e-01,
+    2.62210289443758959518e-01,    2.66011005285956696413e-01,
+    2.70185543533990787703e-01,    2.74790938326829146069e-01,
+    2.79897872545084658580e-01,    2.85595214531367884937e-01,
+    2.91996563960276082260e-01,    2.99249958039079093578e-01,
+    3.07552728501673729425e-01,    3.17175110971853859376e-01,
+    3.28499484645457478560e-01,    3.42089262314247145460e-01,
+    3.58818409071112083449e-01,    3.80137438800575955962e-01,
+    4.08688658441901547146e-01,    4.49993171054416590765e-01,
+    5.18506807270200187726e-01,    6.74353552420908143914e-01
+} ;
+
+class bioGhRule {
+public:
+  bioUInt order ;
+  const bioReal* nodes ;
+  const bioReal* weights ;
+} ;
+
+static constexpr bioGhRule bioGhRules[] = {
+  {10,bioGhNodes10,bioGhWeights10},
+  {20,bioGhNodes20,bioGhWeights20},
+  {30,bioGhNodes30,bioGhWeights30},
+  {50,bioGhNodes50,bioGhWeights50},
+  {100,bioGhNodes100,bioGhWeights100}
+} ;
+
+bioGaussHermite::bioGaussHermite(bioGhFunction* f, bioUInt order) : 
+  theFunction(f),
+  nodes(NULL),
+  weights(NULL),
+  numberOfPositiveNodes(0) {
+  for (const bioGhRule& r : bioGhRules) {
+    if (r.order == order) {
+      nodes = r.nodes ;
+      weights = r.weights ;
+      numberOfPositiveNodes = order / 2 ;
+      return ;
     }
   }
-  return integral;
+  std::stringstream str ;
+  str << "Gauss-Hermite quadrature with " << order << " points is not available. Available:" ;
+  for (const bioGhRule& r : bioGhRules) {
+    str << " " << r.order ;
+  }
+  throw bioExceptions(__FILE__,__LINE__,str.str()) ;
 }
 
-void bioGaussHermite::Gauss_Hermite_Coefs_100pts( bioReal coef[]) {
-   const bioReal *pA = &A[NUM_OF_POSITIVE_ZEROS - 1];
-   bioReal *pc = &coef[NUM_OF_ZEROS - 1];
+void bioGaussHermite::integrate(bioReal mu, bioReal scale) {
 
-   for (; pA >= A; pA--)  {
-      *(coef++) =  *pA;
-      *(pc--) = *pA;
-   }   
-}
+  if (theFunction == NULL) {
+      throw bioExceptNullPointer(__FILE__,__LINE__,"Function to integrate.") ;
+  }
 
-void bioGaussHermite::Gauss_Hermite_Zeros_100pts( bioReal zeros[] ) {
-  const bioReal *px = &x[NUM_OF_POSITIVE_ZEROS - 1];
-  bioReal *pz = &zeros[NUM_OF_ZEROS - 1];
-  
-  for (; px >= x; px--)  {
-    *(zeros++) = - *px;
-      *(pz--) = *px;
-  }   
+  // The smallest terms are added first.
+  for (bioUInt i = numberOfPositiveNodes ; i-- > 0 ; ) {
+    bioReal w = scale * weights[i] ;
+    theFunction->addValue(mu + scale * nodes[i],w) ;
+    theFunction->addValue(mu - scale * nodes[i],w) ;
+  }
 }
 
-
-
+std::vector<bioUInt> bioGaussHermite::getAvailableOrders() {
+  std::vector<bioUInt> result ;
+  for (const bioGhRule& r : bioGhRules) {
+    result.push_back(r.order) ;
+  }
+  return result ;
+}
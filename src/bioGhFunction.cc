@@ -7,30 +7,12 @@
 //
 //--------------------------------------------------------------------
 
-#include <cmath>
 #include "bioGhFunction.h"
 
 bioGhFunction::bioGhFunction() {
 
 }
 
+bioGhFunction::~bioGhFunction() {
 
-std::vector<bioReal> bioGhFunction::getUnweightedValue(bioReal x) {
-  if (x*x >= log(bioMaxReal)) {
-    return std::vector<bioReal>(getSize(),bioMaxReal) ;
-  }
-  std::vector<bioReal> result = getValue(x) ;
-  for (std::vector<bioReal>::iterator i = result.begin() ;
-       i != result.end() ;
-       ++i) {
-    if (*i != bioMaxReal) {
-      (*i) *= exp(x*x) ;
-      if (!std::isfinite(*i)) {
-	(*i) = bioMaxReal ;
-      }
-    }
-  }
-  return result ;
 }
-
-
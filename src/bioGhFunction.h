@@ -14,15 +14,17 @@
 #include "bioTypes.h"
 #include "bioConst.h"
 
+// Function integrated by bioGaussHermite. The function accumulates
+// the weighted values itself, so that no memory is allocated for
+// each node.
 class bioGhFunction {
   friend class bioGaussHermite ;
  public:
   bioGhFunction() ;
-  virtual bioUInt getSize() const = PURE_VIRTUAL ;
-  virtual std::vector<bioReal> getValue(bioReal x) = PURE_VIRTUAL ;
+  virtual ~bioGhFunction() ;
  protected:
-  // This function multiplies the function to be integrated by exp(x*x). 
-  virtual std::vector<bioReal> getUnweightedValue(bioReal x) ;
+  // Adds w times the value of the function at x to the integral.
+  virtual void addValue(bioReal x, bioReal w) = PURE_VIRTUAL ;
 
 };
 
@@ -0,0 +1,332 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioModelCache.cc
+// @date   Mon Oct 19 02:31:01 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include "bioModelCache.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <unordered_map>
+#include <unistd.h>
+#include "bioSignatureParser.h"
+#include "bioExceptions.h"
+
+// Must be incremented each time the format of the file, the content
+// of bioSignatureNode, or the list of bioNodeType, is modified.
+static const uint32_t bioCacheVersion = 7 ;
+static const char bioCacheMagic[8] = {'b','i','o','c','a','c','h','e'} ;
+// Detects files written on a machine with another byte order.
+static const uint32_t bioCacheByteOrder = 0x01020304 ;
+
+// Binary input and output of the components of the nodes.
+static void writeInteger(std::ostream& f, uint64_t x) {
+  f.write(reinterpret_cast<const char*>(&x),sizeof(x)) ;
+}
+
+static void writeString(std::ostream& f, const bioString& s) {
+  writeInteger(f,s.size()) ;
+  f.write(s.data(),s.size()) ;
+}
+
+static void writeIntegers(std::ostream& f, const std::vector<bioUInt>& v) {
+  writeInteger(f,v.size()) ;
+  for (std::size_t i = 0 ; i < v.size() ; ++i) {
+    writeInteger(f,v[i]) ;
+  }
+}
+
+static void writeReals(std::ostream& f, const std::vector<bioReal>& v) {
+  writeInteger(f,v.size()) ;
+  if (!v.empty()) {
+    f.write(reinterpret_cast<const char*>(v.data()),v.size()*sizeof(bioReal)) ;
+  }
+}
+
+// Position of a node in the traversal of the expression.
+static bioUInt getRank(const std::unordered_map<bioUInt,bioUInt>& ranks,
+		       bioUInt id) {
+  std::unordered_map<bioUInt,bioUInt>::const_iterator found = ranks.find(id) ;
+  if (found == ranks.end()) {
+    std::stringstream str ;
+    str << "No expression number: " << id ;
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  return found->second ;
+}
+
+// The file is read at once, and decoded from memory. The lengths
+// read from the file are bounded, so that a corrupted file does not
+// trigger a huge allocation.
+class bioCacheReader {
+public:
+  bioCacheReader(const std::vector<char>& b) :
+    current(b.data()), end(b.data()+b.size()) {
+  }
+  bioBoolean read(void* x, std::size_t n) {
+    if (std::size_t(end - current) < n) {
+      return false ;
+    }
+    std::memcpy(x,current,n) ;
+    current += n ;
+    return true ;
+  }
+  bioBoolean readInteger(uint64_t& x) {
+    return read(&x,sizeof(x)) ;
+  }
+  bioBoolean readSize(uint64_t& n, uint64_t maxSize) {
+    return readInteger(n) && n <= maxSize ;
+  }
+  bioBoolean readString(bioString& s, uint64_t maxSize) {
+    uint64_t n ;
+    if (!readSize(n,maxSize) || std::size_t(end - current) < n) {
+      return false ;
+    }
+    s.assign(current,n) ;
+    current += n ;
+    return true ;
+  }
+  bioBoolean readIntegers(std::vector<bioUInt>& v, uint64_t maxSize) {
+    uint64_t n ;
+    if (!readSize(n,maxSize)) {
+      return false ;
+    }
+    v.resize(n) ;
+    for (uint64_t i = 0 ; i < n ; ++i) {
+      uint64_t x ;
+      if (!readInteger(x)) {
+	return false ;
+      }
+      v[i] = x ;
+    }
+    return true ;
+  }
+  bioBoolean readReals(std::vector<bioReal>& v, uint64_t maxSize) {
+    uint64_t n ;
+    if (!readSize(n,maxSize)) {
+      return false ;
+    }
+    v.resize(n) ;
+    return n == 0 || read(v.data(),n*sizeof(bioReal)) ;
+  }
+  bioBoolean atEnd() const {
+    return current == end ;
+  }
+private:
+  const char* current ;
+  const char* end ;
+} ;
+
+bioModelCache::bioModelCache(const bioString& directory,
+			     const std::vector<bioString>& signatures) {
+  // The ids of the expressions are the addresses of the Python
+  // objects, which change from one run to the next. The hash is
+  // therefore computed on a canonical form of the signatures, where
+  // each id is replaced by the rank of the first signature defining
+  // it, that is its position in the traversal of the expression.
+  std::unordered_map<bioString,bioUInt> ranks ;
+  ranks.reserve(signatures.size()) ;
+  std::size_t length = 0 ;
+  for (std::vector<bioString>::const_iterator i = signatures.begin() ;
+       i != signatures.end() ;
+       ++i) {
+    std::size_t start = i->find('{') ;
+    std::size_t stop = i->find('}',start) ;
+    if (start != bioString::npos && stop != bioString::npos) {
+      ranks.emplace(i->substr(start+1,stop-start-1),ranks.size()) ;
+    }
+    length += i->size() + 1 ;
+  }
+  // The separator avoids that two different lists of signatures have
+  // the same concatenation. The ids appear after '{' or ',' and are
+  // followed by '}', ',' or the end of the signature. The quoted
+  // names are not modified.
+  canonicalSignatures.reserve(length) ;
+  for (std::vector<bioString>::const_iterator i = signatures.begin() ;
+       i != signatures.end() ;
+       ++i) {
+    const bioString& sig = *i ;
+    bioBoolean quoted = false ;
+    std::size_t j = 0 ;
+    while (j < sig.size()) {
+      char c = sig[j] ;
+      if (c == '"') {
+	quoted = !quoted ;
+      }
+      else if (!quoted && isdigit(c) && j > 0 &&
+	       (sig[j-1] == '{' || sig[j-1] == ',')) {
+	std::size_t k = j ;
+	while (k < sig.size() && isdigit(sig[k])) {
+	  ++k ;
+	}
+	if (k == sig.size() || sig[k] == '}' || sig[k] == ',') {
+	  std::unordered_map<bioString,bioUInt>::const_iterator found =
+	    ranks.find(sig.substr(j,k-j)) ;
+	  if (found != ranks.end()) {
+	    std::stringstream rank ;
+	    rank << '#' << found->second ;
+	    canonicalSignatures += rank.str() ;
+	    j = k ;
+	    continue ;
+	  }
+	}
+      }
+      canonicalSignatures += c ;
+      ++j ;
+    }
+    canonicalSignatures += '\n' ;
+  }
+  // 64-bit FNV-1a hash
+  uint64_t h = 14695981039346656037ULL ;
+  for (bioString::const_iterator c = canonicalSignatures.begin() ;
+       c != canonicalSignatures.end() ;
+       ++c) {
+    h = (h ^ static_cast<unsigned char>(*c)) * 1099511628211ULL ;
+  }
+  std::stringstream str ;
+  str << directory ;
+  if (!directory.empty() && directory[directory.size()-1] != '/') {
+    str << '/' ;
+  }
+  str << "biogeme_" << std::hex << std::setw(16) << std::setfill('0') << h << ".bin" ;
+  theFileName = str.str() ;
+}
+
+bioString bioModelCache::getFileName() const {
+  return theFileName ;
+}
+
+bioBoolean bioModelCache::load(std::vector<bioSignatureNode>& nodes,
+			       bioUInt& root) const {
+  std::ifstream f(theFileName.c_str(),std::ios::binary | std::ios::ate) ;
+  if (!f) {
+    return false ;
+  }
+  std::streamoff size = f.tellg() ;
+  if (size <= 0) {
+    return false ;
+  }
+  std::vector<char> buffer(size) ;
+  f.seekg(0) ;
+  if (!f.read(buffer.data(),size)) {
+    return false ;
+  }
+  bioCacheReader reader(buffer) ;
+  char magic[sizeof(bioCacheMagic)] ;
+  uint32_t version ;
+  uint32_t byteOrder ;
+  uint64_t sizeOfReal, r, nbrOfNodes ;
+  uint64_t maxSize = canonicalSignatures.size() ;
+  bioString signatures ;
+  if (!reader.read(magic,sizeof(magic)) ||
+      !std::equal(magic,magic+sizeof(magic),bioCacheMagic) ||
+      !reader.read(&version,sizeof(version)) ||
+      version != bioCacheVersion ||
+      !reader.read(&byteOrder,sizeof(byteOrder)) ||
+      byteOrder != bioCacheByteOrder ||
+      !reader.readInteger(sizeOfReal) || sizeOfReal != sizeof(bioReal) ||
+      !reader.readString(signatures,maxSize) ||
+      signatures != canonicalSignatures ||
+      !reader.readInteger(r) ||
+      !reader.readSize(nbrOfNodes,maxSize)) {
+    return false ;
+  }
+  std::vector<bioSignatureNode> result(nbrOfNodes) ;
+  for (std::vector<bioSignatureNode>::iterator node = result.begin() ;
+       node != result.end() ;
+       ++node) {
+    uint64_t type, id, status, nbrOfNames ;
+    if (!reader.readInteger(type) || type >= bioNodeUnknown ||
+	!reader.readInteger(id) ||
+	!reader.readString(node->name,maxSize) ||
+	!reader.readInteger(status) ||
+	!reader.read(&node->value,sizeof(bioReal)) ||
+	!reader.readIntegers(node->children,maxSize) ||
+	!reader.readIntegers(node->integers,maxSize) ||
+	!reader.readReals(node->reals,maxSize) ||
+	!reader.readSize(nbrOfNames,maxSize)) {
+      return false ;
+    }
+    node->type = bioNodeType(type) ;
+    node->id = id ;
+    node->status = status ;
+    node->names.resize(nbrOfNames) ;
+    for (uint64_t i = 0 ; i < nbrOfNames ; ++i) {
+      if (!reader.readString(node->names[i],maxSize)) {
+	return false ;
+      }
+    }
+  }
+  if (!reader.atEnd()) {
+    return false ;
+  }
+  nodes.swap(result) ;
+  root = r ;
+  return true ;
+}
+
+void bioModelCache::save(const std::vector<bioSignatureNode>& nodes,
+			 bioUInt root) const {
+  // The file is written under a temporary name, and renamed when
+  // complete, so that another process never reads a partial file.
+  std::stringstream tmp ;
+  tmp << theFileName << "." << getpid() << ".tmp" ;
+  bioString tmpName = tmp.str() ;
+  {
+    std::ofstream f(tmpName.c_str(),std::ios::binary | std::ios::trunc) ;
+    if (!f) {
+      throw bioExceptions(__FILE__,__LINE__,"Cannot write the file "+tmpName) ;
+    }
+    f.write(bioCacheMagic,sizeof(bioCacheMagic)) ;
+    f.write(reinterpret_cast<const char*>(&bioCacheVersion),sizeof(bioCacheVersion)) ;
+    f.write(reinterpret_cast<const char*>(&bioCacheByteOrder),sizeof(bioCacheByteOrder)) ;
+    writeInteger(f,sizeof(bioReal)) ;
+    writeString(f,canonicalSignatures) ;
+    // The nodes are renumbered in the order of the traversal, so that
+    // the file does not depend on the ids of the run that created it.
+    std::unordered_map<bioUInt,bioUInt> ranks ;
+    ranks.reserve(nodes.size()) ;
+    for (std::size_t i = 0 ; i < nodes.size() ; ++i) {
+      ranks[nodes[i].id] = i ;
+    }
+    writeInteger(f,getRank(ranks,root)) ;
+    writeInteger(f,nodes.size()) ;
+    std::vector<bioUInt> children ;
+    for (std::vector<bioSignatureNode>::const_iterator node = nodes.begin() ;
+	 node != nodes.end() ;
+	 ++node) {
+      writeInteger(f,node->type) ;
+      writeInteger(f,getRank(ranks,node->id)) ;
+      writeString(f,node->name) ;
+      writeInteger(f,node->status) ;
+      f.write(reinterpret_cast<const char*>(&node->value),sizeof(bioReal)) ;
+      children.resize(node->children.size()) ;
+      for (std::size_t i = 0 ; i < children.size() ; ++i) {
+	children[i] = getRank(ranks,node->children[i]) ;
+      }
+      writeIntegers(f,children) ;
+      writeIntegers(f,node->integers) ;
+      writeReals(f,node->reals) ;
+      writeInteger(f,node->names.size()) ;
+      for (std::size_t i = 0 ; i < node->names.size() ; ++i) {
+	writeString(f,node->names[i]) ;
+      }
+    }
+    f.close() ;
+    if (!f) {
+      std::remove(tmpName.c_str()) ;
+      throw bioExceptions(__FILE__,__LINE__,"Error while writing the file "+tmpName) ;
+    }
+  }
+  if (std::rename(tmpName.c_str(),theFileName.c_str()) != 0) {
+    std::remove(tmpName.c_str()) ;
+    throw bioExceptions(__FILE__,__LINE__,"Cannot create the file "+theFileName) ;
+  }
+}
@@ -0,0 +1,42 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioModelCache.h
+// @date   Mon Oct 19 02:28:10 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioModelCache_h
+#define bioModelCache_h
+
+#include <vector>
+#include "bioTypes.h"
+#include "bioString.h"
+
+class bioSignatureNode ;
+
+// Binary copy of the parsed signatures of a formula, stored in a
+// directory. The name of the file is a hash of the signatures, where
+// the ids of the Python objects are replaced by the position of the
+// expressions in the traversal, so that a formula that has not
+// changed since the last run is rebuilt without parsing the
+// signatures again. The file also contains that canonical form of
+// the signatures, which is compared when the file is loaded, so that
+// a collision of the hash is detected.
+class bioModelCache {
+ public:
+  bioModelCache(const bioString& directory,
+		const std::vector<bioString>& signatures) ;
+  // Returns false if the formula is not in the cache, or if the file
+  // cannot be used. In that case, the signatures must be parsed.
+  bioBoolean load(std::vector<bioSignatureNode>& nodes, bioUInt& root) const ;
+  void save(const std::vector<bioSignatureNode>& nodes, bioUInt root) const ;
+  bioString getFileName() const ;
+ private:
+  bioString theFileName ;
+  // Signatures where the ids are replaced by their rank. Stored in
+  // the file to detect collisions of the hash.
+  bioString canonicalSignatures ;
+} ;
+
+#endif
@@ -10,26 +10,32 @@
 #ifndef bioNormalCdf_h
 #define bioNormalCdf_h
 
-#include <vector>
 #include "bioTypes.h"
 
+// Cumulative distribution function, density and log of the CDF of the
+// standard normal distribution, accurate to a few units in the last
+// place of a double, including in the tails. The tails are obtained
+// from the Mills ratio m(a) = (1-CDF(a)) / pdf(a), a >= 0,
+// approximated by piecewise polynomials in t = 4/(4+a), without
+// iterations. The functions contain no branch that depends on the
+// argument, so that the loops of the batch versions are vectorized
+// by the compiler.
 class bioNormalCdf {
 
  public:
   bioNormalCdf() ;
-  bioReal compute(bioReal gdx) const ;
+  bioReal compute(bioReal x) const ;
   bioReal derivative(bioReal x) const ;
- private:
-  bioReal gammp(bioReal a, bioReal x) const ;
-  bioReal gser(bioReal a, bioReal x) const ;
-  bioReal gcf(bioReal a, bioReal x) const ;
-  bioReal gammln(bioReal xx) const ; 
-  bioReal oneDivSqrtTwoPi ;
-  unsigned short itmax ;
-  bioReal eps ;
-  bioReal fpmin ;
-  std::vector<bioReal> cof ;
-  bioReal stp ;
+  // log(CDF(x)), finite for all finite x.
+  bioReal logCompute(bioReal x) const ;
+  // pdf(x) / CDF(x), derivative of log(CDF(x)).
+  bioReal inverseMillsRatio(bioReal x) const ;
+  // Mills ratio (1-CDF(a)) / pdf(a) for a >= 0.
+  static bioReal millsRatio(bioReal a) ;
+  // CDF and pdf of the n values of x.
+  static void compute(const bioReal* x, bioReal* cdf, bioReal* pdf, bioUInt n) ;
+  // pdf of the n values of x.
+  static void derivative(const bioReal* x, bioReal* pdf, bioUInt n) ;
 };
 
 #endif
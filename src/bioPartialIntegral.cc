@@ -0,0 +1,68 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioPartialIntegral.cc
+// @date   Mon Oct 19 03:06:41 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include "bioPartialIntegral.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "bioDerivatives.h"
+
+bioPartialIntegral::bioPartialIntegral(bioUInt n) :
+  maxLog(-std::numeric_limits<bioReal>::infinity()),
+  sum(0.0),
+  g(n,0.0) {
+}
+
+void bioPartialIntegral::setToZero() {
+  maxLog = -std::numeric_limits<bioReal>::infinity() ;
+  sum = 0.0 ;
+  std::fill(g.begin(),g.end(),0.0) ;
+}
+
+void bioPartialIntegral::rescale(bioReal m) {
+  if (m <= maxLog) {
+    return ;
+  }
+  bioReal scale = exp(maxLog - m) ;
+  sum *= scale ;
+  for (std::vector<bioReal>::iterator i = g.begin() ; i != g.end() ; ++i) {
+    *i *= scale ;
+  }
+  maxLog = m ;
+}
+
+void bioPartialIntegral::merge(const bioPartialIntegral& p) {
+  if (p.sum == 0.0) {
+    return ;
+  }
+  rescale(p.maxLog) ;
+  bioReal scale = exp(p.maxLog - maxLog) ;
+  sum += scale * p.sum ;
+  for (bioUInt i = 0 ; i < g.size() && i < p.g.size() ; ++i) {
+    g[i] += scale * p.g[i] ;
+  }
+}
+
+void bioPartialIntegral::getLogIntegral(bioUInt numberOfDraws,
+					bioBoolean gradient,
+					bioDerivatives& result) const {
+  if (sum == 0.0) {
+    // Same value as the log of a zero probability.
+    result.f = -bioMaxReal / 2.0 ;
+    if (gradient) {
+      result.setGradientToZero() ;
+    }
+    return ;
+  }
+  result.f = maxLog + log(sum / bioReal(numberOfDraws)) ;
+  if (gradient) {
+    for (bioUInt i = 0 ; i < g.size() ; ++i) {
+      result.g[i] = g[i] / sum ;
+    }
+  }
+}
@@ -0,0 +1,40 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioPartialIntegral.h
+// @date   Mon Oct 19 03:04:27 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioPartialIntegral_h
+#define bioPartialIntegral_h
+
+#include <vector>
+#include "bioTypes.h"
+
+class bioDerivatives ;
+
+// Sum of the likelihood, and of its gradient, over a range of draws
+// of a Monte-Carlo integral. To avoid overflows, the sums are stored
+// relative to the largest log likelihood: the sum of the likelihood
+// is exp(maxLog) * sum, and the sum of its gradient exp(maxLog) * g.
+// The sums over several ranges of draws are merged before the log of
+// the integral is taken.
+class bioPartialIntegral {
+ public:
+  bioPartialIntegral(bioUInt n = 0) ;
+  void setToZero() ;
+  // The sums are expressed relative to exp(m), if m is larger than
+  // the current reference.
+  void rescale(bioReal m) ;
+  void merge(const bioPartialIntegral& p) ;
+  // Log of the average likelihood over the draws, and its gradient.
+  void getLogIntegral(bioUInt numberOfDraws,
+		      bioBoolean gradient,
+		      bioDerivatives& result) const ;
+  bioReal maxLog ;
+  bioReal sum ;
+  std::vector<bioReal> g ;
+};
+
+#endif
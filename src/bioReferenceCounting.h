@@ -9,10 +9,14 @@
 #ifndef bioReferenceCounting_h
 #define bioReferenceCounting_h
 
+#include <atomic>
+
+// The count is atomic, as the expressions are shared by several
+// threads.
 class bioReferenceCounting
 {
     private:
-    int count; // Reference count
+    std::atomic<int> count; // Reference count
 
     public:
     bioReferenceCounting() {
@@ -0,0 +1,463 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioSignatureParser.cc
+// @date   Mon Oct 19 02:26:20 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include "bioSignatureParser.h"
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <unordered_set>
+#include "bioExceptions.h"
+
+bioSignatureNode::bioSignatureNode() : type(bioNodeUnknown), id(0), status(0), value(0.0) {
+}
+
+bioSignatureParser::bioSignatureParser(const bioString& s) :
+  signature(s),
+  current(s.data()),
+  end(s.data()+s.size()) {
+}
+
+// The dispatch is based on the length of the name, so that at most a
+// few names are compared.
+bioNodeType bioSignatureParser::getType(const char* name, std::size_t length) {
+#define BIO_NODE(str,type) if (std::memcmp(name,str,length) == 0) return type
+  switch (length) {
+  case 2:
+    BIO_NODE("Or",bioNodeOr) ;
+    break ;
+  case 3:
+    BIO_NODE("And",bioNodeAnd) ;
+    BIO_NODE("exp",bioNodeExp) ;
+    BIO_NODE("log",bioNodeLog) ;
+    break ;
+  case 4:
+    BIO_NODE("Beta",bioNodeBeta) ;
+    BIO_NODE("Plus",bioNodePlus) ;
+    BIO_NODE("Less",bioNodeLess) ;
+    BIO_NODE("Elem",bioNodeElem) ;
+    break ;
+  case 5:
+    BIO_NODE("Minus",bioNodeMinus) ;
+    BIO_NODE("Times",bioNodeTimes) ;
+    BIO_NODE("Power",bioNodePower) ;
+    BIO_NODE("Equal",bioNodeEqual) ;
+    break ;
+  case 6:
+    BIO_NODE("Divide",bioNodeDivide) ;
+    BIO_NODE("bioMin",bioNodeMin) ;
+    BIO_NODE("bioMax",bioNodeMax) ;
+    BIO_NODE("Derive",bioNodeDerive) ;
+    break ;
+  case 7:
+    BIO_NODE("Numeric",bioNodeNumeric) ;
+    BIO_NODE("Greater",bioNodeGreater) ;
+    break ;
+  case 8:
+    BIO_NODE("Variable",bioNodeVariable) ;
+    BIO_NODE("bioDraws",bioNodeDraws) ;
+    BIO_NODE("NotEqual",bioNodeNotEqual) ;
+    break ;
+  case 9:
+    BIO_NODE("Integrate",bioNodeIntegrate) ;
+    break ;
+  case 10:
+    BIO_NODE("UnaryMinus",bioNodeUnaryMinus) ;
+    BIO_NODE("MonteCarlo",bioNodeMonteCarlo) ;
+    BIO_NODE("bioMultSum",bioNodeMultSum) ;
+    BIO_NODE("_bioLogCnl",bioNodeLogCnl) ;
+    BIO_NODE("_bioLogMev",bioNodeLogMev) ;
+    break ;
+  case 11:
+    BIO_NODE("LessOrEqual",bioNodeLessOrEqual) ;
+    break ;
+  case 12:
+    BIO_NODE("bioNormalCdf",bioNodeNormalCdf) ;
+    BIO_NODE("bioNormalPdf",bioNodeNormalPdf) ;
+    BIO_NODE("_bioLogLogit",bioNodeLogLogit) ;
+    break ;
+  case 13:
+    BIO_NODE("_bioLogNested",bioNodeLogNested) ;
+    break ;
+  case 14:
+    BIO_NODE("DefineVariable",bioNodeVariable) ;
+    BIO_NODE("RandomVariable",bioNodeRandomVariable) ;
+    BIO_NODE("GreaterOrEqual",bioNodeGreaterOrEqual) ;
+    break ;
+  case 16:
+    BIO_NODE("bioLinearUtility",bioNodeLinearUtility) ;
+    break ;
+  case 17:
+    BIO_NODE("MultipleIntegrate",bioNodeMultipleIntegrate) ;
+    break ;
+  case 18:
+    BIO_NODE("_bioLogLatentClass",bioNodeLogLatentClass) ;
+    break ;
+  case 19:
+    BIO_NODE("_bioLogLogitSampled",bioNodeLogLogitSampled) ;
+    break ;
+  case 25:
+    BIO_NODE("PanelLikelihoodTrajectory",bioNodePanelTrajectory) ;
+    BIO_NODE("_bioLogLogitFullChoiceSet",bioNodeLogLogitFullChoiceSet) ;
+    break ;
+  default:
+    break ;
+  }
+#undef BIO_NODE
+  return bioNodeUnknown ;
+}
+
+void bioSignatureParser::parseHeader(bioSignatureNode& node) {
+  expect('<') ;
+  const char* name = current ;
+  while (current < end && *current != '>') {
+    ++current ;
+  }
+  std::size_t length = current - name ;
+  expect('>') ;
+  node.type = getType(name,length) ;
+  if (node.type == bioNodeUnknown) {
+    error("Unknown expression: "+bioString(name,length)) ;
+  }
+  expect('{') ;
+  node.id = readUInt() ;
+  expect('}') ;
+}
+
+void bioSignatureParser::parseBody(bioSignatureNode& node) {
+  switch (node.type) {
+  case bioNodeBeta:
+    node.name = readQuoted() ;
+    expect('[') ;
+    node.status = readUInt() ;
+    expect(']') ;
+    expect(',') ;
+    node.integers.push_back(readUInt()) ;
+    expect(',') ;
+    node.integers.push_back(readUInt()) ;
+    break ;
+  case bioNodeVariable:
+  case bioNodeDraws:
+  case bioNodeRandomVariable:
+    node.name = readQuoted() ;
+    expect(',') ;
+    node.integers.push_back(readUInt()) ;
+    expect(',') ;
+    node.integers.push_back(readUInt()) ;
+    break ;
+  case bioNodeNumeric:
+    expect(',') ;
+    node.value = readReal() ;
+    break ;
+  case bioNodePlus:
+  case bioNodeMinus:
+  case bioNodeTimes:
+  case bioNodeDivide:
+  case bioNodePower:
+  case bioNodeAnd:
+  case bioNodeOr:
+  case bioNodeEqual:
+  case bioNodeNotEqual:
+  case bioNodeLess:
+  case bioNodeLessOrEqual:
+  case bioNodeGreater:
+  case bioNodeGreaterOrEqual:
+  case bioNodeMin:
+  case bioNodeMax: {
+    bioUInt n = readNumberOfChildren() ;
+    if (n != 2) {
+      std::stringstream str ;
+      str << "Incorrect number of children: " << n ;
+      error(str.str()) ;
+    }
+    readChildren(n,node) ;
+    break ;
+  }
+  case bioNodeUnaryMinus:
+  case bioNodeMonteCarlo:
+  case bioNodeNormalCdf:
+  case bioNodeNormalPdf:
+  case bioNodePanelTrajectory:
+  case bioNodeExp:
+  case bioNodeLog: {
+    bioUInt n = readNumberOfChildren() ;
+    if (n != 1) {
+      std::stringstream str ;
+      str << "Incorrect number of children: " << n ;
+      error(str.str()) ;
+    }
+    readChildren(n,node) ;
+    break ;
+  }
+  case bioNodeMultSum: {
+    bioUInt n = readNumberOfChildren() ;
+    readChildren(n,node) ;
+    break ;
+  }
+  case bioNodeDerive:
+    readChildren(1,node) ;
+    expect(',') ;
+    node.integers.push_back(readUInt()) ;
+    break ;
+  case bioNodeIntegrate:
+    readChildren(1,node) ;
+    expect(',') ;
+    node.integers.push_back(readUInt()) ;
+    if (current != end) {
+      expect(',') ;
+      node.integers.push_back(readUInt()) ;
+      expect(',') ;
+      node.integers.push_back(readUInt()) ;
+    }
+    break ;
+  case bioNodeMultipleIntegrate: {
+    bioUInt n = readNumberOfChildren() ;
+    readChildren(1,node) ;
+    expect(',') ;
+    node.integers.push_back(readUInt()) ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      expect(',') ;
+      node.integers.push_back(readUInt()) ;
+    }
+    break ;
+  }
+  case bioNodeLogLogit:
+  case bioNodeLogLogitFullChoiceSet: {
+    bioUInt n = readNumberOfChildren() ;
+    readChildren(1,node) ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      expect(',') ;
+      node.integers.push_back(readUInt()) ;
+      readChildren(2,node) ;
+    }
+    break ;
+  }
+  case bioNodeLogLogitSampled: {
+    bioUInt n = readNumberOfChildren() ;
+    readChildren(1,node) ;
+    expect(',') ;
+    node.integers.push_back(readUInt()) ;
+    expect(',') ;
+    node.integers.push_back(readUInt()) ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      expect(',') ;
+      node.integers.push_back(readUInt()) ;
+      readChildren(2,node) ;
+      expect(',') ;
+      node.reals.push_back(readReal()) ;
+    }
+    break ;
+  }
+  case bioNodeLogNested: {
+    bioUInt n = readNumberOfChildren() ;
+    node.integers.push_back(n) ;
+    readChildren(2,node) ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      expect(',') ;
+      node.integers.push_back(readUInt()) ;
+      readChildren(2,node) ;
+    }
+    expect(',') ;
+    bioUInt nbrOfNests = readUInt() ;
+    for (bioUInt m = 0 ; m < nbrOfNests ; ++m) {
+      readChildren(1,node) ;
+      expect(',') ;
+      bioUInt k = readUInt() ;
+      node.integers.push_back(k) ;
+      for (bioUInt i = 0 ; i < k ; ++i) {
+	expect(',') ;
+	node.integers.push_back(readUInt()) ;
+      }
+    }
+    break ;
+  }
+  case bioNodeLogCnl: {
+    bioUInt n = readNumberOfChildren() ;
+    node.integers.push_back(n) ;
+    readChildren(2,node) ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      expect(',') ;
+      node.integers.push_back(readUInt()) ;
+      readChildren(2,node) ;
+    }
+    expect(',') ;
+    bioUInt nbrOfNests = readUInt() ;
+    for (bioUInt m = 0 ; m < nbrOfNests ; ++m) {
+      readChildren(1,node) ;
+      expect(',') ;
+      bioUInt k = readUInt() ;
+      node.integers.push_back(k) ;
+      for (bioUInt i = 0 ; i < k ; ++i) {
+	expect(',') ;
+	node.integers.push_back(readUInt()) ;
+	readChildren(1,node) ;
+      }
+    }
+    break ;
+  }
+  case bioNodeLogMev: {
+    bioUInt n = readNumberOfChildren() ;
+    node.integers.push_back(n) ;
+    readChildren(1,node) ;
+    expect(',') ;
+    bioUInt correction = readUInt() ;
+    node.integers.push_back(correction) ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      expect(',') ;
+      node.integers.push_back(readUInt()) ;
+      readChildren((correction) ? 3 : 2,node) ;
+    }
+    expect(',') ;
+    bioUInt nbrOfNodes = readUInt() ;
+    for (bioUInt k = 0 ; k < nbrOfNodes ; ++k) {
+      readChildren(1,node) ;
+      expect(',') ;
+      bioUInt s = readUInt() ;
+      node.integers.push_back(s) ;
+      for (bioUInt i = 0 ; i < s ; ++i) {
+	expect(',') ;
+	node.integers.push_back(readUInt()) ;
+	expect(',') ;
+	node.integers.push_back(readUInt()) ;
+	readChildren(1,node) ;
+      }
+    }
+    break ;
+  }
+  case bioNodeLogLatentClass: {
+    bioUInt n = readNumberOfChildren() ;
+    expect(',') ;
+    node.integers.push_back(readUInt()) ;
+    readChildren(2 * n,node) ;
+    break ;
+  }
+  case bioNodeElem: {
+    bioUInt n = readNumberOfChildren() ;
+    readChildren(1,node) ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      expect(',') ;
+      node.integers.push_back(readUInt()) ;
+      readChildren(1,node) ;
+    }
+    break ;
+  }
+  case bioNodeLinearUtility: {
+    bioUInt n = readNumberOfChildren() ;
+    for (bioUInt i = 0 ; i < 2 * n ; ++i) {
+      readChildren(1,node) ;
+      expect(',') ;
+      node.integers.push_back(readUInt()) ;
+      expect(',') ;
+      node.names.push_back(readUntil(',')) ;
+    }
+    break ;
+  }
+  default:
+    error("Unknown expression") ;
+  }
+  if (current != end) {
+    error("Unexpected characters at the end of the signature") ;
+  }
+}
+
+bioUInt bioSignatureParser::parseSignatures(const std::vector<bioString>& signatures,
+					    std::vector<bioSignatureNode>& nodes) {
+  nodes.clear() ;
+  nodes.reserve(signatures.size()) ;
+  std::unordered_set<bioUInt> parsed ;
+  parsed.reserve(signatures.size()) ;
+  bioUInt root = 0 ;
+  for (std::vector<bioString>::const_iterator i = signatures.begin() ;
+       i != signatures.end() ;
+       ++i) {
+    bioSignatureParser theParser(*i) ;
+    bioSignatureNode node ;
+    theParser.parseHeader(node) ;
+    root = node.id ;
+    if (parsed.insert(node.id).second) {
+      theParser.parseBody(node) ;
+      nodes.push_back(node) ;
+    }
+  }
+  return root ;
+}
+
+void bioSignatureParser::expect(char c) {
+  if (current >= end || *current != c) {
+    std::stringstream str ;
+    str << "Character '" << c << "' expected at position " << current - signature.data() ;
+    error(str.str()) ;
+  }
+  ++current ;
+}
+
+bioUInt bioSignatureParser::readUInt() {
+  if (current >= end || *current < '0' || *current > '9') {
+    std::stringstream str ;
+    str << "Integer expected at position " << current - signature.data() ;
+    error(str.str()) ;
+  }
+  bioUInt result = 0 ;
+  while (current < end && *current >= '0' && *current <= '9') {
+    result = 10 * result + bioUInt(*current - '0') ;
+    ++current ;
+  }
+  return result ;
+}
+
+bioReal bioSignatureParser::readReal() {
+  // The signature is stored in a string, so that the characters are
+  // null terminated.
+  char* next ;
+  bioReal result = std::strtod(current,&next) ;
+  if (next == current) {
+    std::stringstream str ;
+    str << "Number expected at position " << current - signature.data() ;
+    error(str.str()) ;
+  }
+  current = next ;
+  return result ;
+}
+
+bioString bioSignatureParser::readQuoted() {
+  expect('"') ;
+  const char* start = current ;
+  while (current < end && *current != '"') {
+    ++current ;
+  }
+  bioString result(start,current-start) ;
+  expect('"') ;
+  return result ;
+}
+
+bioString bioSignatureParser::readUntil(char c) {
+  const char* start = current ;
+  while (current < end && *current != c) {
+    ++current ;
+  }
+  return bioString(start,current-start) ;
+}
+
+bioUInt bioSignatureParser::readNumberOfChildren() {
+  expect('(') ;
+  bioUInt n = readUInt() ;
+  expect(')') ;
+  return n ;
+}
+
+void bioSignatureParser::readChildren(bioUInt n, bioSignatureNode& node) {
+  for (bioUInt i = 0 ; i < n ; ++i) {
+    expect(',') ;
+    node.children.push_back(readUInt()) ;
+  }
+}
+
+void bioSignatureParser::error(const bioString& msg) const {
+  std::stringstream str ;
+  str << msg << " in signature: " << signature ;
+  throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+}
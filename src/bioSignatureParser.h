@@ -0,0 +1,138 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioSignatureParser.h
+// @date   Mon Oct 19 02:24:06 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioSignatureParser_h
+#define bioSignatureParser_h
+
+#include <vector>
+#include "bioTypes.h"
+#include "bioString.h"
+
+// Types of the expressions that can appear in a signature.
+enum bioNodeType {
+  bioNodeBeta,
+  bioNodeVariable,
+  bioNodeDraws,
+  bioNodeRandomVariable,
+  bioNodeNumeric,
+  bioNodePlus,
+  bioNodeMinus,
+  bioNodeTimes,
+  bioNodeDivide,
+  bioNodePower,
+  bioNodeAnd,
+  bioNodeOr,
+  bioNodeEqual,
+  bioNodeNotEqual,
+  bioNodeLess,
+  bioNodeLessOrEqual,
+  bioNodeGreater,
+  bioNodeGreaterOrEqual,
+  bioNodeMin,
+  bioNodeMax,
+  bioNodeUnaryMinus,
+  bioNodeMonteCarlo,
+  bioNodeNormalCdf,
+  bioNodeNormalPdf,
+  bioNodePanelTrajectory,
+  bioNodeExp,
+  bioNodeLog,
+  bioNodeDerive,
+  bioNodeIntegrate,
+  bioNodeMultipleIntegrate,
+  bioNodeLinearUtility,
+  bioNodeLogLogit,
+  bioNodeLogLogitFullChoiceSet,
+  bioNodeLogLogitSampled,
+  bioNodeLogNested,
+  bioNodeLogCnl,
+  bioNodeLogMev,
+  bioNodeLogLatentClass,
+  bioNodeMultSum,
+  bioNodeElem,
+  bioNodeUnknown
+} ;
+
+// Content of the signature of one expression. The children are
+// identified by the id of their own signature.
+//
+// - literals: integers = {uniqueId, index}, plus name and status (Beta),
+// - Numeric: value,
+// - Derive: integers = {literal id},
+// - Integrate: integers = {random variable id, number of points,
+//   adaptive}, where the last two are optional,
+// - MultipleIntegrate: integers = {level, random variable id_1, ...},
+// - _bioLogLogit: children = {choice, util_1, av_1, util_2, ...},
+//   integers = {alt_1, alt_2, ...},
+// - _bioLogLogitSampled: same as _bioLogLogit, with integers = {R,
+//   seed, alt_1, alt_2, ...}, where R is the number of sampled
+//   alternatives, and reals = {w_1, w_2, ...}, the sampling weights,
+// - _bioLogNested: children = {choice, scale, util_1, av_1, util_2,
+//   ..., mu_1, mu_2, ...}, integers = {J, alt_1, ..., alt_J, K_1,
+//   alternatives of nest 1, K_2, alternatives of nest 2, ...}, where
+//   K_m is the number of alternatives of nest m,
+// - _bioLogCnl: same as _bioLogNested, where each nest parameter mu_m
+//   is followed in the children by the alpha parameters of the K_m
+//   alternatives of the nest,
+// - _bioLogMev: children = {choice, util_1, av_1, [corr_1,] util_2,
+//   ..., mu_1, alpha_11, alpha_12, ..., mu_2, ...}, integers = {J,
+//   correction, alt_1, ..., alt_J, S_1, kind_11, succ_11, kind_12,
+//   ..., S_2, ...}, where correction is 1 if the corrections for
+//   endogenous sampling are present, S_k is the number of successors
+//   of node k, and kind is 1 if the successor is an alternative,
+// - _bioLogLatentClass: children = {W_1, L_1, W_2, L_2, ...},
+//   integers = {panel}, where W_c is the membership utility and L_c
+//   the class-specific model of class c,
+// - Elem: children = {key, expr_1, expr_2, ...}, integers = {key_1, ...},
+// - bioLinearUtility: children = {beta_1, var_1, beta_2, ...},
+//   integers and names: unique ids and names of the same literals.
+class bioSignatureNode {
+ public:
+  bioSignatureNode() ;
+  bioNodeType type ;
+  bioUInt id ;
+  bioString name ;
+  bioUInt status ;
+  bioReal value ;
+  std::vector<bioUInt> children ;
+  std::vector<bioUInt> integers ;
+  std::vector<bioReal> reals ;
+  std::vector<bioString> names ;
+} ;
+
+// Parses the signatures generated by Expression.getSignature() in
+// one pass over the characters, without splitting the string.
+class bioSignatureParser {
+ public:
+  bioSignatureParser(const bioString& s) ;
+  // Reads the type and the id of the expression.
+  void parseHeader(bioSignatureNode& node) ;
+  // Reads the rest of the signature. parseHeader must have been called.
+  void parseBody(bioSignatureNode& node) ;
+  static bioNodeType getType(const char* name, std::size_t length) ;
+  // Parses a list of signatures. An expression appearing several
+  // times is parsed only once. Returns the id of the last signature,
+  // which is the formula itself.
+  static bioUInt parseSignatures(const std::vector<bioString>& signatures,
+				 std::vector<bioSignatureNode>& nodes) ;
+ private:
+  void expect(char c) ;
+  bioUInt readUInt() ;
+  bioReal readReal() ;
+  bioString readQuoted() ;
+  bioString readUntil(char c) ;
+  bioUInt readNumberOfChildren() ;
+  void readChildren(bioUInt n, bioSignatureNode& node) ;
+  void error(const bioString& msg) const ;
+ private:
+  const bioString& signature ;
+  const char* current ;
+  const char* end ;
+} ;
+
+#endif
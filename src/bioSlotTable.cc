@@ -0,0 +1,46 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioSlotTable.cc
+// @date   Mon Oct 19 04:23:13 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include <algorithm>
+#include "bioConst.h"
+#include "bioSlotTable.h"
+
+bioSlotTable::bioSlotTable() {
+}
+
+void bioSlotTable::setIds(const std::vector<bioUInt>& ids) {
+  theIds = ids ;
+  directTable.clear() ;
+  if (theIds.empty()) {
+    return ;
+  }
+  // The direct table is used if it is not much larger than the list.
+  bioUInt largest = theIds.back() ;
+  if (largest >= 1024 && largest / 8 >= theIds.size()) {
+    return ;
+  }
+  directTable.assign(largest+1,bioBadId) ;
+  for (bioUInt k = 0 ; k < theIds.size() ; ++k) {
+    directTable[theIds[k]] = k ;
+  }
+}
+
+bioUInt bioSlotTable::getSlot(bioUInt id) const {
+  if (!directTable.empty()) {
+    return (id < directTable.size()) ? directTable[id] : bioBadId ;
+  }
+  std::vector<bioUInt>::const_iterator found = std::lower_bound(theIds.begin(),theIds.end(),id) ;
+  if (found == theIds.end() || *found != id) {
+    return bioBadId ;
+  }
+  return bioUInt(found - theIds.begin()) ;
+}
+
+bioUInt bioSlotTable::size() const {
+  return theIds.size() ;
+}
@@ -0,0 +1,33 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioSlotTable.h
+// @date   Mon Oct 19 04:20:59 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioSlotTable_h
+#define bioSlotTable_h
+
+#include <vector>
+#include "bioTypes.h"
+
+// Position (slot) of an id in a sorted list of ids, such as the
+// alternatives of a choice model. If the ids are small integers, the
+// slots are stored in a table indexed by the id, so that the lookup
+// takes a constant time. Otherwise, a binary search is performed.
+class bioSlotTable {
+ public:
+  bioSlotTable() ;
+  // The ids must be sorted and distinct.
+  void setIds(const std::vector<bioUInt>& ids) ;
+  // Returns bioBadId if the id is not in the list.
+  bioUInt getSlot(bioUInt id) const ;
+  bioUInt size() const ;
+ private:
+  std::vector<bioUInt> theIds ;
+  // Empty if the ids are too large or too sparse.
+  std::vector<bioUInt> directTable ;
+};
+
+#endif
@@ -9,6 +9,7 @@
 #ifndef bioSmartPointer_h
 #define bioSmartPointer_h
 
+#include <cstddef>
 #include "bioTypes.h"
 #include "bioReferenceCounting.h"
 
@@ -0,0 +1,268 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioSparseGrid.cc
+// @date   Mon Oct 19 03:34:15 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#include "bioSparseGrid.h"
+#include <map>
+#include <algorithm>
+#include "bioConst.h"
+#include "bioExceptions.h"
+
+// Genz-Keister rules (Genz and Keister, 1996): nested extensions
+// of the Gauss-Hermite rule with 3 points, for the standard normal
+// density. The weights are multiplied by sqrt(2 pi) exp(x*x/2). The
+// values have been calculated with 120 significant digits, by
+// solving the Kronrod-Patterson conditions for each extension.
+
+// 1 points
+static constexpr bioReal bioGkNodes1[] = {
+    0.00000000000000000000e+00
+} ;
+static constexpr bioReal bioGkWeights1[] = {
+    2.50662827463100068570e+00
+} ;
+
+// 3 points
+static constexpr bioReal bioGkNodes3[] = {
+    -1.73205080756887719318e+00,    0.00000000000000000000e+00,
+    1.73205080756887719318e+00
+} ;
+static constexpr bioReal bioGkWeights3[] = {
+    1.87232142363568598853e+00,    1.67108551642066704979e+00,
+    1.87232142363568598853e+00
+} ;
+
+// 9 points
+static constexpr bioReal bioGkNodes9[] = {
+    -4.18495601767273228688e+00,    -2.86127957605705818267e+00,
+    -1.73205080756887719318e+00,    -7.41095349994540852911e-01,
+    0.00000000000000000000e+00,    7.41095349994540852911e-01,
+    1.73205080756887719318e+00,    2.86127957605705818267e+00,
+    4.18495601767273228688e+00
+} ;
+static constexpr bioReal bioGkWeights9[] = {
+    1.50157365484211258178e+00,    1.20156608940273379460e+00,
+    1.06554877767884570439e+00,    8.90913114335777800434e-01,
+    6.36604006255492183008e-01,    8.90913114335777800434e-01,
+    1.06554877767884570439e+00,    1.20156608940273379460e+00,
+    1.50157365484211258178e+00
+} ;
+
+// 19 points
+static constexpr bioReal bioGkNodes19[] = {
+    -6.36339449433636961118e+00,    -5.18701603991365622903e+00,
+    -4.18495601767273228688e+00,    -3.20533379449919442195e+00,
+    -2.86127957605705818267e+00,    -2.59608311504920230561e+00,
+    -1.73205080756887719318e+00,    -1.23042363402730603461e+00,
+    -7.41095349994540852911e-01,    0.00000000000000000000e+00,
+    7.41095349994540852911e-01,    1.23042363402730603461e+00,
+    1.73205080756887719318e+00,    2.59608311504920230561e+00,
+    2.86127957605705818267e+00,    3.20533379449919442195e+00,
+    4.18495601767273228688e+00,    5.18701603991365622903e+00,
+    6.36339449433636961118e+00
+} ;
+static constexpr bioReal bioGkWeights19[] = {
+    1.34271046531240667576e+00,    1.06273732611441440454e+00,
+    9.57676748772218755512e-01,    1.23090426891272941567e+00,
+    -9.52261690742466915260e-01,    1.31798340196740548791e+00,
+    7.20050498163806174112e-01,    3.26773688650690508073e-01,
+    6.87216246707252342851e-01,    7.60679463577649039863e-01,
+    6.87216246707252342851e-01,    3.26773688650690508073e-01,
+    7.20050498163806174112e-01,    1.31798340196740548791e+00,
+    -9.52261690742466915260e-01,    1.23090426891272941567e+00,
+    9.57676748772218755512e-01,    1.06273732611441440454e+00,
+    1.34271046531240667576e+00
+} ;
+
+// 35 points
+static constexpr bioReal bioGkNodes35[] = {
+    -9.01693978989030320292e+00,    -7.98077179859056062838e+00,
+    -7.12210670080461660802e+00,    -6.36339449433636961118e+00,
+    -5.69817776848810986223e+00,    -5.18701603991365622903e+00,
+    -4.73643308595229672875e+00,    -4.18495601767273228688e+00,
+    -3.63531851903727831754e+00,    -3.20533379449919442195e+00,
+    -2.86127957605705818267e+00,    -2.59608311504920230561e+00,
+    -2.23362606167694144332e+00,    -1.73205080756887719318e+00,
+    -1.23042363402730603461e+00,    -7.41095349994540852911e-01,
+    -2.48992297579960608633e-01,    0.00000000000000000000e+00,
+    2.48992297579960608633e-01,    7.41095349994540852911e-01,
+    1.23042363402730603461e+00,    1.73205080756887719318e+00,
+    2.23362606167694144332e+00,    2.59608311504920230561e+00,
+    2.86127957605705818267e+00,    3.20533379449919442195e+00,
+    3.63531851903727831754e+00,    4.18495601767273228688e+00,
+    4.73643308595229672875e+00,    5.18701603991365622903e+00,
+    5.69817776848810986223e+00,    6.36339449433636961118e+00,
+    7.12210670080461660802e+00,    7.98077179859056062838e+00,
+    9.01693978989030320292e+00
+} ;
+static constexpr bioReal bioGkWeights35[] = {
+    1.19449888037455176359e+00,    9.25098157485592764715e-01,
+    8.03020562917172830986e-01,    7.15906490158669250867e-01,
+    6.02545098657911171181e-01,    4.30276899481723540397e-01,
+    5.09754325555937581882e-01,    5.69115908279163362771e-01,
+    5.11120229460164776647e-01,    3.49426573333492362927e-01,
+    3.47313784539999559353e-01,    2.29956977609275109442e-01,
+    4.76015748315861630946e-01,    5.08601347340069231961e-01,
+    4.93565143434285702462e-01,    4.88451625642975895136e-01,
+    4.95804804422251998997e-01,    1.29064913237743458460e-03,
+    4.95804804422251998997e-01,    4.88451625642975895136e-01,
+    4.93565143434285702462e-01,    5.08601347340069231961e-01,
+    4.76015748315861630946e-01,    2.29956977609275109442e-01,
+    3.47313784539999559353e-01,    3.49426573333492362927e-01,
+    5.11120229460164776647e-01,    5.69115908279163362771e-01,
+    5.09754325555937581882e-01,    4.30276899481723540397e-01,
+    6.02545098657911171181e-01,    7.15906490158669250867e-01,
+    8.03020562917172830986e-01,    9.25098157485592764715e-01,
+    1.19449888037455176359e+00
+} ;
+
+class bioGkRule {
+public:
+  bioUInt size ;
+  // The rule is exact for the polynomials of this degree.
+  bioUInt degree ;
+  const bioReal* nodes ;
+  const bioReal* weights ;
+} ;
+
+static constexpr bioGkRule bioGkRules[] = {
+  {1,1,bioGkNodes1,bioGkWeights1},
+  {3,5,bioGkNodes3,bioGkWeights3},
+  {9,15,bioGkNodes9,bioGkWeights9},
+  {19,29,bioGkNodes19,bioGkWeights19},
+  {35,51,bioGkNodes35,bioGkWeights35}
+} ;
+
+// Smallest rule that is exact for the polynomials of degree 2l-1
+static const bioGkRule& getRule(bioUInt level) {
+  for (const bioGkRule& r : bioGkRules) {
+    if (r.degree >= 2 * level - 1) {
+      return r ;
+    }
+  }
+  throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,level,1,bioSparseGridMaxLevel) ;
+}
+
+// Number of combinations of k elements among n
+static bioReal binomial(bioUInt n, bioUInt k) {
+  bioReal result = 1.0 ;
+  for (bioUInt i = 1 ; i <= k ; ++i) {
+    result = result * bioReal(n - k + i) / bioReal(i) ;
+  }
+  return result ;
+}
+
+// Multi-indices l, with l_i >= 1, such that |l| is between minSum
+// and maxSum. The first k elements of current are already set.
+static void getMultiIndices(bioUInt k,
+			    bioUInt sum,
+			    bioUInt minSum,
+			    bioUInt maxSum,
+			    std::vector<bioUInt>& current,
+			    std::vector<std::vector<bioUInt> >& result) {
+  bioUInt d = current.size() ;
+  if (k == d) {
+    if (sum >= minSum) {
+      result.push_back(current) ;
+    }
+    return ;
+  }
+  // Each remaining index is at least one.
+  bioUInt remaining = d - k - 1 ;
+  for (bioUInt l = 1 ; sum + l + remaining <= maxSum ; ++l) {
+    current[k] = l ;
+    getMultiIndices(k+1,sum+l,minSum,maxSum,current,result) ;
+  }
+}
+
+bioSparseGrid::bioSparseGrid(bioUInt d, bioUInt level) : dimension(d) {
+  if (dimension == 0) {
+    throw bioExceptions(__FILE__,__LINE__,"A sparse grid needs at least one dimension") ;
+  }
+  if (level == 0 || level > bioSparseGridMaxLevel) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,level,1,bioSparseGridMaxLevel) ;
+  }
+  // One-dimensional rules. As all the other indices are at least
+  // one, no index is larger than the level.
+  std::vector<const bioGkRule*> rules(level+1,NULL) ;
+  for (bioUInt l = 1 ; l <= level ; ++l) {
+    rules[l] = &getRule(l) ;
+  }
+  bioUInt maxSum = level + dimension - 1 ;
+  std::vector<bioUInt> current(dimension,1) ;
+  std::vector<std::vector<bioUInt> > multiIndices ;
+  getMultiIndices(0,0,level,maxSum,current,multiIndices) ;
+  // The points of the tensor products are merged.
+  std::map<std::vector<bioReal>,bioReal> thePoints ;
+  std::vector<bioReal> x(dimension) ;
+  std::vector<bioUInt> position(dimension) ;
+  for (std::vector<std::vector<bioUInt> >::const_iterator l = multiIndices.begin() ;
+       l != multiIndices.end() ;
+       ++l) {
+    bioUInt sum = 0 ;
+    for (bioUInt k = 0 ; k < dimension ; ++k) {
+      sum += (*l)[k] ;
+    }
+    bioReal coefficient = binomial(dimension-1,maxSum-sum) ;
+    if ((maxSum - sum) % 2 == 1) {
+      coefficient = -coefficient ;
+    }
+    std::fill(position.begin(),position.end(),0) ;
+    while (true) {
+      bioReal w = coefficient ;
+      for (bioUInt k = 0 ; k < dimension ; ++k) {
+	const bioGkRule* r = rules[(*l)[k]] ;
+	x[k] = r->nodes[position[k]] ;
+	w *= r->weights[position[k]] ;
+      }
+      thePoints[x] += w ;
+      // Next point of the tensor product
+      bioUInt k = 0 ;
+      while (k < dimension && ++position[k] == rules[(*l)[k]]->size) {
+	position[k] = 0 ;
+	++k ;
+      }
+      if (k == dimension) {
+	break ;
+      }
+    }
+  }
+  nodes.reserve(thePoints.size() * dimension) ;
+  weights.reserve(thePoints.size()) ;
+  for (std::map<std::vector<bioReal>,bioReal>::const_iterator i = thePoints.begin() ;
+       i != thePoints.end() ;
+       ++i) {
+    // Points of the tensor products that cancel out
+    if (i->second == 0.0) {
+      continue ;
+    }
+    nodes.insert(nodes.end(),i->first.begin(),i->first.end()) ;
+    weights.push_back(i->second) ;
+  }
+}
+
+bioUInt bioSparseGrid::getDimension() const {
+  return dimension ;
+}
+
+bioUInt bioSparseGrid::getNumberOfPoints() const {
+  return weights.size() ;
+}
+
+const bioReal* bioSparseGrid::getNode(bioUInt point) const {
+  if (point >= weights.size()) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,point,0,weights.size()-1) ;
+  }
+  return &nodes[point * dimension] ;
+}
+
+bioReal bioSparseGrid::getWeight(bioUInt point) const {
+  if (point >= weights.size()) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,point,0,weights.size()-1) ;
+  }
+  return weights[point] ;
+}
@@ -0,0 +1,46 @@
+//-*-c++-*------------------------------------------------------------
+//
+// File name : bioSparseGrid.h
+// @date   Mon Oct 19 03:32:01 2026
+// @author Michel Bierlaire
+//
+//--------------------------------------------------------------------
+
+#ifndef bioSparseGrid_h
+#define bioSparseGrid_h
+
+// Smolyak sparse grid for the integral from -infinity to +infinity
+// of f(x_1,...,x_d), obtained with the combination technique:
+//
+//   A(q,d) = sum_{q <= |l| <= q+d-1} (-1)^(q+d-1-|l|)
+//                                    C(d-1,q+d-1-|l|) U_l1 x ... x U_ld
+//
+// where U_l is the smallest Genz-Keister rule that is exact for the
+// polynomials of degree 2l-1 multiplied by the standard normal
+// density. The rules, with 1, 3, 9, 19 and 35 points, are nested, so
+// that most of the points of the tensor products coincide and are
+// merged. At level q, the grid is exact for the polynomials of total
+// degree 2q-1 multiplied by exp(-x'x/2), with a number of points
+// that grows polynomially with d, instead of exponentially for the
+// tensor product of one-dimensional rules. The weights are
+// multiplied by the inverse of the density, so that the grid applies
+// directly to the function to integrate. Some weights are negative.
+
+#include <vector>
+#include "bioTypes.h"
+
+class bioSparseGrid {
+ public:
+  bioSparseGrid(bioUInt dimension, bioUInt level) ;
+  bioUInt getDimension() const ;
+  bioUInt getNumberOfPoints() const ;
+  // Coordinates of the point, in an array of size getDimension()
+  const bioReal* getNode(bioUInt point) const ;
+  bioReal getWeight(bioUInt point) const ;
+ private:
+  bioUInt dimension ;
+  std::vector<bioReal> nodes ;
+  std::vector<bioReal> weights ;
+};
+
+#endif
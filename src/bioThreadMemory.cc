@@ -13,11 +13,7 @@
 
 bioThreadMemory::bioThreadMemory(bioUInt nThreads,bioUInt dim):
   inputStructures(nThreads) {
-  for (bioUInt i = 0 ; i < numberOfThreads() ; ++i) {
-    inputStructures[i].grad.resize(dim) ;
-    inputStructures[i].hessian.resize(dim,inputStructures[i].grad) ;
-    inputStructures[i].bhhh.resize(dim,inputStructures[i].grad) ;
-  }
+  setDimension(dim) ;
 }
 
 bioThreadMemory::~bioThreadMemory() {
@@ -31,39 +27,21 @@ bioThreadArg* bioThreadMemory::getInput(bioUInt t) {
   if (t >= inputStructures.size()) {
     throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,t,0,inputStructures.size()  - 1) ;
   }
-  if (t >= loglikes.size()) {
-    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,t,0,loglikes.size()  - 1) ;
-  }
-  inputStructures[t].theLoglike = loglikes[t] ;
-  if (!weights.empty()) {
-    if (t >= weights.size()) {
-      throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,t,0,weights.size()  - 1) ;
-    }
-    inputStructures[t].theWeight = weights[t] ;
-  }
-  else {
-    inputStructures[t].theWeight = NULL ;
+  if (theLoglike == NULL) {
+    throw bioExceptNullPointer(__FILE__,__LINE__,"loglikelihood formula") ;
   }
+  inputStructures[t].theLoglike = theLoglike ;
+  inputStructures[t].theWeight = theWeight ;
   return &(inputStructures[t]) ;
 }
 
 
-void bioThreadMemory::setLoglike(std::vector<bioString> f) {
-  loglikes.resize(numberOfThreads()) ;
-  for(std::vector<bioSmartPointer<bioFormula> >::iterator i = loglikes.begin() ;
-      i != loglikes.end() ;
-      ++i) {
-    *i = bioSmartPointer<bioFormula>(new bioFormula(f)) ;
-  }
+void bioThreadMemory::setLoglike(std::vector<bioString> f, bioString cacheDirectory) {
+  theLoglike = bioSmartPointer<bioFormula>(new bioFormula(f,cacheDirectory)) ;
 }
 
-void bioThreadMemory::setWeight(std::vector<bioString> w) {
-  weights.resize(numberOfThreads()) ;
-  for(std::vector<bioSmartPointer<bioFormula> >::iterator i =  weights.begin() ;
-      i != weights.end() ;
-      ++i) {
-    *i = bioSmartPointer<bioFormula>(new bioFormula(w)) ;
-  }
+void bioThreadMemory::setWeight(std::vector<bioString> w, bioString cacheDirectory) {
+  theWeight = bioSmartPointer<bioFormula>(new bioFormula(w,cacheDirectory)) ;
 }
 
 bioUInt bioThreadMemory::numberOfThreads() {
@@ -73,84 +51,91 @@ bioUInt bioThreadMemory::dimension() {
   return inputStructures[0].grad.size() ;
 }
 
+void bioThreadMemory::setDimension(bioUInt dim) {
+  for (bioUInt i = 0 ; i < numberOfThreads() ; ++i) {
+    inputStructures[i].grad.assign(dim,0.0) ;
+    inputStructures[i].hessian.assign(dim,inputStructures[i].grad) ;
+    inputStructures[i].bhhh.assign(dim,inputStructures[i].grad) ;
+  }
+}
+
 void bioThreadMemory::setParameters(std::vector<bioReal>* p) {
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = loglikes.begin() ;
-       i != loglikes.end() ;
-       ++i) {
-    (*i)->setParameters(p) ;
+  if (theLoglike != NULL) {
+    theLoglike->setParameters(p) ;
   }
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = weights.begin() ;
-       i != weights.end() ;
-       ++i) {
-    (*i)->setParameters(p) ;
+  if (theWeight != NULL) {
+    theWeight->setParameters(p) ;
   }
 }
 
 void bioThreadMemory::setFixedParameters(std::vector<bioReal>* p) {
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = loglikes.begin() ;
-       i != loglikes.end() ;
-       ++i) {
-    (*i)->setFixedParameters(p) ;
+  if (theLoglike != NULL) {
+    theLoglike->setFixedParameters(p) ;
   }
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = weights.begin() ;
-       i != weights.end() ;
-       ++i) {
-    (*i)->setFixedParameters(p) ;
+  if (theWeight != NULL) {
+    theWeight->setFixedParameters(p) ;
   }
-
 }
 
 void bioThreadMemory::setData(std::vector< std::vector<bioReal> >* d) {
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = loglikes.begin() ;
-       i != loglikes.end() ;
-       ++i) {
-    (*i)->setData(d) ;
+  if (theLoglike != NULL) {
+    theLoglike->setData(d) ;
   }
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = weights.begin() ;
-       i != weights.end() ;
-       ++i) {
-    (*i)->setData(d) ;
+  if (theWeight != NULL) {
+    theWeight->setData(d) ;
   }
-
 }
 
 void bioThreadMemory::setMissingData(bioReal md) {
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = loglikes.begin() ;
-       i != loglikes.end() ;
-       ++i) {
-    (*i)->setMissingData(md) ;
+  if (theLoglike != NULL) {
+    theLoglike->setMissingData(md) ;
   }
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = weights.begin() ;
-       i != weights.end() ;
-       ++i) {
-    (*i)->setMissingData(md) ;
+  if (theWeight != NULL) {
+    theWeight->setMissingData(md) ;
   }
 }
 
+void bioThreadMemory::prepareData() {
+  if (theLoglike != NULL) {
+    theLoglike->prepareData() ;
+  }
+  if (theWeight != NULL) {
+    theWeight->prepareData() ;
+  }
+}
 
 void bioThreadMemory::setDataMap(std::vector< std::vector<bioUInt> >* dm) {
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = loglikes.begin() ;
-       i != loglikes.end() ;
-       ++i) {
-    (*i)->setDataMap(dm) ;
+  if (theLoglike != NULL) {
+    theLoglike->setDataMap(dm) ;
+  }
+  if (theWeight != NULL) {
+    theWeight->setDataMap(dm) ;
+  }
+}
+
+void bioThreadMemory::setDraws(const bioDrawTable* d) {
+  if (theLoglike != NULL) {
+    theLoglike->setDraws(d) ;
+  }
+  if (theWeight != NULL) {
+    theWeight->setDraws(d) ;
+  }
+}
+
+void bioThreadMemory::setDrawGenerator(const bioDrawGenerator* g) {
+  if (theLoglike != NULL) {
+    theLoglike->setDrawGenerator(g) ;
   }
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = weights.begin() ;
-       i != weights.end() ;
-       ++i) {
-    (*i)->setDataMap(dm) ;
+  if (theWeight != NULL) {
+    theWeight->setDrawGenerator(g) ;
   }
 }
 
-void bioThreadMemory::setDraws(std::vector< std::vector< std::vector<bioReal> > >* d) {
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = loglikes.begin() ;
-       i != loglikes.end() ;
-       ++i) {
-    (*i)->setDraws(d) ;
+void bioThreadMemory::setNumberOfDraws(bioUInt r) {
+  if (theLoglike != NULL) {
+    theLoglike->setNumberOfDraws(r) ;
   }
-  for (std::vector<bioSmartPointer<bioFormula> >::iterator i = weights.begin() ;
-       i != weights.end() ;
-       ++i) {
-    (*i)->setDraws(d) ;
+  if (theWeight != NULL) {
+    theWeight->setNumberOfDraws(r) ;
   }
-  
 }
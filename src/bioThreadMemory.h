@@ -17,6 +17,8 @@
 #include "bioTypes.h"
 #include "bioString.h"
 #include "bioFormula.h"
+#include "bioEvaluationState.h"
+#include "bioPartialIntegral.h"
 
 class bioExpression ;
 
@@ -34,10 +36,28 @@ typedef struct{
   bioReal result ;
   bioUInt startData ;
   bioUInt endData ;
+  // Indices of the rows (or individuals) in the sample. If NULL, all
+  // the data between startData and endData is used.
+  std::vector<bioUInt>* sample ;
+  // The formulas are shared by all threads.
   bioSmartPointer<bioFormula> theLoglike ;
   bioSmartPointer<bioFormula> theWeight ;
   std::vector<bioUInt>* literalIds ;
   bioBoolean panel ;
+  // Row, individual and draw of the evaluation in progress in this thread
+  bioEvaluationState state ;
+  // If drawChunks > 1, the draws of each individual are split into
+  // drawChunks ranges of drawChunkSize draws. The work item i is the
+  // range i % drawChunks of the individual i / drawChunks of the
+  // sample. The thread processes the items threadId, threadId+step,
+  // ... and stores the partial sums of the integral in partials, and
+  // the weight of the individuals in weights.
+  bioUInt drawChunks ;
+  bioUInt drawChunkSize ;
+  bioUInt numberOfDraws ;
+  bioUInt step ;
+  std::vector<bioPartialIntegral>* partials ;
+  std::vector<bioReal>* weights ;
 } bioThreadArg ;
 
 
@@ -47,21 +67,29 @@ class bioThreadMemory {
   bioThreadMemory(bioUInt nThreads,bioUInt dim) ;
   ~bioThreadMemory() ;
   bioThreadArg* getInput(bioUInt t) ;
-  void setLoglike(std::vector<bioString> f) ;
-  void setWeight(std::vector<bioString> w) ;
+  // If the cache directory is empty, the formulas are not cached.
+  void setLoglike(std::vector<bioString> f, bioString cacheDirectory) ;
+  void setWeight(std::vector<bioString> w, bioString cacheDirectory) ;
   bioUInt numberOfThreads() ;
   bioUInt dimension() ;
+  void setDimension(bioUInt dim) ;
   void setParameters(std::vector<bioReal>* p) ;
   void setFixedParameters(std::vector<bioReal>* p) ;
   void setData(std::vector< std::vector<bioReal> >* d) ;
   void setMissingData(bioReal md) ;
   void setDataMap(std::vector< std::vector<bioUInt> >* dm) ;
-  void setDraws(std::vector< std::vector< std::vector<bioReal> > >* d) ;
+  void setDraws(const bioDrawTable* d) ;
+  void setDrawGenerator(const bioDrawGenerator* g) ;
+  void setNumberOfDraws(bioUInt r) ;
+  // Must be called once the data, the data map and the missing value
+  // have been set.
+  void prepareData() ;
   
  private:
   std::vector<bioThreadArg> inputStructures ;
-  std::vector<bioSmartPointer<bioFormula> > loglikes ;
-  std::vector<bioSmartPointer<bioFormula> > weights ;
+  // The formulas are parsed once, whatever the number of threads.
+  bioSmartPointer<bioFormula> theLoglike ;
+  bioSmartPointer<bioFormula> theWeight ;
 
 };
 #endif
@@ -10,6 +10,7 @@
 #include "biogeme.h"
 #include <iostream>
 #include <sstream>
+#include <limits>
 #include <cmath>
 #include "bioSmartPointer.h"
 #include <algorithm>
@@ -18,19 +19,28 @@
 #include "bioDebug.h"
 #include "bioThreadMemory.h"
 #include "bioExpression.h"
+#include "bioEvaluationState.h"
 #include "bioCfsqp.h"
+#include "bioDrawCache.h"
 
 // Dealing with exceptions across threads
 static std::exception_ptr theExceptionPtr = nullptr ;
 
 void *computeFunctionForThread( void *ptr );
+void *computePartialIntegralsForThread( void *ptr );
 
 biogeme::biogeme(): nbrOfThreads(1),
 		    fixedBetasDefined(false),
 		    calculateHessian(false),
 		    calculateBhhh(false),
+		    missingData(99999),
 		    panel(false),
-		    forceDataPreparation(true) {
+		    forceFormulaPreparation(true),
+		    forceDataPreparation(true),
+		    nbrOfDataBlocks(0),
+		    drawChunks(1),
+		    drawChunkSize(0),
+		    activeNumberOfDraws(0) {
 }
 
 biogeme::~biogeme() {
@@ -38,15 +48,17 @@ biogeme::~biogeme() {
 
 void biogeme::setPanel(bioBoolean p) {
   panel = p ;
+  forceDataPreparation = true ;
 }
 
 bioReal biogeme::calculateLikelihood(std::vector<bioReal>& betas,
 				     std::vector<bioReal>& fixedBetas) {
 
   ++nbrFctEvaluations ;
-  if (forceDataPreparation || (theThreadMemory->dimension() != literalIds.size())) {
+  if (forceDataPreparation ||
+      forceFormulaPreparation ||
+      (theThreadMemory->dimension() != literalIds.size())) {
     prepareData() ;
-    forceDataPreparation = false ;
   }
   theThreadMemory->setParameters(&betas) ;
   theThreadMemory->setFixedParameters(&fixedBetas) ;
@@ -81,12 +93,16 @@ bioReal biogeme::applyTheFormula(  std::vector<bioReal>* g,
     }
   }
 
-  //  std::vector<bioThreadArg*> theInput(nbrOfThreads) ;
-  std::vector<pthread_t> theThreads(nbrOfThreads) ;
+  // The draws are split among the threads only for the value and
+  // the gradient.
+  bioBoolean splitDraws = (drawChunks > 1 && h == NULL) ;
+  // Only the threads that have received a block of data are launched.
+  bioUInt nbrOfActiveThreads = (splitDraws) ? theInput.size() : nbrOfDataBlocks ;
+  std::vector<pthread_t> theThreads(nbrOfActiveThreads) ;
   if (theThreadMemory == NULL) {
     throw bioExceptNullPointer(__FILE__,__LINE__,"thread memory") ;
   }
-  for (bioUInt thread = 0 ; thread < nbrOfThreads ; ++thread) {
+  for (bioUInt thread = 0 ; thread < nbrOfActiveThreads ; ++thread) {
     if (theInput[thread] == NULL) {
       throw bioExceptNullPointer(__FILE__,__LINE__,"thread") ;
     }
@@ -100,7 +116,7 @@ bioReal biogeme::applyTheFormula(  std::vector<bioReal>* g,
     try {
       diagnostic = pthread_create(&(theThreads[thread]),
 				  NULL,
-				  computeFunctionForThread,
+				  (splitDraws) ? computePartialIntegralsForThread : computeFunctionForThread,
 				  (void*) theInput[thread]) ;
     }
     catch (std::exception& e) {
@@ -109,7 +125,7 @@ bioReal biogeme::applyTheFormula(  std::vector<bioReal>* g,
 
     if (diagnostic != 0) {
       std::stringstream str ;
-      str << "Error " << diagnostic << " in creating thread " << thread << "/" << nbrOfThreads ;
+      str << "Error " << diagnostic << " in creating thread " << thread << "/" << nbrOfActiveThreads ;
       throw bioExceptions(__FILE__,__LINE__,str.str()) ;
     }
   }
@@ -124,11 +140,14 @@ bioReal biogeme::applyTheFormula(  std::vector<bioReal>* g,
       std::fill(bh->begin(),bh->end(),*g) ;
     }
   }
-  for (bioUInt thread = 0 ; thread < nbrOfThreads ; ++thread) {
+  for (bioUInt thread = 0 ; thread < nbrOfActiveThreads ; ++thread) {
     pthread_join( theThreads[thread], NULL);
     if (theExceptionPtr != nullptr) {
       std::rethrow_exception(theExceptionPtr);
     }
+    if (splitDraws) {
+      continue ;
+    }
     result += theInput[thread]->result ;
     if (g != NULL) {
       for (bioUInt i = 0 ; i < g->size() ; ++i) {
@@ -147,6 +166,10 @@ bioReal biogeme::applyTheFormula(  std::vector<bioReal>* g,
     }
   }
 
+  if (splitDraws) {
+    result = reducePartialIntegrals(g,bh) ;
+  }
+
   if (!std::isfinite(result)) {
     result = -std::numeric_limits<bioReal>::max() ;
   }
@@ -204,9 +227,10 @@ bioReal biogeme::calculateLikeAndDerivatives(std::vector<bioReal>& betas,
 
   ++nbrFctEvaluations ;
   literalIds = betaIds ;
-  if (forceDataPreparation || (theThreadMemory->dimension() != literalIds.size())) {
+  if (forceDataPreparation ||
+      forceFormulaPreparation ||
+      (theThreadMemory->dimension() != literalIds.size())) {
     prepareData() ;
-    forceDataPreparation = false ;
   }
   calculateHessian = hessian ;
   calculateBhhh = bhhh ;
@@ -254,10 +278,15 @@ void biogeme::setExpressions(std::vector<bioString> ll,
   theLoglikeString = ll ;
   theWeightString = w ;
   nbrOfThreads = t ;
+  forceFormulaPreparation = true ;
   prepareData() ;
 
 }
 
+void biogeme::setCacheDirectory(bioString d) {
+  cacheDirectory = d ;
+}
+
 void *computeFunctionForThread(void* fctPtr) {
   try {
     bioThreadArg *input = (bioThreadArg *) fctPtr;
@@ -273,14 +302,18 @@ void *computeFunctionForThread(void* fctPtr) {
       }
     }
 
+    // The formula is shared with the other threads. The indices of
+    // the current evaluation are stored in the state of this thread.
+    bioEvaluationState* state = &(input->state) ;
+    state->reset() ;
+    bioEvaluationState::setCurrent(state) ;
     bioSmartPointer<bioExpression> myLoglike = input->theLoglike->getExpression() ;
     if (input->panel) {
       // Panel data
-      bioUInt individual ;
-      myLoglike->setIndividualIndex(&individual) ;
-      for (individual = input->startData ;
-	   individual < input->endData ;
-	   ++individual) {
+      for (bioUInt k = input->startData ;
+	   k < input->endData ;
+	   ++k) {
+	state->individual = (input->sample == NULL) ? k : (*input->sample)[k] ;
 	if (input->theWeight != NULL) {
 	  w = input->theWeight->getExpression()->getValue() ;
 	}
@@ -325,19 +358,15 @@ void *computeFunctionForThread(void* fctPtr) {
     }
     else {
       // No panel data
-      bioUInt row ;
       if (myLoglike == NULL) {
 	throw bioExceptNullPointer(__FILE__,__LINE__,"thread memory") ;
       }
-      myLoglike->setIndividualIndex(&row) ;
-      myLoglike->setRowIndex(&row) ;
-      if (input->theWeight != NULL) {
-	input->theWeight->setIndividualIndex(&row) ;
-	input->theWeight->setRowIndex(&row) ;
-      }
-      for (row = input->startData ;
-	   row < input->endData ;
-	   ++row) {
+      for (bioUInt k = input->startData ;
+	   k < input->endData ;
+	   ++k) {
+	bioUInt row = (input->sample == NULL) ? k : (*input->sample)[k] ;
+	state->row = row ;
+	state->individual = row ;
 	try {
 	  if (input->theWeight != NULL) {
 	    w = input->theWeight->getExpression()->getValue() ;
@@ -389,26 +418,66 @@ void *computeFunctionForThread(void* fctPtr) {
 	}
       }
     }
-    input->theLoglike->setRowIndex(NULL) ;
-    input->theLoglike->setIndividualIndex(NULL) ;
-    if (input->theWeight != NULL) {
-      input->theWeight->setRowIndex(NULL) ;
-      input->theWeight->setIndividualIndex(NULL) ;
-    }
+    bioEvaluationState::setCurrent(NULL) ;
   }
   catch(...)  {
+    bioEvaluationState::setCurrent(NULL) ;
     theExceptionPtr = std::current_exception() ;
   }
 
   return NULL ;
 }
 
+void *computePartialIntegralsForThread(void* fctPtr) {
+  try {
+    bioThreadArg *input = (bioThreadArg *) fctPtr;
+    bioEvaluationState* state = &(input->state) ;
+    state->reset() ;
+    bioEvaluationState::setCurrent(state) ;
+    bioSmartPointer<bioExpression> myLoglike = input->theLoglike->getExpression() ;
+    bioUInt numberOfItems = input->partials->size() ;
+    for (bioUInt item = input->threadId ; item < numberOfItems ; item += input->step) {
+      bioUInt k = item / input->drawChunks ;
+      bioUInt chunk = item % input->drawChunks ;
+      bioUInt individual = (input->sample == NULL) ? k : (*input->sample)[k] ;
+      state->individual = individual ;
+      state->row = (input->panel) ? bioBadId : individual ;
+      try {
+	if (chunk == 0) {
+	  (*input->weights)[k] = (input->theWeight == NULL) ? 1.0 : input->theWeight->getExpression()->getValue() ;
+	}
+	bioUInt firstDraw = chunk * input->drawChunkSize ;
+	bioUInt lastDraw = std::min(firstDraw + input->drawChunkSize,input->numberOfDraws) ;
+	myLoglike->getPartialLogIntegral(*input->literalIds,
+					 input->calcGradient,
+					 firstDraw,
+					 lastDraw,
+					 (*input->partials)[item]) ;
+      }
+      catch(bioExceptions& e) {
+	if (input->panel) {
+	  throw ;
+	}
+	std::stringstream str ;
+	str << "Error for data entry " << individual << " : " << e.what() ;
+	throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+      }
+    }
+    bioEvaluationState::setCurrent(NULL) ;
+  }
+  catch(...)  {
+    bioEvaluationState::setCurrent(NULL) ;
+    theExceptionPtr = std::current_exception() ;
+  }
+  return NULL ;
+}
+
 void biogeme::prepareMemoryForThreads(bioBoolean force) {
   theThreadMemory = bioSmartPointer<bioThreadMemory>(new bioThreadMemory(nbrOfThreads,
 									 literalIds.size())) ;
-  theThreadMemory->setLoglike(theLoglikeString) ;
+  theThreadMemory->setLoglike(theLoglikeString,cacheDirectory) ;
   if (!theWeightString.empty()) {
-    theThreadMemory->setWeight(theWeightString) ;
+    theThreadMemory->setWeight(theWeightString,cacheDirectory) ;
   }
 }
 
@@ -421,35 +490,49 @@ void biogeme::simulateFormula(std::vector<bioString> formula,
   bioFormula theFormula(formula) ;
   theFormula.setParameters(&beta) ;
   theFormula.setFixedParameters(&fixedBeta) ;
-  if (!theDraws.empty()) {
+  if (theDrawGenerator != NULL) {
+    theFormula.setDrawGenerator(&(*theDrawGenerator)) ;
+  }
+  else if (!theDraws.empty()) {
     theFormula.setDraws(&theDraws) ;
   }  
+  if (getNumberOfAvailableDraws() > 0) {
+    theFormula.setNumberOfDraws(activeNumberOfDraws) ;
+  }
 
   bioUInt N = data.size() ;
   results.resize(N) ;
   theFormula.setData(&data) ;
   theFormula.setMissingData(missingData) ;
-  bioUInt row ;
-  theFormula.setRowIndex(&row) ;
-  theFormula.setIndividualIndex(&row) ;
-  for (row = 0 ;
-       row < N ;
-       ++row) {
-    results[row] = theFormula.getExpression()->getValue() ;
-  }
-  theFormula.setRowIndex(NULL) ;
-  theFormula.setIndividualIndex(NULL) ;
+  theFormula.prepareData() ;
+  bioEvaluationState state ;
+  bioEvaluationState::setCurrent(&state) ;
+  try {
+    for (bioUInt row = 0 ;
+	 row < N ;
+	 ++row) {
+      state.row = state.individual = row ;
+      results[row] = theFormula.getExpression()->getValue() ;
+    }
+  }
+  catch(...) {
+    bioEvaluationState::setCurrent(NULL) ;
+    throw ;
+  }
+  bioEvaluationState::setCurrent(NULL) ;
   return ;
 }
 
 
 void biogeme::setData(std::vector< std::vector<bioReal> >& d) {
   theData = d ;
+  theSample.clear() ;
   forceDataPreparation = true ;
 }
 
 void biogeme::setDataMap(std::vector< std::vector<bioUInt> >& dm) {
   theDataMap = dm ;
+  theSample.clear() ;
   forceDataPreparation = true ;
 }
 
@@ -458,28 +541,111 @@ void biogeme::setMissingData(bioReal md) {
   forceDataPreparation = true ;
 }
 
-void biogeme::setDraws(std::vector< std::vector< std::vector<bioReal> > >& draws) {
-  theDraws = draws ;
+void biogeme::setDraws(const bioReal* draws,
+		       bioUInt sampleSize,
+		       bioUInt numberOfDraws,
+		       bioUInt numberOfVariables) {
+  theDraws.set(draws,sampleSize,numberOfDraws,numberOfVariables) ;
+  theDrawGenerator = bioSmartPointer<bioDrawGenerator>() ;
+  activeNumberOfDraws = 0 ;
+  forceDataPreparation = true ;
+}
+
+void biogeme::setDraws(const float* draws,
+		       bioUInt sampleSize,
+		       bioUInt numberOfDraws,
+		       bioUInt numberOfVariables) {
+  theDraws.set(draws,sampleSize,numberOfDraws,numberOfVariables) ;
+  theDrawGenerator = bioSmartPointer<bioDrawGenerator>() ;
+  activeNumberOfDraws = 0 ;
+  forceDataPreparation = true ;
+}
+
+void biogeme::setSharedDraws(const bioReal* base,
+			     const bioReal* shifts,
+			     std::vector<bioString> types,
+			     bioUInt sampleSize,
+			     bioUInt numberOfDraws,
+			     bioUInt numberOfVariables) {
+  theDraws.setShared(base,shifts,types,sampleSize,numberOfDraws,numberOfVariables) ;
+  theDrawGenerator = bioSmartPointer<bioDrawGenerator>() ;
+  activeNumberOfDraws = 0 ;
+  forceDataPreparation = true ;
+}
+
+bioBoolean biogeme::setCachedDraws(std::vector<bioString> types,
+				   bioUInt sampleSize,
+				   bioUInt numberOfDraws,
+				   bioUInt seed,
+				   bioBoolean singlePrecision,
+				   bioUInt nbrOfThreads) {
+  theDrawGenerator = bioSmartPointer<bioDrawGenerator>() ;
+  activeNumberOfDraws = 0 ;
+  forceDataPreparation = true ;
+  if (cacheDirectory.empty()) {
+    theDraws.generate(bioDrawGenerator(types,numberOfDraws,seed),sampleSize,singlePrecision,nbrOfThreads) ;
+    return false ;
+  }
+  bioDrawCache theCache(cacheDirectory,types,sampleSize,numberOfDraws,seed,singlePrecision) ;
+  if (theCache.load(theDraws)) {
+    return true ;
+  }
+  theDraws.generate(bioDrawGenerator(types,numberOfDraws,seed),sampleSize,singlePrecision,nbrOfThreads) ;
+  theCache.save(theDraws) ;
+  return false ;
+}
+
+void biogeme::setDrawGenerator(std::vector<bioString> types,
+			       bioUInt numberOfDraws,
+			       bioUInt seed) {
+  theDrawGenerator = bioSmartPointer<bioDrawGenerator>(new bioDrawGenerator(types,numberOfDraws,seed)) ;
+  // Release the memory of the table of draws
+  theDraws.clear() ;
+  activeNumberOfDraws = 0 ;
+  forceDataPreparation = true ;
+}
+
+void biogeme::setNumberOfDraws(bioUInt r) {
+  bioUInt available = getNumberOfAvailableDraws() ;
+  if (r > available) {
+    throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,r,0,available) ;
+  }
+  activeNumberOfDraws = r ;
   forceDataPreparation = true ;
 }
 
 void biogeme::prepareData() {
 
   // Here, we prepare the data that do not vary from one call of the
-  // functions to the next.
+  // functions to the next. The formulas are parsed only if the
+  // expressions have changed. Otherwise, the data is bound to the
+  // existing formulas.
 
-  prepareMemoryForThreads() ;
+  if (forceFormulaPreparation || theThreadMemory == NULL) {
+    prepareMemoryForThreads() ;
+    forceFormulaPreparation = false ;
+  }
   if (theThreadMemory == NULL) {
     throw bioExceptNullPointer(__FILE__,__LINE__,"thread memory") ;
   }
+  if (theThreadMemory->dimension() != literalIds.size()) {
+    theThreadMemory->setDimension(literalIds.size()) ;
+  }
   theThreadMemory->setData(&theData) ;
   if (panel) {
     theThreadMemory->setDataMap(&theDataMap) ;
   }
   theThreadMemory->setMissingData(missingData) ;
-  if (!theDraws.empty()) {
+  if (theDrawGenerator != NULL) {
+    theThreadMemory->setDrawGenerator(&(*theDrawGenerator)) ;
+  }
+  else if (!theDraws.empty()) {
     theThreadMemory->setDraws(&theDraws) ;
   }
+  if (getNumberOfAvailableDraws() > 0) {
+    theThreadMemory->setNumberOfDraws(activeNumberOfDraws) ;
+  }
+  theThreadMemory->prepareData() ;
 
   if (theThreadMemory->dimension() < literalIds.size()) {
     std::stringstream str ;
@@ -487,59 +653,240 @@ void biogeme::prepareData() {
     throw bioExceptions(__FILE__,__LINE__,str.str()) ;
   }
   
-  // Prepare the input for the threads
-
-  // Calculate the size of the block  of data to be sent to each thread
-  bioUInt sizeOfEachBlock ;
-  bioUInt numberOfBlocks ;
-  if (panel) {
-    sizeOfEachBlock = ceil(bioReal(theDataMap.size())/bioReal(nbrOfThreads)) ;
-    numberOfBlocks = ceil(bioReal(theDataMap.size()) / bioReal(sizeOfEachBlock)) ;
+  theInput.clear() ;
+  for (bioUInt thread = 0 ; thread < nbrOfThreads ; ++thread) {
+    bioThreadArg* input = theThreadMemory->getInput(thread) ;
+    if (input == NULL) {
+      throw bioExceptNullPointer(__FILE__,__LINE__,"thread memory") ;
+    }
+    input->panel = panel ;
+    input->data = &theData ;
+    if (panel) {
+      input->dataMap = &theDataMap ;
+    }
+    input->missingData = missingData ;
+    input->literalIds = &literalIds ;
   }
-  else {
-    sizeOfEachBlock = ceil(bioReal(theData.size())/bioReal(nbrOfThreads)) ;
-    numberOfBlocks = ceil(bioReal(theData.size()) / bioReal(sizeOfEachBlock)) ;
+  prepareThreadBlocks() ;
+  forceDataPreparation = false ;
+}
+
+void biogeme::prepareThreadBlocks() {
+
+  // Calculate the size of the block of data to be sent to each
+  // thread. Only this needs to be updated when the sample changes.
+  bioUInt sampleSize = getSampleSize() ;
+  std::vector<bioUInt>* theIndices = (theSample.empty()) ? NULL : &theSample ;
+  bioUInt sizeOfEachBlock = ceil(bioReal(sampleSize)/bioReal(nbrOfThreads)) ;
+  if (sizeOfEachBlock == 0) {
+    sizeOfEachBlock = 1 ;
   }
+  bioUInt numberOfBlocks = ceil(bioReal(sampleSize) / bioReal(sizeOfEachBlock)) ;
   // For small data sets, there may be more threads than number of blocks.
-  if (numberOfBlocks < nbrOfThreads) {
-    nbrOfThreads = numberOfBlocks ;
+  nbrOfDataBlocks = std::min(nbrOfThreads,numberOfBlocks) ;
+  prepareDrawChunks(sampleSize) ;
+  bioUInt numberOfItems = sampleSize * drawChunks ;
+  bioUInt nbrOfActiveThreads = nbrOfDataBlocks ;
+  if (drawChunks > 1) {
+    nbrOfActiveThreads = std::min(nbrOfThreads,numberOfItems) ;
   }
 
-  theInput.resize(nbrOfThreads,NULL) ;
-
-  for (bioUInt thread = 0 ; thread < nbrOfThreads ; ++thread) {
+  theInput.resize(nbrOfActiveThreads,NULL) ;
+  for (bioUInt thread = 0 ; thread < nbrOfActiveThreads ; ++thread) {
     theInput[thread] = theThreadMemory->getInput(thread) ;
-    theInput[thread]->panel = panel ;
     if (theInput[thread] == NULL) {
       throw bioExceptNullPointer(__FILE__,__LINE__,"thread memory") ;
     }
-    theInput[thread]->data = &theData ;
-    if (panel) {
-      theInput[thread]->dataMap = &theDataMap ;
-    }
-    theInput[thread]->missingData = missingData ;
-    theInput[thread]->startData = thread * sizeOfEachBlock ;
-    if (panel) {
-      theInput[thread]->endData = (thread == nbrOfThreads-1) ? theDataMap.size() : (thread+1) * sizeOfEachBlock ;
+    theInput[thread]->sample = theIndices ;
+    if (thread < nbrOfDataBlocks) {
+      theInput[thread]->startData = thread * sizeOfEachBlock ;
+      theInput[thread]->endData = (thread == nbrOfDataBlocks-1) ? sampleSize : (thread+1) * sizeOfEachBlock ;
     }
     else {
-      theInput[thread]->endData = (thread == nbrOfThreads-1) ? theData.size() : (thread+1) * sizeOfEachBlock ;
+      theInput[thread]->startData = theInput[thread]->endData = sampleSize ;
     }
-    theInput[thread]->literalIds = &literalIds ;
-    bioSmartPointer<bioExpression>  theLoglike = theInput[thread]->theLoglike->getExpression() ;
-    theLoglike->setData(theInput[thread]->data) ;
-    if (panel) {
-      theLoglike->setDataMap(theInput[thread]->dataMap) ;
+    // The work items are interleaved, so that the threads finish at
+    // about the same time.
+    theInput[thread]->drawChunks = drawChunks ;
+    theInput[thread]->drawChunkSize = drawChunkSize ;
+    theInput[thread]->numberOfDraws = getNumberOfDraws() ;
+    theInput[thread]->step = nbrOfActiveThreads ;
+    theInput[thread]->partials = &thePartials ;
+    theInput[thread]->weights = &theWeights ;
+  }
+}
+
+void biogeme::prepareDrawChunks(bioUInt sampleSize) {
+  drawChunks = 1 ;
+  drawChunkSize = 0 ;
+  bioUInt numberOfDraws = getNumberOfDraws() ;
+  if (nbrOfThreads <= 1 || sampleSize == 0 || numberOfDraws <= bioDrawBatchSize) {
+    return ;
+  }
+  bioSmartPointer<bioExpression> theLoglike = theThreadMemory->getInput(0)->theLoglike->getExpression() ;
+  if (theLoglike == NULL || !theLoglike->isDrawSplittable()) {
+    return ;
+  }
+  // If there are enough individuals to keep the threads busy, only
+  // the individuals are split among the threads.
+  bioUInt numberOfItems = bioWorkItemsPerThread * nbrOfThreads ;
+  if (sampleSize >= numberOfItems) {
+    return ;
+  }
+  // Each range contains a whole number of batches of draws.
+  bioUInt numberOfBatches = (numberOfDraws + bioDrawBatchSize - 1) / bioDrawBatchSize ;
+  bioUInt chunks = std::min((numberOfItems + sampleSize - 1) / sampleSize,numberOfBatches) ;
+  drawChunkSize = bioDrawBatchSize * ((numberOfBatches + chunks - 1) / chunks) ;
+  drawChunks = (numberOfDraws + drawChunkSize - 1) / drawChunkSize ;
+  if (drawChunks <= 1) {
+    drawChunks = 1 ;
+    drawChunkSize = 0 ;
+    return ;
+  }
+  thePartials.assign(sampleSize * drawChunks,bioPartialIntegral(literalIds.size())) ;
+  theWeights.assign(sampleSize,1.0) ;
+}
+
+bioUInt biogeme::getNumberOfAvailableDraws() const {
+  if (theDrawGenerator != NULL) {
+    return theDrawGenerator->getNumberOfDraws() ;
+  }
+  return theDraws.getNumberOfDraws() ;
+}
+
+bioUInt biogeme::getNumberOfDraws() const {
+  bioUInt available = getNumberOfAvailableDraws() ;
+  if (activeNumberOfDraws == 0 || activeNumberOfDraws > available) {
+    return available ;
+  }
+  return activeNumberOfDraws ;
+}
+
+bioReal biogeme::reducePartialIntegrals(std::vector<bioReal>* g,
+					std::vector< std::vector<bioReal> >* bh) {
+  bioUInt numberOfDraws = getNumberOfDraws() ;
+  bioUInt n = literalIds.size() ;
+  bioDerivatives d(n) ;
+  bioReal result(0.0) ;
+  for (bioUInt k = 0 ; k < theWeights.size() ; ++k) {
+    bioPartialIntegral& p = thePartials[k * drawChunks] ;
+    for (bioUInt c = 1 ; c < drawChunks ; ++c) {
+      p.merge(thePartials[k * drawChunks + c]) ;
     }
-    theLoglike->setMissingData(theInput[thread]->missingData) ;
-    if (theInput[thread]->theWeight != NULL) {
-      theInput[thread]->theWeight->setData(theInput[thread]->data) ;
-      if (panel) {
-	theInput[thread]->theWeight->setDataMap(theInput[thread]->dataMap) ;
+    p.getLogIntegral(numberOfDraws,g != NULL,d) ;
+    bioReal w = theWeights[k] ;
+    result += w * d.f ;
+    if (g != NULL) {
+      for (bioUInt i = 0 ; i < n ; ++i) {
+	(*g)[i] += w * d.g[i] ;
+	if (bh != NULL) {
+	  for (bioUInt j = i ; j < n ; ++j) {
+	    (*bh)[i][j] += w * d.g[i] * d.g[j] ;
+	  }
+	}
       }
-      theInput[thread]->theWeight->setMissingData(theInput[thread]->missingData) ;
     }
   }
+  return result ;
+}
+
+bioUInt biogeme::getPopulationSize() const {
+  return (panel) ? theDataMap.size() : theData.size() ;
+}
+
+std::vector<bioUInt> biogeme::getSample() const {
+  if (!theSample.empty()) {
+    return theSample ;
+  }
+  std::vector<bioUInt> s(getPopulationSize()) ;
+  for (bioUInt i = 0 ; i < s.size() ; ++i) {
+    s[i] = i ;
+  }
+  return s ;
+}
+
+bioUInt biogeme::getSampleSize() const {
+  return (theSample.empty()) ? getPopulationSize() : theSample.size() ;
+}
+
+void biogeme::setSeed(bioUInt s) {
+  randomGenerator.seed(s) ;
+}
+
+void biogeme::setSample(std::vector<bioUInt>& s) {
+  bioUInt n = getPopulationSize() ;
+  for (std::vector<bioUInt>::iterator i = s.begin() ; i != s.end() ; ++i) {
+    if (*i >= n) {
+      throw bioExceptOutOfRange<bioUInt>(__FILE__,__LINE__,*i,0,n-1) ;
+    }
+  }
+  theSample = s ;
+  std::sort(theSample.begin(),theSample.end()) ;
+  if (!forceDataPreparation) {
+    prepareThreadBlocks() ;
+  }
+}
+
+void biogeme::sampleWithoutReplacement(bioReal samplingRate,
+				       std::vector<bioReal>& weights) {
+  if (samplingRate <= 0.0 || samplingRate > 1.0) {
+    throw bioExceptOutOfRange<bioReal>(__FILE__,__LINE__,samplingRate,0.0,1.0) ;
+  }
+  bioUInt n = getPopulationSize() ;
+  if (!weights.empty() && weights.size() != n) {
+    std::stringstream str ;
+    str << "Incompatible sizes: " << weights.size() << " weights for " << n << " entries" ;
+    throw bioExceptions(__FILE__,__LINE__,str.str()) ;
+  }
+  bioUInt size = bioUInt(round(samplingRate * bioReal(n))) ;
+  if (size == 0) {
+    size = 1 ;
+  }
+  if (size >= n) {
+    useFullSample() ;
+    return ;
+  }
+  std::vector<bioUInt> indices(n) ;
+  for (bioUInt i = 0 ; i < n ; ++i) {
+    indices[i] = i ;
+  }
+  std::uniform_real_distribution<bioReal> uniform(0.0,1.0) ;
+  if (weights.empty()) {
+    // Partial Fisher-Yates shuffle
+    for (bioUInt i = 0 ; i < size ; ++i) {
+      std::uniform_int_distribution<bioUInt> pick(i,n-1) ;
+      std::swap(indices[i],indices[pick(randomGenerator)]) ;
+    }
+  }
+  else {
+    // Efraimidis and Spirakis: the entries with the largest keys
+    // u^(1/w) are selected.
+    std::vector<bioReal> keys(n) ;
+    for (bioUInt i = 0 ; i < n ; ++i) {
+      if (weights[i] <= 0.0) {
+	keys[i] = -std::numeric_limits<bioReal>::infinity() ;
+      }
+      else {
+	keys[i] = log(uniform(randomGenerator)) / weights[i] ;
+      }
+    }
+    std::nth_element(indices.begin(),
+		     indices.begin()+size,
+		     indices.end(),
+		     [&keys](bioUInt a, bioUInt b) { return keys[a] > keys[b] ; }) ;
+  }
+  theSample.assign(indices.begin(),indices.begin()+size) ;
+  std::sort(theSample.begin(),theSample.end()) ;
+  if (!forceDataPreparation) {
+    prepareThreadBlocks() ;
+  }
+}
+
+void biogeme::useFullSample() {
+  theSample.clear() ;
+  if (!forceDataPreparation) {
+    prepareThreadBlocks() ;
+  }
 }
 
 bioUInt biogeme::getDimension() const {
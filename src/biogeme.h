@@ -13,9 +13,12 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <random>
 #include "bioTypes.h"
 #include "bioString.h"
 #include "bioThreadMemory.h"
+#include "bioDrawGenerator.h"
+#include "bioDrawTable.h"
 
 class bioExpression ;
 class bioThreadMemory ;
@@ -66,10 +69,66 @@ class biogeme {
   void setExpressions(std::vector<bioString> ll,
 		      std::vector<bioString> w,
 		      bioUInt t) ;
+  // Directory where the parsed formulas are stored, so that they are
+  // not parsed again by the next runs. If empty, nothing is stored.
+  void setCacheDirectory(bioString d) ;
   void setData(std::vector< std::vector<bioReal> >& d) ;
   void setDataMap(std::vector< std::vector<bioUInt> >& dm) ;
   void setMissingData(bioReal md) ;
-  void setDraws(std::vector< std::vector< std::vector<bioReal> > >& draws) ;
+  // The draws are ordered as [individual][variable][draw]. They are
+  // copied in a table, in single precision if requested.
+  void setDraws(const bioReal* draws,
+		bioUInt sampleSize,
+		bioUInt numberOfDraws,
+		bioUInt numberOfVariables) ;
+  void setDraws(const float* draws,
+		bioUInt sampleSize,
+		bioUInt numberOfDraws,
+		bioUInt numberOfVariables) ;
+  // Quasi Monte-Carlo draws shared by the individuals. The uniform
+  // draws of the base sequences are ordered as [variable][draw], and
+  // the shifts as [individual][variable]. The types of draws define
+  // the distribution of each variable.
+  void setSharedDraws(const bioReal* base,
+		      const bioReal* shifts,
+		      std::vector<bioString> types,
+		      bioUInt sampleSize,
+		      bioUInt numberOfDraws,
+		      bioUInt numberOfVariables) ;
+  // The draws are generated from the seed, and stored in a table. If
+  // a cache directory is defined, the table is saved in a file the
+  // first time, and the file is mapped in memory by the next
+  // runs. Returns true if the draws have been read from the cache.
+  bioBoolean setCachedDraws(std::vector<bioString> types,
+			    bioUInt sampleSize,
+			    bioUInt numberOfDraws,
+			    bioUInt seed,
+			    bioBoolean singlePrecision,
+			    bioUInt nbrOfThreads) ;
+  // The draws are generated when needed, from the seed, and are not
+  // stored. It replaces the table of draws set by setDraws.
+  void setDrawGenerator(std::vector<bioString> types,
+			bioUInt numberOfDraws,
+			bioUInt seed) ;
+  // Only the first r draws of each individual are used. As the draws
+  // are nested, the number of draws can be increased during the
+  // estimation without generating them again. If r is 0, all the
+  // draws are used.
+  void setNumberOfDraws(bioUInt r) ;
+  // Mini-batches for stochastic algorithms. The data stays resident,
+  // and only the indices of the rows (or of the individuals for panel
+  // data) involved in the next evaluations are stored.
+  void setSeed(bioUInt s) ;
+  void setSample(std::vector<bioUInt>& s) ;
+  // If the weights are empty, each row (or individual) has the same
+  // probability to be selected.
+  void sampleWithoutReplacement(bioReal samplingRate,
+				std::vector<bioReal>& weights) ;
+  void useFullSample() ;
+  // Rows (or individuals) used for the next evaluations, sorted
+  std::vector<bioUInt> getSample() const ;
+  // Number of rows (or individuals) used for the next evaluations
+  bioUInt getSampleSize() const ;
   bioUInt getDimension() const ;
   void setBounds(std::vector<bioReal>& lb, std::vector<bioReal>& ub) ;
   std::vector<bioReal> getLowerBounds() ;
@@ -79,6 +138,21 @@ class biogeme {
 private: // methods
   void prepareData() ;
   void prepareMemoryForThreads(bioBoolean force = false) ;
+  void prepareThreadBlocks() ;
+  // Decides if the draws of the individuals are split among the
+  // threads, depending on the sample size, the number of draws and
+  // the number of threads.
+  void prepareDrawChunks(bioUInt sampleSize) ;
+  // Log likelihood of each individual, from the sums over the ranges
+  // of draws calculated by the threads.
+  bioReal reducePartialIntegrals(std::vector<bioReal>* g,
+				 std::vector< std::vector<bioReal> >* bh) ;
+  // Number of draws used for the integrals
+  bioUInt getNumberOfDraws() const ;
+  // Number of draws stored or generated
+  bioUInt getNumberOfAvailableDraws() const ;
+  // Number of rows, or of individuals for panel data
+  bioUInt getPopulationSize() const ;
   bioReal applyTheFormula(std::vector<bioReal>* g = NULL,
 			  std::vector< std::vector<bioReal> >* h = NULL,
 			  std::vector< std::vector<bioReal> >* bh = NULL) ;
@@ -86,6 +160,7 @@ private: // methods
 private: // data
   std::vector<bioString> theLoglikeString ;
   std::vector<bioString> theWeightString ;
+  bioString cacheDirectory ;
   bioUInt nbrOfThreads ;
   std::vector<bioUInt> literalIds ;
   std::vector<bioReal> theFixedBetas;
@@ -95,14 +170,33 @@ private: // data
   bioSmartPointer<bioThreadMemory> theThreadMemory ;
   std::vector< std::vector<bioReal> > theData ;
   std::vector< std::vector<bioUInt> > theDataMap ;
-  std::vector< std::vector< std::vector<bioReal> > > theDraws ;
+  bioDrawTable theDraws ;
+  bioSmartPointer<bioDrawGenerator> theDrawGenerator ;
   bioReal missingData ;
   std::vector<bioThreadArg*> theInput ;
   std::vector<bioReal> lowerBounds ;
   std::vector<bioReal> upperBounds ;
   bioUInt nbrFctEvaluations ;
   bioBoolean panel ;
+  // The formulas are parsed again only when the expressions or the
+  // number of threads change.
+  bioBoolean forceFormulaPreparation ;
+  // When only the data, the map, the missing value or the draws
+  // change, they are simply bound again to the existing formulas.
   bioBoolean forceDataPreparation ; 
+  // If the sample is empty, the full data set is used.
+  std::vector<bioUInt> theSample ;
+  std::mt19937 randomGenerator ;
+  // Number of threads that have received a block of data
+  bioUInt nbrOfDataBlocks ;
+  // Number of ranges of draws per individual. 1 if the draws are not
+  // split among the threads.
+  bioUInt drawChunks ;
+  bioUInt drawChunkSize ;
+  std::vector<bioPartialIntegral> thePartials ;
+  std::vector<bioReal> theWeights ;
+  // 0 if all the draws are used
+  bioUInt activeNumberOfDraws ;
 
 };
   
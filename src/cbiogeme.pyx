@@ -53,7 +53,9 @@ cdef extern from "biogeme.h":
 
 		void setExpressions(vector[string] loglikeSignatures, 
 						vector[string] weightSignatures,
-						unsigned long numberOfThreads)
+						unsigned long numberOfThreads) except +
+
+		void setCacheDirectory(string d)
 
 		void setData(double_matrix& d)
 
@@ -61,7 +63,125 @@ cdef extern from "biogeme.h":
 
 		void setMissingData(double md)
 		
-		void setDraws(double_tensor& draws)
+		void setDraws(double* draws,
+				unsigned long sampleSize,
+				unsigned long numberOfDraws,
+				unsigned long numberOfVariables) except +
+
+		void setDraws(float* draws,
+				unsigned long sampleSize,
+				unsigned long numberOfDraws,
+				unsigned long numberOfVariables) except +
+
+		void setSharedDraws(double* base,
+				double* shifts,
+				vector[string] types,
+				unsigned long sampleSize,
+				unsigned long numberOfDraws,
+				unsigned long numberOfVariables) except +
+
+		bint setCachedDraws(vector[string] types,
+				unsigned long sampleSize,
+				unsigned long numberOfDraws,
+				unsigned long seed,
+				bint singlePrecision,
+				unsigned long nbrOfThreads) except +
+
+		void setDrawGenerator(vector[string] types,
+					unsigned long numberOfDraws,
+					unsigned long seed) except +
+
+		void setNumberOfDraws(unsigned long r) except +
+
+		void setSeed(unsigned long s)
+
+		void setSample(uint_vector& s) except +
+
+		void sampleWithoutReplacement(double samplingRate,
+					double_vector& weights) except +
+
+		void useFullSample()
+
+		vector[unsigned long] getSample()
+		unsigned long getSampleSize()
+
+cdef extern from "bioDrawGenerator.h":
+
+	cdef cppclass bioDrawGenerator:
+		bioDrawGenerator(vector[string] types,
+				unsigned long numberOfDraws,
+				unsigned long seed) except +
+
+		void generate(unsigned long variable,
+				unsigned long sampleSize,
+				double* output,
+				unsigned long nbrOfThreads) except +
+
+		void generateShared(unsigned long variable,
+				unsigned long sampleSize,
+				double* base,
+				double* shifts) except +
+
+		@staticmethod
+		void haltonSequence(unsigned long base,
+				unsigned long skip,
+				unsigned long length,
+				double* output,
+				unsigned long nbrOfThreads) except +
+
+		@staticmethod
+		void normalQuantiles(const double* p,
+				unsigned long length,
+				double* output,
+				unsigned long nbrOfThreads) except +
+
+
+def generateDraws(drawType, sampleSize, numberOfDraws, seed, numberOfThreads=1):
+	"""Draws of a native type, generated in parallel by the C++ engine.
+
+	:return: array of dimensions (sampleSize, numberOfDraws)
+	"""
+	cdef np.ndarray[double, ndim=2, mode='c'] result = np.empty((sampleSize, numberOfDraws))
+	cdef vector[string] types = [drawType.encode()]
+	cdef bioDrawGenerator* theGenerator = new bioDrawGenerator(types, numberOfDraws, seed)
+	try:
+		if sampleSize > 0:
+			theGenerator.generate(0, sampleSize, &result[0, 0], numberOfThreads)
+	finally:
+		del theGenerator
+	return result
+
+def generateSharedDraws(drawType, sampleSize, numberOfDraws, seed):
+	"""Draws of a native type shared by the individuals: base sequence
+	and shift of each individual, generated by the C++ engine.
+
+	:return: arrays of dimensions (numberOfDraws,) and (sampleSize,)
+	"""
+	cdef np.ndarray[double, ndim=1, mode='c'] base = np.empty(numberOfDraws)
+	cdef np.ndarray[double, ndim=1, mode='c'] shifts = np.empty(sampleSize)
+	cdef vector[string] types = [drawType.encode()]
+	cdef bioDrawGenerator* theGenerator = new bioDrawGenerator(types, numberOfDraws, seed)
+	try:
+		if sampleSize > 0:
+			theGenerator.generateShared(0, sampleSize, &base[0], &shifts[0])
+	finally:
+		del theGenerator
+	return base, shifts
+
+def haltonSequence(base, skip, length, numberOfThreads=1):
+	"""Elements skip+1 to skip+length of the Halton sequence."""
+	cdef np.ndarray[double, ndim=1, mode='c'] result = np.empty(length)
+	if length > 0:
+		bioDrawGenerator.haltonSequence(base, skip, length, &result[0], numberOfThreads)
+	return result
+
+def normalQuantiles(p, numberOfThreads=1):
+	"""Quantiles of the standard normal distribution (algorithm AS241)."""
+	cdef np.ndarray[double, ndim=1, mode='c'] u = np.ascontiguousarray(p, dtype=np.float64).ravel()
+	cdef np.ndarray[double, ndim=1, mode='c'] result = np.empty(u.shape[0])
+	if u.shape[0] > 0:
+		bioDrawGenerator.normalQuantiles(&u[0], u.shape[0], &result[0], numberOfThreads)
+	return result.reshape(np.shape(p))
 
 
 cdef class pyBiogeme:
@@ -109,6 +229,9 @@ cdef class pyBiogeme:
 			w = weightFormulas
 		self.theBiogeme.setExpressions(loglikeFormulas,w,nbrOfThreads)
 
+	def setCacheDirectory(self, d):
+		self.theBiogeme.setCacheDirectory(d.encode())
+
 	def setData(self, d):
 		d = np.ascontiguousarray(d)
 		self.theBiogeme.setData(d)
@@ -121,13 +244,63 @@ cdef class pyBiogeme:
 		self.theBiogeme.setMissingData(md)
 
 
-	def setDraws(self, draws):
-		draws = np.ascontiguousarray(draws)
-		self.theBiogeme.setDraws(draws)
+	def setDraws(self, draws, singlePrecision=False):
+		cdef np.ndarray[double, ndim=3, mode='c'] d
+		cdef np.ndarray[float, ndim=3, mode='c'] f
+		# The draws are transmitted as [individual][variable][draw]
+		t = np.moveaxis(np.asarray(draws), 2, 1)
+		if t.size == 0:
+			self.theBiogeme.setDraws(<double*>NULL, 0, 0, 0)
+		elif singlePrecision:
+			f = np.ascontiguousarray(t, dtype=np.float32)
+			self.theBiogeme.setDraws(&f[0, 0, 0], f.shape[0], f.shape[2], f.shape[1])
+		else:
+			d = np.ascontiguousarray(t, dtype=np.float64)
+			self.theBiogeme.setDraws(&d[0, 0, 0], d.shape[0], d.shape[2], d.shape[1])
+
+	def setSharedDraws(self, base, shifts, types):
+		cdef np.ndarray[double, ndim=2, mode='c'] b
+		cdef np.ndarray[double, ndim=2, mode='c'] s
+		# The base sequences are transmitted as [variable][draw], and
+		# the shifts as [individual][variable]
+		b = np.ascontiguousarray(np.asarray(base, dtype=np.float64).T)
+		s = np.ascontiguousarray(shifts, dtype=np.float64)
+		if b.size == 0 or s.size == 0:
+			self.theBiogeme.setDraws(<double*>NULL, 0, 0, 0)
+		else:
+			self.theBiogeme.setSharedDraws(&b[0, 0], &s[0, 0], [t.encode() for t in types], s.shape[0], b.shape[1], b.shape[0])
+
+	def setCachedDraws(self, types, sampleSize, numberOfDraws, seed, singlePrecision=False, numberOfThreads=1):
+		return self.theBiogeme.setCachedDraws([t.encode() for t in types], sampleSize, numberOfDraws, seed, singlePrecision, numberOfThreads)
+
+	def setDrawGenerator(self, types, numberOfDraws, seed):
+		self.theBiogeme.setDrawGenerator([t.encode() for t in types],numberOfDraws,seed)
+
+	def setNumberOfDraws(self, r):
+		self.theBiogeme.setNumberOfDraws(r)
 
 				
 
 
 				
 
+	def setSeed(self, s):
+		self.theBiogeme.setSeed(s)
+
+	def setSample(self, indices):
+		self.theBiogeme.setSample(indices)
+
+	def sampleWithoutReplacement(self, samplingRate, weights=None):
+		cdef double_vector w
+		if (weights is not None):
+			w = np.ascontiguousarray(weights)
+		self.theBiogeme.sampleWithoutReplacement(samplingRate,w)
+
+	def useFullSample(self):
+		self.theBiogeme.useFullSample()
+
+	def getSample(self):
+		return self.theBiogeme.getSample()
 
+	def getSampleSize(self):
+		return self.theBiogeme.getSampleSize()
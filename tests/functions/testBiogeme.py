@@ -14,12 +14,50 @@ Test the biogeme module
 # Not needed in test
 # pylint: disable=missing-function-docstring, missing-class-docstring
 
+import os
+import sys
+import shutil
+import subprocess
+import tempfile
 import unittest
 import random as rnd
 import numpy as np
+import pandas as pd
+import biogeme.biogeme as bio
+import biogeme.database as db
+import biogeme.models as models
+from biogeme.expressions import Variable, Beta, exp, log, bioDraws, MonteCarlo, \
+    PanelLikelihoodTrajectory, RandomVariable, Integrate
+from testData import myData1, myData2, df1
+
+# Estimates the model with a cache directory. The first argument is
+# the directory, the second the number of unrelated objects created
+# before the model, so that the ids of the expressions differ from one
+# process to the next, and the third the power of beta2.
+cachedModel = """
+import sys
 import biogeme.biogeme as bio
 from biogeme.expressions import Variable, Beta, exp
 from testData import myData1
+padding = [object() for _ in range(int(sys.argv[2]))]
+beta1 = Beta('beta1', -1.0, -3, 3, 0)
+beta2 = Beta('beta2', 2.0, -3, 10, 0)
+likelihood = -beta1**2 * Variable('Variable1') - \\
+    exp(beta2 * beta1) * Variable('Variable2') - beta2**int(sys.argv[3])
+myBiogeme = bio.BIOGEME(myData1, likelihood, cacheDirectory=sys.argv[1])
+print(myBiogeme.calculateInitLikelihood())
+"""
+
+def runCachedModel(cache, padding, power=2):
+    here = os.path.dirname(os.path.abspath(__file__))
+    out = subprocess.run([sys.executable, '-c', cachedModel,
+                          cache, str(padding), str(power)],
+                         cwd=here, check=True,
+                         capture_output=True, text=True)
+    return float(out.stdout.split()[-1])
+
+def cachedFormulas(cache):
+    return sorted(f for f in os.listdir(cache) if f.endswith('.bin'))
 
 class testBiogeme(unittest.TestCase):
     def setUp(self):
@@ -101,5 +139,333 @@ class testBiogeme(unittest.TestCase):
         self.assertLess(left.loc[0, 'loglike'], s.loc[0, 'loglike'])
         self.assertGreater(right.loc[0, 'loglike'], s.loc[0, 'loglike'])
 
+    def test_sampleWithZeroWeights(self):
+        weights = [0.0, 1.0, 0.0, 2.0, 3.0]
+        for s in range(20):
+            self.myBiogeme.theC.setSeed(s)
+            self.myBiogeme.theC.sampleWithoutReplacement(0.6, weights)
+            self.assertListEqual(self.myBiogeme.theC.getSample(), [1, 3, 4])
+        self.myBiogeme.theC.useFullSample()
+        self.assertListEqual(self.myBiogeme.theC.getSample(), [0, 1, 2, 3, 4])
+
+    def test_sharedDatabase(self):
+        data = db.Database('test', df1.copy())
+        beta1 = Beta('beta1', -1.0, -3, 3, 0)
+        beta2 = Beta('beta2', 2.0, -3, 10, 0)
+        first = bio.BIOGEME(data, beta1 * Variable('Variable1'))
+        # The variables that are not used by the first model are
+        # still available for the second one.
+        second = bio.BIOGEME(data, beta2 * Variable('Variable2'))
+        self.assertListEqual(list(data.data.columns), list(df1.columns))
+        self.assertEqual(first.calculateInitLikelihood(), -15.0)
+        self.assertEqual(second.calculateInitLikelihood(), 300.0)
+
+    def test_rebindData(self):
+        x = self.myBiogeme.betaInitValues
+        first = self.myBiogeme.calculateLikelihood(x, scaled=False)
+        columns = self.myBiogeme.engineColumns
+        # The formulas already parsed are evaluated on the new data.
+        self.myBiogeme.theC.setData(myData2.data[columns])
+        res = self.myBiogeme.calculateLikelihood(x, scaled=False)
+        self.assertAlmostEqual(res, -230.0 - 1500.0 * np.exp(-2.0), 8)
+        other = bio.BIOGEME(myData2, self.myBiogeme.loglike)
+        self.assertAlmostEqual(res, other.calculateLikelihood(x, scaled=False), 8)
+        self.myBiogeme.theC.setData(myData1.data[columns])
+        res = self.myBiogeme.calculateLikelihood(x, scaled=False)
+        self.assertEqual(res, first)
+
+    def test_modelCache(self):
+        with tempfile.TemporaryDirectory() as cache:
+            first = runCachedModel(cache, 0)
+            files = cachedFormulas(cache)
+            self.assertEqual(len(files), 1)
+            created = os.path.getmtime(os.path.join(cache, files[0]))
+            second = runCachedModel(cache, 1000)
+            # The second run loads the file written by the first one.
+            self.assertListEqual(cachedFormulas(cache), files)
+            self.assertEqual(os.path.getmtime(os.path.join(cache, files[0])),
+                             created)
+            self.assertEqual(first, second)
+
+    def test_modelCacheCollision(self):
+        with tempfile.TemporaryDirectory() as cache:
+            runCachedModel(cache, 0, 2)
+            other = cachedFormulas(cache)[0]
+            expected = runCachedModel(cache, 0, 4)
+            current = [f for f in cachedFormulas(cache) if f != other][0]
+            currentFile = os.path.join(cache, current)
+            with open(currentFile, 'rb') as f:
+                content = f.read()
+            # The file of the formula is replaced by the file of
+            # another formula, as if their hashes were equal.
+            shutil.copyfile(os.path.join(cache, other), currentFile)
+            self.assertEqual(runCachedModel(cache, 1000, 4), expected)
+            with open(currentFile, 'rb') as f:
+                self.assertEqual(f.read(), content)
+
+    def test_drawCache(self):
+        Variable1 = Variable('Variable1')
+        beta1 = Beta('beta1', 0.0, -3, 3, 0)
+        omega = bioDraws('omega', 'NORMAL')
+        prob = MonteCarlo(1.0 / (1.0 + exp((beta1 + omega) * Variable1)))
+        for seed, expected in [(None, 0), (10, 1)]:
+            with tempfile.TemporaryDirectory() as cache:
+                data = db.Database('test', df1.copy())
+                bio.BIOGEME(data, log(prob), numberOfDraws=10,
+                            seed=seed, cacheDirectory=cache)
+                files = [f for f in os.listdir(cache)
+                         if f.startswith('biogeme_draws_')]
+                # Without a seed, the draws are not stored.
+                self.assertEqual(len(files), expected)
+
+    def threadsDerivatives(self, panel, threads):
+        data = db.Database('test', df1.copy())
+        if panel:
+            data.panel('Person')
+        beta1 = Beta('beta1', 0.5, None, None, 0)
+        sigma = Beta('sigma', 1.5, None, None, 0)
+        omega = RandomVariable('omega')
+        xi = bioDraws('xi', 'NORMAL_HALTON2')
+        V = {1: (beta1 + sigma * omega) * Variable('Variable1') / 10,
+             2: (sigma * xi - beta1) * Variable('Variable2') / 100,
+             3: 0}
+        av = {1: 1, 2: Variable('Av2'), 3: Variable('Av3')}
+        P = exp(models.loglogit(V, av, Variable('Choice')))
+        if panel:
+            P = PanelLikelihoodTrajectory(P)
+        # The draws, the random variable and the rows are part of the
+        # state of each thread.
+        P = Integrate(P * exp(-omega * omega / 2) / np.sqrt(2 * np.pi), 'omega')
+        myBiogeme = bio.BIOGEME(data, log(MonteCarlo(P)), numberOfDraws=20,
+                                numberOfThreads=threads)
+        return myBiogeme.calculateLikelihoodAndDerivatives(myBiogeme.betaInitValues,
+                                                           scaled=False,
+                                                           hessian=True,
+                                                           bhhh=True)
+
+    def compareThreads(self, panel):
+        single = self.threadsDerivatives(panel, 1)
+        for threads in [2, 5]:
+            shared = self.threadsDerivatives(panel, threads)
+            for i, j in zip(shared, single):
+                np.testing.assert_allclose(i, j, rtol=1.0e-10)
+
+    def test_sharedFormula(self):
+        self.compareThreads(False)
+
+    def test_panelSharedFormula(self):
+        self.compareThreads(True)
+
+    def mixedLogitDerivatives(self, panel, fused):
+        data = db.Database('test', df1.copy())
+        if panel:
+            data.panel('Person')
+        beta1 = Beta('beta1', 0.5, None, None, 0)
+        sigma = Beta('sigma', 1.5, None, None, 0)
+        omega = bioDraws('omega', 'NORMAL_HALTON2')
+        V = {1: (beta1 + sigma * omega) * Variable('Variable1') / 10,
+             2: -beta1 * Variable('Variable2') / 100,
+             3: sigma * 0}
+        av = {1: 1, 2: Variable('Av2'), 3: Variable('Av3')} if panel else None
+        L = models.loglogit(V, av, Variable('Choice'))
+        # The product by one prevents the fusion of the mixed logit.
+        P = exp(L) if fused else exp(L) * 1
+        if panel:
+            P = PanelLikelihoodTrajectory(P)
+        myBiogeme = bio.BIOGEME(data, log(MonteCarlo(P)), numberOfDraws=20)
+        return myBiogeme.calculateLikelihoodAndDerivatives(myBiogeme.betaInitValues,
+                                                           scaled=False,
+                                                           hessian=True,
+                                                           bhhh=True)
+
+    def compareMixedLogit(self, panel):
+        fused = self.mixedLogitDerivatives(panel, True)
+        tree = self.mixedLogitDerivatives(panel, False)
+        for i, j in zip(fused, tree):
+            np.testing.assert_allclose(i, j, rtol=1.0e-10)
+
+    def test_mixedLogit(self):
+        self.compareMixedLogit(False)
+
+    def test_panelMixedLogit(self):
+        self.compareMixedLogit(True)
+
+    def hoistedDerivatives(self, panel, hessian):
+        data = db.Database('test', df1.copy())
+        if panel:
+            data.panel('Person')
+        beta1 = Beta('beta1', 0.5, None, None, 0)
+        beta2 = Beta('beta2', -0.5, None, None, 0)
+        sigma = Beta('sigma', 1.5, None, None, 0)
+        omega = bioDraws('omega', 'NORMAL_HALTON2')
+        # The utility of the second alternative and the scale do not
+        # depend on the draws.
+        V = {1: (beta1 + sigma * omega) * Variable('Variable1') / 10,
+             2: beta2 * Variable('Variable2') / 100,
+             3: -beta1}
+        av = {1: 1, 2: Variable('Av2'), 3: Variable('Av3')}
+        scale = exp(-beta2 ** 2 * Variable('Variable1') / 10)
+        P = exp(models.loglogit(V, av, Variable('Choice'))) * scale
+        if panel:
+            P = PanelLikelihoodTrajectory(P)
+        myBiogeme = bio.BIOGEME(data, log(MonteCarlo(P)), numberOfDraws=300)
+        # The draw-invariant subexpressions are evaluated once per
+        # row only when the hessian is not requested.
+        f, g, _, _ = myBiogeme.calculateLikelihoodAndDerivatives(myBiogeme.betaInitValues,
+                                                                 scaled=False,
+                                                                 hessian=hessian)
+        return f, g
+
+    def compareHoisted(self, panel):
+        f, g = self.hoistedDerivatives(panel, False)
+        fd, gd = self.hoistedDerivatives(panel, True)
+        self.assertAlmostEqual(f, fd, 10)
+        np.testing.assert_allclose(g, gd, rtol=1.0e-10)
+
+    def test_hoisting(self):
+        self.compareHoisted(False)
+
+    def test_panelHoisting(self):
+        self.compareHoisted(True)
+
+    def splitDrawsDerivatives(self, threads):
+        data = db.Database('test', df1.copy())
+        data.panel('Person')
+        beta1 = Beta('beta1', 0.5, None, None, 0)
+        sigma = Beta('sigma', 1.5, None, None, 0)
+        omega = bioDraws('omega', 'NORMAL_HALTON2')
+        V = {1: (beta1 + sigma * omega) * Variable('Variable1') / 10,
+             2: -beta1 * Variable('Variable2') / 100,
+             3: 0}
+        av = {1: 1, 2: Variable('Av2'), 3: Variable('Av3')}
+        P = PanelLikelihoodTrajectory(exp(models.loglogit(V, av, Variable('Choice'))))
+        myBiogeme = bio.BIOGEME(data, log(MonteCarlo(P)), numberOfDraws=1000,
+                                numberOfThreads=threads)
+        f, g, _, bhhh = myBiogeme.calculateLikelihoodAndDerivatives(myBiogeme.betaInitValues,
+                                                                    scaled=False,
+                                                                    hessian=False,
+                                                                    bhhh=True)
+        return f, g, bhhh
+
+    def test_splitDraws(self):
+        # With two individuals, the draws of each individual are
+        # shared among the threads.
+        single = self.splitDrawsDerivatives(1)
+        split = self.splitDrawsDerivatives(4)
+        for i, j in zip(split, single):
+            np.testing.assert_allclose(i, j, rtol=1.0e-10)
+
+    def sparseLogitDerivatives(self, ids, precomputed, mixed=False):
+        rng = np.random.RandomState(2026)
+        rows = 50
+        # Few alternatives are available, including the chosen one.
+        av = rng.uniform(size=(rows, len(ids))) < 0.2
+        chosen = rng.randint(len(ids), size=rows)
+        av[np.arange(rows), chosen] = True
+        columns = {'Choice': [ids[c] for c in chosen]}
+        for k in range(len(ids)):
+            columns[f'x{k}'] = rng.uniform(size=rows)
+            columns[f'av{k}'] = av[:, k].astype(float)
+        data = db.Database('sparse', pd.DataFrame(columns))
+        beta1 = Beta('beta1', 0.5, None, None, 0)
+        beta2 = Beta('beta2', -0.5, None, None, 0)
+        sigma = Beta('sigma', 1.5, None, None, 0)
+        one = Beta('one', 1, None, None, 1)
+        omega = bioDraws('omega', 'NORMAL_HALTON2')
+        V = {i: beta1 * Variable(f'x{k}') + beta2 * k / len(ids)
+             for k, i in enumerate(ids)}
+        if mixed:
+            V[ids[0]] = V[ids[0]] + sigma * omega
+        # An availability that depends on a parameter is evaluated at
+        # each iteration.
+        A = {i: Variable(f'av{k}') if precomputed else Variable(f'av{k}') * one
+             for k, i in enumerate(ids)}
+        L = models.loglogit(V, A, Variable('Choice'))
+        if mixed:
+            L = log(MonteCarlo(exp(L)))
+        myBiogeme = bio.BIOGEME(data, L, numberOfDraws=50)
+        f, g, _, bhhh = myBiogeme.calculateLikelihoodAndDerivatives(myBiogeme.betaInitValues,
+                                                                    scaled=False,
+                                                                    hessian=False,
+                                                                    bhhh=True)
+        return f, g, bhhh
+
+    def compareSparseLogit(self, mixed):
+        ids = list(range(1, 31))
+        precomputed = self.sparseLogitDerivatives(ids, True, mixed)
+        evaluated = self.sparseLogitDerivatives(ids, False, mixed)
+        for i, j in zip(precomputed, evaluated):
+            np.testing.assert_allclose(i, j, rtol=1.0e-12)
+
+    def test_sparseLogit(self):
+        self.compareSparseLogit(False)
+
+    def test_sparseMixedLogit(self):
+        self.compareSparseLogit(True)
+
+    def test_largeAlternativeIds(self):
+        # The positions of large and sparse ids are found by a binary
+        # search instead of a table.
+        small = list(range(1, 31))
+        large = [1000 * i + 7 for i in small]
+        for mixed in [False, True]:
+            expected = self.sparseLogitDerivatives(small, True, mixed)
+            for precomputed in [True, False]:
+                res = self.sparseLogitDerivatives(large, precomputed, mixed)
+                for i, j in zip(res, expected):
+                    np.testing.assert_allclose(i, j, rtol=1.0e-12)
+
+    def latentClassDerivatives(self, native):
+        data = db.Database('test', df1.copy())
+        data.panel('Person')
+        beta1 = Beta('beta1', 0.5, None, None, 0)
+        beta2 = Beta('beta2', -0.5, None, None, 0)
+        gamma = Beta('gamma', 0.2, None, None, 0)
+        Variable1 = Variable('Variable1')
+        Variable2 = Variable('Variable2')
+        V = {1: beta1 * Variable1 / 10,
+             2: beta2 * Variable2 / 100,
+             3: -beta1}
+        W = {1: beta1 * Variable1 / 100,
+             2: beta2 * Variable2 / 1000,
+             3: -gamma}
+        av = {1: 1, 2: Variable('Av2'), 3: Variable('Av3')}
+        # The membership depends only on the individual.
+        W1 = {1: 0.0, 2: gamma * Variable('Person')}
+        L = {1: models.loglogit(V, av, Variable('Choice')),
+             2: models.loglogit(W, av, Variable('Choice'))}
+        if native:
+            loglike = models.loglatentclass(W1, L, panel=True)
+        else:
+            loglike = log(models.logit(W1, None, 1) *
+                          PanelLikelihoodTrajectory(exp(L[1])) +
+                          models.logit(W1, None, 2) *
+                          PanelLikelihoodTrajectory(exp(L[2])))
+        myBiogeme = bio.BIOGEME(data, loglike)
+        return myBiogeme.calculateLikelihoodAndDerivatives(myBiogeme.betaInitValues,
+                                                           scaled=False,
+                                                           hessian=True,
+                                                           bhhh=True)
+
+    def test_panelLatentClass(self):
+        native = self.latentClassDerivatives(True)
+        tree = self.latentClassDerivatives(False)
+        for i, j in zip(native, tree):
+            np.testing.assert_allclose(i, j, rtol=1.0e-10)
+
+    def test_estimateAdaptiveDraws(self):
+        Variable1 = Variable('Variable1')
+        beta1 = Beta('beta1', 0.0, -3, 3, 0)
+        sigma = Beta('sigma', 1.0, -3, 3, 0)
+        omega = bioDraws('omega', 'NORMAL')
+        prob = MonteCarlo(1.0 / (1.0 + exp((beta1 + sigma * omega) * Variable1)))
+        myBiogeme = bio.BIOGEME(myData1, log(prob), numberOfDraws=400, seed=10)
+        myBiogeme.generateHtml = False
+        myBiogeme.generatePickle = False
+        direct = myBiogeme.estimate(saveIterations=None)
+        adaptive = myBiogeme.estimate(saveIterations=None,
+                                      initialNumberOfDraws=50)
+        self.assertAlmostEqual(adaptive.data.logLike, direct.data.logLike, 4)
+
 if __name__ == '__main__':
     unittest.main()
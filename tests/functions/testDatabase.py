@@ -15,12 +15,16 @@ Test the database module
 # pylint: disable=missing-function-docstring, missing-class-docstring
 
 import os
+import tempfile
 import unittest
 
 from copy import deepcopy
 from pathlib import Path
 import numpy as np
-from biogeme.expressions import Variable, bioDraws
+import biogeme.biogeme as bio
+import biogeme.exceptions as excep
+import biogeme.models as models
+from biogeme.expressions import Variable, Beta, bioDraws, MonteCarlo
 from testData import myData1
 
 class testDatabase(unittest.TestCase):
@@ -84,6 +88,84 @@ class testDatabase(unittest.TestCase):
         dim = theDrawsTable.shape
         self.assertTupleEqual(dim, (5, 10, 2))
 
+    def test_generateNativeDraws(self):
+        randomDraws1 = bioDraws('randomDraws1', 'UNIFORM_RHALTON3')
+        randomDraws2 = bioDraws('randomDraws2', 'NORMAL_MLHS_ANTI')
+        x = randomDraws1 + randomDraws2
+        types = x.dictOfDraws()
+        theDrawsTable = myData1.generateDraws(types, ['randomDraws1', 'randomDraws2'], 10)
+        dim = theDrawsTable.shape
+        self.assertTupleEqual(dim, (5, 10, 2))
+        self.assertTrue(np.min(theDrawsTable[:, :, 0]) > 0)
+        self.assertTrue(np.max(theDrawsTable[:, :, 0]) < 1)
+        antithetic = theDrawsTable[:, :5, 1] + theDrawsTable[:, 5:, 1]
+        self.assertAlmostEqual(np.max(np.abs(antithetic)), 0, 10)
+
+    def drawsDerivatives(self, seed=10, **kwargs):
+        beta1 = Beta('beta1', 0.5, None, None, 0)
+        sigma = Beta('sigma', 1.5, None, None, 0)
+        omega1 = bioDraws('omega1', 'NORMAL_MLHS')
+        omega2 = bioDraws('omega2', 'UNIFORM')
+        V = {1: (beta1 + sigma * omega1) * self.Variable1 / 10,
+             2: -beta1 * omega2 * self.Variable2 / 100,
+             3: 0}
+        av = {1: 1, 2: self.Av2, 3: self.Av3}
+        prob = MonteCarlo(models.logit(V, av, self.Choice))
+        myBiogeme = bio.BIOGEME(myData1, prob, numberOfDraws=200,
+                                seed=seed, **kwargs)
+        f, g, _, _ = myBiogeme.calculateLikelihoodAndDerivatives(myBiogeme.betaInitValues,
+                                                                 scaled=False,
+                                                                 hessian=False)
+        return [f] + g.tolist()
+
+    def test_drawGenerator(self):
+        # The draws generated when they are needed depend only on the
+        # individual, the draw and the variable.
+        reference = self.drawsDerivatives(storeDraws=False, numberOfThreads=1)
+        for threads in [1, 2, 4]:
+            result = self.drawsDerivatives(storeDraws=False, numberOfThreads=threads)
+            np.testing.assert_allclose(result, reference, rtol=1.0e-12)
+        other = self.drawsDerivatives(storeDraws=False, seed=11)
+        self.assertNotAlmostEqual(other[0], reference[0], 5)
+
+    def test_singlePrecisionDraws(self):
+        double = self.drawsDerivatives()
+        single = self.drawsDerivatives(singlePrecisionDraws=True)
+        np.testing.assert_allclose(single, double, rtol=1.0e-6)
+
+    def test_cachedDraws(self):
+        # The draws in the cache are those of the generator.
+        reference = self.drawsDerivatives(storeDraws=False)
+        with tempfile.TemporaryDirectory() as cache:
+            # The first run stores the draws, the second one maps them.
+            for _ in range(2):
+                result = self.drawsDerivatives(cacheDirectory=cache)
+                np.testing.assert_allclose(result, reference, rtol=1.0e-12)
+            single = self.drawsDerivatives(cacheDirectory=cache,
+                                           singlePrecisionDraws=True)
+            np.testing.assert_allclose(single, reference, rtol=1.0e-6)
+            self.assertEqual(len([f for f in os.listdir(cache)
+                                  if f.startswith('biogeme_draws_')]), 2)
+
+    def test_generateSharedDraws(self):
+        randomDraws1 = bioDraws('randomDraws1', 'UNIFORM_SHALTON2')
+        randomDraws2 = bioDraws('randomDraws2', 'UNIFORM_SHALTON3')
+        x = randomDraws1 + randomDraws2
+        types = x.dictOfDraws()
+        names = ['randomDraws1', 'randomDraws2']
+        np.random.seed(10)
+        base, shifts = myData1.generateSharedDraws(types, names, 10)
+        self.assertTupleEqual(base.shape, (10, 2))
+        self.assertTupleEqual(shifts.shape, (5, 2))
+        # Same draws as the full table generated with the same seed
+        np.random.seed(10)
+        theDrawsTable = myData1.generateDraws(types, names, 10)
+        shifted = np.mod(base[np.newaxis, :, :] + shifts[:, np.newaxis, :], 1.0)
+        self.assertAlmostEqual(np.max(np.abs(theDrawsTable - shifted)), 0, 10)
+        types['randomDraws2'] = 'NORMAL'
+        with self.assertRaises(excep.biogemeError):
+            myData1.generateSharedDraws(types, names, 10)
+
     def test_setRandomGenerators(self):
         def logNormalDraws(sampleSize, numberOfDraws):
             return np.exp(np.random.randn(sampleSize, numberOfDraws))
@@ -148,5 +230,12 @@ class testDatabase(unittest.TestCase):
         dim = res.shape
         self.assertTupleEqual(dim, (10, 2))
 
+    def test_getSamplingWeights(self):
+        w = myData1.getSamplingWeights('Variable1').tolist()
+        self.assertListEqual(w, [1, 2, 3, 4, 5])
+        self.myPanelData.panel('Person')
+        w = self.myPanelData.getSamplingWeights('Variable1').tolist()
+        self.assertListEqual(w, [1, 4])
+
 if __name__ == '__main__':
     unittest.main()
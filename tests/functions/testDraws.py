@@ -207,5 +207,28 @@ class testDraws(unittest.TestCase):
         mean = np.linalg.norm(np.average(draws, axis=1))
         self.assertAlmostEqual(mean, 0, 5)
 
+    def test_normalTails(self):
+        unif = np.array([0.001, 0.02, 0.5, 0.98, 0.999])
+        draws = dr.getNormalWichuraDraws(sampleSize=1,
+                                         numberOfDraws=5,
+                                         uniformNumbers=unif)
+        q = [-3.090232306167813,
+             -2.053748910631823,
+             0.0,
+             2.053748910631823,
+             3.090232306167813]
+        for a, b in zip(q, draws[0].tolist()):
+            self.assertAlmostEqual(a, b, 10)
+
+    def test_normalBounds(self):
+        unif = np.array([0.0, 1.0e-300, 1.0 - 1.0e-16, 1.0])
+        draws = dr.getNormalWichuraDraws(sampleSize=1,
+                                         numberOfDraws=4,
+                                         uniformNumbers=unif)
+        self.assertTrue(np.isfinite(draws).all())
+        self.assertTrue(np.all(np.diff(draws[0]) >= 0))
+        self.assertLess(draws[0, 0], -37)
+        self.assertGreater(draws[0, 3], 8)
+
 if __name__ == '__main__':
     unittest.main()
@@ -15,8 +15,14 @@ Test the expressions module
 # pylint: disable=missing-function-docstring, missing-class-docstring
 
 import unittest
+import numpy as np
+import pandas as pd
+import biogeme.biogeme as bio
+import biogeme.cbiogeme as cb
+import biogeme.database as db
 import biogeme.expressions as ex
 import biogeme.models as models
+import biogeme.exceptions as excep
 from testData import myData2
 
 class testExpressions(unittest.TestCase):
@@ -89,6 +95,29 @@ class testExpressions(unittest.TestCase):
         s = expr2.getSignature()
         self.assertEqual(len(s), 17)
 
+    def test_signatureParser(self):
+        # The numeric constants keep double precision.
+        value = 0.1234567890123456789
+        expr = ex.Numeric(value) * self.Variable1
+        res = expr.getValue_c(self.myData)
+        for r, v in zip(res, self.myData.data['Variable1']):
+            self.assertEqual(r, value * v)
+        expr = self.beta1 * self.Variable1
+        expr._prepareFormulaForEvaluation(self.myData)
+        s = expr.getSignature()
+        theC = cb.pyBiogeme()
+        theC.setData(self.myData.data)
+        # A missing child, a truncated signature and a wrong number of
+        # children are reported.
+        for wrong in [s[1:],
+                      s[:2] + [s[2][:30]],
+                      s[:2] + [s[2].replace(b'(2)', b'(3)')]]:
+            with self.assertRaises(RuntimeError):
+                theC.simulateFormula(wrong,
+                                     expr.freeBetaValues,
+                                     expr.fixedBetaValues,
+                                     self.myData.data)
+
     def test_expr3(self):
         myDraws = ex.bioDraws('myDraws', 'UNIFORM')
         expr3 = ex.MonteCarlo(myDraws * myDraws)
@@ -109,6 +138,36 @@ class testExpressions(unittest.TestCase):
         for v in res:
             self.assertAlmostEqual(v, 1.0 / 3.0, 2)
 
+    def test_expr4Order(self):
+        omega = ex.RandomVariable('omega')
+        x = 1 / (1 + ex.exp(-omega))
+        dx = ex.exp(-omega) * (1 + ex.exp(-omega))**(-2)
+        integrand = x * x
+        expr20 = ex.Integrate(integrand * dx, 'omega', order=20)
+        res = expr20.getValue_c(self.myData)
+        for v in res:
+            self.assertAlmostEqual(v, 1.0 / 3.0, 2)
+        expr10 = ex.Integrate(integrand * dx, 'omega', order=10, adaptive=True)
+        res = expr10.getValue_c(self.myData)
+        for v in res:
+            self.assertAlmostEqual(v, 1.0 / 3.0, 2)
+        with self.assertRaises(excep.biogemeError):
+            ex.Integrate(integrand * dx, 'omega', order=7)
+
+    def test_multipleIntegrate(self):
+        omega1 = ex.RandomVariable('omega1')
+        omega2 = ex.RandomVariable('omega2')
+        density = ex.exp(-(omega1 * omega1 + omega2 * omega2) / 2) / (2 * 3.141592653589793)
+        expr = ex.MultipleIntegrate((omega1 * omega1 + omega2 * omega2) * density,
+                                    ['omega1', 'omega2'], level=2)
+        res = expr.getValue_c(self.myData)
+        for v in res:
+            self.assertAlmostEqual(v, 2.0, 10)
+        with self.assertRaises(excep.biogemeError):
+            ex.MultipleIntegrate(density, ['omega1', 'omega1'])
+        with self.assertRaises(excep.biogemeError):
+            ex.MultipleIntegrate(density, ['omega1', 'omega2'], level=0)
+
     def test_expr5(self):
         expr1 = 2 * self.beta1 - ex.exp(-self.beta2) / (self.beta3 * (self.beta2 >= self.beta1))
         expr2 = 2 * self.beta1 * self.Variable1 - ex.exp(-self.beta2 * self.Variable2) / \
@@ -160,6 +219,144 @@ class testExpressions(unittest.TestCase):
         for v in res:
             self.assertAlmostEqual(v, -0.8446375965030364, 5)
 
+    def test_logit_sampled(self):
+        V = {1: self.beta1 * self.Variable1 / 10,
+             2: -self.beta2 * self.Variable2 / 10,
+             3: -self.beta1}
+        av = {1: self.Av1, 2: self.Av2, 3: self.Av3}
+        onlyChosen = models.loglogit_sampled(V, av, 2, 0)
+        for i in onlyChosen.getValue_c(self.myData):
+            self.assertAlmostEqual(i, 0.0, 10)
+        weights = {1: 1.0, 2: 2.0, 3: 0.5}
+        sampled = models.loglogit_sampled(V, av, 2, 20, weights, seed=3)
+        first = sampled.getValue_c(self.myData)
+        second = sampled.getValue_c(self.myData)
+        self.assertListEqual(first, second)
+        for i in first:
+            self.assertLessEqual(i, 0.0)
+        with self.assertRaises(excep.biogemeError):
+            models.loglogit_sampled(V, av, 2, 20, {1: 1.0, 2: 0.0, 3: 1.0})
+
+    def test_nested(self):
+        mu = ex.Beta('mu', 1.5, None, None, 0)
+        V = {1: self.beta1 * self.Variable1 / 10,
+             2: -self.beta2 * self.Variable2 / 10,
+             3: -self.beta1}
+        av = {1: self.Av1, 2: self.Av2, 3: self.Av3}
+        nests = (mu, [1, 2]), (1.0, [3])
+        native = models.lognested(V, av, nests, 1)
+        logGi = models.getMevForNested(V, av, nests)
+        tree = models.logmev(V, logGi, av, 1)
+        for i, j in zip(native.getValue_c(self.myData),
+                        tree.getValue_c(self.myData)):
+            self.assertAlmostEqual(i, j, 10)
+        for i, j in zip(ex.Derive(native, 'mu').getValue_c(self.myData),
+                        ex.Derive(tree, 'mu').getValue_c(self.myData)):
+            self.assertAlmostEqual(i, j, 10)
+        with self.assertRaises(excep.biogemeError):
+            models.lognested(V, av, ((mu, [1, 2]), (1.0, [2, 3])), 1)
+
+    def test_cnl(self):
+        mu = ex.Beta('mu', 1.5, None, None, 0)
+        alpha = ex.Beta('alpha', 0.3, None, None, 0)
+        V = {1: self.beta1 * self.Variable1 / 10,
+             2: -self.beta2 * self.Variable2 / 10,
+             3: -self.beta1}
+        av = {1: self.Av1, 2: self.Av2, 3: self.Av3}
+        nests = (mu, {1: 1.0, 2: alpha}), (1.0, {2: 1 - alpha, 3: 1.0})
+        native = models.logcnl(V, av, nests, 2)
+        logGi = models.getMevForCrossNested(V, av, nests)
+        tree = models.logmev(V, logGi, av, 2)
+        for i, j in zip(native.getValue_c(self.myData),
+                        tree.getValue_c(self.myData)):
+            self.assertAlmostEqual(i, j, 10)
+        for b in ['mu', 'alpha']:
+            for i, j in zip(ex.Derive(native, b).getValue_c(self.myData),
+                            ex.Derive(tree, b).getValue_c(self.myData)):
+                self.assertAlmostEqual(i, j, 10)
+
+    def test_networkgev(self):
+        mu = ex.Beta('mu', 1.5, None, None, 0)
+        alpha = ex.Beta('alpha', 0.3, None, None, 0)
+        V = {1: self.beta1 * self.Variable1 / 10,
+             2: -self.beta2 * self.Variable2 / 10,
+             3: -self.beta1}
+        av = {1: self.Av1, 2: self.Av2, 3: self.Av3}
+        nests = (mu, {1: 1.0, 2: alpha}), (1.0, {2: 1 - alpha, 3: 1.0})
+        network = {'root': (1.0, {'a': 1.0, 'b': 1.0}),
+                   'a': (mu, {1: 1.0, 2: alpha ** mu}),
+                   'b': (1.0, {2: 1 - alpha, 3: 1.0})}
+        correction = {1: 0.1 * self.beta1, 2: 0.0, 3: -0.2}
+        logGi = models.getMevForCrossNested(V, av, nests)
+        native = models.lognetworkgev(V, av, network, 2, correction)
+        tree = models.logmev_endogenousSampling(V, logGi, av, correction, 2)
+        for i, j in zip(native.getValue_c(self.myData),
+                        tree.getValue_c(self.myData)):
+            self.assertAlmostEqual(i, j, 10)
+        for b in ['mu', 'alpha', 'beta1']:
+            for i, j in zip(ex.Derive(native, b).getValue_c(self.myData),
+                            ex.Derive(tree, b).getValue_c(self.myData)):
+                self.assertAlmostEqual(i, j, 10)
+        with self.assertRaises(excep.biogemeError):
+            models.lognetworkgev(V, av, {'a': (mu, {1: 1.0, 'b': 1.0}),
+                                         'b': (mu, {2: 1.0, 'a': 1.0})}, 2)
+
+    def test_missingData(self):
+        # The availability of alternative 1 is zero in the first row,
+        # which must not be interpreted as a missing value.
+        res = (self.Av1 * self.Variable1).getValue_c(self.myData)
+        self.assertListEqual(res, [0.0, 20.0, 30.0, 40.0, 50.0])
+        data = db.Database('test', pd.DataFrame({'Variable1': [1, 99999]}))
+        with self.assertRaises(RuntimeError):
+            self.Variable1.getValue_c(data)
+
+    def test_latentclass(self):
+        gamma = ex.Beta('gamma', 0.5, None, None, 0)
+        V = {1: self.beta1 * self.Variable1 / 10,
+             2: -self.beta2 * self.Variable2 / 10,
+             3: -self.beta1}
+        W = {1: self.beta1 * self.Variable1 / 10,
+             2: -self.beta2 * self.Variable2 / 10,
+             3: -gamma}
+        av = {1: self.Av1, 2: self.Av2, 3: self.Av3}
+        W1 = {1: 0.0, 2: gamma * self.Variable2 / 10}
+        L = {1: models.loglogit(V, av, 2),
+             2: models.loglogit(W, av, 2)}
+        native = models.loglatentclass(W1, L)
+        tree = ex.log(models.logit(W1, None, 1) * ex.exp(L[1]) +
+                      models.logit(W1, None, 2) * ex.exp(L[2]))
+        for i, j in zip(native.getValue_c(self.myData),
+                        tree.getValue_c(self.myData)):
+            self.assertAlmostEqual(i, j, 10)
+        for b in ['gamma', 'beta1']:
+            for i, j in zip(ex.Derive(native, b).getValue_c(self.myData),
+                            ex.Derive(tree, b).getValue_c(self.myData)):
+                self.assertAlmostEqual(i, j, 10)
+        with self.assertRaises(excep.biogemeError):
+            models.loglatentclass(W1, {1: L[1], 3: L[2]})
+
+    def test_montecarloBatches(self):
+        sigma = ex.Beta('sigma', 1.5, None, None, 0)
+        omega = ex.bioDraws('omega', 'NORMAL_HALTON2')
+        V = {1: (self.beta1 + sigma * omega) * self.Variable1 / 10,
+             2: -self.beta2 * self.Variable2 / 100,
+             3: 0}
+        av = {1: 1, 2: self.Av2, 3: self.Av3}
+        prob = ex.MonteCarlo(models.logit(V, av, self.Choice))
+        # The last batch of draws is not complete.
+        myBiogeme = bio.BIOGEME(self.myData, prob, numberOfDraws=300)
+        x = myBiogeme.betaInitValues
+        # Without the hessian, the draws are processed by
+        # batches. With the hessian, they are processed one by one.
+        f, g, _, _ = myBiogeme.calculateLikelihoodAndDerivatives(x,
+                                                                 scaled=False,
+                                                                 hessian=False)
+        fd, gd, _, _ = myBiogeme.calculateLikelihoodAndDerivatives(x,
+                                                                   scaled=False,
+                                                                   hessian=True)
+        self.assertAlmostEqual(f, fd, 10)
+        np.testing.assert_allclose(g, gd, rtol=1.0e-10)
+
     def test_expr10(self):
         expr10 = ex.bioNormalCdf(self.Variable1 / 10 - 1)
         res = expr10.getValue_c(self.myData)
@@ -170,6 +367,16 @@ class testExpressions(unittest.TestCase):
                               0.9999683287581669]):
             self.assertAlmostEqual(i, j, 5)
 
+    def test_expr10Pdf(self):
+        expr10 = ex.bioNormalPdf(self.Variable1 / 10 - 1)
+        res = expr10.getValue_c(self.myData)
+        for i, j in zip(res, [0.3989422804014327,
+                              0.24197072451914337,
+                              0.05399096651318806,
+                              0.0044318484119380075,
+                              0.00013383022576488537]):
+            self.assertAlmostEqual(i, j, 10)
+
     def test_expr11(self):
         expr1 = 2 * self.beta1 - ex.exp(-self.beta2) / (self.beta3 * (self.beta2 >= self.beta1))
         expr2 = 2 * self.beta1 * self.Variable1 - ex.exp(-self.beta2 * self.Variable2) / \
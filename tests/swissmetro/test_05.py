@@ -83,7 +83,7 @@ class test_05(unittest.TestCase):
     def testEstimation(self):
         biogeme = bio.BIOGEME(database,logprob,seed=10,numberOfDraws=5)
         results = biogeme.estimate()
-        self.assertAlmostEqual(results.data.logLike,-5310.590444447898,2)
+        self.assertAlmostEqual(results.data.logLike,-5310.565013868023,2)
 
 if __name__ == '__main__':
     unittest.main()
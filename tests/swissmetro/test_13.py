@@ -80,7 +80,7 @@ class test_13(unittest.TestCase):
     def testEstimation(self):
         biogeme  = bio.BIOGEME(database,logprob,numberOfDraws=5,seed=10)
         results = biogeme.estimate()
-        self.assertAlmostEqual(results.data.logLike,-4557.1998156795935,2)
+        self.assertAlmostEqual(results.data.logLike,-4557.267106520507,2)
     
 if __name__ == '__main__':
     unittest.main()
@@ -98,7 +98,7 @@ class test_15(unittest.TestCase):
     def testEstimation(self):
         biogeme = bio.BIOGEME(database,logprob,numberOfDraws=5,seed=10)
         results = biogeme.estimate()
-        self.assertAlmostEqual(results.data.logLike,-4104.417442345575,2)
+        self.assertAlmostEqual(results.data.logLike,-4104.486455769781,2)
     
 if __name__ == '__main__':
     unittest.main()
@@ -111,7 +111,7 @@ class test_16(unittest.TestCase):
     def testEstimation(self):
         biogeme = bio.BIOGEME(database,logprob,numberOfDraws=5,seed=10)
         results = biogeme.estimate()
-        self.assertAlmostEqual(results.data.logLike,-4102.692581020569,2)
+        self.assertAlmostEqual(results.data.logLike,-4102.756872561732,2)
 
     
 if __name__ == '__main__':
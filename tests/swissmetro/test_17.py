@@ -85,7 +85,7 @@ class test_17(unittest.TestCase):
     def testEstimation(self):
         biogeme = bio.BIOGEME(database,logprob,numberOfDraws=5,seed=10)
         results = biogeme.estimate()
-        self.assertAlmostEqual(results.data.logLike,-5312.735685567558,2)
+        self.assertAlmostEqual(results.data.logLike,-5312.7007411477225,2)
     
 if __name__ == '__main__':
     unittest.main()